@@ -49,7 +49,9 @@ LLCharacter::LLCharacter()
 	mPreferredPelvisHeight( 0.f ),
 	mSex( SEX_FEMALE ),
 	mAppearanceSerialNum( 0 ),
-	mSkeletonSerialNum( 0 )
+	mSkeletonSerialNum( 0 ),
+	mVisualParamsPending( FALSE ),
+	mCurParamIndex( 0 )
 {
 	mMotionController.setCharacter( this );
 	sInstances.push_back(this);
@@ -197,6 +199,33 @@ void LLCharacter::updateMotions(e_update_t update_type)
 	}
 }
 
+//-----------------------------------------------------------------------------
+// beginMotionUpdate()
+//-----------------------------------------------------------------------------
+BOOL LLCharacter::beginMotionUpdate(e_update_t update_type)
+{
+	llassert(update_type != HIDDEN_UPDATE);
+	LLFastTimer t(FTM_UPDATE_ANIMATION);
+	if (mMotionController.isPaused() && mPauseRequest->getNumRefs() == 1)
+	{
+		mMotionController.unpauseAllMotions();
+	}
+	return mMotionController.beginUpdate(update_type == FORCE_UPDATE);
+}
+
+//-----------------------------------------------------------------------------
+// commitMotionUpdate()
+//-----------------------------------------------------------------------------
+void LLCharacter::commitMotionUpdate()
+{
+	mMotionController.commitUpdate();
+	if (mVisualParamsPending)
+	{
+		mVisualParamsPending = FALSE;
+		updateVisualParams();
+	}
+}
+
 
 //-----------------------------------------------------------------------------
 // deactivateAllMotions()
@@ -271,11 +300,10 @@ void LLCharacter::removeAnimationData(std::string name)
 //-----------------------------------------------------------------------------
 BOOL LLCharacter::setVisualParamWeight(LLVisualParam* which_param, F32 weight, BOOL upload_bake)
 {
-	S32 index = which_param->getID();
-	visual_param_index_map_t::iterator index_iter = mVisualParamIndexMap.find(index);
-	if (index_iter != mVisualParamIndexMap.end())
+	LLVisualParam* param = mVisualParams.find(which_param->getID());
+	if (param)
 	{
-		index_iter->second->setWeight(weight, upload_bake);
+		param->setWeight(weight, upload_bake);
 		return TRUE;
 	}
 	return FALSE;
@@ -304,10 +332,10 @@ BOOL LLCharacter::setVisualParamWeight(const char* param_name, F32 weight, BOOL
 //-----------------------------------------------------------------------------
 BOOL LLCharacter::setVisualParamWeight(S32 index, F32 weight, BOOL upload_bake)
 {
-	visual_param_index_map_t::iterator index_iter = mVisualParamIndexMap.find(index);
-	if (index_iter != mVisualParamIndexMap.end())
+	LLVisualParam* param = mVisualParams.find(index);
+	if (param)
 	{
-		index_iter->second->setWeight(weight, upload_bake);
+		param->setWeight(weight, upload_bake);
 		return TRUE;
 	}
 	llwarns << "LLCharacter::setVisualParamWeight() Invalid visual parameter index: " << index << llendl;
@@ -320,10 +348,10 @@ BOOL LLCharacter::setVisualParamWeight(S32 index, F32 weight, BOOL upload_bake)
 F32 LLCharacter::getVisualParamWeight(LLVisualParam *which_param)
 {
 	S32 index = which_param->getID();
-	visual_param_index_map_t::iterator index_iter = mVisualParamIndexMap.find(index);
-	if (index_iter != mVisualParamIndexMap.end())
+	LLVisualParam* param = mVisualParams.find(index);
+	if (param)
 	{
-		return index_iter->second->getWeight();
+		return param->getWeight();
 	}
 	else
 	{
@@ -354,10 +382,10 @@ F32 LLCharacter::getVisualParamWeight(const char* param_name)
 //-----------------------------------------------------------------------------
 F32 LLCharacter::getVisualParamWeight(S32 index)
 {
-	visual_param_index_map_t::iterator index_iter = mVisualParamIndexMap.find(index);
-	if (index_iter != mVisualParamIndexMap.end())
+	LLVisualParam* param = mVisualParams.find(index);
+	if (param)
 	{
-		return index_iter->second->getWeight();
+		return param->getWeight();
 	}
 	else
 	{
@@ -404,11 +432,7 @@ LLVisualParam*	LLCharacter::getVisualParam(const char *param_name)
 //-----------------------------------------------------------------------------
 void LLCharacter::addSharedVisualParam(LLVisualParam *param)
 {
-	S32 index = param->getID();
-	visual_param_index_map_t::iterator index_iter = mVisualParamIndexMap.find(index);
-	LLVisualParam* current_param = 0;
-	if (index_iter != mVisualParamIndexMap.end())
-		current_param = index_iter->second;
+	LLVisualParam* current_param = mVisualParams.find(param->getID());
 	if( current_param )
 	{
 		LLVisualParam* next_param = current_param;
@@ -430,16 +454,12 @@ void LLCharacter::addSharedVisualParam(LLVisualParam *param)
 //-----------------------------------------------------------------------------
 void LLCharacter::addVisualParam(LLVisualParam *param)
 {
-	S32 index = param->getID();
-	// Add Index map
-	std::pair<visual_param_index_map_t::iterator, bool> idxres;
-	idxres = mVisualParamIndexMap.insert(visual_param_index_map_t::value_type(index, param));
-	if (!idxres.second)
+	// Add to the ID ordered table
+	LLVisualParam* replaced = mVisualParams.add(param);
+	if (replaced)
 	{
 		llwarns << "Visual parameter " << param->getName() << " already exists with same ID as " << 
-			param->getName() << llendl;
-		visual_param_index_map_t::iterator index_iter = idxres.first;
-		index_iter->second = param;
+			replaced->getName() << llendl;
 	}
 
 	if (param->getInfo())
@@ -461,25 +481,27 @@ void LLCharacter::addVisualParam(LLVisualParam *param)
 }
 
 //-----------------------------------------------------------------------------
-// updateVisualParams()
+// requestVisualParamUpdate()
 //-----------------------------------------------------------------------------
-void LLCharacter::updateVisualParams()
+void LLCharacter::requestVisualParamUpdate()
 {
-	for (LLVisualParam *param = getFirstVisualParam(); 
-		param;
-		param = getNextVisualParam())
+	if (mMotionController.isEvaluating())
 	{
-		if (param->isAnimating())
-		{
-			continue;
-		}
-		// only apply parameters whose effective weight has changed
-		F32 effective_weight = ( param->getSex() & mSex ) ? param->getWeight() : param->getDefaultWeight();
-		if (effective_weight != param->getLastWeight())
-		{
-			param->apply( mSex );
-		}
+		// applied by commitMotionUpdate() back on the main thread
+		mVisualParamsPending = TRUE;
 	}
+	else
+	{
+		updateVisualParams();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// updateVisualParams()
+//-----------------------------------------------------------------------------
+void LLCharacter::updateVisualParams()
+{
+	mVisualParams.applyChanged(mSex, FALSE);
 }
  
 LLAnimPauseRequest LLCharacter::requestPause()
@@ -124,6 +124,10 @@ public:
 	// updates all visual parameters for this character
 	virtual void updateVisualParams();
 
+	// updates visual parameters now, or after the motion update when
+	// called from a motion being evaluated by evaluateMotions()
+	void requestVisualParamUpdate();
+
 	virtual void addDebugText( const std::string& text ) = 0;
 
 	virtual const LLUUID&	getID() = 0;
@@ -162,6 +166,13 @@ public:
 	enum e_update_t { NORMAL_UPDATE, HIDDEN_UPDATE, FORCE_UPDATE };
 	void updateMotions(e_update_t update_type);
 
+	// updateMotions() for NORMAL_UPDATE and FORCE_UPDATE, split so the
+	// evaluation of several characters can run in parallel.
+	// See LLMotionController::beginUpdate().
+	BOOL beginMotionUpdate(e_update_t update_type);
+	void evaluateMotions() { mMotionController.evaluateMotions(); }
+	void commitMotionUpdate();
+
 	LLAnimPauseRequest requestPause();
 	BOOL areAnimationsPaused() const { return mMotionController.isPaused(); }
 	void setAnimTimeFactor(F32 factor) { mMotionController.setTimeFactor(factor); }
@@ -212,24 +223,22 @@ public:
 	// visual parameter accessors
 	LLVisualParam*	getFirstVisualParam()
 	{
-		mCurIterator = mVisualParamIndexMap.begin();
+		mCurParamIndex = 0;
 		return getNextVisualParam();
 	}
 	LLVisualParam*	getNextVisualParam()
 	{
-		if (mCurIterator == mVisualParamIndexMap.end())
+		if (mCurParamIndex >= mVisualParams.size())
 			return 0;
-		return (mCurIterator++)->second;
+		return mVisualParams.getParam(mCurParamIndex++);
 	}
 
 	S32 getVisualParamCountInGroup(const EVisualParamGroup group) const
 	{
 		S32 rtn = 0;
-		for (visual_param_index_map_t::const_iterator iter = mVisualParamIndexMap.begin();
-		     iter != mVisualParamIndexMap.end();
-		     /**/ )
+		for (S32 i = 0; i < mVisualParams.size(); i++)
 		{
-			if ((iter++)->second->getGroup() == group)
+			if (mVisualParams.getParam(i)->getGroup() == group)
 			{
 				++rtn;
 			}
@@ -239,22 +248,23 @@ public:
 
 	LLVisualParam*	getVisualParam(S32 id) const
 	{
-		visual_param_index_map_t::const_iterator iter = mVisualParamIndexMap.find(id);
-		return (iter == mVisualParamIndexMap.end()) ? 0 : iter->second;
+		return mVisualParams.find(id);
 	}
 	S32 getVisualParamID(LLVisualParam *id)
 	{
-		visual_param_index_map_t::iterator iter;
-		for (iter = mVisualParamIndexMap.begin(); iter != mVisualParamIndexMap.end(); iter++)
+		for (S32 i = 0; i < mVisualParams.size(); i++)
 		{
-			if (iter->second == id)
-				return iter->first;
+			if (mVisualParams.getParam(i) == id)
+				return id->getID();
 		}
 		return 0;
 	}
-	S32				getVisualParamCount() const { return (S32)mVisualParamIndexMap.size(); }
+	S32				getVisualParamCount() const { return mVisualParams.size(); }
 	LLVisualParam*	getVisualParam(const char *name);
 
+	// apply every visual param, animating ones included, whose weight changed since it was last applied
+	S32				applyChangedVisualParams() { return mVisualParams.applyChanged(mSex, TRUE); }
+
 
 	ESex getSex() const			{ return mSex; }
 	void setSex( ESex sex )		{ mSex = sex; }
@@ -269,6 +279,7 @@ public:
 
 protected:
 	LLMotionController	mMotionController;
+	LLSkeletonPose		mSkeletonPose;
 
 	typedef std::map<std::string, void *> animation_data_map_t;
 	animation_data_map_t mAnimationData;
@@ -278,15 +289,15 @@ protected:
 	U32					mAppearanceSerialNum;
 	U32					mSkeletonSerialNum;
 	LLAnimPauseRequest	mPauseRequest;
+	BOOL				mVisualParamsPending;
 
 
 private:
 	// visual parameter stuff
-	typedef std::map<S32, LLVisualParam *> 		visual_param_index_map_t;
 	typedef std::map<char *, LLVisualParam *> 	visual_param_name_map_t;
 
-	visual_param_index_map_t::iterator 			mCurIterator;
-	visual_param_index_map_t 					mVisualParamIndexMap;
+	S32											mCurParamIndex;
+	LLVisualParamTable							mVisualParams;
 	visual_param_name_map_t  					mVisualParamNameMap;
 
 	static LLStringTable sVisualParamNames;	
@@ -110,7 +110,7 @@ BOOL LLHandMotion::onActivate()
 			mCharacter->setVisualParamWeight(gHandPoseNames[i], 0.f);
 		}
 		mCharacter->setVisualParamWeight(gHandPoseNames[mCurrentPose], 1.f);
-		mCharacter->updateVisualParams();
+		mCharacter->requestVisualParamUpdate();
 	}
 	return TRUE;
 }
@@ -174,7 +174,7 @@ BOOL LLHandMotion::onUpdate(F32 time, U8* joint_mask)
 			mCharacter->setVisualParamWeight(gHandPoseNames[mCurrentPose], outgoingWeight);
 		}
 
-		mCharacter->updateVisualParams();
+		mCharacter->requestVisualParamUpdate();
 		
 		if (incomingWeight == 1.f && outgoingWeight == 0.f)
 		{
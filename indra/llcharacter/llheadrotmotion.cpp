@@ -285,6 +285,9 @@ LLEyeMotion::LLEyeMotion(const LLUUID &id) : LLMotion(id)
 	
 	mHeadJoint = NULL;
 
+	// seeded on the main thread, xorshift needs a non-zero state
+	mRandState = (U32) ll_rand() | 1;
+
 	mName = "eye_rot";
 
 	mLeftEyeState = new LLJointState;
@@ -300,6 +303,18 @@ LLEyeMotion::~LLEyeMotion()
 {
 }
 
+//-----------------------------------------------------------------------------
+// LLEyeMotion::frand()
+// xorshift32, uniform in [0, val)
+//-----------------------------------------------------------------------------
+F32 LLEyeMotion::frand(F32 val)
+{
+	mRandState ^= mRandState << 13;
+	mRandState ^= mRandState >> 17;
+	mRandState ^= mRandState << 5;
+	return (F32) (mRandState >> 8) * (1.f / 16777216.f) * val;
+}
+
 //-----------------------------------------------------------------------------
 // LLEyeMotion::onInitialize(LLCharacter *character)
 //-----------------------------------------------------------------------------
@@ -360,31 +375,31 @@ BOOL LLEyeMotion::onUpdate(F32 time, U8* joint_mask)
 	//calculate jitter
 	if (mEyeJitterTimer.getElapsedTimeF32() > mEyeJitterTime)
 	{
-		mEyeJitterTime = EYE_JITTER_MIN_TIME + ll_frand(EYE_JITTER_MAX_TIME - EYE_JITTER_MIN_TIME);
-		mEyeJitterYaw = (ll_frand(2.f) - 1.f) * EYE_JITTER_MAX_YAW;
-		mEyeJitterPitch = (ll_frand(2.f) - 1.f) * EYE_JITTER_MAX_PITCH;
+		mEyeJitterTime = EYE_JITTER_MIN_TIME + frand(EYE_JITTER_MAX_TIME - EYE_JITTER_MIN_TIME);
+		mEyeJitterYaw = (frand(2.f) - 1.f) * EYE_JITTER_MAX_YAW;
+		mEyeJitterPitch = (frand(2.f) - 1.f) * EYE_JITTER_MAX_PITCH;
 		// make sure lookaway time count gets updated, because we're resetting the timer
 		mEyeLookAwayTime -= llmax(0.f, mEyeJitterTimer.getElapsedTimeF32());
 		mEyeJitterTimer.reset();
 	} 
 	else if (mEyeJitterTimer.getElapsedTimeF32() > mEyeLookAwayTime)
 	{
-		if (ll_frand() > 0.1f)
+		if (frand() > 0.1f)
 		{
 			// blink while moving eyes some percentage of the time
 			mEyeBlinkTime = mEyeBlinkTimer.getElapsedTimeF32();
 		}
 		if (mEyeLookAwayYaw == 0.f && mEyeLookAwayPitch == 0.f)
 		{
-			mEyeLookAwayYaw = (ll_frand(2.f) - 1.f) * EYE_LOOK_AWAY_MAX_YAW;
-			mEyeLookAwayPitch = (ll_frand(2.f) - 1.f) * EYE_LOOK_AWAY_MAX_PITCH;
-			mEyeLookAwayTime = EYE_LOOK_BACK_MIN_TIME + ll_frand(EYE_LOOK_BACK_MAX_TIME - EYE_LOOK_BACK_MIN_TIME);
+			mEyeLookAwayYaw = (frand(2.f) - 1.f) * EYE_LOOK_AWAY_MAX_YAW;
+			mEyeLookAwayPitch = (frand(2.f) - 1.f) * EYE_LOOK_AWAY_MAX_PITCH;
+			mEyeLookAwayTime = EYE_LOOK_BACK_MIN_TIME + frand(EYE_LOOK_BACK_MAX_TIME - EYE_LOOK_BACK_MIN_TIME);
 		}
 		else
 		{
 			mEyeLookAwayYaw = 0.f;
 			mEyeLookAwayPitch = 0.f;
-			mEyeLookAwayTime = EYE_LOOK_AWAY_MIN_TIME + ll_frand(EYE_LOOK_AWAY_MAX_TIME - EYE_LOOK_AWAY_MIN_TIME);
+			mEyeLookAwayTime = EYE_LOOK_AWAY_MIN_TIME + frand(EYE_LOOK_AWAY_MAX_TIME - EYE_LOOK_AWAY_MIN_TIME);
 		}
 	}
 
@@ -398,7 +413,7 @@ BOOL LLEyeMotion::onUpdate(F32 time, U8* joint_mask)
 		rightEyeBlinkMorph = llclamp(rightEyeBlinkMorph / EYE_BLINK_SPEED, 0.f, 1.f);
 		mCharacter->setVisualParamWeight("Blink_Left", leftEyeBlinkMorph);
 		mCharacter->setVisualParamWeight("Blink_Right", rightEyeBlinkMorph);
-		mCharacter->updateVisualParams();
+		mCharacter->requestVisualParamUpdate();
 
 		if (rightEyeBlinkMorph == 1.f)
 		{
@@ -418,12 +433,12 @@ BOOL LLEyeMotion::onUpdate(F32 time, U8* joint_mask)
 			rightEyeBlinkMorph = 1.f - llclamp(rightEyeBlinkMorph / EYE_BLINK_SPEED, 0.f, 1.f);
 			mCharacter->setVisualParamWeight("Blink_Left", leftEyeBlinkMorph);
 			mCharacter->setVisualParamWeight("Blink_Right", rightEyeBlinkMorph);
-			mCharacter->updateVisualParams();
+			mCharacter->requestVisualParamUpdate();
 
 			if (rightEyeBlinkMorph == 0.f)
 			{
 				mEyesClosed = FALSE;
-				mEyeBlinkTime = EYE_BLINK_MIN_TIME + ll_frand(EYE_BLINK_MAX_TIME - EYE_BLINK_MIN_TIME);
+				mEyeBlinkTime = EYE_BLINK_MIN_TIME + frand(EYE_BLINK_MAX_TIME - EYE_BLINK_MIN_TIME);
 				mEyeBlinkTimer.reset();
 			}
 		}
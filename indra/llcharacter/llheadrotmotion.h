@@ -206,6 +206,13 @@ public:
 	LLFrameTimer		mEyeBlinkTimer;
 	F32					mEyeBlinkTime;
 	BOOL				mEyesClosed;
+
+private:
+	// onUpdate() runs on motion evaluator threads, where the shared
+	// ll_frand() generator would race, so each motion keeps its own
+	F32 frand(F32 val = 1.f);
+
+	U32					mRandState;
 };
 
 #endif // LL_LLHEADROTMOTION_H
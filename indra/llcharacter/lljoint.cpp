@@ -49,6 +49,8 @@ LLJoint::LLJoint()
 	mDirtyFlags = MATRIX_DIRTY | ROTATION_DIRTY | POSITION_DIRTY;
 	mUpdateXform = TRUE;
 	mJointNum = -1;
+	mPose = NULL;
+	mPoseIndex = -1;
 	touch();
 }
 
@@ -66,6 +68,8 @@ LLJoint::LLJoint(const std::string &name, LLJoint *parent)
 	mDirtyFlags = MATRIX_DIRTY | ROTATION_DIRTY | POSITION_DIRTY;
 	mUpdateXform = FALSE;
 	mJointNum = 0;
+	mPose = NULL;
+	mPoseIndex = -1;
 
 	setName(name);
 	if (parent)
@@ -81,6 +85,10 @@ LLJoint::LLJoint(const std::string &name, LLJoint *parent)
 //-----------------------------------------------------------------------------
 LLJoint::~LLJoint()
 {
+	if (mPose)
+	{
+		mPose->unbind();
+	}
 	if (mParent)
 	{
 		mParent->removeChild( this );
@@ -107,6 +115,12 @@ void LLJoint::setup(const std::string &name, LLJoint *parent)
 //-----------------------------------------------------------------------------
 void LLJoint::touch(U32 flags)
 {
+	if (mPose)
+	{
+		mPose->touch(mPoseIndex, flags);
+		return;
+	}
+
 	if ((flags | mDirtyFlags) != mDirtyFlags)
 	{
 		sNumTouches++;
@@ -167,6 +181,15 @@ LLJoint *LLJoint::findJoint( const std::string &name )
 //--------------------------------------------------------------------
 void LLJoint::addChild(LLJoint* joint)
 {
+	if (mPose)
+	{
+		mPose->unbind();
+	}
+	if (joint->mPose)
+	{
+		joint->mPose->unbind();
+	}
+
 	if (joint->mParent)
 		joint->mParent->removeChild(joint);
 
@@ -185,6 +208,11 @@ void LLJoint::removeChild(LLJoint* joint)
 	child_list_t::iterator iter = std::find(mChildren.begin(), mChildren.end(), joint);
 	if (iter != mChildren.end())
 	{
+		if (mPose)
+		{
+			mPose->unbind();
+		}
+
 		mChildren.erase(iter);
 	
 		joint->mXform.setParent(NULL);
@@ -199,6 +227,11 @@ void LLJoint::removeChild(LLJoint* joint)
 //--------------------------------------------------------------------
 void LLJoint::removeAllChildren()
 {
+	if (mPose && !mChildren.empty())
+	{
+		mPose->unbind();
+	}
+
 	for (child_list_t::iterator iter = mChildren.begin();
 		 iter != mChildren.end();)
 	{
@@ -217,6 +250,10 @@ void LLJoint::removeAllChildren()
 //--------------------------------------------------------------------
 const LLVector3& LLJoint::getPosition()
 {
+	if (mPose)
+	{
+		return mPose->mPositions[mPoseIndex];
+	}
 	return mXform.getPosition();
 }
 
@@ -229,6 +266,10 @@ void LLJoint::setPosition( const LLVector3& pos )
 //	if (mXform.getPosition() != pos)
 	{
 		mXform.setPosition(pos);
+		if (mPose)
+		{
+			mPose->mPositions[mPoseIndex] = mXform.getPosition();
+		}
 		touch(MATRIX_DIRTY | POSITION_DIRTY);
 	}
 }
@@ -240,6 +281,10 @@ void LLJoint::setPosition( const LLVector3& pos )
 LLVector3 LLJoint::getWorldPosition()
 {
 	updateWorldPRSParent();
+	if (mPose)
+	{
+		return mPose->mWorldPositions[mPoseIndex];
+	}
 	return mXform.getWorldPosition();
 }
 
@@ -248,6 +293,10 @@ LLVector3 LLJoint::getWorldPosition()
 //-----------------------------------------------------------------------------
 LLVector3 LLJoint::getLastWorldPosition()
 {
+	if (mPose)
+	{
+		return mPose->mWorldPositions[mPoseIndex];
+	}
 	return mXform.getWorldPosition();
 }
 
@@ -286,6 +335,10 @@ void LLJoint::setWorldPosition( const LLVector3& pos )
 //--------------------------------------------------------------------
 const LLQuaternion& LLJoint::getRotation()
 {
+	if (mPose)
+	{
+		return mPose->mRotations[mPoseIndex];
+	}
 	return mXform.getRotation();
 }
 
@@ -300,6 +353,10 @@ void LLJoint::setRotation( const LLQuaternion& rot )
 	//	if (mXform.getRotation() != rot)
 		{
 			mXform.setRotation(rot);
+			if (mPose)
+			{
+				mPose->mRotations[mPoseIndex] = mXform.getRotation();
+			}
 			touch(MATRIX_DIRTY | ROTATION_DIRTY);
 		}
 	}
@@ -313,6 +370,10 @@ LLQuaternion LLJoint::getWorldRotation()
 {
 	updateWorldPRSParent();
 
+	if (mPose)
+	{
+		return mPose->mWorldRotations[mPoseIndex];
+	}
 	return mXform.getWorldRotation();
 }
 
@@ -321,6 +382,10 @@ LLQuaternion LLJoint::getWorldRotation()
 //-----------------------------------------------------------------------------
 LLQuaternion LLJoint::getLastWorldRotation()
 {
+	if (mPose)
+	{
+		return mPose->mWorldRotations[mPoseIndex];
+	}
 	return mXform.getWorldRotation();
 }
 
@@ -355,6 +420,10 @@ void LLJoint::setWorldRotation( const LLQuaternion& rot )
 //--------------------------------------------------------------------
 const LLVector3& LLJoint::getScale()
 {
+	if (mPose)
+	{
+		return mPose->mScales[mPoseIndex];
+	}
 	return mXform.getScale();
 }
 
@@ -366,6 +435,10 @@ void LLJoint::setScale( const LLVector3& scale )
 //	if (mXform.getScale() != scale)
 	{
 		mXform.setScale(scale);
+		if (mPose)
+		{
+			mPose->mScales[mPoseIndex] = mXform.getScale();
+		}
 		touch();
 	}
 
@@ -380,6 +453,10 @@ const LLMatrix4 &LLJoint::getWorldMatrix()
 {
 	updateWorldMatrixParent();
 
+	if (mPose)
+	{
+		return mPose->mWorldMatrices[mPoseIndex];
+	}
 	return mXform.getWorldMatrix();
 }
 
@@ -407,6 +484,12 @@ llinfos << "WARNING: LLJoint::setWorldMatrix() not correctly implemented yet" <<
 //-----------------------------------------------------------------------------
 void LLJoint::updateWorldMatrixParent()
 {
+	if (mPose)
+	{
+		mPose->updateParents(mPoseIndex);
+		return;
+	}
+
 	if (mDirtyFlags & MATRIX_DIRTY)
 	{
 		LLJoint *parent = getParent();
@@ -423,6 +506,12 @@ void LLJoint::updateWorldMatrixParent()
 //-----------------------------------------------------------------------------
 void LLJoint::updateWorldPRSParent()
 {
+	if (mPose)
+	{
+		mPose->updateParents(mPoseIndex);
+		return;
+	}
+
 	if (mDirtyFlags & (ROTATION_DIRTY | POSITION_DIRTY))
 	{
 		LLJoint *parent = getParent();
@@ -443,6 +532,12 @@ void LLJoint::updateWorldMatrixChildren()
 {	
 	if (!this->mUpdateXform) return;
 
+	if (mPose)
+	{
+		mPose->updateChildren(mPoseIndex);
+		return;
+	}
+
 	if (mDirtyFlags & MATRIX_DIRTY)
 	{
 		updateWorldMatrix();
@@ -460,6 +555,12 @@ void LLJoint::updateWorldMatrixChildren()
 //-----------------------------------------------------------------------------
 void LLJoint::updateWorldMatrix()
 {
+	if (mPose)
+	{
+		mPose->updateParents(mPoseIndex);
+		return;
+	}
+
 	if (mDirtyFlags & MATRIX_DIRTY)
 	{
 		sNumUpdates++;
@@ -521,4 +622,229 @@ void LLJoint::clampRotation(LLQuaternion old_rot, LLQuaternion new_rot)
 //	}
 }
 
+//-----------------------------------------------------------------------------
+// LLSkeletonTopology
+//-----------------------------------------------------------------------------
+LLSkeletonTopology::topology_list_t LLSkeletonTopology::sShared;
+
+LLSkeletonTopology::~LLSkeletonTopology()
+{
+	topology_list_t::iterator iter = std::find(sShared.begin(), sShared.end(), this);
+	if (iter != sShared.end())
+	{
+		sShared.erase(iter);
+	}
+}
+
+//static
+LLPointer<LLSkeletonTopology> LLSkeletonTopology::getShared(LLJoint* root, std::vector<LLJoint*>& joints)
+{
+	LLPointer<LLSkeletonTopology> topology = new LLSkeletonTopology();
+	joints.clear();
+	flatten(root, -1, topology, joints);
+
+	for (topology_list_t::iterator iter = sShared.begin(); iter != sShared.end(); ++iter)
+	{
+		if (**iter == *topology)
+		{
+			return *iter;
+		}
+	}
+
+	sShared.push_back(topology);
+	return topology;
+}
+
+//static
+void LLSkeletonTopology::flatten(LLJoint* joint, S32 parent, LLSkeletonTopology* topology, std::vector<LLJoint*>& joints)
+{
+	S32 index = (S32)joints.size();
+	joints.push_back(joint);
+	topology->mParents.push_back(parent);
+	topology->mSubtreeSizes.push_back(1);
+	topology->mNames.push_back(joint->getName());
+
+	for (LLJoint::child_list_t::iterator iter = joint->mChildren.begin();
+		 iter != joint->mChildren.end(); ++iter)
+	{
+		flatten(*iter, index, topology, joints);
+	}
+
+	topology->mSubtreeSizes[index] = (S32)joints.size() - index;
+}
+
+bool LLSkeletonTopology::operator==(const LLSkeletonTopology& other) const
+{
+	return mParents == other.mParents && mNames == other.mNames;
+}
+
+//-----------------------------------------------------------------------------
+// LLSkeletonPose
+//-----------------------------------------------------------------------------
+LLSkeletonPose::LLSkeletonPose()
+{
+}
+
+LLSkeletonPose::~LLSkeletonPose()
+{
+	unbind();
+}
+
+void LLSkeletonPose::bind(LLJoint* root)
+{
+	unbind();
+
+	std::vector<LLJoint*> joints;
+	LLPointer<LLSkeletonTopology> topology = LLSkeletonTopology::getShared(root, joints);
+
+	S32 num_joints = topology->getNumJoints();
+	for (S32 i = 0; i < num_joints; ++i)
+	{
+		if (joints[i]->mPose)
+		{
+			joints[i]->mPose->unbind();
+		}
+	}
+
+	mTopology = topology;
+	mJoints.swap(joints);
+	mDirtyFlags.resize(num_joints);
+	mPositions.resize(num_joints);
+	mRotations.resize(num_joints);
+	mScales.resize(num_joints);
+	mWorldPositions.resize(num_joints);
+	mWorldRotations.resize(num_joints);
+	mWorldMatrices.resize(num_joints);
+
+	for (S32 i = 0; i < num_joints; ++i)
+	{
+		LLJoint* joint = mJoints[i];
+		const LLXformMatrix& xform = joint->mXform;
+
+		mDirtyFlags[i] = joint->mDirtyFlags;
+		mPositions[i] = xform.getPosition();
+		mRotations[i] = xform.getRotation();
+		mScales[i] = xform.getScale();
+		mWorldPositions[i] = xform.getWorldPosition();
+		mWorldRotations[i] = xform.getWorldRotation();
+		mWorldMatrices[i] = xform.getWorldMatrix();
+
+		joint->mPose = this;
+		joint->mPoseIndex = i;
+	}
+}
+
+void LLSkeletonPose::unbind()
+{
+	if (mTopology.isNull())
+	{
+		return;
+	}
+
+	// mXform holds the same transforms, only the dirty state has to go back
+	for (S32 i = 0; i < (S32)mJoints.size(); ++i)
+	{
+		LLJoint* joint = mJoints[i];
+		joint->mDirtyFlags = mDirtyFlags[i];
+		joint->mPose = NULL;
+		joint->mPoseIndex = -1;
+	}
+
+	mJoints.clear();
+	mTopology = NULL;
+}
+
+void LLSkeletonPose::touch(S32 index, U32 flags)
+{
+	if ((flags | mDirtyFlags[index]) == mDirtyFlags[index])
+	{
+		return;
+	}
+
+	LLJoint::sNumTouches++;
+	mDirtyFlags[index] |= flags;
+
+	U32 child_flags = flags;
+	if (flags & LLJoint::ROTATION_DIRTY)
+	{
+		child_flags |= LLJoint::POSITION_DIRTY;
+	}
+
+	// the subtree follows its root directly
+	S32 end = index + mTopology->getSubtreeSize(index);
+	for (S32 i = index + 1; i < end; ++i)
+	{
+		mDirtyFlags[i] |= child_flags;
+	}
+}
+
+void LLSkeletonPose::updateParents(S32 index)
+{
+	if (!mDirtyFlags[index])
+	{
+		return;
+	}
+
+	// dirty flags spread to children, so any dirty ancestors are a chain above index
+	S32 parent = mTopology->getParent(index);
+	if (parent >= 0 && mDirtyFlags[parent])
+	{
+		updateParents(parent);
+	}
+	updateJoint(index);
+}
+
+void LLSkeletonPose::updateChildren(S32 index)
+{
+	updateParents(index);
+
+	S32 end = index + mTopology->getSubtreeSize(index);
+	for (S32 i = index + 1; i < end; )
+	{
+		if (!mDirtyFlags[i])
+		{
+			++i;
+		}
+		else if (!mJoints[i]->mUpdateXform)
+		{ //left dirty for whoever asks for it, like LLJoint::updateWorldMatrixChildren()
+			i += mTopology->getSubtreeSize(i);
+		}
+		else
+		{
+			updateJoint(i);
+			++i;
+		}
+	}
+}
+
+void LLSkeletonPose::updateJoint(S32 index)
+{
+	LLJoint* joint = mJoints[index];
+	S32 parent = mTopology->getParent(index);
+
+	if (parent < 0)
+	{ //the root may hang off a non joint transform (sitting), let its xform work it out
+		joint->mXform.updateMatrix(FALSE);
+		mWorldPositions[index] = joint->mXform.getWorldPosition();
+		mWorldRotations[index] = joint->mXform.getWorldRotation();
+		mWorldMatrices[index] = joint->mXform.getWorldMatrix();
+	}
+	else
+	{ //same as LLXformMatrix::updateMatrix(), joints always scale child offsets
+		LLVector3 world_pos = mPositions[index];
+		world_pos.scaleVec(mScales[parent]);
+		world_pos *= mWorldRotations[parent];
+		world_pos += mWorldPositions[parent];
+
+		mWorldPositions[index] = world_pos;
+		mWorldRotations[index] = mRotations[index] * mWorldRotations[parent];
+		mWorldMatrices[index].initAll(mScales[index], mWorldRotations[index], world_pos);
+
+		joint->mXform.setWorldTransform(world_pos, mWorldRotations[index], mWorldMatrices[index]);
+	}
+
+	mDirtyFlags[index] = 0;
+	LLJoint::sNumUpdates++;
+}
+
 // End
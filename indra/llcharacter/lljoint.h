@@ -31,6 +31,7 @@
 // Header Files
 //-----------------------------------------------------------------------------
 #include <string>
+#include <vector>
 
 #include "linked_lists.h"
 #include "v3math.h"
@@ -39,6 +40,8 @@
 #include "llquaternion.h"
 #include "xform.h"
 #include "lldarray.h"
+#include "llpointer.h"
+#include "llrefcount.h"
 
 const S32 LL_CHARACTER_MAX_JOINTS_PER_MESH = 15;
 const U32 LL_CHARACTER_MAX_JOINTS = 32; // must be divisible by 4!
@@ -47,6 +50,8 @@ const U32 LL_FACE_JOINT_NUM = 30;
 const S32 LL_CHARACTER_MAX_PRIORITY = 7;
 const F32 LL_MAX_PELVIS_OFFSET = 5.f;
 
+class LLSkeletonPose;
+
 //-----------------------------------------------------------------------------
 // class LLJoint
 //-----------------------------------------------------------------------------
@@ -81,6 +86,12 @@ protected:
 	// explicit transformation members
 	LLXformMatrix		mXform;
 
+	// while bound the transforms below are read from mPose, mXform is kept
+	// in step for LLXform children (attachments) and getXform() users
+	friend class LLSkeletonPose;
+	LLSkeletonPose*	mPose;
+	S32				mPoseIndex;
+
 public:
 	U32				mDirtyFlags;
 	BOOL			mUpdateXform;
@@ -172,6 +183,94 @@ public:
 
 	S32 getJointNum() const { return mJointNum; }
 	void setJointNum(S32 joint_num) { mJointNum = joint_num; }
+
+	LLSkeletonPose* getPose() const { return mPose; }
+};
+
+//-----------------------------------------------------------------------------
+// class LLSkeletonTopology
+// Immutable joint hierarchy flattened depth first, so every parent comes
+// before its children and a subtree is a contiguous index range.  Characters
+// built from the same skeleton definition share one instance.
+//-----------------------------------------------------------------------------
+class LLSkeletonTopology : public LLRefCount
+{
+public:
+	// flattens the hierarchy under root into joints, returning the shared
+	// topology if an identical one exists
+	static LLPointer<LLSkeletonTopology> getShared(LLJoint* root, std::vector<LLJoint*>& joints);
+
+	S32 getNumJoints() const { return (S32)mParents.size(); }
+	// index of the parent joint, -1 for the root
+	S32 getParent(S32 index) const { return mParents[index]; }
+	// number of joints in the subtree rooted at index, itself included
+	S32 getSubtreeSize(S32 index) const { return mSubtreeSizes[index]; }
+	const std::string& getName(S32 index) const { return mNames[index]; }
+
+	static S32 getNumShared() { return (S32)sShared.size(); }
+
+protected:
+	LLSkeletonTopology() { }
+	~LLSkeletonTopology();
+
+private:
+	static void flatten(LLJoint* joint, S32 parent, LLSkeletonTopology* topology, std::vector<LLJoint*>& joints);
+	bool operator==(const LLSkeletonTopology& other) const;
+
+	std::vector<S32>			mParents;
+	std::vector<S32>			mSubtreeSizes;
+	std::vector<std::string>	mNames;
+
+	typedef std::vector<LLSkeletonTopology*> topology_list_t;
+	static topology_list_t sShared;
+};
+
+//-----------------------------------------------------------------------------
+// class LLSkeletonPose
+// Per character transform storage for a bound joint hierarchy, held as
+// contiguous arrays in topology order.  World transforms are updated in one
+// forward pass instead of a recursive walk.  Changing the hierarchy of a
+// bound joint unbinds the whole pose, the owner binds it again once the
+// hierarchy is settled.
+//-----------------------------------------------------------------------------
+class LLSkeletonPose
+{
+public:
+	LLSkeletonPose();
+	~LLSkeletonPose();
+
+	// takes over the transforms of every joint under root
+	void bind(LLJoint* root);
+	// hands the transforms back to the joints
+	void unbind();
+	BOOL isBound() const { return mTopology.notNull(); }
+
+	const LLSkeletonTopology* getTopology() const { return mTopology; }
+
+private:
+	friend class LLJoint;
+
+	void touch(S32 index, U32 flags);
+	// brings the world transform of index and its ancestors up to date
+	void updateParents(S32 index);
+	// brings the subtree under index up to date, skipping subtrees of
+	// joints that do not want their transform updated
+	void updateChildren(S32 index);
+	void updateJoint(S32 index);
+
+	LLPointer<LLSkeletonTopology>	mTopology;
+	std::vector<LLJoint*>			mJoints;
+	std::vector<U32>				mDirtyFlags;
+
+	// local transforms
+	std::vector<LLVector3>			mPositions;
+	std::vector<LLQuaternion>		mRotations;
+	std::vector<LLVector3>			mScales;
+
+	// world transforms
+	std::vector<LLVector3>			mWorldPositions;
+	std::vector<LLQuaternion>		mWorldRotations;
+	std::vector<LLMatrix4>			mWorldMatrices;
 };
 #endif // LL_LLJOINT_H
 
@@ -39,6 +39,7 @@
 #include "llendianswizzle.h"
 #include "llkeyframemotion.h"
 #include "llquantize.h"
+#include "llv4math.h"		// for LL_VECTORIZE
 #include "llvfile.h"
 #include "m3math.h"
 #include "message.h"
@@ -127,6 +128,94 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 //-----------------------------------------------------------------------------
 
 
+//-----------------------------------------------------------------------------
+// Key search helpers shared by the curve classes
+//-----------------------------------------------------------------------------
+// keys a playing motion is allowed to step over linearly before falling back
+// to a binary search, covers a frame hitch on densely keyed animations
+static const S32 MAX_CURSOR_STEPS = 4;
+
+template <class KEY>
+struct key_time_less
+{
+	bool operator()(const KEY& key, F32 time) const { return key.mTime < time; }
+};
+
+template <class KEY>
+struct key_time_sort
+{
+	bool operator()(const KEY& a, const KEY& b) const { return a.mTime < b.mTime; }
+};
+
+// Sorts keys by time and keeps the last of several keys sharing a time,
+// which is what the old std::map assignment did.
+template <class KEY>
+static void sort_keys(std::vector<KEY>& keys)
+{
+	std::stable_sort(keys.begin(), keys.end(), key_time_sort<KEY>());
+
+	typename std::vector<KEY>::iterator out = keys.begin();
+	for (typename std::vector<KEY>::iterator iter = keys.begin(); iter != keys.end(); ++iter)
+	{
+		typename std::vector<KEY>::iterator next = iter + 1;
+		if (next == keys.end() || next->mTime != iter->mTime)
+		{
+			*out++ = *iter;
+		}
+	}
+	keys.erase(out, keys.end());
+}
+
+// Finds the first key at or after time, starting from the index found by
+// the previous call on the same curve since playback almost always moves
+// forward from there.
+// Returns FALSE with before set when time is before, on or past a single key.
+template <class KEY>
+static BOOL find_keys(const std::vector<KEY>& keys, F32 time, S32& cursor, const KEY*& before, const KEY*& after, F32& u)
+{
+	const S32 count = (S32)keys.size();
+	S32 right = llclamp(cursor, 0, count);
+
+	if (right > 0 && keys[right - 1].mTime >= time)
+	{
+		// went backwards, looped or restarted
+		right = std::lower_bound(keys.begin(), keys.begin() + right, time, key_time_less<KEY>()) - keys.begin();
+	}
+	else
+	{
+		S32 steps = 0;
+		while (right < count && keys[right].mTime < time)
+		{
+			if (++steps > MAX_CURSOR_STEPS)
+			{
+				right = std::lower_bound(keys.begin() + right, keys.end(), time, key_time_less<KEY>()) - keys.begin();
+				break;
+			}
+			++right;
+		}
+	}
+	cursor = right;
+
+	if (right == count)
+	{
+		// Past last key
+		before = &keys[count - 1];
+		return FALSE;
+	}
+	if (right == 0 || keys[right].mTime == time)
+	{
+		// Before first key or exactly on a key
+		before = &keys[right];
+		return FALSE;
+	}
+
+	// Between two keys
+	before = &keys[right - 1];
+	after = &keys[right];
+	u = (time - before->mTime) / (after->mTime - before->mTime);
+	return TRUE;
+}
+
 //-----------------------------------------------------------------------------
 // ScaleCurve::ScaleCurve()
 //-----------------------------------------------------------------------------
@@ -148,7 +237,13 @@ LLKeyframeMotion::ScaleCurve::~ScaleCurve()
 //-----------------------------------------------------------------------------
 // getValue()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
+LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration) const
+{
+	S32 cursor = 0;
+	return getValue(time, duration, cursor);
+}
+
+LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration, S32& cursor) const
 {
 	LLVector3 value;
 
@@ -157,39 +252,38 @@ LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
 		value.clearVec();
 		return value;
 	}
-	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+
+	const ScaleKey* before;
+	const ScaleKey* after;
+	F32 u;
+	if (!findKeys(time, cursor, before, after, u) || mInterpolationType == IT_STEP)
 	{
-		// Past last key
-		--right;
-		value = right->second.mScale;
-	}
-	else if (right == mKeys.begin() || right->first == time)
-	{
-		// Before first key or exactly on a key
-		value = right->second.mScale;
+		value = before->mScale;
 	}
 	else
 	{
-		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		ScaleKey& scale_before = left->second;
-		ScaleKey& scale_after = right->second;
-		if (right == mKeys.end())
-		{
-			scale_after = mLoopInKey;
-			index_after = duration;
-		}
-
-		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, scale_before, scale_after);
+		value = lerp(before->mScale, after->mScale, u);
 	}
 	return value;
 }
 
+//-----------------------------------------------------------------------------
+// findKeys()
+//-----------------------------------------------------------------------------
+BOOL LLKeyframeMotion::ScaleCurve::findKeys(F32 time, S32& cursor, const ScaleKey*& before, const ScaleKey*& after, F32& u) const
+{
+	return find_keys(mKeys, time, cursor, before, after, u);
+}
+
+//-----------------------------------------------------------------------------
+// sortKeys()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::ScaleCurve::sortKeys()
+{
+	sort_keys(mKeys);
+	mNumKeys = mKeys.size();
+}
+
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
@@ -228,7 +322,13 @@ LLKeyframeMotion::RotationCurve::~RotationCurve()
 //-----------------------------------------------------------------------------
 // RotationCurve::getValue()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
+LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration) const
+{
+	S32 cursor = 0;
+	return getValue(time, duration, cursor);
+}
+
+LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration, S32& cursor) const
 {
 	LLQuaternion value;
 
@@ -237,39 +337,38 @@ LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
 		value = LLQuaternion::DEFAULT;
 		return value;
 	}
-	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
-	{
-		// Past last key
-		--right;
-		value = right->second.mRotation;
-	}
-	else if (right == mKeys.begin() || right->first == time)
+
+	const RotationKey* before;
+	const RotationKey* after;
+	F32 u;
+	if (!findKeys(time, cursor, before, after, u) || mInterpolationType == IT_STEP)
 	{
-		// Before first key or exactly on a key
-		value = right->second.mRotation;
+		value = before->mRotation;
 	}
 	else
 	{
-		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		RotationKey& rot_before = left->second;
-		RotationKey& rot_after = right->second;
-		if (right == mKeys.end())
-		{
-			rot_after = mLoopInKey;
-			index_after = duration;
-		}
-
-		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, rot_before, rot_after);
+		value = nlerp(u, before->mRotation, after->mRotation);
 	}
 	return value;
 }
 
+//-----------------------------------------------------------------------------
+// RotationCurve::findKeys()
+//-----------------------------------------------------------------------------
+BOOL LLKeyframeMotion::RotationCurve::findKeys(F32 time, S32& cursor, const RotationKey*& before, const RotationKey*& after, F32& u) const
+{
+	return find_keys(mKeys, time, cursor, before, after, u);
+}
+
+//-----------------------------------------------------------------------------
+// RotationCurve::sortKeys()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::RotationCurve::sortKeys()
+{
+	sort_keys(mKeys);
+	mNumKeys = mKeys.size();
+}
+
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
@@ -309,7 +408,13 @@ LLKeyframeMotion::PositionCurve::~PositionCurve()
 //-----------------------------------------------------------------------------
 // PositionCurve::getValue()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
+LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration) const
+{
+	S32 cursor = 0;
+	return getValue(time, duration, cursor);
+}
+
+LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration, S32& cursor) const
 {
 	LLVector3 value;
 
@@ -318,35 +423,17 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
 		value.clearVec();
 		return value;
 	}
-	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
-	{
-		// Past last key
-		--right;
-		value = right->second.mPosition;
-	}
-	else if (right == mKeys.begin() || right->first == time)
+
+	const PositionKey* before;
+	const PositionKey* after;
+	F32 u;
+	if (!findKeys(time, cursor, before, after, u) || mInterpolationType == IT_STEP)
 	{
-		// Before first key or exactly on a key
-		value = right->second.mPosition;
+		value = before->mPosition;
 	}
 	else
 	{
-		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		PositionKey& pos_before = left->second;
-		PositionKey& pos_after = right->second;
-		if (right == mKeys.end())
-		{
-			pos_after = mLoopInKey;
-			index_after = duration;
-		}
-
-		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, pos_before, pos_after);
+		value = lerp(before->mPosition, after->mPosition, u);
 	}
 
 	llassert(value.isFinite());
@@ -354,6 +441,23 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
 	return value;
 }
 
+//-----------------------------------------------------------------------------
+// PositionCurve::findKeys()
+//-----------------------------------------------------------------------------
+BOOL LLKeyframeMotion::PositionCurve::findKeys(F32 time, S32& cursor, const PositionKey*& before, const PositionKey*& after, F32& u) const
+{
+	return find_keys(mKeys, time, cursor, before, after, u);
+}
+
+//-----------------------------------------------------------------------------
+// PositionCurve::sortKeys()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::PositionCurve::sortKeys()
+{
+	sort_keys(mKeys);
+	mNumKeys = mKeys.size();
+}
+
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
@@ -371,6 +475,208 @@ LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, Po
 }
 
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// InterpolationBatch class
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// InterpolationBatch::addRotation()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::InterpolationBatch::addRotation(LLJointState* joint_state, const LLQuaternion& before, const LLQuaternion& after, F32 u)
+{
+	mRotJoints.push_back(joint_state);
+	for (U32 i = 0; i < 4; ++i)
+	{
+		mRotBefore[i].push_back(before.mQ[i]);
+		mRotAfter[i].push_back(after.mQ[i]);
+	}
+	mRotU.push_back(u);
+}
+
+//-----------------------------------------------------------------------------
+// InterpolationBatch::addPosition()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::InterpolationBatch::addPosition(LLJointState* joint_state, const LLVector3& before, const LLVector3& after, F32 u)
+{
+	mPosJoints.push_back(joint_state);
+	for (U32 i = 0; i < 3; ++i)
+	{
+		mPosBefore[i].push_back(before.mV[i]);
+		mPosAfter[i].push_back(after.mV[i]);
+	}
+	mPosU.push_back(u);
+}
+
+//-----------------------------------------------------------------------------
+// InterpolationBatch::apply()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::InterpolationBatch::apply()
+{
+	if (!mRotJoints.empty())
+	{
+		applyRotations();
+	}
+	if (!mPosJoints.empty())
+	{
+		applyPositions();
+	}
+}
+
+// gathers component i of SoA quaternion storage, without the renormalization
+// done by the LLQuaternion(x, y, z, w) constructor
+static inline LLQuaternion load_quat(const std::vector<F32>* components, U32 i)
+{
+	LLQuaternion q;
+	for (U32 c = 0; c < 4; ++c)
+	{
+		q.mQ[c] = components[c][i];
+	}
+	return q;
+}
+
+//-----------------------------------------------------------------------------
+// InterpolationBatch::applyRotations()
+// same result as nlerp() for each joint
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::InterpolationBatch::applyRotations()
+{
+	const U32 count = mRotJoints.size();
+	for (U32 i = 0; i < 4; ++i)
+	{
+		mResult[i].resize(count);
+	}
+
+	U32 vec_end = 0;
+#if LL_VECTORIZE
+	vec_end = count & ~3;
+
+	const V4F32 one = _mm_set1_ps(1.f);
+	const V4F32 sign_mask = _mm_set1_ps(-0.f);
+	const V4F32 unit_tolerance = _mm_set1_ps(ONE_PART_IN_A_MILLION);
+	LL_LLV4MATH_ALIGN_PREFIX F32 dot[4] LL_LLV4MATH_ALIGN_POSTFIX;
+	LL_LLV4MATH_ALIGN_PREFIX F32 mag[4] LL_LLV4MATH_ALIGN_POSTFIX;
+
+	for (U32 i = 0; i < vec_end; i += 4)
+	{
+		V4F32 t = _mm_loadu_ps(&mRotU[i]);
+		V4F32 inv_t = _mm_sub_ps(one, t);
+
+		V4F32 r[4];
+		V4F32 d = _mm_setzero_ps();
+		V4F32 m = _mm_setzero_ps();
+		for (U32 c = 0; c < 4; ++c)
+		{
+			V4F32 a = _mm_loadu_ps(&mRotBefore[c][i]);
+			V4F32 b = _mm_loadu_ps(&mRotAfter[c][i]);
+			d = _mm_add_ps(d, _mm_mul_ps(a, b));
+			r[c] = _mm_add_ps(_mm_mul_ps(t, b), _mm_mul_ps(inv_t, a));
+			m = _mm_add_ps(m, _mm_mul_ps(r[c], r[c]));
+		}
+		m = _mm_sqrt_ps(m);
+
+		// like LLQuaternion::normalize(), leave results within tolerance of unit length alone
+		V4F32 off_unit = _mm_cmpgt_ps(_mm_andnot_ps(sign_mask, _mm_sub_ps(one, m)), unit_tolerance);
+		V4F32 scale = _mm_or_ps(_mm_and_ps(off_unit, _mm_div_ps(one, m)), _mm_andnot_ps(off_unit, one));
+		for (U32 c = 0; c < 4; ++c)
+		{
+			_mm_storeu_ps(&mResult[c][i], _mm_mul_ps(r[c], scale));
+		}
+
+		_mm_store_ps(dot, d);
+		_mm_store_ps(mag, m);
+		for (U32 j = 0; j < 4; ++j)
+		{
+			if (dot[j] < 0.f || mag[j] <= FP_MAG_THRESHOLD)
+			{
+				// opposite hemispheres take the slerp path, degenerate
+				// results become identity, both handled by nlerp()
+				LLQuaternion q = nlerp(mRotU[i+j], load_quat(mRotBefore, i+j), load_quat(mRotAfter, i+j));
+				for (U32 c = 0; c < 4; ++c)
+				{
+					mResult[c][i+j] = q.mQ[c];
+				}
+			}
+		}
+	}
+#endif
+
+	for (U32 i = vec_end; i < count; ++i)
+	{
+		LLQuaternion q = nlerp(mRotU[i], load_quat(mRotBefore, i), load_quat(mRotAfter, i));
+		for (U32 c = 0; c < 4; ++c)
+		{
+			mResult[c][i] = q.mQ[c];
+		}
+	}
+
+	for (U32 i = 0; i < count; ++i)
+	{
+		mRotJoints[i]->setRotation(load_quat(mResult, i));
+	}
+
+	mRotJoints.clear();
+	for (U32 i = 0; i < 4; ++i)
+	{
+		mRotBefore[i].clear();
+		mRotAfter[i].clear();
+	}
+	mRotU.clear();
+}
+
+//-----------------------------------------------------------------------------
+// InterpolationBatch::applyPositions()
+// same result as lerp() for each joint
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::InterpolationBatch::applyPositions()
+{
+	const U32 count = mPosJoints.size();
+	for (U32 i = 0; i < 3; ++i)
+	{
+		mResult[i].resize(count);
+	}
+
+	U32 vec_end = 0;
+#if LL_VECTORIZE
+	vec_end = count & ~3;
+	for (U32 i = 0; i < vec_end; i += 4)
+	{
+		V4F32 u = _mm_loadu_ps(&mPosU[i]);
+		for (U32 c = 0; c < 3; ++c)
+		{
+			V4F32 a = _mm_loadu_ps(&mPosBefore[c][i]);
+			V4F32 b = _mm_loadu_ps(&mPosAfter[c][i]);
+			_mm_storeu_ps(&mResult[c][i], _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), u)));
+		}
+	}
+#endif
+
+	for (U32 i = vec_end; i < count; ++i)
+	{
+		for (U32 c = 0; c < 3; ++c)
+		{
+			mResult[c][i] = mPosBefore[c][i] + (mPosAfter[c][i] - mPosBefore[c][i]) * mPosU[i];
+		}
+	}
+
+	for (U32 i = 0; i < count; ++i)
+	{
+		LLVector3 position(mResult[VX][i], mResult[VY][i], mResult[VZ][i]);
+		llassert(position.isFinite());
+		mPosJoints[i]->setPosition(position);
+	}
+
+	mPosJoints.clear();
+	for (U32 i = 0; i < 3; ++i)
+	{
+		mPosBefore[i].clear();
+		mPosAfter[i].clear();
+	}
+	mPosU.clear();
+}
+
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // JointMotion class
@@ -379,8 +685,10 @@ LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, Po
 
 //-----------------------------------------------------------------------------
 // JointMotion::update()
+// scale is set directly, interpolated rotations and positions are queued
+// on batch for LLKeyframeMotion::applyKeyframes()
 //-----------------------------------------------------------------------------
-void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration)
+void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration, JointCursor& cursor, InterpolationBatch& batch)
 {
 	// this value being 0 is the cause of https://jira.lindenlab.com/browse/SL-22678 but I haven't 
 	// managed to get a stack to see how it got here. Testing for 0 here will stop the crash.
@@ -396,7 +704,7 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::SCALE) && mScaleCurve.mNumKeys)
 	{
-		joint_state->setScale( mScaleCurve.getValue( time, duration ) );
+		joint_state->setScale( mScaleCurve.getValue( time, duration, cursor.mScale ) );
 	}
 
 	//-------------------------------------------------------------------------
@@ -404,7 +712,17 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::ROT) && mRotationCurve.mNumKeys)
 	{
-		joint_state->setRotation( mRotationCurve.getValue( time, duration ) );
+		const RotationKey* before;
+		const RotationKey* after;
+		F32 u;
+		if (mRotationCurve.findKeys(time, cursor.mRotation, before, after, u) && mRotationCurve.mInterpolationType != IT_STEP)
+		{
+			batch.addRotation(joint_state, before->mRotation, after->mRotation, u);
+		}
+		else
+		{
+			joint_state->setRotation( before->mRotation );
+		}
 	}
 
 	//-------------------------------------------------------------------------
@@ -412,7 +730,17 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::POS) && mPositionCurve.mNumKeys)
 	{
-		joint_state->setPosition( mPositionCurve.getValue( time, duration ) );
+		const PositionKey* before;
+		const PositionKey* after;
+		F32 u;
+		if (mPositionCurve.findKeys(time, cursor.mPosition, before, after, u) && mPositionCurve.mInterpolationType != IT_STEP)
+		{
+			batch.addPosition(joint_state, before->mPosition, after->mPosition, u);
+		}
+		else
+		{
+			joint_state->setPosition( before->mPosition );
+		}
 	}
 }
 
@@ -721,12 +1049,19 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
 	llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
+	if (mJointCursors.size() != mJointMotionList->getNumJointMotions())
+	{
+		mJointCursors.resize(mJointMotionList->getNumJointMotions());
+	}
 	for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
 	{
 		mJointMotionList->getJointMotion(i)->update(mJointStates[i],
 													  time, 
-													  mJointMotionList->mDuration );
+													  mJointMotionList->mDuration,
+													  mJointCursors[i],
+													  mInterpolationBatch );
 	}
+	mInterpolationBatch.apply();
 
 	LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
 	if (pose_priority)
@@ -1497,8 +1832,9 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				return FALSE;
 			}
 
-			rCurve->mKeys[time] = rot_key;
+			rCurve->mKeys.push_back(rot_key);
 		}
+		rCurve->sortKeys();
 
 		//---------------------------------------------------------------------
 		// scan position curve header
@@ -1576,7 +1912,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				return FALSE;
 			}
 			
-			pCurve->mKeys[pos_key.mTime] = pos_key;
+			pCurve->mKeys.push_back(pos_key);
 
 			if (is_pelvis)
 			{
@@ -1584,6 +1920,8 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 			}
 		}
 
+		pCurve->sortKeys();
+
 		joint_motion->mUsage = joint_state->getUsage();
 	}
 
@@ -1827,10 +2165,10 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
 		success &= dp.packS32(joint_motionp->mPriority, "joint_priority");
 		success &= dp.packS32(joint_motionp->mRotationCurve.mNumKeys, "num_rot_keys");
 
-		for (RotationCurve::key_map_t::iterator iter = joint_motionp->mRotationCurve.mKeys.begin();
+		for (RotationCurve::key_list_t::iterator iter = joint_motionp->mRotationCurve.mKeys.begin();
 			 iter != joint_motionp->mRotationCurve.mKeys.end(); ++iter)
 		{
-			RotationKey& rot_key = iter->second;
+			RotationKey& rot_key = *iter;
 			U16 time_short = F32_to_U16(rot_key.mTime, 0.f, mJointMotionList->mDuration);
 			success &= dp.packU16(time_short, "time");
 
@@ -1847,10 +2185,10 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
 		}
 
 		success &= dp.packS32(joint_motionp->mPositionCurve.mNumKeys, "num_pos_keys");
-		for (PositionCurve::key_map_t::iterator iter = joint_motionp->mPositionCurve.mKeys.begin();
+		for (PositionCurve::key_list_t::iterator iter = joint_motionp->mPositionCurve.mKeys.begin();
 			 iter != joint_motionp->mPositionCurve.mKeys.end(); ++iter)
 		{
-			PositionKey& pos_key = iter->second;
+			PositionKey& pos_key = *iter;
 			U16 time_short = F32_to_U16(pos_key.mTime, 0.f, mJointMotionList->mDuration);
 			success &= dp.packU16(time_short, "time");
 
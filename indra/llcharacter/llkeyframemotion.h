@@ -319,13 +319,16 @@ public:
 	public:
 		ScaleCurve();
 		~ScaleCurve();
-		LLVector3 getValue(F32 time, F32 duration);
+		LLVector3 getValue(F32 time, F32 duration) const;
+		LLVector3 getValue(F32 time, F32 duration, S32& cursor) const;
+		BOOL findKeys(F32 time, S32& cursor, const ScaleKey*& before, const ScaleKey*& after, F32& u) const;
+		void sortKeys();
 		LLVector3 interp(F32 u, ScaleKey& before, ScaleKey& after);
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, ScaleKey> key_map_t;
-		key_map_t 			mKeys;
+		typedef std::vector<ScaleKey> key_list_t;
+		key_list_t 			mKeys;
 		ScaleKey			mLoopInKey;
 		ScaleKey			mLoopOutKey;
 	};
@@ -338,13 +341,16 @@ public:
 	public:
 		RotationCurve();
 		~RotationCurve();
-		LLQuaternion getValue(F32 time, F32 duration);
+		LLQuaternion getValue(F32 time, F32 duration) const;
+		LLQuaternion getValue(F32 time, F32 duration, S32& cursor) const;
+		BOOL findKeys(F32 time, S32& cursor, const RotationKey*& before, const RotationKey*& after, F32& u) const;
+		void sortKeys();
 		LLQuaternion interp(F32 u, RotationKey& before, RotationKey& after);
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, RotationKey> key_map_t;
-		key_map_t		mKeys;
+		typedef std::vector<RotationKey> key_list_t;
+		key_list_t		mKeys;
 		RotationKey		mLoopInKey;
 		RotationKey		mLoopOutKey;
 	};
@@ -357,17 +363,63 @@ public:
 	public:
 		PositionCurve();
 		~PositionCurve();
-		LLVector3 getValue(F32 time, F32 duration);
+		LLVector3 getValue(F32 time, F32 duration) const;
+		LLVector3 getValue(F32 time, F32 duration, S32& cursor) const;
+		BOOL findKeys(F32 time, S32& cursor, const PositionKey*& before, const PositionKey*& after, F32& u) const;
+		void sortKeys();
 		LLVector3 interp(F32 u, PositionKey& before, PositionKey& after);
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, PositionKey> key_map_t;
-		key_map_t		mKeys;
+		typedef std::vector<PositionKey> key_list_t;
+		key_list_t		mKeys;
 		PositionKey		mLoopInKey;
 		PositionKey		mLoopOutKey;
 	};
 
+	//-------------------------------------------------------------------------
+	// JointCursor
+	// per-instance key indices into the shared curves of a JointMotion
+	//-------------------------------------------------------------------------
+	class JointCursor
+	{
+	public:
+		JointCursor() : mScale(0), mRotation(0), mPosition(0) {}
+
+		S32				mScale;
+		S32				mRotation;
+		S32				mPosition;
+	};
+
+	//-------------------------------------------------------------------------
+	// InterpolationBatch
+	// rotation and position interpolations gathered across all joints by
+	// applyKeyframes() and evaluated together
+	//-------------------------------------------------------------------------
+	class InterpolationBatch
+	{
+	public:
+		void addRotation(LLJointState* joint_state, const LLQuaternion& before, const LLQuaternion& after, F32 u);
+		void addPosition(LLJointState* joint_state, const LLVector3& before, const LLVector3& after, F32 u);
+
+		// sets the interpolated values on the joint states and clears the batch
+		void apply();
+
+	private:
+		void applyRotations();
+		void applyPositions();
+
+		std::vector<LLJointState*>	mRotJoints;
+		std::vector<F32>			mRotBefore[4];
+		std::vector<F32>			mRotAfter[4];
+		std::vector<F32>			mRotU;
+		std::vector<LLJointState*>	mPosJoints;
+		std::vector<F32>			mPosBefore[3];
+		std::vector<F32>			mPosAfter[3];
+		std::vector<F32>			mPosU;
+		std::vector<F32>			mResult[4];
+	};
+
 	//-------------------------------------------------------------------------
 	// JointMotion
 	//-------------------------------------------------------------------------
@@ -381,7 +433,7 @@ public:
 		U32				mUsage;
 		LLJoint::JointPriority	mPriority;
 
-		void update(LLJointState* joint_state, F32 time, F32 duration);
+		void update(LLJointState* joint_state, F32 time, F32 duration, JointCursor& cursor, InterpolationBatch& batch);
 	};
 	
 	//-------------------------------------------------------------------------
@@ -424,6 +476,8 @@ protected:
 	//-------------------------------------------------------------------------
 	JointMotionList*				mJointMotionList;
 	std::vector<LLPointer<LLJointState> > mJointStates;
+	std::vector<JointCursor>		mJointCursors;
+	InterpolationBatch				mInterpolationBatch;
 	LLJoint*						mPelvisp;
 	LLCharacter*					mCharacter;
 	typedef std::list<JointConstraint*>	constraint_list_t;
@@ -138,6 +138,8 @@ LLMotionController::LLMotionController()
 	  mTimeStep(0.f),
 	  mTimeStepCount(0),
 	  mLastInterp(0.f),
+	  mEvaluating(FALSE),
+	  mForceUpdate(FALSE),
 	  mIsSelf(FALSE)
 {
 }
@@ -511,7 +513,7 @@ void LLMotionController::updateIdleMotion(LLMotion* motionp)
 		// this will only be called when an animation stops itself (runs out of time)
 		if (mLastTime <= motionp->mSendStopTimestamp)
 		{
-			mCharacter->requestStopMotion( motionp );
+			requestStopMotion( motionp );
 			stopMotionInstance(motionp, FALSE);
 		}
 	}
@@ -612,7 +614,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// this will only be called when an animation stops itself (runs out of time)
 				if (mLastTime <= motionp->mSendStopTimestamp)
 				{
-					mCharacter->requestStopMotion( motionp );
+					requestStopMotion( motionp );
 					stopMotionInstance(motionp, FALSE);
 				}
 			}
@@ -693,7 +695,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// this will only be called when an animation stops itself (runs out of time)
 				if (mLastTime <= motionp->mSendStopTimestamp)
 				{
-					mCharacter->requestStopMotion( motionp );
+					requestStopMotion( motionp );
 					stopMotionInstance(motionp, FALSE);
 				}
 			}
@@ -737,7 +739,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// animation has stopped itself due to internal logic
 				// propagate this to the network
 				// as not all viewers are guaranteed to have access to the same logic
-				mCharacter->requestStopMotion( motionp );
+				requestStopMotion( motionp );
 				stopMotionInstance(motionp, FALSE);
 			}
 
@@ -799,8 +801,22 @@ void LLMotionController::updateLoadingMotions()
 // updateMotion()
 //-----------------------------------------------------------------------------
 void LLMotionController::updateMotions(bool force_update)
+{
+	if (beginUpdate(force_update))
+	{
+		updateActiveMotions();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// beginUpdate()
+// advances the animation clock and finishes loading motions
+// returns FALSE if there is no new pose to evaluate this frame
+//-----------------------------------------------------------------------------
+BOOL LLMotionController::beginUpdate(bool force_update)
 {
 	BOOL use_quantum = (mTimeStep != 0.f);
+	mForceUpdate = force_update;
 
 	// Always update mPrevTimerElapsed
 	F32 cur_time = mTimer.getElapsedTimeF32();
@@ -832,7 +848,7 @@ void LLMotionController::updateMotions(bool force_update)
 				}
 
 				updateLoadingMotions();
-				return;
+				return FALSE;
 			}
 			
 			// is calculating a new keyframe pose, make sure the last one gets applied
@@ -851,9 +867,48 @@ void LLMotionController::updateMotions(bool force_update)
 
 	updateLoadingMotions();
 
+	return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// evaluateMotions()
+// only touches this controller's motions and character joints, so
+// different controllers may be evaluated concurrently
+//-----------------------------------------------------------------------------
+void LLMotionController::evaluateMotions()
+{
+	mEvaluating = TRUE;
+	updateActiveMotions();
+	mEvaluating = FALSE;
+}
+
+//-----------------------------------------------------------------------------
+// commitUpdate()
+// forwards the stop notifications queued by evaluateMotions()
+//-----------------------------------------------------------------------------
+void LLMotionController::commitUpdate()
+{
+	for (motion_list_t::iterator iter = mPendingStopRequests.begin();
+		 iter != mPendingStopRequests.end(); ++iter)
+	{
+		LLMotion* motionp = *iter;
+		// the motion may have been deprecated and deleted since
+		if (mLoadedMotions.find(motionp) != mLoadedMotions.end())
+		{
+			mCharacter->requestStopMotion(motionp);
+		}
+	}
+	mPendingStopRequests.clear();
+}
+
+//-----------------------------------------------------------------------------
+// updateActiveMotions()
+//-----------------------------------------------------------------------------
+void LLMotionController::updateActiveMotions()
+{
 	resetJointSignatures();
 
-	if (mPaused && !force_update)
+	if (mPaused && !mForceUpdate)
 	{
 		updateIdleActiveMotions();
 	}
@@ -866,7 +921,7 @@ void LLMotionController::updateMotions(bool force_update)
 		// update all regular motions
 		updateRegularMotions();
 
-		if (use_quantum)
+		if (mTimeStep != 0.f)
 		{
 			mPoseBlender.blendAndCache(TRUE);
 		}
@@ -880,6 +935,22 @@ void LLMotionController::updateMotions(bool force_update)
 //	llinfos << "Motion controller time " << motionTimer.getElapsedTimeF32() << llendl;
 }
 
+//-----------------------------------------------------------------------------
+// requestStopMotion()
+// character notifications are not safe while evaluating off the main thread
+//-----------------------------------------------------------------------------
+void LLMotionController::requestStopMotion(LLMotion* motionp)
+{
+	if (mEvaluating)
+	{
+		mPendingStopRequests.push_back(motionp);
+	}
+	else
+	{
+		mCharacter->requestStopMotion(motionp);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // updateMotionsMinimal()
 // minimal update (e.g. while hidden)
@@ -133,6 +133,16 @@ public:
 	// deactivates terminated motions`
 	void updateMotions(bool force_update = false);
 
+	// updateMotions() split in three steps so several characters can be
+	// evaluated at once.  beginUpdate() and commitUpdate() must be called
+	// on the main thread; evaluateMotions() only touches this character
+	// and may run on a worker thread in between.
+	// beginUpdate() returns FALSE when there is no new pose to evaluate.
+	BOOL beginUpdate(bool force_update = false);
+	void evaluateMotions();
+	void commitUpdate();
+	BOOL isEvaluating() const { return mEvaluating; }
+
 	// minimal update (e.g. while hidden)
 	void updateMotionsMinimal();
 
@@ -177,6 +187,7 @@ protected:
 	void deprecateMotionInstance(LLMotion* motion);
 	BOOL stopMotionInstance(LLMotion *motion, BOOL stop_imemdiate);
 	void removeMotionInstance(LLMotion* motion);
+	void updateActiveMotions();
 	void updateRegularMotions();
 	void updateAdditiveMotions();
 	void resetJointSignatures();
@@ -185,6 +196,7 @@ protected:
 	void updateIdleActiveMotions();
 	void purgeExcessMotions();
 	void deactivateStoppedMotions();
+	void requestStopMotion(LLMotion* motionp);
 
 protected:
 	F32					mTimeFactor;
@@ -219,6 +231,9 @@ protected:
 	F32					mTimeStep;
 	S32					mTimeStepCount;
 	F32					mLastInterp;
+	BOOL				mEvaluating;
+	BOOL				mForceUpdate;
+	motion_list_t		mPendingStopRequests;
 
 	U8					mJointSignature[2][LL_CHARACTER_MAX_JOINTS];
 };
@@ -31,6 +31,8 @@
 
 #include "llvisualparam.h"
 
+#include <algorithm>
+
 //-----------------------------------------------------------------------------
 // LLVisualParamInfo()
 //-----------------------------------------------------------------------------
@@ -168,7 +170,9 @@ LLVisualParam::LLVisualParam()
 	mIsAnimating( FALSE ),
 	mID( -1 ),
 	mInfo( 0 ),
-	mIsDummy(FALSE)
+	mIsDummy(FALSE),
+	mTable( NULL ),
+	mIsDirty( FALSE )
 {
 }
 
@@ -234,6 +238,7 @@ void LLVisualParam::setWeight(F32 weight, BOOL upload_bake)
 	{
 		mCurWeight = weight;
 	}
+	markDirty();
 	
 	if (mNext)
 	{
@@ -306,6 +311,18 @@ void LLVisualParam::stopAnimating(BOOL upload_bake)
 	}
 }
 
+//-----------------------------------------------------------------------------
+// markDirty()
+//-----------------------------------------------------------------------------
+void LLVisualParam::markDirty()
+{
+	if (mTable && !mIsDirty)
+	{
+		mIsDirty = TRUE;
+		mTable->mDirtyParams.push_back(this);
+	}
+}
+
 //virtual
 BOOL LLVisualParam::linkDrivenParams(visual_param_mapper mapper, BOOL only_cross_params)
 {
@@ -319,3 +336,119 @@ void LLVisualParam::resetDrivenParams()
 	// nothing to do for non-driver parameters
 	return;
 }
+
+//-----------------------------------------------------------------------------
+// LLVisualParamTable()
+//-----------------------------------------------------------------------------
+LLVisualParamTable::LLVisualParamTable()
+:	mAppliedSex(SEX_BOTH)	// no avatar is both, the first pass checks every param
+{
+}
+
+//-----------------------------------------------------------------------------
+// LLVisualParamTable::add()
+//-----------------------------------------------------------------------------
+LLVisualParam* LLVisualParamTable::add(LLVisualParam* param)
+{
+	S32 id = param->getID();
+	std::vector<S32>::iterator iter = std::lower_bound(mIDs.begin(), mIDs.end(), id);
+	S32 index = (S32)(iter - mIDs.begin());
+	LLVisualParam* replaced = NULL;
+	if (iter != mIDs.end() && *iter == id)
+	{
+		replaced = mParams[index];
+		mParams[index] = param;
+		if (replaced->mIsDirty)
+		{
+			mDirtyParams.erase(std::find(mDirtyParams.begin(), mDirtyParams.end(), replaced));
+			replaced->mIsDirty = FALSE;
+		}
+		replaced->mTable = NULL;
+	}
+	else
+	{
+		mIDs.insert(iter, id);
+		mParams.insert(mParams.begin() + index, param);
+	}
+
+	// a new param hasn't been applied at its weight yet
+	param->mTable = this;
+	param->markDirty();
+	return replaced;
+}
+
+//-----------------------------------------------------------------------------
+// LLVisualParamTable::findIndex()
+//-----------------------------------------------------------------------------
+S32 LLVisualParamTable::findIndex(S32 id) const
+{
+	std::vector<S32>::const_iterator iter = std::lower_bound(mIDs.begin(), mIDs.end(), id);
+	if (iter == mIDs.end() || *iter != id)
+	{
+		return -1;
+	}
+	return (S32)(iter - mIDs.begin());
+}
+
+//-----------------------------------------------------------------------------
+// LLVisualParamTable::find()
+//-----------------------------------------------------------------------------
+LLVisualParam* LLVisualParamTable::find(S32 id) const
+{
+	S32 index = findIndex(id);
+	return (index < 0) ? NULL : mParams[index];
+}
+
+//-----------------------------------------------------------------------------
+// LLVisualParamTable::applyChanged()
+//-----------------------------------------------------------------------------
+S32 LLVisualParamTable::applyChanged(ESex avatar_sex, BOOL include_animating)
+{
+	if (avatar_sex != mAppliedSex)
+	{
+		// params of the other sex fall back to their default weight
+		mAppliedSex = avatar_sex;
+		for (std::vector<LLVisualParam*>::iterator iter = mParams.begin(); iter != mParams.end(); ++iter)
+		{
+			(*iter)->markDirty();
+		}
+	}
+
+	// apply() may queue more params, so walk by index and compact the
+	// ones that have to wait for a later pass in place
+	S32 num_applied = 0;
+	U32 num_kept = 0;
+	for (U32 i = 0; i < mDirtyParams.size(); ++i)
+	{
+		LLVisualParam* param = mDirtyParams[i];
+		if (param->isAnimating() && !include_animating)
+		{
+			mDirtyParams[num_kept++] = param;
+			continue;
+		}
+		param->mIsDirty = FALSE;
+
+		// only apply parameters whose effective weight has changed
+		F32 effective_weight = ( param->getSex() & avatar_sex ) ? param->getCurrentWeight() : param->getDefaultWeight();
+		if (effective_weight != param->getLastWeight())
+		{
+			F32 last_weight = param->getLastWeight();
+			param->apply( avatar_sex );
+			++num_applied;
+
+			// apply() steps mLastWeight by a delta, which can land an ulp
+			// short of the target; keep it queued until it settles.  Params
+			// that don't track a last weight (drivers) are done here.
+			effective_weight = ( param->getSex() & avatar_sex ) ? param->getCurrentWeight() : param->getDefaultWeight();
+			if (!param->mIsDirty
+				&& param->getLastWeight() != last_weight
+				&& param->getLastWeight() != effective_weight)
+			{
+				param->mIsDirty = TRUE;
+				mDirtyParams[num_kept++] = param;
+			}
+		}
+	}
+	mDirtyParams.resize(num_kept);
+	return num_applied;
+}
@@ -31,8 +31,10 @@
 #include "llstring.h"
 #include "llxmltree.h"
 #include <boost/function.hpp>
+#include <vector>
 
 class LLPolyMesh;
+class LLVisualParamTable;
 class LLXmlTreeNode;
 
 enum ESex
@@ -144,12 +146,17 @@ public:
 	LLVisualParam*			getNextParam()		{ return mNext; }
 	void					setNextParam( LLVisualParam *next );
 	
-	virtual void			setAnimating(BOOL is_animating) { mIsAnimating = is_animating && !mIsDummy; }
+	virtual void			setAnimating(BOOL is_animating) { mIsAnimating = is_animating && !mIsDummy; markDirty(); }
 	BOOL					getAnimating() const { return mIsAnimating; }
 
 	void					setIsDummy(BOOL is_dummy) { mIsDummy = is_dummy; }
 
 protected:
+	// Queues this param for the next LLVisualParamTable::applyChanged() of
+	// the table holding it.  Anything changing mCurWeight, mIsAnimating or
+	// mLastWeight outside of apply() has to call this.
+	void				markDirty();
+
 	F32					mCurWeight;			// current weight
 	F32					mLastWeight;		// last weight
 	LLVisualParam*		mNext;				// next param in a shared chain
@@ -160,6 +167,51 @@ protected:
 
 	S32					mID;				// id for storing weight/morphtarget compares compactly
 	LLVisualParamInfo	*mInfo;
+
+private:
+	friend class LLVisualParamTable;
+	LLVisualParamTable*	mTable;				// table holding this param, if any
+	BOOL				mIsDirty;			// queued in mTable
+};
+
+//-----------------------------------------------------------------------------
+// LLVisualParamTable
+// Dense storage for a character's visual params, kept in ID order.
+// The IDs live in their own packed array so a lookup is a short binary
+// search over a few KB instead of a walk through map nodes.  Params queue
+// themselves when their weight changes, driven params included since
+// drivers set them through setWeight(), so applying weights only visits
+// the params that changed since the last pass.
+//-----------------------------------------------------------------------------
+class LLVisualParamTable
+{
+public:
+	LLVisualParamTable();
+
+	// Inserts param in ID order.  If a param with the same ID is already
+	// stored it is replaced and returned, otherwise returns NULL.
+	LLVisualParam*	add(LLVisualParam* param);
+
+	LLVisualParam*	find(S32 id) const;
+	S32				findIndex(S32 id) const; // -1 if not present
+
+	S32				size() const				{ return (S32)mParams.size(); }
+	LLVisualParam*	getParam(S32 index) const	{ return mParams[index]; }
+
+	// Applies every queued param whose effective weight differs from the
+	// weight it was last applied at and returns how many were applied.
+	// Animating params stay queued unless include_animating is set, in which
+	// case they are applied at their current interpolated weight.  A change
+	// of avatar_sex queues every param.
+	S32				applyChanged(ESex avatar_sex, BOOL include_animating);
+
+private:
+	friend class LLVisualParam;
+
+	std::vector<S32>			mIDs;
+	std::vector<LLVisualParam*>	mParams;
+	std::vector<LLVisualParam*>	mDirtyParams;
+	ESex						mAppliedSex;
 };
 
 #endif // LL_LLVisualParam_H
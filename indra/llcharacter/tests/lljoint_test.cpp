@@ -220,6 +220,115 @@ namespace tut
 	}
 
 
+	// builds root -> (hip -> (knee -> foot), spine -> head) and poses it
+	struct lljoint_rig
+	{
+		lljoint_rig()
+			: mRoot("root"), mHip("hip"), mKnee("knee"), mFoot("foot"), mSpine("spine"), mHead("head")
+		{
+			mRoot.addChild(&mHip);
+			mHip.addChild(&mKnee);
+			mKnee.addChild(&mFoot);
+			mRoot.addChild(&mSpine);
+			mSpine.addChild(&mHead);
+
+			mRoot.setPosition(LLVector3(10.f, 20.f, 1.f));
+			mRoot.setRotation(LLQuaternion(0.3f, LLVector3(0.f, 0.f, 1.f)));
+			mHip.setPosition(LLVector3(0.f, 0.1f, -0.2f));
+			mHip.setScale(LLVector3(1.1f, 0.9f, 1.2f));
+			mKnee.setPosition(LLVector3(0.f, 0.f, -0.5f));
+			mKnee.setRotation(LLQuaternion(-0.7f, LLVector3(0.f, 1.f, 0.f)));
+			mFoot.setPosition(LLVector3(0.1f, 0.f, -0.45f));
+			mSpine.setPosition(LLVector3(0.f, 0.f, 0.3f));
+			mSpine.setRotation(LLQuaternion(0.2f, LLVector3(1.f, 0.f, 0.f)));
+			mHead.setPosition(LLVector3(0.f, 0.f, 0.4f));
+		}
+
+		LLJoint* get(S32 i)
+		{
+			LLJoint* joints[] = { &mRoot, &mHip, &mKnee, &mFoot, &mSpine, &mHead };
+			return joints[i];
+		}
+
+		LLJoint mRoot, mHip, mKnee, mFoot, mSpine, mHead;
+	};
+
+	static void ensure_same_pose(const std::string& msg, lljoint_rig& bound, lljoint_rig& unbound)
+	{
+		for (S32 i = 0; i < 6; ++i)
+		{
+			const LLMatrix4& a = bound.get(i)->getWorldMatrix();
+			const LLMatrix4& b = unbound.get(i)->getWorldMatrix();
+			for (S32 r = 0; r < 4; ++r)
+			{
+				for (S32 c = 0; c < 4; ++c)
+				{
+					ensure_approximately_equals((msg + " matrix " + bound.get(i)->getName()).c_str(),
+						a.mMatrix[r][c], b.mMatrix[r][c], 16);
+				}
+			}
+			ensure((msg + " position " + bound.get(i)->getName()).c_str(),
+				dist_vec(bound.get(i)->getWorldPosition(), unbound.get(i)->getWorldPosition()) < 1e-5f);
+			ensure((msg + " xform " + bound.get(i)->getName()).c_str(),
+				dist_vec(bound.get(i)->getXform()->getWorldPosition(), unbound.get(i)->getWorldPosition()) < 1e-5f);
+		}
+	}
+
+	// bound joints give the same transforms as the recursive update
+	template<> template<>
+	void lljoint_object::test<15>()
+	{
+		lljoint_rig bound, unbound;
+		LLSkeletonPose pose;
+		pose.bind(&bound.mRoot);
+		ensure("bind failed", pose.isBound() && bound.mFoot.getPose() == &pose);
+		ensure_equals("joint count", pose.getTopology()->getNumJoints(), 6);
+
+		bound.mRoot.updateWorldMatrixChildren();
+		unbound.mRoot.updateWorldMatrixChildren();
+		ensure_same_pose("initial", bound, unbound);
+
+		// local edits after the bind, read back lazily without a bulk update
+		for (S32 i = 0; i < 2; ++i)
+		{
+			lljoint_rig& rig = i ? unbound : bound;
+			rig.mHip.setRotation(LLQuaternion(0.5f, LLVector3(1.f, 0.f, 0.f)));
+			rig.mRoot.setPosition(LLVector3(11.f, 19.f, 2.f));
+			rig.mSpine.setScale(LLVector3(1.3f, 1.3f, 0.8f));
+		}
+		ensure_same_pose("lazy", bound, unbound);
+		ensure("local rotation", bound.mHip.getRotation() == unbound.mHip.getRotation());
+		ensure("local scale", bound.mSpine.getScale() == unbound.mSpine.getScale());
+	}
+
+	// identical hierarchies share a topology, hierarchy changes unbind
+	template<> template<>
+	void lljoint_object::test<16>()
+	{
+		lljoint_rig rig1, rig2;
+		LLSkeletonPose pose1, pose2;
+		pose1.bind(&rig1.mRoot);
+		pose2.bind(&rig2.mRoot);
+		ensure("topology not shared", pose1.getTopology() == pose2.getTopology());
+		ensure_equals("parent before child", pose1.getTopology()->getParent(3), 2);
+		ensure_equals("subtree size", pose1.getTopology()->getSubtreeSize(1), 3);
+
+		LLJoint extra("extra");
+		rig2.mHead.addChild(&extra);
+		ensure("addChild did not unbind", !pose2.isBound() && rig2.mHead.getPose() == NULL);
+		ensure("other pose unbound", pose1.isBound());
+
+		pose2.bind(&rig2.mRoot);
+		ensure("different hierarchy shares topology", pose1.getTopology() != pose2.getTopology());
+
+		// transforms survive unbinding
+		rig1.mKnee.setPosition(LLVector3(0.f, 0.2f, -0.6f));
+		rig2.mKnee.setPosition(LLVector3(0.f, 0.2f, -0.6f));
+		pose1.unbind();
+		pose2.unbind();
+		ensure_same_pose("unbound", rig1, rig2);
+	}
+
 	/*
 		Test cases for the following not added. They perform operations 
 		on underlying LLXformMatrix	and LLVector3 elements which have
@@ -0,0 +1,346 @@
+/** 
+ * @file llvisualparam_test.cpp
+ * @brief LLVisualParamTable test cases.
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#include "linden_common.h"
+
+#include "../llvisualparam.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	class test_param_info : public LLVisualParamInfo
+	{
+	public:
+		test_param_info(S32 id, ESex sex, F32 default_weight)
+		{
+			mID = id;
+			mSex = sex;
+			mMinWeight = -1.f;
+			mMaxWeight = 2.f;
+			mDefaultWeight = default_weight;
+		}
+	};
+
+	// Accumulates the differential update the way LLPolyMorphTarget does,
+	// so mApplied holds what a mesh driven by this param would hold.
+	class test_param : public LLVisualParam
+	{
+	public:
+		test_param(S32 id, ESex sex = SEX_BOTH, F32 default_weight = 0.f)
+			: mTestInfo(id, sex, default_weight),
+			  mApplied(0.f),
+			  mApplyCount(0)
+		{
+			mInfo = &mTestInfo;
+			mID = id;
+			setWeight(default_weight, FALSE);
+		}
+
+		/*virtual*/ void apply( ESex avatar_sex )
+		{
+			F32 delta_weight = ( getSex() & avatar_sex ) ? (mCurWeight - mLastWeight) : (getDefaultWeight() - mLastWeight);
+			mLastWeight += delta_weight;
+			mApplied += delta_weight;
+			mApplyCount++;
+		}
+
+		test_param_info mTestInfo;
+		F32 mApplied;
+		S32 mApplyCount;
+	};
+
+	// Pushes its weight into driven params the way LLDriverParam does.
+	class test_driver_param : public test_param
+	{
+	public:
+		test_driver_param(S32 id) : test_param(id) {}
+
+		/*virtual*/ void apply( ESex avatar_sex ) {}
+		/*virtual*/ void setWeight(F32 weight, BOOL upload_bake)
+		{
+			LLVisualParam::setWeight(weight, upload_bake);
+			for (std::vector<LLVisualParam*>::iterator iter = mDriven.begin(); iter != mDriven.end(); ++iter)
+			{
+				if (!mIsAnimating || (*iter)->getAnimating())
+				{
+					(*iter)->setWeight(mCurWeight * 0.5f + 0.1f, upload_bake);
+				}
+			}
+		}
+		/*virtual*/ void setAnimationTarget(F32 target_value, BOOL upload_bake)
+		{
+			LLVisualParam::setAnimationTarget(target_value, upload_bake);
+			for (std::vector<LLVisualParam*>::iterator iter = mDriven.begin(); iter != mDriven.end(); ++iter)
+			{
+				(*iter)->setAnimationTarget(mTargetWeight * 0.5f + 0.1f, upload_bake);
+			}
+		}
+		/*virtual*/ void stopAnimating(BOOL upload_bake)
+		{
+			LLVisualParam::stopAnimating(upload_bake);
+			for (std::vector<LLVisualParam*>::iterator iter = mDriven.begin(); iter != mDriven.end(); ++iter)
+			{
+				(*iter)->setAnimating(FALSE);
+			}
+		}
+
+		std::vector<LLVisualParam*> mDriven;
+	};
+
+	// One character's worth of params: a few drivers, each with two driven
+	// params, plus free standing params of mixed sex, in ID order.
+	struct test_param_set
+	{
+		test_param_set()
+		{
+			S32 id = 1;
+			for (S32 i = 0; i < 4; ++i)
+			{
+				test_driver_param* driver = new test_driver_param(id++);
+				mParams.push_back(driver);
+				for (S32 j = 0; j < 2; ++j)
+				{
+					test_param* driven = new test_param(id++);
+					driver->mDriven.push_back(driven);
+					mParams.push_back(driven);
+				}
+			}
+			for (S32 i = 0; i < 12; ++i)
+			{
+				ESex sex = (i % 3 == 0) ? SEX_FEMALE : ((i % 3 == 1) ? SEX_MALE : SEX_BOTH);
+				mParams.push_back(new test_param(id++, sex, (i % 4) * 0.25f));
+			}
+		}
+
+		~test_param_set()
+		{
+			for (std::vector<test_param*>::iterator iter = mParams.begin(); iter != mParams.end(); ++iter)
+			{
+				delete *iter;
+			}
+		}
+
+		std::vector<test_param*> mParams;
+	};
+
+	// what LLCharacter::updateVisualParams() did before the table existed
+	void reference_update(test_param_set& set, ESex sex)
+	{
+		for (std::vector<test_param*>::iterator iter = set.mParams.begin(); iter != set.mParams.end(); ++iter)
+		{
+			LLVisualParam* param = *iter;
+			if (param->isAnimating())
+			{
+				continue;
+			}
+			F32 effective_weight = ( param->getSex() & sex ) ? param->getWeight() : param->getDefaultWeight();
+			if (effective_weight != param->getLastWeight())
+			{
+				param->apply(sex);
+			}
+		}
+	}
+
+	// what LLVOAvatar::idleUpdateAppearanceAnimation() did every frame
+	void reference_apply_all(test_param_set& set, ESex sex)
+	{
+		for (std::vector<test_param*>::iterator iter = set.mParams.begin(); iter != set.mParams.end(); ++iter)
+		{
+			(*iter)->apply(sex);
+		}
+	}
+
+	// deterministic so a failure can be reproduced
+	U32 next_random(U32& seed)
+	{
+		seed = seed * 1664525 + 1013904223;
+		return seed >> 8;
+	}
+}
+
+namespace tut
+{
+	struct llvisualparam_data
+	{
+	};
+	typedef test_group<llvisualparam_data> llvisualparam_test;
+	typedef llvisualparam_test::object llvisualparam_object;
+	tut::llvisualparam_test llvisualparam_testcase("LLVisualParamTable");
+
+	template<> template<>
+	void llvisualparam_object::test<1>()
+	{
+		S32 ids[] = { 10032, 1, 568, 10000, 4, 1207 };
+		std::vector<test_param*> params;
+		LLVisualParamTable table;
+		for (S32 i = 0; i < 6; ++i)
+		{
+			params.push_back(new test_param(ids[i]));
+			ensure("add() of a new ID returns NULL", table.add(params.back()) == NULL);
+		}
+
+		ensure_equals("size()", table.size(), 6);
+		for (S32 i = 1; i < table.size(); ++i)
+		{
+			ensure("params are kept in ID order", table.getParam(i - 1)->getID() < table.getParam(i)->getID());
+		}
+		for (S32 i = 0; i < 6; ++i)
+		{
+			ensure("find() returns the param added under that ID", table.find(ids[i]) == params[i]);
+			ensure_equals("findIndex() agrees with getParam()", table.getParam(table.findIndex(ids[i]))->getID(), ids[i]);
+		}
+		ensure("find() of a missing ID", table.find(2) == NULL);
+		ensure("find() past the last ID", table.find(20000) == NULL);
+		ensure_equals("findIndex() before the first ID", table.findIndex(0), -1);
+
+		test_param* replacement = new test_param(568);
+		ensure("add() of an existing ID returns the old param", table.add(replacement) == params[2]);
+		ensure("find() returns the replacement", table.find(568) == replacement);
+		ensure_equals("replacing does not grow the table", table.size(), 6);
+
+		delete replacement;
+		for (std::vector<test_param*>::iterator iter = params.begin(); iter != params.end(); ++iter)
+		{
+			delete *iter;
+		}
+	}
+
+	template<> template<>
+	void llvisualparam_object::test<2>()
+	{
+		// Drive two identical param sets through the same weight changes and
+		// appearance animations.  One is applied the old way, the other through
+		// the table; every param must end up applied to the same weight.
+		test_param_set reference;
+		test_param_set compact;
+		LLVisualParamTable table;
+		for (S32 i = (S32)compact.mParams.size() - 1; i >= 0; --i)
+		{
+			table.add(compact.mParams[i]);
+		}
+
+		const S32 num_params = (S32)reference.mParams.size();
+		S32 reference_applies = 0;
+		S32 compact_applies = 0;
+		ESex sex = SEX_FEMALE;
+		U32 seed = 12345;
+		for (S32 step = 0; step < 200; ++step)
+		{
+			U32 op = next_random(seed) % 8;
+			S32 which = next_random(seed) % num_params;
+			F32 weight = (F32)(next_random(seed) % 1000) / 500.f - 0.5f;
+
+			if (op == 0)
+			{
+				sex = (sex == SEX_FEMALE) ? SEX_MALE : SEX_FEMALE;
+			}
+			else if (op < 5)
+			{
+				reference.mParams[which]->setWeight(weight, FALSE);
+				compact.mParams[which]->setWeight(weight, FALSE);
+			}
+			else
+			{
+				reference.mParams[which]->setAnimationTarget(weight, FALSE);
+				compact.mParams[which]->setAnimationTarget(weight, FALSE);
+				for (S32 frame = 0; frame < 6; ++frame)
+				{
+					for (S32 i = 0; i < num_params; ++i)
+					{
+						reference.mParams[i]->animate(0.3f, FALSE);
+						compact.mParams[i]->animate(0.3f, FALSE);
+					}
+					reference_apply_all(reference, sex);
+					table.applyChanged(sex, TRUE);
+				}
+				for (S32 i = 0; i < num_params; ++i)
+				{
+					reference.mParams[i]->stopAnimating(FALSE);
+					compact.mParams[i]->stopAnimating(FALSE);
+				}
+			}
+
+			reference_update(reference, sex);
+			table.applyChanged(sex, FALSE);
+
+			for (S32 i = 0; i < num_params; ++i)
+			{
+				ensure_equals("current weight", compact.mParams[i]->getCurrentWeight(), reference.mParams[i]->getCurrentWeight());
+				ensure_equals("applied weight", compact.mParams[i]->mApplied, reference.mParams[i]->mApplied);
+				ensure_equals("last weight", compact.mParams[i]->getLastWeight(), reference.mParams[i]->getLastWeight());
+			}
+		}
+
+		for (S32 i = 0; i < num_params; ++i)
+		{
+			reference_applies += reference.mParams[i]->mApplyCount;
+			compact_applies += compact.mParams[i]->mApplyCount;
+		}
+		ensure("unchanged params are not re-applied", compact_applies < reference_applies);
+	}
+
+	template<> template<>
+	void llvisualparam_object::test<3>()
+	{
+		// only params marked dirty since the last pass are looked at
+		test_param_set set;
+		LLVisualParamTable table;
+		for (std::vector<test_param*>::iterator iter = set.mParams.begin(); iter != set.mParams.end(); ++iter)
+		{
+			table.add(*iter);
+			(*iter)->setWeight((*iter)->getDefaultWeight() + 0.5f, FALSE);
+		}
+		table.applyChanged(SEX_FEMALE, FALSE);
+		table.applyChanged(SEX_FEMALE, FALSE);
+		ensure_equals("a settled table applies nothing", table.applyChanged(SEX_FEMALE, FALSE), 0);
+
+		test_param* param = set.mParams.back();
+		S32 apply_count = param->mApplyCount;
+		param->setWeight(param->getWeight() + 0.5f, FALSE);
+		ensure_equals("one changed weight applies one param", table.applyChanged(SEX_FEMALE, FALSE), 1);
+		ensure_equals("the changed param was applied", param->mApplyCount, apply_count + 1);
+		ensure_equals("and then nothing", table.applyChanged(SEX_FEMALE, FALSE), 0);
+
+		param->setAnimationTarget(param->getWeight() - 0.25f, FALSE);
+		param->animate(0.5f, FALSE);
+		ensure_equals("animating params wait", table.applyChanged(SEX_FEMALE, FALSE), 0);
+		ensure_equals("until animating params are included", table.applyChanged(SEX_FEMALE, TRUE), 1);
+		param->stopAnimating(FALSE);
+		table.applyChanged(SEX_FEMALE, FALSE);
+
+		ensure("a sex change re-applies single sex params", table.applyChanged(SEX_MALE, FALSE) > 0);
+		for (std::vector<test_param*>::iterator iter = set.mParams.begin(); iter != set.mParams.end(); ++iter)
+		{
+			test_param* p = *iter;
+			if (p->getSex() != SEX_BOTH)
+			{
+				F32 effective_weight = ( p->getSex() & SEX_MALE ) ? p->getWeight() : p->getDefaultWeight();
+				ensure_equals("applied for the new sex", p->getLastWeight(), effective_weight);
+			}
+		}
+	}
+}
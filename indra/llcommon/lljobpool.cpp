@@ -0,0 +1,221 @@
+/** 
+ * @file lljobpool.cpp
+ * @brief Fork/join pool running batches of jobs on worker threads.
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+  
+#include "linden_common.h"
+
+#include "lljobpool.h"
+
+#include "llsys.h"
+
+// The batches run one after the other in a frame, so one pool shared by
+// all of them may take all the spare cores.  More than this rarely pays for
+// the wake ups.
+static const U32 MAX_DEFAULT_WORKERS = 4;
+
+//-----------------------------------------------------------------------------
+// LLJobListWork
+//-----------------------------------------------------------------------------
+class LLJobListWork : public LLJobPool::Work
+{
+public:
+	LLJobListWork(LLJobPool::job_list_t& jobs) : mJobs(jobs) { }
+
+	/*virtual*/ void run(U32 index) { mJobs[index]->run(); }
+
+private:
+	LLJobPool::job_list_t& mJobs;
+};
+
+//-----------------------------------------------------------------------------
+// LLJobPool::Worker
+//-----------------------------------------------------------------------------
+LLJobPool::Worker::Worker(LLJobPool* pool, const std::string& name)
+:	LLThread(name),
+	mPool(pool),
+	mBatch(0),
+	mDoneBatch(0)
+{
+}
+
+void LLJobPool::Worker::kick(U32 batch)
+{
+	lockData();
+	mBatch = batch;
+	wakeLocked();
+	unlockData();
+}
+
+bool LLJobPool::Worker::runCondition()
+{
+	// called with mRunCondition locked
+	return mBatch != mDoneBatch;
+}
+
+void LLJobPool::Worker::run()
+{
+	while (1)
+	{
+		// sleeps until kick() or shutdown
+		checkPause();
+		if (isQuitting())
+		{
+			break;
+		}
+
+		lockData();
+		U32 batch = mBatch;
+		unlockData();
+
+		mPool->runPending();
+
+		// mark the batch done before releasing the caller of run(),
+		// otherwise the next kick() could be lost
+		lockData();
+		mDoneBatch = batch;
+		unlockData();
+
+		mPool->workerDone();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// LLJobPool
+//-----------------------------------------------------------------------------
+LLJobPool::LLJobPool(U32 num_workers, const std::string& name)
+:	mWork(NULL),
+	mCount(0),
+	mNextIndex(0),
+	mDoneCondition(NULL),
+	mBusyWorkers(0),
+	mBatch(0)
+{
+	for (U32 i = 0; i < num_workers; ++i)
+	{
+		Worker* worker = new Worker(this, llformat("%s %d", name.c_str(), i));
+		worker->start();
+		mWorkers.push_back(worker);
+	}
+}
+
+LLJobPool::~LLJobPool()
+{
+	for (std::vector<Worker*>::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		(*iter)->shutdown();
+		delete *iter;
+	}
+	mWorkers.clear();
+}
+
+//static
+U32 LLJobPool::resolveNumWorkers(S32 setting)
+{
+	if (setting >= 0)
+	{
+		return (U32)setting;
+	}
+	return llmin(LLCPUInfo::getProcessorCount() - 1, MAX_DEFAULT_WORKERS);
+}
+
+//static
+U32 LLJobPool::resolveMaxWorkers(S32 setting)
+{
+	return setting < 0 ? U32_MAX : (U32)setting;
+}
+
+void LLJobPool::run(Work& work, U32 count, U32 max_workers)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	mWork = &work;
+	mCount = count;
+	mNextIndex = 0;
+
+	if (mWorkers.empty() || max_workers == 0 || count < 2)
+	{
+		runPending();
+		mWork = NULL;
+		return;
+	}
+
+	// no point waking more workers than there are indices left over
+	// after the calling thread takes its share
+	U32 num_workers = llmin(llmin((U32)mWorkers.size(), max_workers), count - 1);
+
+	mDoneCondition.lock();
+	mBusyWorkers = num_workers;
+	mDoneCondition.unlock();
+
+	++mBatch;
+	for (U32 i = 0; i < num_workers; ++i)
+	{
+		mWorkers[i]->kick(mBatch);
+	}
+
+	runPending();
+
+	mDoneCondition.lock();
+	while (mBusyWorkers > 0)
+	{
+		mDoneCondition.wait();
+	}
+	mDoneCondition.unlock();
+
+	mWork = NULL;
+}
+
+void LLJobPool::run(job_list_t& jobs, U32 max_workers)
+{
+	LLJobListWork work(jobs);
+	run(work, jobs.size(), max_workers);
+}
+
+void LLJobPool::runPending()
+{
+	while (1)
+	{
+		// post-increment returns the previous value
+		U32 index = mNextIndex++;
+		if (index >= mCount)
+		{
+			break;
+		}
+		mWork->run(index);
+	}
+}
+
+void LLJobPool::workerDone()
+{
+	mDoneCondition.lock();
+	if (--mBusyWorkers == 0)
+	{
+		mDoneCondition.signal();
+	}
+	mDoneCondition.unlock();
+}
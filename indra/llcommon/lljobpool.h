@@ -0,0 +1,118 @@
+/** 
+ * @file lljobpool.h
+ * @brief Fork/join pool running batches of jobs on worker threads.
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+   
+#ifndef LL_LLJOBPOOL_H
+#define LL_LLJOBPOOL_H
+
+#include <string>
+#include <vector>
+
+#include "llapr.h"
+#include "llthread.h"
+
+//-----------------------------------------------------------------------------
+// class LLJobPool
+// Fork/join helper shared by the per-frame batches of the viewer (motion
+// evaluation, skinning, terrain decoding, flexible objects, sky tiles).
+// run() hands the indices of a batch out to the workers one at a time.  The
+// calling thread takes part in the work and run() returns once every index is
+// done, so the batch can be prepared before and committed after on the
+// calling thread.  Each index must only touch its own data.  Batches run one
+// at a time, so run() must not be called from inside a Work.
+//-----------------------------------------------------------------------------
+class LL_COMMON_API LLJobPool
+{
+public:
+	class Work
+	{
+	public:
+		virtual ~Work() { }
+
+		// called on any thread, once per index of the batch
+		virtual void run(U32 index) = 0;
+	};
+
+	// Batches of unrelated objects
+	class Job
+	{
+	public:
+		virtual ~Job() { }
+
+		// called on any thread
+		virtual void run() = 0;
+	};
+	typedef std::vector<Job*> job_list_t;
+
+	// name prefixes the names of the worker threads
+	LLJobPool(U32 num_workers, const std::string& name);
+	~LLJobPool();
+
+	// calls work.run(index) for every index below count, using at most
+	// max_workers workers besides the calling thread
+	void run(Work& work, U32 count, U32 max_workers = U32_MAX);
+	void run(job_list_t& jobs, U32 max_workers = U32_MAX);
+
+	U32 getNumWorkers() const { return mWorkers.size(); }
+
+	// Worker count for a thread count setting.  A negative setting takes one
+	// worker per processor core besides the calling thread, up to 4.
+	static U32 resolveNumWorkers(S32 setting);
+	// max_workers for run() from a per-batch thread setting.  A negative
+	// setting takes every worker, 0 keeps the batch on the calling thread.
+	static U32 resolveMaxWorkers(S32 setting);
+
+private:
+	class Worker : public LLThread
+	{
+	public:
+		Worker(LLJobPool* pool, const std::string& name);
+
+		// wakes the worker up for the given batch
+		void kick(U32 batch);
+
+	protected:
+		/*virtual*/ void run();
+		/*virtual*/ bool runCondition();
+
+	private:
+		LLJobPool*	mPool;
+		U32			mBatch;
+		U32			mDoneBatch;
+	};
+
+	void runPending();
+	void workerDone();
+
+	std::vector<Worker*>	mWorkers;
+	Work*					mWork;
+	U32						mCount;
+	LLAtomicU32				mNextIndex;
+	LLCondition				mDoneCondition;
+	U32						mBusyWorkers;
+	U32						mBatch;
+};
+
+#endif // LL_LLJOBPOOL_H
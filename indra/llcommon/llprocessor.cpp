@@ -132,7 +132,8 @@ namespace
 		eMONTIOR_MWAIT=33,
 		eCPLDebugStore=34,
 		eThermalMonitor2=35,
-		eAltivec=36
+		eAltivec=36,
+		eAVX=37
 	};
 
 	const char* cpu_feature_names[] =
@@ -175,7 +176,8 @@ namespace
 		"CPL Qualified Debug Store",
 		"Thermal Monitor 2",
 
-		"Altivec"
+		"Altivec",
+		"AVX"
 	};
 
 	std::string intel_CPUFamilyName(int composed_family) 
@@ -275,6 +277,11 @@ public:
 		return hasExtension("Altivec"); 
 	}
 
+	bool hasAVX() const
+	{
+		return hasExtension(cpu_feature_names[eAVX]);
+	}
+
 	std::string getCPUFamilyName() const { return getInfo(eFamilyName, "Unknown").asString(); }
 	std::string getCPUBrandName() const { return getInfo(eBrandName, "Unknown").asString(); }
 
@@ -733,29 +740,33 @@ private:
 		LLFILE* cpuinfo_fp = LLFile::fopen(CPUINFO_FILE, "rb");
 		if(cpuinfo_fp)
 		{
-			char line[MAX_STRING];
-			memset(line, 0, MAX_STRING);
-			while(fgets(line, MAX_STRING, cpuinfo_fp))
+			char buffer[MAX_STRING];
+			std::string line;
+			while(fgets(buffer, MAX_STRING, cpuinfo_fp))
 			{
+				// The flags line is far longer than the buffer, keep
+				// reading until the whole line is in.
+				line += buffer;
+				if (line[line.size() - 1] != '\n' && !feof(cpuinfo_fp))
+					continue;
+
 				// /proc/cpuinfo on Linux looks like:
 				// name\t*: value\n
-				char* tabspot = strchr( line, '\t' );
-				if (tabspot == NULL)
-					continue;
-				char* colspot = strchr( tabspot, ':' );
-				if (colspot == NULL)
-					continue;
-				char* spacespot = strchr( colspot, ' ' );
-				if (spacespot == NULL)
-					continue;
-				char* nlspot = strchr( line, '\n' );
-				if (nlspot == NULL)
-					nlspot = line + strlen( line ); // Fallback to terminating NUL
-				std::string linename( line, tabspot );
-				std::string llinename(linename);
-				LLStringUtil::toLower(llinename);
-				std::string lineval( spacespot + 1, nlspot );
-				cpuinfo[ llinename ] = lineval;
+				std::string::size_type tabspot = line.find( '\t' );
+				std::string::size_type colspot = line.find( ':', tabspot );
+				std::string::size_type spacespot = line.find( ' ', colspot );
+				if (tabspot != std::string::npos
+					&& colspot != std::string::npos
+					&& spacespot != std::string::npos)
+				{
+					std::string::size_type nlspot = line.find( '\n', spacespot );
+					if (nlspot == std::string::npos)
+						nlspot = line.size();
+					std::string llinename( line, 0, tabspot );
+					LLStringUtil::toLower(llinename);
+					cpuinfo[ llinename ] = line.substr( spacespot + 1, nlspot - spacespot - 1 );
+				}
+				line.clear();
 			}
 			fclose(cpuinfo_fp);
 		}
@@ -820,6 +831,12 @@ private:
 		{
 			setExtension(cpu_feature_names[eSSE2_Ext]);
 		}
+
+		// the kernel only reports avx when it also saves the ymm state
+		if( flags.find( " avx " ) != std::string::npos )
+		{
+			setExtension(cpu_feature_names[eAVX]);
+		}
 	
 # endif // LL_X86
 	}
@@ -881,6 +898,7 @@ F64 LLProcessorInfo::getCPUFrequency() const { return mImpl->getCPUFrequency();
 bool LLProcessorInfo::hasSSE() const { return mImpl->hasSSE(); }
 bool LLProcessorInfo::hasSSE2() const { return mImpl->hasSSE2(); }
 bool LLProcessorInfo::hasAltivec() const { return mImpl->hasAltivec(); }
+bool LLProcessorInfo::hasAVX() const { return mImpl->hasAVX(); }
 std::string LLProcessorInfo::getCPUFamilyName() const { return mImpl->getCPUFamilyName(); }
 std::string LLProcessorInfo::getCPUBrandName() const { return mImpl->getCPUBrandName(); }
 std::string LLProcessorInfo::getCPUFeatureDescription() const { return mImpl->getCPUFeatureDescription(); }
@@ -521,6 +521,7 @@ LLCPUInfo::LLCPUInfo()
 	mHasSSE = proc.hasSSE();
 	mHasSSE2 = proc.hasSSE2();
 	mHasAltivec = proc.hasAltivec();
+	mHasAVX = proc.hasAVX();
 	mCPUMHz = (F64)proc.getCPUFrequency();
 	mFamily = proc.getCPUFamilyName();
 	mCPUString = "Unknown";
@@ -548,6 +549,11 @@ bool LLCPUInfo::hasSSE2() const
 	return mHasSSE2;
 }
 
+bool LLCPUInfo::hasAVX() const
+{
+	return mHasAVX;
+}
+
 F64 LLCPUInfo::getMHz() const
 {
 	return mCPUMHz;
@@ -558,6 +564,28 @@ std::string LLCPUInfo::getCPUString() const
 	return mCPUString;
 }
 
+//static
+U32 LLCPUInfo::getProcessorCount()
+{
+	S32 count = 0;
+#if LL_WINDOWS
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	count = (S32)info.dwNumberOfProcessors;
+#elif LL_DARWIN
+	int mib[2] = { CTL_HW, HW_NCPU };
+	int ncpu = 0;
+	size_t len = sizeof(ncpu);
+	if (sysctl(mib, 2, &ncpu, &len, NULL, 0) == 0)
+	{
+		count = ncpu;
+	}
+#elif LL_LINUX || LL_SOLARIS
+	count = (S32)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return (U32)llmax(count, 1);
+}
+
 void LLCPUInfo::stream(std::ostream& s) const
 {
 	// gather machine information.
@@ -568,6 +596,7 @@ void LLCPUInfo::stream(std::ostream& s) const
 	s << "->mHasSSE:     " << (U32)mHasSSE << std::endl;
 	s << "->mHasSSE2:    " << (U32)mHasSSE2 << std::endl;
 	s << "->mHasAltivec: " << (U32)mHasAltivec << std::endl;
+	s << "->mHasAVX:     " << (U32)mHasAVX << std::endl;
 	s << "->mCPUMHz:     " << mCPUMHz << std::endl;
 	s << "->mCPUString:  " << mCPUString << std::endl;
 }
@@ -75,8 +75,12 @@ public:
 	bool hasAltivec() const;
 	bool hasSSE() const;
 	bool hasSSE2() const;
+	bool hasAVX() const;
 	F64 getMHz() const;
 
+	// Number of logical processors the OS reports as online, at least 1
+	static U32 getProcessorCount();
+
 	// Family is "AMD Duron" or "Intel Pentium Pro"
 	const std::string& getFamily() const { return mFamily; }
 
@@ -84,6 +88,7 @@ private:
 	bool mHasSSE;
 	bool mHasSSE2;
 	bool mHasAltivec;
+	bool mHasAVX;
 	F64 mCPUMHz;
 	std::string mFamily;
 	std::string mCPUString;
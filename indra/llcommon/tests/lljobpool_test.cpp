@@ -0,0 +1,148 @@
+/** 
+ * @file lljobpool_test.cpp
+ * @brief Tests for LLJobPool.
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../lljobpool.h"
+
+#include "../test/lltut.h"
+
+class LLCountingWork : public LLJobPool::Work
+{
+public:
+	LLCountingWork(U32 count) : mRuns(count, 0) { }
+
+	/*virtual*/ void run(U32 index) { ++mRuns[index]; }
+
+	std::vector<U32> mRuns;
+};
+
+class LLCountingJob : public LLJobPool::Job
+{
+public:
+	LLCountingJob() : mRuns(0) { }
+
+	/*virtual*/ void run() { ++mRuns; }
+
+	U32 mRuns;
+};
+
+namespace tut
+{
+	struct jobpool_test
+	{
+		jobpool_test()
+		{
+			ll_init_apr();
+		}
+	};
+	typedef test_group<jobpool_test> jobpool_group_t;
+	typedef jobpool_group_t::object jobpool_object_t;
+	tut::jobpool_group_t jobpool_instance("LLJobPool");
+
+	template<> template<>
+	void jobpool_object_t::test<1>()
+	{
+		// without workers everything runs on the calling thread
+		LLJobPool pool(0, "Test Pool");
+		ensure_equals("no workers", pool.getNumWorkers(), 0U);
+
+		LLCountingWork work(10);
+		pool.run(work, 10);
+		for (U32 i = 0; i < 10; ++i)
+		{
+			ensure_equals("index run once", work.mRuns[i], 1U);
+		}
+	}
+
+	template<> template<>
+	void jobpool_object_t::test<2>()
+	{
+		// consecutive batches on the same workers
+		LLJobPool pool(3, "Test Pool");
+		ensure_equals("workers", pool.getNumWorkers(), 3U);
+
+		for (U32 batch = 0; batch < 50; ++batch)
+		{
+			U32 count = 1 + batch * 37;
+			LLCountingWork work(count);
+			pool.run(work, count);
+			for (U32 i = 0; i < count; ++i)
+			{
+				ensure_equals("index run once", work.mRuns[i], 1U);
+			}
+		}
+	}
+
+	template<> template<>
+	void jobpool_object_t::test<3>()
+	{
+		LLJobPool pool(2, "Test Pool");
+
+		std::vector<LLCountingJob> counting_jobs(100);
+		LLJobPool::job_list_t jobs;
+		for (U32 i = 0; i < counting_jobs.size(); ++i)
+		{
+			jobs.push_back(&counting_jobs[i]);
+		}
+
+		pool.run(jobs);
+		pool.run(jobs);
+		for (U32 i = 0; i < counting_jobs.size(); ++i)
+		{
+			ensure_equals("job run once per batch", counting_jobs[i].mRuns, 2U);
+		}
+	}
+
+	template<> template<>
+	void jobpool_object_t::test<5>()
+	{
+		// batches sharing one pool, each capped to its own worker count
+		LLJobPool pool(3, "Test Pool");
+
+		for (U32 max_workers = 0; max_workers < 5; ++max_workers)
+		{
+			LLCountingWork work(200);
+			pool.run(work, 200, max_workers);
+			for (U32 i = 0; i < 200; ++i)
+			{
+				ensure_equals("index run once", work.mRuns[i], 1U);
+			}
+		}
+	}
+
+	template<> template<>
+	void jobpool_object_t::test<4>()
+	{
+		ensure_equals("explicit count", LLJobPool::resolveNumWorkers(0), 0U);
+		ensure_equals("explicit count", LLJobPool::resolveNumWorkers(6), 6U);
+		ensure("default count", LLJobPool::resolveNumWorkers(-1) <= 4U);
+
+		ensure_equals("calling thread only", LLJobPool::resolveMaxWorkers(0), 0U);
+		ensure_equals("explicit limit", LLJobPool::resolveMaxWorkers(2), 2U);
+		ensure_equals("whole pool", LLJobPool::resolveMaxWorkers(-1), U32_MAX);
+	}
+}
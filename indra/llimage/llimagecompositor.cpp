@@ -0,0 +1,377 @@
+/** 
+ * @file llimagecompositor.cpp
+ * @brief CPU implementation of the blend operations used to composite avatar bakes
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#include "linden_common.h"
+
+#include "llimagecompositor.h"
+
+#include <map>
+
+#include "llv4math.h"
+
+// SSE2 is only guaranteed when the whole build targets it (see llv4math.h).
+#if LL_VECTORIZE && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define LL_IMAGECOMPOSITOR_SSE2 1
+#include <emmintrin.h>
+#else
+#define LL_IMAGECOMPOSITOR_SSE2 0
+#endif
+
+//----------------------------------------------------------------------------
+// Kernels
+//
+// All arithmetic is 8 bit fixed point: a * b / 255 rounded to nearest, which
+// is what fixed function GL hardware does for blending.  Each term of the
+// blend equation is rounded separately and the sum is clamped.
+//----------------------------------------------------------------------------
+
+static inline U32 mul255(U32 a, U32 b)
+{
+	U32 x = a * b + 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static inline U32 blend_factor(LLImageCompositor::EBlendFactor f, U32 src_alpha, U32 dst_alpha)
+{
+	switch (f)
+	{
+	  case LLImageCompositor::BF_ZERO:					return 0;
+	  case LLImageCompositor::BF_ONE:					return 255;
+	  case LLImageCompositor::BF_SOURCE_ALPHA:			return src_alpha;
+	  case LLImageCompositor::BF_ONE_MINUS_SOURCE_ALPHA:	return 255 - src_alpha;
+	  case LLImageCompositor::BF_DEST_ALPHA:			return dst_alpha;
+	  case LLImageCompositor::BF_ONE_MINUS_DEST_ALPHA:	return 255 - dst_alpha;
+	}
+	return 0;
+}
+
+// static
+void LLImageCompositor::blendPixelsScalar(U8* dst, const U8* src, S32 pixels, const LLColor4U& tint,
+										  EBlendFactor sfactor, EBlendFactor dfactor,
+										  bool write_color, bool write_alpha)
+{
+	const S32 first = write_color ? 0 : 3;
+	const S32 last = write_alpha ? 4 : 3;
+	U32 s[4];
+	for (S32 i = 0; i < pixels; i++, dst += 4)
+	{
+		for (S32 c = 0; c < 4; c++)
+		{
+			s[c] = src ? mul255(src[c], tint.mV[c]) : tint.mV[c];
+		}
+		if (src)
+		{
+			src += 4;
+		}
+
+		const U32 fs = blend_factor(sfactor, s[3], dst[3]);
+		const U32 fd = blend_factor(dfactor, s[3], dst[3]);
+		for (S32 c = first; c < last; c++)
+		{
+			dst[c] = (U8)llmin(mul255(s[c], fs) + mul255(dst[c], fd), (U32)255);
+		}
+	}
+}
+
+#if LL_IMAGECOMPOSITOR_SSE2
+
+static inline __m128i mul255_epi16(__m128i a, __m128i b)
+{
+	__m128i x = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+static inline __m128i broadcast_alpha_epi16(__m128i v)
+{
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+	return _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static inline __m128i blend_factor_epi16(LLImageCompositor::EBlendFactor f, __m128i src_alpha, __m128i dst_alpha)
+{
+	const __m128i one = _mm_set1_epi16(255);
+	switch (f)
+	{
+	  case LLImageCompositor::BF_ZERO:					return _mm_setzero_si128();
+	  case LLImageCompositor::BF_ONE:					return one;
+	  case LLImageCompositor::BF_SOURCE_ALPHA:			return src_alpha;
+	  case LLImageCompositor::BF_ONE_MINUS_SOURCE_ALPHA:	return _mm_sub_epi16(one, src_alpha);
+	  case LLImageCompositor::BF_DEST_ALPHA:			return dst_alpha;
+	  case LLImageCompositor::BF_ONE_MINUS_DEST_ALPHA:	return _mm_sub_epi16(one, dst_alpha);
+	}
+	return _mm_setzero_si128();
+}
+
+// Two pixels, one per 64 bit half, as 16 bit lanes.
+static inline __m128i blend_epi16(__m128i s, __m128i d,
+								  LLImageCompositor::EBlendFactor sfactor,
+								  LLImageCompositor::EBlendFactor dfactor)
+{
+	const __m128i sa = broadcast_alpha_epi16(s);
+	const __m128i da = broadcast_alpha_epi16(d);
+	return _mm_add_epi16(mul255_epi16(s, blend_factor_epi16(sfactor, sa, da)),
+						 mul255_epi16(d, blend_factor_epi16(dfactor, sa, da)));
+}
+
+#endif
+
+// static
+void LLImageCompositor::blendPixels(U8* dst, const U8* src, S32 pixels, const LLColor4U& tint,
+									EBlendFactor sfactor, EBlendFactor dfactor,
+									bool write_color, bool write_alpha)
+{
+	if (!write_color && !write_alpha)
+	{
+		return;
+	}
+
+#if LL_IMAGECOMPOSITOR_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i tint16 = _mm_set_epi16(tint.mV[3], tint.mV[2], tint.mV[1], tint.mV[0],
+										 tint.mV[3], tint.mV[2], tint.mV[1], tint.mV[0]);
+	const U8 c = write_color ? 0xff : 0;
+	const U8 a = write_alpha ? 0xff : 0;
+	const __m128i mask = _mm_set_epi8(a, c, c, c, a, c, c, c, a, c, c, c, a, c, c, c);
+
+	S32 i = 0;
+	for ( ; i + 4 <= pixels; i += 4, dst += 16)
+	{
+		const __m128i d8 = _mm_loadu_si128((const __m128i*)dst);
+		__m128i s_lo = tint16;
+		__m128i s_hi = tint16;
+		if (src)
+		{
+			const __m128i t8 = _mm_loadu_si128((const __m128i*)src);
+			s_lo = mul255_epi16(_mm_unpacklo_epi8(t8, zero), tint16);
+			s_hi = mul255_epi16(_mm_unpackhi_epi8(t8, zero), tint16);
+			src += 16;
+		}
+
+		const __m128i r_lo = blend_epi16(s_lo, _mm_unpacklo_epi8(d8, zero), sfactor, dfactor);
+		const __m128i r_hi = blend_epi16(s_hi, _mm_unpackhi_epi8(d8, zero), sfactor, dfactor);
+		// packus clamps the sums to 255.
+		const __m128i r8 = _mm_packus_epi16(r_lo, r_hi);
+		_mm_storeu_si128((__m128i*)dst, _mm_or_si128(_mm_and_si128(mask, r8), _mm_andnot_si128(mask, d8)));
+	}
+	blendPixelsScalar(dst, src, pixels - i, tint, sfactor, dfactor, write_color, write_alpha);
+#else
+	blendPixelsScalar(dst, src, pixels, tint, sfactor, dfactor, write_color, write_alpha);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// LLImageCompositor
+//----------------------------------------------------------------------------
+
+LLImageCompositor::LLImageCompositor(S32 width, S32 height)
+:	mWidth(width),
+	mHeight(height),
+	mSourceFactor(BF_SOURCE_ALPHA),
+	mDestFactor(BF_ONE_MINUS_SOURCE_ALPHA),
+	mWriteColor(true),
+	mWriteAlpha(true),
+	mTextureReplace(false),
+	mColor(255, 255, 255, 255)
+{
+}
+
+LLImageCompositor::~LLImageCompositor()
+{
+}
+
+void LLImageCompositor::setBlendFunc(EBlendFactor sfactor, EBlendFactor dfactor)
+{
+	mSourceFactor = sfactor;
+	mDestFactor = dfactor;
+}
+
+void LLImageCompositor::setColorMask(bool write_color, bool write_alpha)
+{
+	mWriteColor = write_color;
+	mWriteAlpha = write_alpha;
+}
+
+void LLImageCompositor::setColor(const LLColor4& color)
+{
+	mColor.setVec((U8)(llclamp(color.mV[VRED], 0.f, 1.f) * 255),
+				  (U8)(llclamp(color.mV[VGREEN], 0.f, 1.f) * 255),
+				  (U8)(llclamp(color.mV[VBLUE], 0.f, 1.f) * 255),
+				  (U8)(llclamp(color.mV[VALPHA], 0.f, 1.f) * 255));
+}
+
+void LLImageCompositor::setTextureReplace(bool replace)
+{
+	mTextureReplace = replace;
+}
+
+void LLImageCompositor::drawRect()
+{
+	addOp(NULL, false, mColor);
+}
+
+void LLImageCompositor::drawTexture(LLImageRaw* image, bool alpha_only)
+{
+	if (!image || !image->getData())
+	{
+		return;
+	}
+
+	LLColor4U tint = mColor;
+	if (mTextureReplace)
+	{
+		// Channels the texture provides replace the current color, the rest
+		// come from the current color.  prepareSource() fills the missing
+		// channels with 255, so this reduces to a modulate.
+		const S32 components = image->getComponents();
+		const bool has_color = !(components == 1 && alpha_only);
+		const bool has_alpha = (components == 1 && alpha_only) || components == 2 || components == 4;
+		if (has_color)
+		{
+			tint.mV[VRED] = tint.mV[VGREEN] = tint.mV[VBLUE] = 255;
+		}
+		if (has_alpha)
+		{
+			tint.mV[VALPHA] = 255;
+		}
+	}
+	addOp(image, alpha_only, tint);
+}
+
+void LLImageCompositor::addOp(LLImageRaw* image, bool alpha_only, const LLColor4U& tint)
+{
+	if (!mWriteColor && !mWriteAlpha)
+	{
+		return;
+	}
+
+	Op op;
+	op.mImage = image;
+	op.mAlphaOnly = alpha_only;
+	op.mTint = tint;
+	op.mSourceFactor = mSourceFactor;
+	op.mDestFactor = mDestFactor;
+	op.mWriteColor = mWriteColor;
+	op.mWriteAlpha = mWriteAlpha;
+	mOps.push_back(op);
+}
+
+// Expands the image to RGBA the way GL samples it and scales it to the target size.
+LLImageRaw* LLImageCompositor::prepareSource(LLImageRaw* image, bool alpha_only)
+{
+	const S32 width = image->getWidth();
+	const S32 height = image->getHeight();
+	const S32 components = image->getComponents();
+	const S32 pixels = width * height;
+
+	LLImageRaw* rgba = new LLImageRaw(width, height, 4);
+	if (!rgba->getData())
+	{
+		llwarns << "Unable to allocate " << width << "x" << height << " composite source" << llendl;
+		return rgba;
+	}
+
+	const U8* in = image->getData();
+	U8* out = rgba->getData();
+	for (S32 i = 0; i < pixels; i++, in += components, out += 4)
+	{
+		switch (components)
+		{
+		  case 1:
+			if (alpha_only)
+			{
+				out[0] = out[1] = out[2] = 255;
+				out[3] = in[0];
+			}
+			else
+			{
+				out[0] = out[1] = out[2] = in[0];
+				out[3] = 255;
+			}
+			break;
+		  case 2:
+			out[0] = out[1] = out[2] = in[0];
+			out[3] = in[1];
+			break;
+		  case 3:
+			out[0] = in[0];
+			out[1] = in[1];
+			out[2] = in[2];
+			out[3] = 255;
+			break;
+		  default:
+			out[0] = in[0];
+			out[1] = in[1];
+			out[2] = in[2];
+			out[3] = in[3];
+			break;
+		}
+	}
+
+	if (width != mWidth || height != mHeight)
+	{
+		rgba->scale(mWidth, mHeight);
+	}
+	return rgba;
+}
+
+bool LLImageCompositor::composite()
+{
+	mResult = new LLImageRaw(mWidth, mHeight, 4);
+	U8* data = mResult->getData();
+	if (!data)
+	{
+		return false;
+	}
+	// Matches a freshly created render target.
+	memset(data, 0, mWidth * mHeight * 4);
+
+	// Layers frequently share sources (static masks, the same local texture
+	// for color and alpha), so expand each one once.
+	typedef std::map<std::pair<LLImageRaw*, bool>, LLPointer<LLImageRaw> > source_map_t;
+	source_map_t sources;
+
+	for (op_list_t::const_iterator iter = mOps.begin(); iter != mOps.end(); ++iter)
+	{
+		const Op& op = *iter;
+		const U8* src = NULL;
+		if (op.mImage.notNull())
+		{
+			LLPointer<LLImageRaw>& source = sources[std::make_pair(op.mImage.get(), op.mAlphaOnly)];
+			if (source.isNull())
+			{
+				source = prepareSource(op.mImage, op.mAlphaOnly);
+			}
+			src = source->getData();
+			if (!src || source->getWidth() != mWidth || source->getHeight() != mHeight)
+			{
+				return false;
+			}
+		}
+		blendPixels(data, src, mWidth * mHeight, op.mTint, op.mSourceFactor, op.mDestFactor,
+					op.mWriteColor, op.mWriteAlpha);
+	}
+	return true;
+}
@@ -0,0 +1,127 @@
+/** 
+ * @file llimagecompositor.h
+ * @brief CPU implementation of the blend operations used to composite avatar bakes
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#ifndef LL_LLIMAGECOMPOSITOR_H
+#define LL_LLIMAGECOMPOSITOR_H
+
+#include <vector>
+
+#include "llimage.h"
+#include "llpointer.h"
+#include "v4color.h"
+#include "v4coloru.h"
+
+//============================================================================
+// LLImageCompositor
+//
+// Records a sequence of full-image draws against an RGBA target and replays
+// them on the CPU.  The recording interface mirrors the small subset of GL
+// state the avatar bake code uses (blend function, color mask, current color,
+// texture modulate/replace), so a caller can describe a composite with the
+// same sequence of calls it would make against gGL.  composite() is safe to
+// call from a worker thread; the recording calls are not.
+//============================================================================
+
+class LLImageCompositor : public LLThreadSafeRefCount
+{
+public:
+	enum EBlendFactor
+	{
+		BF_ZERO = 0,
+		BF_ONE,
+		BF_SOURCE_ALPHA,
+		BF_ONE_MINUS_SOURCE_ALPHA,
+		BF_DEST_ALPHA,
+		BF_ONE_MINUS_DEST_ALPHA
+	};
+
+protected:
+	~LLImageCompositor();
+
+public:
+	LLImageCompositor(S32 width, S32 height);
+
+	// GL-like state, captured by each draw call.
+	void setBlendFunc(EBlendFactor sfactor, EBlendFactor dfactor);
+	void setColorMask(bool write_color, bool write_alpha);
+	// Same clamp and truncation as LLRender::color4f().
+	void setColor(const LLColor4& color);
+	// TRUE for LLTexUnit::TB_REPLACE, FALSE for TB_MULT.
+	void setTextureReplace(bool replace);
+
+	// Untextured rect covering the whole target in the current color.
+	void drawRect();
+	// Textured rect covering the whole target.  The image is scaled to the
+	// target size at composite time.  Single channel images are treated as
+	// GL_ALPHA8 textures when alpha_only is set, as luminance otherwise.
+	void drawTexture(LLImageRaw* image, bool alpha_only);
+
+	S32 getDrawCount() const			{ return (S32)mOps.size(); }
+
+	// Replays the recorded draws into a new 4 component image.
+	bool composite();
+	LLImageRaw* getResult() const		{ return mResult; }
+
+	// Blends pixels from src (or the tint alone when src is NULL) onto dst.
+	// Both are tightly packed RGBA.  Exposed for the unit tests.
+	static void blendPixels(U8* dst, const U8* src, S32 pixels, const LLColor4U& tint,
+							EBlendFactor sfactor, EBlendFactor dfactor,
+							bool write_color, bool write_alpha);
+	static void blendPixelsScalar(U8* dst, const U8* src, S32 pixels, const LLColor4U& tint,
+								  EBlendFactor sfactor, EBlendFactor dfactor,
+								  bool write_color, bool write_alpha);
+
+private:
+	struct Op
+	{
+		LLPointer<LLImageRaw>	mImage;
+		bool					mAlphaOnly;
+		LLColor4U				mTint;
+		EBlendFactor			mSourceFactor;
+		EBlendFactor			mDestFactor;
+		bool					mWriteColor;
+		bool					mWriteAlpha;
+	};
+	typedef std::vector<Op> op_list_t;
+
+	void addOp(LLImageRaw* image, bool alpha_only, const LLColor4U& tint);
+	LLImageRaw* prepareSource(LLImageRaw* image, bool alpha_only);
+
+	const S32				mWidth;
+	const S32				mHeight;
+	op_list_t				mOps;
+	LLPointer<LLImageRaw>	mResult;
+
+	// Current state
+	EBlendFactor			mSourceFactor;
+	EBlendFactor			mDestFactor;
+	bool					mWriteColor;
+	bool					mWriteAlpha;
+	bool					mTextureReplace;
+	LLColor4U				mColor;
+};
+
+#endif
@@ -176,3 +176,117 @@ bool LLImageDecodeThread::ImageRequest::tut_isOK()
 {
 	return mResponder.notNull();
 }
+
+//----------------------------------------------------------------------------
+
+// MAIN THREAD
+LLImageCompositeThread::LLImageCompositeThread(bool threaded)
+	: LLQueuedThread("imagecomposite", threaded)
+{
+}
+
+// MAIN THREAD
+// virtual
+LLImageCompositeThread::~LLImageCompositeThread()
+{
+}
+
+// MAIN THREAD
+LLImageCompositeThread::handle_t LLImageCompositeThread::composite(LLImageCompositor* compositor,
+	U32 priority, Responder* responder)
+{
+	handle_t handle = generateHandle();
+	CompositeRequest* req = new CompositeRequest(handle, compositor, priority, responder);
+	if (!addRequest(req))
+	{
+		llerrs << "request added after LLImageCompositeThread::shutdown()" << llendl;
+	}
+	return handle;
+}
+
+// MAIN THREAD
+LLImageCompositeThread::handle_t LLImageCompositeThread::runJob(Job* job, U32 priority)
+{
+	handle_t handle = generateHandle();
+	JobRequest* req = new JobRequest(handle, job, priority);
+	if (!addRequest(req))
+	{
+		llerrs << "request added after LLImageCompositeThread::shutdown()" << llendl;
+	}
+	return handle;
+}
+
+LLImageCompositeThread::Responder::~Responder()
+{
+}
+
+LLImageCompositeThread::Job::~Job()
+{
+}
+
+//----------------------------------------------------------------------------
+
+LLImageCompositeThread::CompositeRequest::CompositeRequest(handle_t handle, LLImageCompositor* compositor,
+														   U32 priority, LLImageCompositeThread::Responder* responder)
+	: LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
+	  mCompositor(compositor),
+	  mSuccess(false),
+	  mResponder(responder)
+{
+}
+
+LLImageCompositeThread::CompositeRequest::~CompositeRequest()
+{
+	mCompositor = NULL;
+}
+
+// Composites are not sliced; returns true when done, whether or not it succeeded.
+bool LLImageCompositeThread::CompositeRequest::processRequest()
+{
+	if (mCompositor.notNull())
+	{
+		mSuccess = mCompositor->composite();
+	}
+	return true;
+}
+
+void LLImageCompositeThread::CompositeRequest::finishRequest(bool completed)
+{
+	if (mResponder.notNull())
+	{
+		mResponder->completed(completed && mSuccess, mCompositor);
+	}
+	// Will automatically be deleted
+}
+
+//----------------------------------------------------------------------------
+
+LLImageCompositeThread::JobRequest::JobRequest(handle_t handle, LLImageCompositeThread::Job* job, U32 priority)
+	: LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
+	  mJob(job),
+	  mSuccess(false)
+{
+}
+
+LLImageCompositeThread::JobRequest::~JobRequest()
+{
+	mJob = NULL;
+}
+
+bool LLImageCompositeThread::JobRequest::processRequest()
+{
+	if (mJob.notNull())
+	{
+		mSuccess = mJob->run();
+	}
+	return true;
+}
+
+void LLImageCompositeThread::JobRequest::finishRequest(bool completed)
+{
+	if (mJob.notNull())
+	{
+		mJob->completed(completed && mSuccess);
+	}
+	// Will automatically be deleted
+}
@@ -28,6 +28,7 @@
 #define LL_LLIMAGEWORKER_H
 
 #include "llimage.h"
+#include "llimagecompositor.h"
 #include "llpointer.h"
 #include "llworkerthread.h"
 
@@ -101,4 +102,71 @@ private:
 	LLMutex* mCreationMutex;
 };
 
+// Runs LLImageCompositor::composite(), or any other image job, off the main
+// thread.  Requests must be made from the main thread.
+class LLImageCompositeThread : public LLQueuedThread
+{
+public:
+	class Responder : public LLThreadSafeRefCount
+	{
+	protected:
+		virtual ~Responder();
+	public:
+		// Called from the composite thread.
+		virtual void completed(bool success, LLImageCompositor* compositor) = 0;
+	};
+
+	class CompositeRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~CompositeRequest(); // use deleteRequest()
+		
+	public:
+		CompositeRequest(handle_t handle, LLImageCompositor* compositor,
+						 U32 priority, LLImageCompositeThread::Responder* responder);
+
+		/*virtual*/ bool processRequest();
+		/*virtual*/ void finishRequest(bool completed);
+
+	private:
+		LLPointer<LLImageCompositor> mCompositor;
+		bool mSuccess;
+		LLPointer<LLImageCompositeThread::Responder> mResponder;
+	};
+
+	// For composites that don't fit the LLImageCompositor draw model.
+	class Job : public LLThreadSafeRefCount
+	{
+	protected:
+		virtual ~Job();
+	public:
+		// Both are called from the composite thread.
+		virtual bool run() = 0;
+		virtual void completed(bool success) = 0;
+	};
+
+	class JobRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~JobRequest(); // use deleteRequest()
+		
+	public:
+		JobRequest(handle_t handle, LLImageCompositeThread::Job* job, U32 priority);
+
+		/*virtual*/ bool processRequest();
+		/*virtual*/ void finishRequest(bool completed);
+
+	private:
+		LLPointer<LLImageCompositeThread::Job> mJob;
+		bool mSuccess;
+	};
+
+public:
+	LLImageCompositeThread(bool threaded = true);
+	virtual ~LLImageCompositeThread();
+
+	handle_t composite(LLImageCompositor* compositor, U32 priority, Responder* responder);
+	handle_t runJob(Job* job, U32 priority);
+};
+
 #endif
@@ -0,0 +1,351 @@
+/** 
+ * @file llimagecompositor_test.cpp
+ * @brief Pixel comparison of LLImageCompositor against the GL blend equations
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#include "linden_common.h"
+// Class to test 
+#include "../llimagecompositor.h"
+// Tut header
+#include "../test/lltut.h"
+
+#include <stdlib.h>
+
+// -------------------------------------------------------------------------------------------
+// Stubbing: Declarations required to link and run the class being tested
+// Notes: 
+// * LLImageRaw is simulated with a plain heap buffer. The compositor only needs storage,
+//   dimensions and components. scale() is not simulated; the tests use target sized sources.
+
+LLImageBase::LLImageBase() 
+: mData(NULL),
+mDataSize(0),
+mWidth(0),
+mHeight(0),
+mComponents(0),
+mBadBufferAllocation(false),
+mAllowOverSize(false),
+mMemType(LLMemType::MTYPE_IMAGEBASE)
+{
+}
+LLImageBase::~LLImageBase() { delete [] mData; }
+void LLImageBase::dump() { }
+void LLImageBase::sanityCheck() { }
+void LLImageBase::deleteData() { delete [] mData; mData = NULL; mDataSize = 0; }
+U8* LLImageBase::allocateData(S32 size)
+{
+	if (size < 0)
+	{
+		size = mWidth * mHeight * mComponents;
+	}
+	delete [] mData;
+	mData = new U8[size];
+	mDataSize = size;
+	return mData;
+}
+U8* LLImageBase::reallocateData(S32 size) { return allocateData(size); }
+void LLImageBase::setSize(S32 width, S32 height, S32 ncomponents)
+{
+	mWidth = width;
+	mHeight = height;
+	mComponents = ncomponents;
+}
+const U8* LLImageBase::getData() const { return mData; }
+U8* LLImageBase::getData() { return mData; }
+
+LLImageRaw::LLImageRaw(U16 width, U16 height, S8 components) { setSize(width, height, components); allocateData(); }
+LLImageRaw::~LLImageRaw() { }
+void LLImageRaw::deleteData() { LLImageBase::deleteData(); }
+U8* LLImageRaw::allocateData(S32 size) { return LLImageBase::allocateData(size); }
+U8* LLImageRaw::reallocateData(S32 size) { return LLImageBase::allocateData(size); }
+BOOL LLImageRaw::scale(S32 new_width, S32 new_height, BOOL scale_image) { return FALSE; }
+
+// End Stubbing
+// -------------------------------------------------------------------------------------------
+
+namespace
+{
+	// Reference: the GL blend equation evaluated in floating point, with the result
+	// stored to an 8 bit framebuffer.
+	F32 gl_factor(LLImageCompositor::EBlendFactor f, F32 src_alpha, F32 dst_alpha)
+	{
+		switch (f)
+		{
+		  case LLImageCompositor::BF_ZERO:					return 0.f;
+		  case LLImageCompositor::BF_ONE:					return 1.f;
+		  case LLImageCompositor::BF_SOURCE_ALPHA:			return src_alpha;
+		  case LLImageCompositor::BF_ONE_MINUS_SOURCE_ALPHA:	return 1.f - src_alpha;
+		  case LLImageCompositor::BF_DEST_ALPHA:			return dst_alpha;
+		  case LLImageCompositor::BF_ONE_MINUS_DEST_ALPHA:	return 1.f - dst_alpha;
+		}
+		return 0.f;
+	}
+
+	// Blends one fragment (already modulated, 0..1) into an 8 bit pixel.
+	void gl_blend(U8* dst, const F32* frag,
+				  LLImageCompositor::EBlendFactor sfactor, LLImageCompositor::EBlendFactor dfactor,
+				  bool write_color, bool write_alpha)
+	{
+		const F32 da = dst[3] / 255.f;
+		const F32 fs = gl_factor(sfactor, frag[3], da);
+		const F32 fd = gl_factor(dfactor, frag[3], da);
+		for (S32 c = 0; c < 4; c++)
+		{
+			if ((c < 3 && write_color) || (c == 3 && write_alpha))
+			{
+				F32 v = llclamp(frag[c] * fs + (dst[c] / 255.f) * fd, 0.f, 1.f);
+				dst[c] = (U8)(v * 255.f + 0.5f);
+			}
+		}
+	}
+
+	void fill_random(U8* data, S32 size)
+	{
+		for (S32 i = 0; i < size; i++)
+		{
+			data[i] = (U8)(rand() & 0xff);
+		}
+	}
+
+	S32 max_difference(const U8* a, const U8* b, S32 size)
+	{
+		S32 result = 0;
+		for (S32 i = 0; i < size; i++)
+		{
+			result = llmax(result, llabs((S32)a[i] - (S32)b[i]));
+		}
+		return result;
+	}
+
+	// Fixed point rounding of each blend term costs at most one step against the
+	// float equation, the source modulate at most one more.
+	const S32 GL_TOLERANCE = 2;
+
+	const LLImageCompositor::EBlendFactor ALL_FACTORS[] =
+	{
+		LLImageCompositor::BF_ZERO,
+		LLImageCompositor::BF_ONE,
+		LLImageCompositor::BF_SOURCE_ALPHA,
+		LLImageCompositor::BF_ONE_MINUS_SOURCE_ALPHA,
+		LLImageCompositor::BF_DEST_ALPHA,
+		LLImageCompositor::BF_ONE_MINUS_DEST_ALPHA
+	};
+	const S32 NUM_FACTORS = sizeof(ALL_FACTORS) / sizeof(ALL_FACTORS[0]);
+}
+
+namespace tut
+{
+	struct imagecompositor_test
+	{
+		imagecompositor_test()
+		{
+			srand(1234);
+		}
+	};
+
+	typedef test_group<imagecompositor_test> imagecompositor_t;
+	typedef imagecompositor_t::object imagecompositor_object_t;
+	tut::imagecompositor_t tut_imagecompositor("LLImageCompositor");
+
+	template<> template<>
+	void imagecompositor_object_t::test<1>()
+	{
+		// The vectorized kernel must match the scalar one bit for bit, including
+		// the tail that does not fill a whole register.
+		const S32 pixels = 67;
+		U8 src[pixels * 4];
+		U8 dst[pixels * 4];
+		U8 dst_vec[pixels * 4];
+		U8 dst_scalar[pixels * 4];
+		fill_random(src, pixels * 4);
+		fill_random(dst, pixels * 4);
+		const LLColor4U tint(200, 90, 255, 128);
+
+		for (S32 s = 0; s < NUM_FACTORS; s++)
+		{
+			for (S32 d = 0; d < NUM_FACTORS; d++)
+			{
+				for (S32 mask = 1; mask < 4; mask++)
+				{
+					const bool write_color = (mask & 1) != 0;
+					const bool write_alpha = (mask & 2) != 0;
+					for (S32 textured = 0; textured < 2; textured++)
+					{
+						memcpy(dst_vec, dst, sizeof(dst));
+						memcpy(dst_scalar, dst, sizeof(dst));
+						const U8* source = textured ? src : NULL;
+						LLImageCompositor::blendPixels(dst_vec, source, pixels, tint, ALL_FACTORS[s], ALL_FACTORS[d], write_color, write_alpha);
+						LLImageCompositor::blendPixelsScalar(dst_scalar, source, pixels, tint, ALL_FACTORS[s], ALL_FACTORS[d], write_color, write_alpha);
+						ensure_memory_matches("vector and scalar kernels differ", dst_vec, sizeof(dst), dst_scalar, sizeof(dst));
+					}
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void imagecompositor_object_t::test<2>()
+	{
+		// Every blend function against the GL equation.
+		const S32 pixels = 256;
+		U8 src[pixels * 4];
+		U8 dst[pixels * 4];
+		U8 result[pixels * 4];
+		U8 expected[pixels * 4];
+		fill_random(src, pixels * 4);
+		fill_random(dst, pixels * 4);
+		const LLColor4U tint(255, 128, 31, 200);
+
+		for (S32 s = 0; s < NUM_FACTORS; s++)
+		{
+			for (S32 d = 0; d < NUM_FACTORS; d++)
+			{
+				memcpy(result, dst, sizeof(dst));
+				memcpy(expected, dst, sizeof(dst));
+				LLImageCompositor::blendPixels(result, src, pixels, tint, ALL_FACTORS[s], ALL_FACTORS[d], true, true);
+				for (S32 i = 0; i < pixels; i++)
+				{
+					F32 frag[4];
+					for (S32 c = 0; c < 4; c++)
+					{
+						frag[c] = (src[i * 4 + c] / 255.f) * (tint.mV[c] / 255.f);
+					}
+					gl_blend(expected + i * 4, frag, ALL_FACTORS[s], ALL_FACTORS[d], true, true);
+				}
+				ensure("blend function differs from GL", max_difference(result, expected, sizeof(result)) <= GL_TOLERANCE);
+			}
+		}
+	}
+
+	template<> template<>
+	void imagecompositor_object_t::test<3>()
+	{
+		// A bake shaped like LLTexLayerSet::render(): opaque black clear, a tinted
+		// RGB layer behind an alpha mask, a tinted RGBA layer alpha blended on top,
+		// then the alpha channel replaced by a mask texture.
+		const S32 width = 16;
+		const S32 height = 8;
+		const S32 pixels = width * height;
+
+		LLPointer<LLImageRaw> rgb = new LLImageRaw(width, height, 3);
+		LLPointer<LLImageRaw> rgba = new LLImageRaw(width, height, 4);
+		LLPointer<LLImageRaw> mask = new LLImageRaw(width, height, 1);
+		fill_random(rgb->getData(), pixels * 3);
+		fill_random(rgba->getData(), pixels * 4);
+		fill_random(mask->getData(), pixels);
+
+		const LLColor4 clear(0.f, 0.f, 0.f, 1.f);
+		const LLColor4 skin(0.9f, 0.7f, 0.6f, 1.f);
+		const LLColor4 cloth(0.2f, 0.4f, 1.f, 0.75f);
+
+		LLPointer<LLImageCompositor> compositor = new LLImageCompositor(width, height);
+		compositor->setBlendFunc(LLImageCompositor::BF_ONE, LLImageCompositor::BF_ZERO);
+		compositor->setColor(clear);
+		compositor->drawRect();
+
+		compositor->setColorMask(false, true);
+		compositor->setBlendFunc(LLImageCompositor::BF_DEST_ALPHA, LLImageCompositor::BF_ZERO);
+		compositor->drawTexture(mask, true);
+		compositor->setColorMask(true, true);
+		compositor->setBlendFunc(LLImageCompositor::BF_DEST_ALPHA, LLImageCompositor::BF_ONE_MINUS_DEST_ALPHA);
+		compositor->setColor(skin);
+		compositor->drawTexture(rgb, false);
+
+		compositor->setBlendFunc(LLImageCompositor::BF_SOURCE_ALPHA, LLImageCompositor::BF_ONE_MINUS_SOURCE_ALPHA);
+		compositor->setColor(cloth);
+		compositor->drawTexture(rgba, false);
+
+		compositor->setColorMask(false, true);
+		compositor->setBlendFunc(LLImageCompositor::BF_ONE, LLImageCompositor::BF_ZERO);
+		compositor->setTextureReplace(true);
+		compositor->drawTexture(mask, true);
+
+		ensure_equals("draw count", compositor->getDrawCount(), 5);
+		ensure("composite failed", compositor->composite());
+		LLImageRaw* result = compositor->getResult();
+		ensure("no result", result != NULL);
+		ensure_equals("result components", (S32)result->getComponents(), 4);
+
+		// Same sequence through the GL reference, with colors truncated the way
+		// LLRender::color4f() does.
+		std::vector<U8> expected(pixels * 4, 0);
+		for (S32 i = 0; i < pixels; i++)
+		{
+			U8* dst = &expected[i * 4];
+			const U8* c3 = rgb->getData() + i * 3;
+			const U8* c4 = rgba->getData() + i * 4;
+			const F32 m = mask->getData()[i] / 255.f;
+			F32 frag[4];
+
+			frag[0] = frag[1] = frag[2] = 0.f; frag[3] = 1.f;
+			gl_blend(dst, frag, LLImageCompositor::BF_ONE, LLImageCompositor::BF_ZERO, true, true);
+
+			frag[0] = frag[1] = frag[2] = 1.f; frag[3] = m;
+			gl_blend(dst, frag, LLImageCompositor::BF_DEST_ALPHA, LLImageCompositor::BF_ZERO, false, true);
+
+			for (S32 c = 0; c < 3; c++)
+			{
+				frag[c] = (c3[c] / 255.f) * ((U8)(skin.mV[c] * 255) / 255.f);
+			}
+			frag[3] = 1.f;
+			gl_blend(dst, frag, LLImageCompositor::BF_DEST_ALPHA, LLImageCompositor::BF_ONE_MINUS_DEST_ALPHA, true, true);
+
+			for (S32 c = 0; c < 4; c++)
+			{
+				frag[c] = (c4[c] / 255.f) * ((U8)(cloth.mV[c] * 255) / 255.f);
+			}
+			gl_blend(dst, frag, LLImageCompositor::BF_SOURCE_ALPHA, LLImageCompositor::BF_ONE_MINUS_SOURCE_ALPHA, true, true);
+
+			frag[3] = m;
+			gl_blend(dst, frag, LLImageCompositor::BF_ONE, LLImageCompositor::BF_ZERO, false, true);
+		}
+
+		// Errors compound across the layers; allow one tolerance step per draw.
+		const S32 diff = max_difference(result->getData(), &expected[0], pixels * 4);
+		ensure("composite differs from GL", diff <= GL_TOLERANCE * 4);
+		// The last draw writes alpha straight from the mask.
+		for (S32 i = 0; i < pixels; i++)
+		{
+			ensure_equals("mask alpha", result->getData()[i * 4 + 3], mask->getData()[i]);
+		}
+	}
+
+	template<> template<>
+	void imagecompositor_object_t::test<4>()
+	{
+		// Color mask: an alpha-only draw leaves the color channels alone.
+		const S32 pixels = 9;
+		U8 dst[pixels * 4];
+		U8 before[pixels * 4];
+		fill_random(dst, pixels * 4);
+		memcpy(before, dst, sizeof(dst));
+		LLImageCompositor::blendPixels(dst, NULL, pixels, LLColor4U(1, 2, 3, 77),
+									   LLImageCompositor::BF_ONE, LLImageCompositor::BF_ZERO, false, true);
+		for (S32 i = 0; i < pixels; i++)
+		{
+			ensure_memory_matches("color written", dst + i * 4, 3, before + i * 4, 3);
+			ensure_equals("alpha not written", dst[i * 4 + 3], (U8)77);
+		}
+	}
+}
@@ -66,6 +66,9 @@ void LLImageRaw::deleteData() { }
 U8* LLImageRaw::allocateData(S32 size) { return NULL; }
 U8* LLImageRaw::reallocateData(S32 size) { return NULL; }
 
+LLImageCompositor::~LLImageCompositor() { }
+bool LLImageCompositor::composite() { return false; }
+
 // End Stubbing
 // -------------------------------------------------------------------------------------------
 
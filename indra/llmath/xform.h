@@ -139,6 +139,14 @@ public:
 	const LLMatrix4&    getWorldMatrix() const      { return mWorldMatrix; }
 	void setWorldMatrix (const LLMatrix4& mat)   { mWorldMatrix = mat; }
 
+	// for owners that compute the world transform outside of update()
+	void setWorldTransform(const LLVector3& pos, const LLQuaternion& rot, const LLMatrix4& mat)
+	{
+		mWorldPosition = pos;
+		mWorldRotation = rot;
+		mWorldMatrix = mat;
+	}
+
 	void init()
 	{
 		mWorldMatrix.setIdentity();
@@ -82,7 +82,38 @@ void prescan_patch(F32 *patch, LLPatchHeader *php, F32 &zmax, F32 &zmin);
 void compress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *php, S32 prequant);
 void get_patch_group_header(LLGroupHeader *gopp);
 
+// Decompression state.  The tables only depend on the patch size, so every
+// thread decompressing patches keeps its own instance and init() is cheap
+// when the size doesn't change.
+class LLPatchDecompressor
+{
+public:
+	LLPatchDecompressor();
+
+	void init(S32 size);
+	S32 getSize() const { return mSize; }
+
+	// stride is the distance in elements between rows of the output
+	void decompress(F32 *patch, S32 stride, const S32 *cpatch, const LLPatchHeader *ph) const;
+	void decompressv(LLVector3 *v, S32 stride, const S32 *cpatch, const LLPatchHeader *ph) const;
+
+private:
+	void buildDequantizeTable();
+	void setupICosines();
+	void buildDecopyMatrix();
+
+	// dequantizes cpatch into block and runs the inverse DCT on it
+	void decompressBlock(F32 *block, const S32 *cpatch) const;
+	void idct(F32 *block, S32 rows, S32 cols) const;
+
+	S32	mSize;
+	F32	mDequantizeTable[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+	F32	mICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+	S32	mDeCopyMatrix[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+};
+
 // Decompression routines
+// These share one LLPatchDecompressor and the group header, main thread only.
 void set_group_of_patch_header(LLGroupHeader *gopp);
 void init_patch_decompressor(S32 size);
 void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph);
@@ -0,0 +1,199 @@
+/** 
+ * @file patch_idct_test.cpp
+ * @brief LLPatchDecompressor test cases.
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#include "linden_common.h"
+
+#include "llmath.h"
+#include "llrand.h"
+#include "v3math.h"
+
+#include "../patch_dct.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// straight from the definition, in double precision
+	void reference_idct(S32 size, const S32 *cpatch, const LLPatchHeader &ph, F32 *out, S32 stride)
+	{
+		// undo the zig-zag ordering and the quantization
+		std::vector<F64> coeffs(size*size, 0.0);
+		S32 i = 0, j = 0;
+		for (S32 count = 0; count < size*size; count++)
+		{
+			coeffs[j*size + i] = cpatch[count]*(1.0 + 2.0*(i + j));
+			if ((i + j) & 1)
+			{
+				if (j == size - 1) i++;
+				else if (i == 0) j++;
+				else { i--; j++; }
+			}
+			else
+			{
+				if (i == size - 1) j++;
+				else if (j == 0) i++;
+				else { i++; j--; }
+			}
+		}
+
+		S32 prequant = (ph.quant_wbits >> 4) + 2;
+		F64 mult = (F64) ph.range/(F64)(1 << prequant);
+		F64 addval = mult*(F64)(1 << (prequant - 1)) + ph.dc_offset;
+
+		for (S32 y = 0; y < size; y++)
+		{
+			for (S32 x = 0; x < size; x++)
+			{
+				F64 total = 0.0;
+				for (S32 v = 0; v < size; v++)
+				{
+					for (S32 u = 0; u < size; u++)
+					{
+						F64 cu = u ? 1.0 : OO_SQRT2;
+						F64 cv = v ? 1.0 : OO_SQRT2;
+						total += cu*cv*coeffs[v*size + u]
+							*cos((2.0*x + 1.0)*u*F_PI/(2.0*size))
+							*cos((2.0*y + 1.0)*v*F_PI/(2.0*size));
+					}
+				}
+				out[y*stride + x] = (F32)(total*2.0/size*mult + addval);
+			}
+		}
+	}
+
+	void random_patch(S32 size, S32 nonzero, S32 *cpatch, LLPatchHeader &ph)
+	{
+		for (S32 i = 0; i < size*size; i++)
+		{
+			cpatch[i] = i < nonzero ? ll_rand(200) - 100 : 0;
+		}
+		ph.dc_offset = ll_frand(40.f);
+		ph.range = 1 + ll_rand(100);
+		ph.quant_wbits = (ll_rand(6) << 4) | ll_rand(13);
+		ph.patchids = 0;
+	}
+}
+
+namespace tut
+{
+	struct patch_idct_test
+	{
+	};
+	typedef test_group<patch_idct_test> patch_idct_test_t;
+	typedef patch_idct_test_t::object patch_idct_test_object_t;
+	tut::patch_idct_test_t tut_patch_idct_test("LLPatchDecompressor");
+
+	template<> template<>
+	void patch_idct_test_object_t::test<1>()
+	{
+		// a DC-only patch is flat
+		LLPatchDecompressor decompressor;
+		decompressor.init(NORMAL_PATCH_SIZE);
+
+		S32 cpatch[NORMAL_PATCH_SIZE*NORMAL_PATCH_SIZE] = { 0 };
+		cpatch[0] = 10;
+		LLPatchHeader ph;
+		ph.dc_offset = 20.f;
+		ph.range = 16;
+		ph.quant_wbits = 0x48;
+		ph.patchids = 0;
+
+		F32 heights[NORMAL_PATCH_SIZE*NORMAL_PATCH_SIZE];
+		decompressor.decompress(heights, NORMAL_PATCH_SIZE, cpatch, &ph);
+		for (S32 i = 1; i < NORMAL_PATCH_SIZE*NORMAL_PATCH_SIZE; i++)
+		{
+			ensure_approximately_equals("flat patch", heights[i], heights[0], 16);
+		}
+	}
+
+	template<> template<>
+	void patch_idct_test_object_t::test<2>()
+	{
+		// matches the definition for both patch sizes, dense and sparse
+		const S32 stride = LARGE_PATCH_SIZE + 1;
+		S32 cpatch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+		F32 heights[stride*stride];
+		F32 expected[stride*stride];
+		LLPatchHeader ph;
+
+		for (S32 size = NORMAL_PATCH_SIZE; size <= LARGE_PATCH_SIZE; size *= 2)
+		{
+			LLPatchDecompressor decompressor;
+			decompressor.init(size);
+			for (S32 n = 0; n < 20; n++)
+			{
+				random_patch(size, n < 10 ? size*size : 1 + ll_rand(40), cpatch, ph);
+				decompressor.decompress(heights, stride, cpatch, &ph);
+				reference_idct(size, cpatch, ph, expected, stride);
+
+				// single precision sums, allow for rounding relative to the
+				// size of the patch
+				F32 max_height = 1.f;
+				for (S32 y = 0; y < size; y++)
+				{
+					for (S32 x = 0; x < size; x++)
+					{
+						max_height = llmax(max_height, fabsf(expected[y*stride + x]));
+					}
+				}
+				for (S32 y = 0; y < size; y++)
+				{
+					for (S32 x = 0; x < size; x++)
+					{
+						F32 error = fabsf(heights[y*stride + x] - expected[y*stride + x]);
+						ensure("height", error <= 1.e-3f*max_height);
+					}
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void patch_idct_test_object_t::test<3>()
+	{
+		// the shared decompressor behind decompress_patch() gives the same
+		// heights as a private one
+		LLGroupHeader gopp;
+		gopp.stride = NORMAL_PATCH_SIZE;
+		gopp.patch_size = NORMAL_PATCH_SIZE;
+		gopp.layer_type = 0;
+		init_patch_decompressor(gopp.patch_size);
+		set_group_of_patch_header(&gopp);
+
+		LLPatchDecompressor decompressor;
+		decompressor.init(NORMAL_PATCH_SIZE);
+
+		S32 cpatch[NORMAL_PATCH_SIZE*NORMAL_PATCH_SIZE];
+		F32 heights[NORMAL_PATCH_SIZE*NORMAL_PATCH_SIZE];
+		F32 expected[NORMAL_PATCH_SIZE*NORMAL_PATCH_SIZE];
+		LLPatchHeader ph;
+		random_patch(NORMAL_PATCH_SIZE, 30, cpatch, ph);
+
+		decompress_patch(heights, cpatch, &ph);
+		decompressor.decompress(expected, NORMAL_PATCH_SIZE, cpatch, &ph);
+		ensure("same heights", memcmp(heights, expected, sizeof(heights)) == 0);
+	}
+}
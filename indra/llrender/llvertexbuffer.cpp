@@ -33,6 +33,165 @@
 #include "llglheaders.h"
 #include "llmemtype.h"
 #include "llrender.h"
+#include "llframetimer.h"
+
+//============================================================================
+
+LLStreamRing::LLStreamRing(U32 target, U32 size)
+: mTarget(target),
+  mName(0),
+  mSize(size),
+  mHead(0),
+  mEpoch(0)
+{
+}
+
+U32 LLStreamRing::upload(const U8* data, U32 size)
+{
+	U32 offset = allocate(size);
+
+	stop_glerror();
+	glBufferSubDataARB(mTarget, offset, size, data);
+	stop_glerror();
+
+	LLVertexBuffer::sUploadBytes += size;
+	return offset;
+}
+
+BOOL LLStreamRing::isValid(U32 frame, U32 epoch) const
+{
+	return mName && epoch == mEpoch && 
+		LLFrameTimer::getFrameCount() - frame < STREAM_RING_FRAMES;
+}
+
+void LLStreamRing::cleanup()
+{
+	if (mName)
+	{
+		glDeleteBuffersARB(1, (GLuint*) &mName);
+		mName = 0;
+		LLVertexBuffer::sDestroyCount++;
+	}
+	mFences.clear();
+	mHead = 0;
+	mEpoch++;
+}
+
+U32 LLStreamRing::getName()
+{
+	if (!mName)
+	{
+		glGenBuffersARB(1, (GLuint*) &mName);
+		LLVertexBuffer::sCreateCount++;
+		bind();
+		orphan();
+	}
+	return mName;
+}
+
+void LLStreamRing::bind()
+{ //keep LLVertexBuffer's idea of what is bound in sync
+	if (mTarget == GL_ARRAY_BUFFER_ARB)
+	{
+		if (LLVertexBuffer::sGLRenderBuffer != mName || !LLVertexBuffer::sVBOActive)
+		{
+			glBindBufferARB(mTarget, mName);
+			LLVertexBuffer::sGLRenderBuffer = mName;
+			LLVertexBuffer::sVBOActive = TRUE;
+			LLVertexBuffer::sBindCount++;
+		}
+	}
+	else
+	{
+		if (LLVertexBuffer::sGLRenderIndices != mName || !LLVertexBuffer::sIBOActive)
+		{
+			glBindBufferARB(mTarget, mName);
+			LLVertexBuffer::sGLRenderIndices = mName;
+			LLVertexBuffer::sIBOActive = TRUE;
+			LLVertexBuffer::sBindCount++;
+		}
+	}
+}
+
+U32 LLStreamRing::allocate(U32 size)
+{
+	U32 frame = LLFrameTimer::getFrameCount();
+	
+	size = (size + STREAM_RING_ALIGN - 1) & ~(STREAM_RING_ALIGN - 1);
+
+	getName();
+	bind();
+
+	if (size > mSize/4)
+	{ //a region this large would thrash the ring, grow the store
+		while (size > mSize/4)
+		{
+			mSize *= 2;
+		}
+		orphan();
+	}
+
+	retire(frame);
+
+	U32 offset = mHead;
+
+	if (mFences.empty())
+	{ //nothing in flight, whole ring is free
+		if (offset + size > mSize)
+		{
+			offset = 0;
+		}
+	}
+	else
+	{
+		U32 tail = mFences.front().mBegin;
+		if (mHead >= tail)
+		{ //free space is [head, size) and [0, tail)
+			if (offset + size > mSize)
+			{
+				offset = 0;
+				if (size >= tail)
+				{
+					orphan();
+				}
+			}
+		}
+		else if (offset + size >= tail)
+		{ //free space is [head, tail)
+			orphan();
+			offset = 0;
+		}
+	}
+
+	if (mFences.empty() || mFences.back().mFrame != frame)
+	{
+		Fence fence = { offset, frame };
+		mFences.push_back(fence);
+	}
+
+	mHead = offset + size;
+
+	return offset;
+}
+
+void LLStreamRing::retire(U32 frame)
+{
+	while (!mFences.empty() && frame - mFences.front().mFrame >= STREAM_RING_FRAMES)
+	{
+		mFences.pop_front();
+	}
+}
+
+void LLStreamRing::orphan()
+{ //give the driver a fresh store, regions in flight keep the old one
+	stop_glerror();
+	glBufferDataARB(mTarget, mSize, NULL, GL_STREAM_DRAW_ARB);
+	stop_glerror();
+
+	mFences.clear();
+	mHead = 0;
+	mEpoch++;
+}
 
 //============================================================================
 
@@ -42,8 +201,14 @@ LLVBOPool LLVertexBuffer::sDynamicVBOPool;
 LLVBOPool LLVertexBuffer::sStreamIBOPool;
 LLVBOPool LLVertexBuffer::sDynamicIBOPool;
 
+LLStreamRing LLVertexBuffer::sStreamVBORing(GL_ARRAY_BUFFER_ARB, 4*1024*1024);
+LLStreamRing LLVertexBuffer::sStreamIBORing(GL_ELEMENT_ARRAY_BUFFER_ARB, 1024*1024);
+
 U32 LLVertexBuffer::sBindCount = 0;
 U32 LLVertexBuffer::sSetCount = 0;
+U32 LLVertexBuffer::sCreateCount = 0;
+U32 LLVertexBuffer::sDestroyCount = 0;
+U32 LLVertexBuffer::sUploadBytes = 0;
 S32 LLVertexBuffer::sCount = 0;
 S32 LLVertexBuffer::sGLCount = 0;
 S32 LLVertexBuffer::sMappedCount = 0;
@@ -57,6 +222,7 @@ BOOL LLVertexBuffer::sIBOActive = FALSE;
 U32 LLVertexBuffer::sAllocatedBytes = 0;
 BOOL LLVertexBuffer::sMapped = FALSE;
 BOOL LLVertexBuffer::sUseStreamDraw = TRUE;
+BOOL LLVertexBuffer::sUseStreamRing = TRUE;
 
 std::vector<U32> LLVertexBuffer::sDeleteList;
 
@@ -355,6 +521,8 @@ void LLVertexBuffer::cleanupClass()
 	LLMemType mt2(LLMemType::MTYPE_VERTEX_CLEANUP_CLASS);
 	unbind();
 	clientCopy(); // deletes GL buffers
+	sStreamVBORing.cleanup();
+	sStreamIBORing.cleanup();
 }
 
 void LLVertexBuffer::clientCopy(F64 max_time)
@@ -386,7 +554,17 @@ LLVertexBuffer::LLVertexBuffer(U32 typemask, S32 usage) :
 	mFilthy(FALSE),
 	mEmpty(TRUE),
 	mResized(FALSE),
-	mDynamicSize(FALSE)
+	mDynamicSize(FALSE),
+	mStreamed(FALSE),
+	mPartialUpload(FALSE),
+	mStreamDirty(FALSE),
+	mStreamIndexDirty(FALSE),
+	mStreamOffset(0),
+	mStreamIndexOffset(0),
+	mStreamFrame(0),
+	mStreamIndexFrame(0),
+	mStreamEpoch(0),
+	mStreamIndexEpoch(0)
 {
 	LLMemType mt2(LLMemType::MTYPE_VERTEX_CONSTRUCTOR);
 	if (!sEnableVBOs)
@@ -404,6 +582,11 @@ LLVertexBuffer::LLVertexBuffer(U32 typemask, S32 usage) :
 		mUsage = 0;
 	}
 
+#if !LL_DARWIN
+	//stream buffers are client arrays on apple (see useVBOs)
+	mStreamed = mUsage == GL_STREAM_DRAW_ARB && sUseStreamRing;
+#endif
+
 	S32 stride = calcStride(typemask, mOffsets);
 
 	mTypeMask = typemask;
@@ -461,6 +644,7 @@ void LLVertexBuffer::genBuffer()
 		glGenBuffersARB(1, (GLuint*)&mGLBuffer);
 	}
 	sGLCount++;
+	sCreateCount++;
 }
 
 void LLVertexBuffer::genIndices()
@@ -479,6 +663,7 @@ void LLVertexBuffer::genIndices()
 		glGenBuffersARB(1, (GLuint*)&mGLIndices);
 	}
 	sGLCount++;
+	sCreateCount++;
 }
 
 void LLVertexBuffer::releaseBuffer()
@@ -496,6 +681,7 @@ void LLVertexBuffer::releaseBuffer()
 		sDeleteList.push_back(mGLBuffer);
 	}
 	sGLCount--;
+	sDestroyCount++;
 }
 
 void LLVertexBuffer::releaseIndices()
@@ -513,6 +699,7 @@ void LLVertexBuffer::releaseIndices()
 		sDeleteList.push_back(mGLIndices);
 	}
 	sGLCount--;
+	sDestroyCount++;
 }
 
 void LLVertexBuffer::createGLBuffer()
@@ -532,7 +719,14 @@ void LLVertexBuffer::createGLBuffer()
 
 	mEmpty = TRUE;
 
-	if (useVBOs())
+	if (mStreamed)
+	{ //no buffer of our own, client copy is uploaded into the stream ring
+		mGLBuffer = sStreamVBORing.getName();
+		mMappedData = new U8[size];
+		memset(mMappedData, 0, size);
+		mStreamDirty = TRUE;
+	}
+	else if (useVBOs())
 	{
 		mMappedData = NULL;
 		genBuffer();
@@ -564,7 +758,14 @@ void LLVertexBuffer::createGLIndices()
 
 	mEmpty = TRUE;
 
-	if (useVBOs())
+	if (mStreamed)
+	{
+		mGLIndices = sStreamIBORing.getName();
+		mMappedIndexData = new U8[size];
+		memset(mMappedIndexData, 0, size);
+		mStreamIndexDirty = TRUE;
+	}
+	else if (useVBOs())
 	{
 		mMappedIndexData = NULL;
 		genIndices();
@@ -584,7 +785,17 @@ void LLVertexBuffer::destroyGLBuffer()
 	LLMemType mt2(LLMemType::MTYPE_VERTEX_DESTROY_BUFFER);
 	if (mGLBuffer)
 	{
-		if (useVBOs())
+		if (mStreamed)
+		{
+			if (mVertexLocked)
+			{
+				llerrs << "Vertex buffer destroyed while mapped!" << llendl;
+			}
+			delete [] mMappedData;
+			mMappedData = NULL;
+			mEmpty = TRUE;
+		}
+		else if (useVBOs())
 		{
 			freeClientBuffer() ;
 
@@ -613,7 +824,17 @@ void LLVertexBuffer::destroyGLIndices()
 	LLMemType mt2(LLMemType::MTYPE_VERTEX_DESTROY_INDICES);
 	if (mGLIndices)
 	{
-		if (useVBOs())
+		if (mStreamed)
+		{
+			if (mIndexLocked)
+			{
+				llerrs << "Vertex buffer destroyed while mapped." << llendl;
+			}
+			delete [] mMappedIndexData;
+			mMappedIndexData = NULL;
+			mEmpty = TRUE;
+		}
+		else if (useVBOs())
 		{
 			freeClientBuffer() ;
 
@@ -754,7 +975,7 @@ void LLVertexBuffer::resizeBuffer(S32 newnverts, S32 newnindices)
 			else
 			{
 				//delete old buffer, keep GL buffer for now
-				if (!useVBOs())
+				if (!useVBOs() || mStreamed)
 				{
 					U8* old = mMappedData;
 					mMappedData = new U8[newsize];
@@ -774,7 +995,15 @@ void LLVertexBuffer::resizeBuffer(S32 newnverts, S32 newnindices)
 						mEmpty = TRUE;
 					}
 				}
-				mResized = TRUE;
+
+				if (mStreamed)
+				{ //client copy is re-uploaded once filled, no GL store to reset
+					mStreamDirty = TRUE;
+				}
+				else
+				{
+					mResized = TRUE;
+				}
 			}
 		}
 		else if (mGLBuffer)
@@ -790,7 +1019,7 @@ void LLVertexBuffer::resizeBuffer(S32 newnverts, S32 newnindices)
 			}
 			else
 			{
-				if (!useVBOs())
+				if (!useVBOs() || mStreamed)
 				{
 					//delete old buffer, keep GL buffer for now
 					U8* old = mMappedIndexData;
@@ -811,7 +1040,15 @@ void LLVertexBuffer::resizeBuffer(S32 newnverts, S32 newnindices)
 						mEmpty = TRUE;
 					}
 				}
-				mResized = TRUE;
+
+				if (mStreamed)
+				{
+					mStreamIndexDirty = TRUE;
+				}
+				else
+				{
+					mResized = TRUE;
+				}
 			}
 		}
 		else if (mGLIndices)
@@ -848,7 +1085,7 @@ BOOL LLVertexBuffer::useVBOs() const
 //----------------------------------------------------------------------------
 void LLVertexBuffer::freeClientBuffer()
 {
-	if(useVBOs() && sDisableVBOMapping && (mMappedData || mMappedIndexData))
+	if(useVBOs() && !mStreamed && useClientCopy() && (mMappedData || mMappedIndexData))
 	{
 		delete[] mMappedData ;
 		delete[] mMappedIndexData ;
@@ -889,6 +1126,17 @@ U8* LLVertexBuffer::mapVertexBuffer(S32 type, S32 access)
 	{
 		llerrs << "LLVertexBuffer::mapVertexBuffer() called on unallocated buffer." << llendl;
 	}
+
+	if (mStreamed)
+	{ //write straight into the client copy, uploaded in setBuffer
+		if (!mVertexLocked)
+		{
+			allocateClientVertexBuffer();
+			mVertexLocked = TRUE;
+			sMappedCount++;
+		}
+		return mMappedData;
+	}
 		
 	if (!mVertexLocked && useVBOs())
 	{
@@ -898,7 +1146,7 @@ U8* LLVertexBuffer::mapVertexBuffer(S32 type, S32 access)
 			mVertexLocked = TRUE;
 			stop_glerror();	
 
-			if(sDisableVBOMapping)
+			if(useClientCopy())
 			{
 				allocateClientVertexBuffer() ;
 			}
@@ -919,7 +1167,7 @@ U8* LLVertexBuffer::mapVertexBuffer(S32 type, S32 access)
 			llinfos << "Available physical mwmory(KB): " << avail_phy_mem << llendl ; 
 			llinfos << "Available virtual memory(KB): " << avail_vir_mem << llendl;
 
-			if(!sDisableVBOMapping)
+			if(!useClientCopy())
 			{
 				//--------------------
 				//print out more debug info before crash
@@ -962,6 +1210,17 @@ U8* LLVertexBuffer::mapIndexBuffer(S32 access)
 		llerrs << "LLVertexBuffer::mapIndexBuffer() called on unallocated buffer." << llendl;
 	}
 
+	if (mStreamed)
+	{
+		if (!mIndexLocked)
+		{
+			allocateClientIndexBuffer();
+			mIndexLocked = TRUE;
+			sMappedCount++;
+		}
+		return mMappedIndexData;
+	}
+
 	if (!mIndexLocked && useVBOs())
 	{
 		{
@@ -971,7 +1230,7 @@ U8* LLVertexBuffer::mapIndexBuffer(S32 access)
 			mIndexLocked = TRUE;
 			stop_glerror();	
 
-			if(sDisableVBOMapping)
+			if(useClientCopy())
 			{
 				allocateClientIndexBuffer() ;
 			}
@@ -986,7 +1245,7 @@ U8* LLVertexBuffer::mapIndexBuffer(S32 access)
 		{
 			log_glerror();
 
-			if(!sDisableVBOMapping)
+			if(!useClientCopy())
 			{
 				GLint buff;
 				glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING_ARB, &buff);
@@ -1017,16 +1276,51 @@ void LLVertexBuffer::unmapBuffer(S32 type)
 		return ; //nothing to unmap
 	}
 
+	if (mStreamed)
+	{ //nothing to unmap either, just note what needs uploading
+		bool updated_all = mVertexLocked && mIndexLocked && type < 0;
+		if (mVertexLocked && type != TYPE_INDEX)
+		{
+			mVertexLocked = FALSE;
+			mStreamDirty = TRUE;
+			sMappedCount--;
+		}
+		if (mIndexLocked && (type < 0 || type == TYPE_INDEX))
+		{
+			mIndexLocked = FALSE;
+			mStreamIndexDirty = TRUE;
+			sMappedCount--;
+		}
+		if (updated_all)
+		{
+			mEmpty = FALSE;
+		}
+		return;
+	}
+
 	bool updated_all = false ;
 	if (mMappedData && mVertexLocked && type != TYPE_INDEX)
 	{
 		updated_all = (mIndexLocked && type < 0) ; //both vertex and index buffers done updating
 
-		if(sDisableVBOMapping)
+		if(mPartialUpload && !mDirtyRegions.empty())
+		{
+			stop_glerror();
+			for (std::vector<DirtyRegion>::iterator iter = mDirtyRegions.begin(); iter != mDirtyRegions.end(); ++iter)
+			{
+				S32 offset = iter->mIndex * mStride;
+				S32 size = iter->mCount * mStride;
+				glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, offset, size, mMappedData + offset);
+				sUploadBytes += size;
+			}
+			stop_glerror();
+		}
+		else if(useClientCopy())
 		{
 			stop_glerror();
 			glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, getSize(), mMappedData);
 			stop_glerror();
+			sUploadBytes += getSize();
 		}
 		else
 		{
@@ -1035,6 +1329,7 @@ void LLVertexBuffer::unmapBuffer(S32 type)
 			stop_glerror();
 
 			mMappedData = NULL;
+			sUploadBytes += getSize();
 		}
 
 		mVertexLocked = FALSE ;
@@ -1043,11 +1338,24 @@ void LLVertexBuffer::unmapBuffer(S32 type)
 
 	if(mMappedIndexData && mIndexLocked && (type < 0 || type == TYPE_INDEX))
 	{
-		if(sDisableVBOMapping)
+		if(mPartialUpload && !mDirtyRegions.empty())
+		{
+			stop_glerror();
+			for (std::vector<DirtyRegion>::iterator iter = mDirtyRegions.begin(); iter != mDirtyRegions.end(); ++iter)
+			{
+				S32 offset = iter->mIndicesIndex * sizeof(U16);
+				S32 size = iter->mIndicesCount * sizeof(U16);
+				glBufferSubDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, offset, size, mMappedIndexData + offset);
+				sUploadBytes += size;
+			}
+			stop_glerror();
+		}
+		else if(useClientCopy())
 		{
 			stop_glerror();
 			glBufferSubDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0, getIndicesSize(), mMappedIndexData);
 			stop_glerror();
+			sUploadBytes += getIndicesSize();
 		}
 		else
 		{
@@ -1056,12 +1364,18 @@ void LLVertexBuffer::unmapBuffer(S32 type)
 			stop_glerror();
 
 			mMappedIndexData = NULL ;
+			sUploadBytes += getIndicesSize();
 		}
 
 		mIndexLocked = FALSE ;
 		sMappedCount--;
 	}
 
+	if (!mVertexLocked && !mIndexLocked)
+	{
+		mDirtyRegions.clear();
+	}
+
 	if(updated_all)
 	{
 		if(mUsage == GL_STATIC_DRAW_ARB)
@@ -1071,7 +1385,7 @@ void LLVertexBuffer::unmapBuffer(S32 type)
 			mEmpty = TRUE;
 			mFinal = TRUE;
 
-			if(sDisableVBOMapping)
+			if(useClientCopy())
 			{
 				freeClientBuffer() ;
 			}
@@ -1202,6 +1516,21 @@ void LLVertexBuffer::setBuffer(U32 data_mask, S32 type)
 	//set up pointers if the data mask is different ...
 	BOOL setup = (sLastMask != data_mask);
 
+	if (mStreamed)
+	{
+		unmapBuffer(type);
+
+		//stream buffers never set mResized, a reallocated client copy
+		//is only flagged dirty and uploaded once here after being filled
+		if (!mVertexLocked && !mIndexLocked)
+		{
+			uploadStreamBuffer();
+		}
+
+		//every stream buffer shares the ring's GL name, so pointers always need setting up
+		setup = TRUE;
+	}
+
 	if (useVBOs())
 	{
 		if (mGLBuffer && (mGLBuffer != sGLRenderBuffer || !sVBOActive))
@@ -1389,7 +1718,7 @@ void LLVertexBuffer::setupVertexBuffer(U32 data_mask) const
 {
 	LLMemType mt2(LLMemType::MTYPE_VERTEX_SETUP_VERTEX_BUFFER);
 	stop_glerror();
-	U8* base = useVBOs() ? NULL : mMappedData;
+	U8* base = (U8*) getVerticesPointer();
 	S32 stride = mStride;
 
 	if ((data_mask & mTypeMask) != data_mask)
@@ -1450,11 +1779,36 @@ void LLVertexBuffer::setupVertexBuffer(U32 data_mask) const
 	llglassertok();
 }
 
+void LLVertexBuffer::uploadStreamBuffer()
+{
+	LLMemType mt2(LLMemType::MTYPE_VERTEX_SET_BUFFER);
+
+	if (mMappedData && getSize() > 0 &&
+		(mStreamDirty || !sStreamVBORing.isValid(mStreamFrame, mStreamEpoch)))
+	{ //written since last upload, or the ring recycled our region
+		mStreamOffset = sStreamVBORing.upload(mMappedData, getSize());
+		mStreamFrame = LLFrameTimer::getFrameCount();
+		mStreamEpoch = sStreamVBORing.getEpoch();
+		mStreamDirty = FALSE;
+		mGLBuffer = sStreamVBORing.getName();
+	}
+
+	if (mMappedIndexData && getIndicesSize() > 0 &&
+		(mStreamIndexDirty || !sStreamIBORing.isValid(mStreamIndexFrame, mStreamIndexEpoch)))
+	{
+		mStreamIndexOffset = sStreamIBORing.upload(mMappedIndexData, getIndicesSize());
+		mStreamIndexFrame = LLFrameTimer::getFrameCount();
+		mStreamIndexEpoch = sStreamIBORing.getEpoch();
+		mStreamIndexDirty = FALSE;
+		mGLIndices = sStreamIBORing.getName();
+	}
+}
+
 void LLVertexBuffer::markDirty(U32 vert_index, U32 vert_count, U32 indices_index, U32 indices_count)
 {
 	// TODO: use GL_APPLE_flush_buffer_range here
-	/*if (useVBOs() && !mFilthy)
+	if (mPartialUpload && !mFilthy && (vert_count > 0 || indices_count > 0))
 	{
-	
-	}*/
+		mDirtyRegions.push_back(DirtyRegion(vert_index, vert_count, indices_index, indices_count));
+	}
 }
@@ -37,6 +37,7 @@
 #include <set>
 #include <vector>
 #include <list>
+#include <deque>
 
 //============================================================================
 // NOTES
@@ -67,6 +68,60 @@ protected:
 };
 
 
+//============================================================================
+// ring allocator for streaming vertex and index data
+//
+// Stream usage vertex buffers keep their data in client memory and are
+// uploaded with glBufferSubDataARB into a region of one large GL buffer when
+// set for rendering.  Regions are fenced by the frame they were written in and
+// are not handed out again until STREAM_RING_FRAMES frames later.  If the ring
+// wraps onto a region that may still be in flight, the buffer store is
+// orphaned rather than stalling the pipeline.
+
+class LLStreamRing
+{
+public:
+	enum
+	{
+		STREAM_RING_FRAMES = 3,
+		STREAM_RING_ALIGN = 16
+	};
+
+	LLStreamRing(U32 target, U32 size);
+
+	// copy size bytes of data into the ring, returns byte offset of the region
+	// (the ring buffer is left bound to its target)
+	U32 upload(const U8* data, U32 size);
+	
+	// TRUE if a region uploaded at frame/epoch has not been recycled yet
+	BOOL isValid(U32 frame, U32 epoch) const;
+
+	void cleanup();
+
+	U32 getName(); // creates the GL buffer on first use
+	U32 getEpoch() const					{ return mEpoch; }
+	U32 getSize() const						{ return mSize; }
+
+private:
+	U32 allocate(U32 size);
+	void bind();
+	void retire(U32 frame);
+	void orphan();
+
+	struct Fence
+	{
+		U32 mBegin; //first byte written in mFrame
+		U32 mFrame;
+	};
+
+	U32 mTarget;
+	U32 mName;
+	U32 mSize;
+	U32 mHead;
+	U32 mEpoch;
+	std::deque<Fence> mFences;
+};
+
 //============================================================================
 // base class
 
@@ -78,7 +133,11 @@ public:
 	static LLVBOPool sStreamIBOPool;
 	static LLVBOPool sDynamicIBOPool;
 
+	static LLStreamRing sStreamVBORing;
+	static LLStreamRing sStreamIBORing;
+
 	static BOOL	sUseStreamDraw;
+	static BOOL	sUseStreamRing; //suballocate stream buffers from sStreamVBORing/sStreamIBORing
 
 	static void initClass(bool use_vbo, bool no_vbo_mapping);
 	static void cleanupClass();
@@ -141,8 +200,10 @@ protected:
 	virtual BOOL	useVBOs() const;
 	void	unmapBuffer(S32 type);
 	void freeClientBuffer() ;
+	BOOL useClientCopy() const				{ return sDisableVBOMapping || mPartialUpload; }
 	void allocateClientVertexBuffer() ;
 	void allocateClientIndexBuffer() ;
+	void uploadStreamBuffer(); //copy client data into the stream rings if dirty or recycled
 
 public:
 	LLVertexBuffer(U32 typemask, S32 usage);
@@ -181,8 +242,8 @@ public:
 	S32 getRequestedVerts() const			{ return mRequestedNumVerts; }
 	S32 getRequestedIndices() const			{ return mRequestedNumIndices; }
 
-	U8* getIndicesPointer() const			{ return useVBOs() ? NULL : mMappedIndexData; }
-	U8* getVerticesPointer() const			{ return useVBOs() ? NULL : mMappedData; }
+	U8* getIndicesPointer() const			{ return useVBOs() ? (U8*) NULL + mStreamIndexOffset : mMappedIndexData; }
+	U8* getVerticesPointer() const			{ return useVBOs() ? (U8*) NULL + mStreamOffset : mMappedData; }
 	S32 getStride() const					{ return mStride; }
 	S32 getTypeMask() const					{ return mTypeMask; }
 	BOOL hasDataType(S32 type) const		{ return ((1 << type) & getTypeMask()) ? TRUE : FALSE; }
@@ -192,9 +253,14 @@ public:
 	U8* getMappedIndices() const			{ return mMappedIndexData; }
 	S32 getOffset(S32 type) const			{ return mOffsets[type]; }
 	S32 getUsage() const					{ return mUsage; }
+	BOOL isStreamed() const					{ return mStreamed; }
 
 	void setStride(S32 type, S32 new_stride);
 	
+	// With partial upload on, the buffer is written through a client copy
+	// and unmapBuffer() only uploads the regions passed to markDirty() since
+	// the last upload, or everything if none were.
+	void setPartialUpload(BOOL partial)		{ mPartialUpload = partial; }
 	void markDirty(U32 vert_index, U32 vert_count, U32 indices_index, U32 indices_count);
 
 	void draw(U32 mode, U32 count, U32 indices_offset) const;
@@ -221,6 +287,16 @@ protected:
 	BOOL	mEmpty;			// if TRUE, client buffer is empty (or NULL). Old values have been discarded.	
 	BOOL	mResized;		// if TRUE, client buffer has been resized and GL buffer has not
 	BOOL	mDynamicSize;	// if TRUE, buffer has been resized at least once (and should be padded)
+	BOOL	mStreamed;		// if TRUE, data lives in client memory and is suballocated from the stream rings
+	BOOL	mPartialUpload;	// if TRUE, only dirty regions are uploaded, see setPartialUpload()
+	BOOL	mStreamDirty;	// if TRUE, client vertex data has changed since the last upload
+	BOOL	mStreamIndexDirty;	// if TRUE, client index data has changed since the last upload
+	U32		mStreamOffset;	// byte offset of vertex data in sStreamVBORing
+	U32		mStreamIndexOffset;	// byte offset of index data in sStreamIBORing
+	U32		mStreamFrame;	// frame vertex data was last uploaded in
+	U32		mStreamIndexFrame;	// frame index data was last uploaded in
+	U32		mStreamEpoch;	// sStreamVBORing epoch of the last vertex upload
+	U32		mStreamIndexEpoch;	// sStreamIBORing epoch of the last index upload
 	S32		mOffsets[TYPE_MAX];
 
 	class DirtyRegion
@@ -258,6 +334,9 @@ public:
 	static U32 sAllocatedBytes;
 	static U32 sBindCount;
 	static U32 sSetCount;
+	static U32 sCreateCount; //GL buffers created since last reset (per frame)
+	static U32 sDestroyCount; //GL buffers released since last reset (per frame)
+	static U32 sUploadBytes; //bytes copied to GL buffers since last reset (per frame)
 };
 
 
@@ -35,6 +35,7 @@
 #include "v4math.h"
 #include "llquaternion.h"
 #include "lluuid.h"
+#include "llfile.h"
 
 //////////////////////////////////////////////////////////////
 // LLXmlTree
@@ -113,6 +114,226 @@ void LLXmlTree::dumpNode( LLXmlTreeNode* node, const std::string& prefix )
 	}
 }
 
+//////////////////////////////////////////////////////////////
+// Binary copy
+//
+// U32 header[BINARY_HEADER_WORDS]
+// U32 string_ends[num_strings]		end offset of each string in the blob
+// char blob[string_bytes]			padded to 4 bytes
+// U32 nodes[]						document order, each node is
+//		name, contents (or BINARY_NO_STRING), num_attributes,
+//		{key, value} * num_attributes, num_children, children...
+
+static const U32 BINARY_MAGIC = 0x54584c4c; // "LLXT" on little endian hosts
+static const U32 BINARY_VERSION = 1;
+static const U32 BINARY_NO_STRING = 0xffffffff;
+static const U32 BINARY_MAX_DEPTH = 128;	// deeper copies are rejected, not recursed into
+enum
+{
+	BINARY_HEADER_MAGIC,
+	BINARY_HEADER_VERSION,
+	BINARY_HEADER_STAMP_LOW,
+	BINARY_HEADER_STAMP_HIGH,
+	BINARY_HEADER_NUM_STRINGS,
+	BINARY_HEADER_STRING_BYTES,
+	BINARY_HEADER_WORDS
+};
+
+static U32 add_binary_string(const std::string& str, std::map<std::string, U32>& indices,
+							 std::string& blob, std::vector<U32>& string_ends)
+{
+	std::pair<std::map<std::string, U32>::iterator, bool> result =
+		indices.insert(std::make_pair(str, (U32) string_ends.size()));
+	if (result.second)
+	{
+		blob.append(str);
+		string_ends.push_back((U32) blob.size());
+	}
+	return result.first->second;
+}
+
+// static
+void LLXmlTree::writeBinaryNode(LLXmlTreeNode* node, string_index_map_t& indices, std::string& blob,
+								std::vector<U32>& string_ends, std::vector<U32>& words)
+{
+	words.push_back(add_binary_string(node->mName, indices, blob, string_ends));
+	words.push_back(node->mContents.empty() ? BINARY_NO_STRING :
+					add_binary_string(node->mContents, indices, blob, string_ends));
+	words.push_back((U32) node->mAttributes.size());
+	for (LLXmlTreeNode::attribute_map_t::iterator iter = node->mAttributes.begin();
+		 iter != node->mAttributes.end(); ++iter)
+	{
+		words.push_back(add_binary_string(*iter->first, indices, blob, string_ends));
+		words.push_back(add_binary_string(*iter->second, indices, blob, string_ends));
+	}
+	words.push_back((U32) node->mChildList.size());
+	for (LLXmlTreeNode::child_list_t::iterator iter = node->mChildList.begin();
+		 iter != node->mChildList.end(); ++iter)
+	{
+		writeBinaryNode(*iter, indices, blob, string_ends, words);
+	}
+}
+
+LLXmlTreeNode* LLXmlTree::readBinaryNode(const U32*& cursor, const U32* end, const std::vector<std::string>& strings,
+										  U32 depth)
+{
+	if (depth > BINARY_MAX_DEPTH || end - cursor < 3)
+	{
+		return NULL;
+	}
+	const U32 name = *cursor++;
+	const U32 contents = *cursor++;
+	const U32 num_attributes = *cursor++;
+	// the attribute pairs and num_children have to fit, without overflowing
+	// num_attributes * 2
+	const U32 remaining = (U32)(end - cursor);
+	if (name >= strings.size() ||
+		(contents != BINARY_NO_STRING && contents >= strings.size()) ||
+		remaining == 0 ||
+		num_attributes > (remaining - 1) / 2)
+	{
+		return NULL;
+	}
+
+	LLXmlTreeNode* node = new LLXmlTreeNode(strings[name], NULL, this);
+	if (contents != BINARY_NO_STRING)
+	{
+		node->appendContents(strings[contents]);
+	}
+	for (U32 i = 0; i < num_attributes; i++)
+	{
+		const U32 key = *cursor++;
+		const U32 value = *cursor++;
+		if (key >= strings.size() || value >= strings.size())
+		{
+			delete node;
+			return NULL;
+		}
+		node->addAttribute(strings[key], strings[value]);
+	}
+
+	if (cursor >= end)
+	{
+		delete node;
+		return NULL;
+	}
+	const U32 num_children = *cursor++;
+	for (U32 i = 0; i < num_children; i++)
+	{
+		LLXmlTreeNode* child = readBinaryNode(cursor, end, strings, depth + 1);
+		if (!child)
+		{
+			delete node;
+			return NULL;
+		}
+		node->addChild(child);
+	}
+	return node;
+}
+
+BOOL LLXmlTree::loadBinary(const std::string &path, U64 stamp)
+{
+	LLFILE* fp = LLFile::fopen(path, "rb");		/*Flawfinder: ignore*/
+	if (!fp)
+	{
+		return FALSE;
+	}
+	fseek(fp, 0, SEEK_END);
+	const long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (size < (long)(BINARY_HEADER_WORDS * sizeof(U32)) || (size % sizeof(U32)) != 0)
+	{
+		fclose(fp);
+		return FALSE;
+	}
+
+	std::vector<U32> data(size / sizeof(U32));
+	const size_t words_read = fread(&data[0], sizeof(U32), data.size(), fp);
+	fclose(fp);
+	if (words_read != data.size() ||
+		data[BINARY_HEADER_MAGIC] != BINARY_MAGIC ||
+		data[BINARY_HEADER_VERSION] != BINARY_VERSION ||
+		data[BINARY_HEADER_STAMP_LOW] != (U32)(stamp & 0xffffffff) ||
+		data[BINARY_HEADER_STAMP_HIGH] != (U32)(stamp >> 32))
+	{
+		return FALSE;
+	}
+
+	const U32 num_strings = data[BINARY_HEADER_NUM_STRINGS];
+	const U32 string_bytes = data[BINARY_HEADER_STRING_BYTES];
+	const U32 blob_words = (string_bytes + sizeof(U32) - 1) / sizeof(U32);
+	if (num_strings > data.size() || blob_words > data.size() ||
+		BINARY_HEADER_WORDS + num_strings + blob_words > data.size())
+	{
+		return FALSE;
+	}
+
+	const U32* string_ends = &data[BINARY_HEADER_WORDS];
+	const char* blob = (const char*) (string_ends + num_strings);
+	std::vector<std::string> strings(num_strings);
+	U32 start = 0;
+	for (U32 i = 0; i < num_strings; i++)
+	{
+		if (string_ends[i] < start || string_ends[i] > string_bytes)
+		{
+			return FALSE;
+		}
+		strings[i].assign(blob + start, string_ends[i] - start);
+		start = string_ends[i];
+	}
+
+	cleanup();
+	const U32* cursor = string_ends + num_strings + blob_words;
+	const U32* end = &data[0] + data.size();
+	mRoot = readBinaryNode(cursor, end, strings, 0);
+	if (!mRoot || cursor != end)
+	{
+		cleanup();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL LLXmlTree::saveBinary(const std::string &path, U64 stamp)
+{
+	if (!mRoot)
+	{
+		return FALSE;
+	}
+
+	string_index_map_t indices;
+	std::string blob;
+	std::vector<U32> string_ends;
+	std::vector<U32> words;
+	writeBinaryNode(mRoot, indices, blob, string_ends, words);
+	const U32 string_bytes = (U32) blob.size();
+	blob.resize((blob.size() + sizeof(U32) - 1) / sizeof(U32) * sizeof(U32), '\0');
+
+	U32 header[BINARY_HEADER_WORDS];
+	header[BINARY_HEADER_MAGIC] = BINARY_MAGIC;
+	header[BINARY_HEADER_VERSION] = BINARY_VERSION;
+	header[BINARY_HEADER_STAMP_LOW] = (U32)(stamp & 0xffffffff);
+	header[BINARY_HEADER_STAMP_HIGH] = (U32)(stamp >> 32);
+	header[BINARY_HEADER_NUM_STRINGS] = (U32) string_ends.size();
+	header[BINARY_HEADER_STRING_BYTES] = string_bytes;
+
+	LLFILE* fp = LLFile::fopen(path, "wb");		/*Flawfinder: ignore*/
+	if (!fp)
+	{
+		return FALSE;
+	}
+	BOOL success = fwrite(header, sizeof(U32), BINARY_HEADER_WORDS, fp) == BINARY_HEADER_WORDS;
+	success = success && (string_ends.empty() || fwrite(&string_ends[0], sizeof(U32), string_ends.size(), fp) == string_ends.size());
+	success = success && (blob.empty() || fwrite(blob.data(), 1, blob.size(), fp) == blob.size());
+	success = success && fwrite(&words[0], sizeof(U32), words.size(), fp) == words.size();
+	fclose(fp);
+	if (!success)
+	{
+		LLFile::remove(path);
+	}
+	return success;
+}
+
 //////////////////////////////////////////////////////////////
 // LLXmlTreeNode
 
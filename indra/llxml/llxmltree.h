@@ -30,6 +30,7 @@
 
 #include <map>
 #include <list>
+#include <vector>
 #include "llstring.h"
 #include "llxmlparser.h"
 #include "string_table.h"
@@ -58,6 +59,14 @@ public:
 	virtual BOOL	parseFile(const std::string &path, BOOL keep_contents = TRUE);
 	virtual BOOL	parseString(const std::string &string, BOOL keep_contents = TRUE);
 
+	// Binary copy of a parsed tree, so a later run can skip the XML parser.
+	// The file is one flat block (header, string table, nodes in document
+	// order) that is read with a single call.  stamp identifies the source
+	// document, loadBinary() fails on a different stamp or format version,
+	// and on a truncated, corrupt or too deeply nested file.
+	BOOL			loadBinary(const std::string &path, U64 stamp);
+	BOOL			saveBinary(const std::string &path, U64 stamp);
+
 	LLXmlTreeNode*	getRoot() { return mRoot; }
 
 	void			dump();
@@ -77,6 +86,13 @@ protected:
 
 	// local
 	LLStdStringTable mNodeNames;	
+
+private:
+	typedef std::map<std::string, U32> string_index_map_t;
+	static void		writeBinaryNode(LLXmlTreeNode* node, string_index_map_t& indices, std::string& blob,
+									std::vector<U32>& string_ends, std::vector<U32>& words);
+	LLXmlTreeNode*	readBinaryNode(const U32*& cursor, const U32* end, const std::vector<std::string>& strings,
+								   U32 depth);
 };
 
 //////////////////////////////////////////////////////////////
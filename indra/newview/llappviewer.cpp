@@ -75,6 +75,7 @@
 #include "llteleporthistory.h"
 #include "lllocationhistory.h"
 #include "llfasttimerview.h"
+#include "llviewerbenchmark.h"
 #include "llvoicechannel.h"
 #include "llvoavatarself.h"
 #include "llsidetray.h"
@@ -134,6 +135,7 @@
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
+#include "lljobpool.h"
 #include "llevents.h"
 
 // The files below handle dependencies from cleanup.
@@ -165,6 +167,7 @@
 #include "llsdserialize.h"
 
 #include "llworld.h"
+#include "llregionprewarm.h"
 #include "llhudeffecttrail.h"
 #include "llvectorperfoptions.h"
 #include "llslurl.h"
@@ -178,6 +181,7 @@
 #include "llvosky.h"
 #include "llvotree.h"
 #include "llvoavatar.h"
+#include "llphysicsmotion.h"
 #include "llfolderview.h"
 #include "llagentpilot.h"
 #include "llvovolume.h"
@@ -471,14 +475,25 @@ static void settings_to_globals()
 	MENU_BAR_WIDTH		= gSavedSettings.getS32("MenuBarWidth");
 
 	LLSurface::setTextureSize(gSavedSettings.getU32("RegionTextureSize"));
+	LLSurface::setDecodeThreads(gSavedSettings.getS32("TerrainDecodeThreads"));
 	
 	LLImageGL::sGlobalUseAnisotropic	= gSavedSettings.getBOOL("RenderAnisotropic");
 	LLVOVolume::sLODFactor				= gSavedSettings.getF32("RenderVolumeLODFactor");
 	LLVOVolume::sDistanceFactor			= 1.f-LLVOVolume::sLODFactor * 0.1f;
 	LLVolumeImplFlexible::sUpdateFactor = gSavedSettings.getF32("RenderFlexTimeFactor");
+	LLVolumeImplFlexible::sUpdateDistance = gSavedSettings.getF32("RenderFlexUpdateDistance");
+	LLVolumeImplFlexible::setSimulationThreads(gSavedSettings.getS32("FlexiSimulationThreads"));
+	LLVOSky::setTileThreads(gSavedSettings.getS32("SkyTileThreads"));
 	LLVOTree::sTreeFactor				= gSavedSettings.getF32("RenderTreeLODFactor");
 	LLVOAvatar::sLODFactor				= gSavedSettings.getF32("RenderAvatarLODFactor");
 	LLVOAvatar::sPhysicsLODFactor		= gSavedSettings.getF32("RenderAvatarPhysicsLODFactor");
+	LLVOAvatar::sAvatarPhysics			= gSavedSettings.getBOOL("AvatarPhysics");
+	LLPhysicsMotionController::sBatchUpdate	= gSavedSettings.getBOOL("AvatarPhysicsBatch");
+	LLPhysicsMotionController::sLODDistance	= gSavedSettings.getF32("AvatarPhysicsLODDistance");
+	LLVOAvatar::sUpdateBudget			= gSavedSettings.getF32("AvatarUpdateBudget");
+	LLVOAvatar::sUpdateHeavyCost		= gSavedSettings.getF32("AvatarUpdateHeavyCost");
+	LLVOAvatar::setAnimationThreads(gSavedSettings.getS32("AvatarAnimationThreads"));
+	LLViewerJointMesh::setSkinningThreads(gSavedSettings.getS32("AvatarSkinningThreads"));
 	LLVOAvatar::sMaxVisible				= (U32)gSavedSettings.getS32("RenderAvatarMaxVisible");
 	LLVOAvatar::sVisibleInFirstPerson	= gSavedSettings.getBOOL("FirstPersonAvatarVisible");
 	// clamp auto-open time to some minimum usable value
@@ -512,6 +527,12 @@ static void settings_modify()
 		gSavedSettings.setU32("VectorizeProcessor", 0 );
 	}
 	else
+	if (gSysCPU.hasAVX() && gSavedSettings.getBOOL("VectorizeAVX"))
+	{
+		gSavedSettings.setBOOL("VectorizeEnable", TRUE );
+		gSavedSettings.setU32("VectorizeProcessor", 3 );
+	}
+	else
 	if (gSysCPU.hasSSE2())
 	{
 		gSavedSettings.setBOOL("VectorizeEnable", TRUE );
@@ -595,7 +616,9 @@ const std::string LLAppViewer::sGlobalSettingsName = "Global";
 
 LLTextureCache* LLAppViewer::sTextureCache = NULL; 
 LLImageDecodeThread* LLAppViewer::sImageDecodeThread = NULL; 
+LLImageCompositeThread* LLAppViewer::sImageCompositeThread = NULL;
 LLTextureFetch* LLAppViewer::sTextureFetch = NULL; 
+LLJobPool* LLAppViewer::sJobPool = NULL;
 
 LLAppViewer::LLAppViewer() : 
 	mMarkerFile(),
@@ -685,6 +708,33 @@ bool LLAppViewer::init()
 		LLError::setFatalFunction(boost::bind(_exit, rc));
 	}
 
+	// Workers for the per-frame batches, they sleep until a batch is run.
+	// Created ahead of the headless benchmarks below, which use it too.
+	sJobPool = new LLJobPool(LLJobPool::resolveNumWorkers(gSavedSettings.getS32("JobPoolThreads")), "Job Pool");
+
+	std::string layer_data_capture = gSavedSettings.getString("BenchmarkLayerDataFile");
+	if (!layer_data_capture.empty())
+	{
+		// Headless, nothing past this point has been set up.  Like
+		// QAModeTermCode, skip the normal cleanup.
+		bool ok = LLViewerBenchmark::runLayerDataBenchmark(layer_data_capture);
+		_exit(ok ? 0 : 1);
+	}
+
+	U32 flexi_chains = gSavedSettings.getU32("BenchmarkFlexiChains");
+	if (flexi_chains > 0)
+	{
+		bool ok = LLViewerBenchmark::runFlexiBenchmark(flexi_chains);
+		_exit(ok ? 0 : 1);
+	}
+
+	U32 physics_motions = gSavedSettings.getU32("BenchmarkPhysicsMotions");
+	if (physics_motions > 0)
+	{
+		bool ok = LLViewerBenchmark::runPhysicsBenchmark(physics_motions);
+		_exit(ok ? 0 : 1);
+	}
+
     mAlloc.setProfilingEnabled(gSavedSettings.getBOOL("MemProfiling"));
 
 #if LL_RECORD_VIEWER_STATS
@@ -1077,6 +1127,7 @@ bool LLAppViewer::mainLoop()
 	while (!LLApp::isExiting())
 	{
 		LLFastTimer::nextFrame(); // Should be outside of any timer instances
+		LLViewerBenchmark::nextFrame();
 
 		//clear call stack records
 		llclearcallstacks;
@@ -1576,6 +1627,8 @@ bool LLAppViewer::cleanup()
 	LLWaterParamManager::cleanupClass();
 	LLWLParamManager::cleanupClass();
 	LLPostProcess::cleanupClass();
+	LLSurface::cleanupClass();
+	LLVolumeImplFlexible::cleanupClass();
 
 	LLTracker::cleanupInstance();
 	
@@ -1695,6 +1748,7 @@ bool LLAppViewer::cleanup()
 		S32 pending = 0;
 		pending += LLAppViewer::getTextureCache()->update(1); // unpauses the worker thread
 		pending += LLAppViewer::getImageDecodeThread()->update(1); // unpauses the image thread
+		pending += LLAppViewer::getImageCompositeThread()->update(1); // unpauses the bake composite thread
 		pending += LLAppViewer::getTextureFetch()->update(1); // unpauses the texture fetch thread
 		pending += LLVFSThread::updateClass(0);
 		pending += LLLFSThread::updateClass(0);
@@ -1715,6 +1769,7 @@ bool LLAppViewer::cleanup()
 	sTextureFetch->shutdown();
 	sTextureCache->shutdown();	
 	sImageDecodeThread->shutdown();
+	sImageCompositeThread->shutdown();
 	
 	sTextureFetch->shutDownTextureCacheThread() ;
 	sTextureFetch->shutDownImageDecodeThread() ;
@@ -1725,6 +1780,10 @@ bool LLAppViewer::cleanup()
     sTextureFetch = NULL;
 	delete sImageDecodeThread;
     sImageDecodeThread = NULL;
+	delete sImageCompositeThread;
+	sImageCompositeThread = NULL;
+	delete sJobPool;
+	sJobPool = NULL;
 	delete mFastTimerLogThread;
 	mFastTimerLogThread = NULL;
 	
@@ -1854,6 +1913,8 @@ bool LLAppViewer::initThreads()
 
 	// Image decoding
 	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+	// Avatar bake compositing (AvatarBakeCompositeOnCPU)
+	LLAppViewer::sImageCompositeThread = new LLImageCompositeThread(enable_threads && true);
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(),
 													sImageDecodeThread,
@@ -1861,6 +1922,8 @@ bool LLAppViewer::initThreads()
 													app_metrics_qa_mode);
 	LLImage::initClass();
 
+	LLViewerBenchmark::initClass();
+
 	if (LLFastTimer::sLog || LLFastTimer::sMetricLog)
 	{
 		LLFastTimer::sLogLock = new LLMutex(NULL);
@@ -3871,6 +3934,7 @@ static LLFastTimer::DeclareTimer FTM_CLEANUP("Cleanup");
 static LLFastTimer::DeclareTimer FTM_IDLE_CB("Idle Callbacks");
 static LLFastTimer::DeclareTimer FTM_LOD_UPDATE("Update LOD");
 static LLFastTimer::DeclareTimer FTM_OBJECTLIST_UPDATE("Update Objectlist");
+static LLFastTimer::DeclareTimer FTM_REGION_PREWARM("Region Prewarm");
 static LLFastTimer::DeclareTimer FTM_REGION_UPDATE("Update Region");
 static LLFastTimer::DeclareTimer FTM_WORLD_UPDATE("Update World");
 static LLFastTimer::DeclareTimer FTM_NETWORK("Network");
@@ -3894,6 +3958,7 @@ void LLAppViewer::idle()
 	LLEventTimer::updateClass();
 	LLCriticalDamp::updateInterpolants();
 	LLMortician::updateClass();
+	LLViewerBenchmark::idle();
 	F32 dt_raw = idle_timer.getElapsedTimeAndResetF32();
 
 	// Cap out-of-control frame times
@@ -4187,6 +4252,10 @@ void LLAppViewer::idle()
 	//
 
 	LLWorld::getInstance()->updateVisibilities();
+	{
+		LLFastTimer t(FTM_REGION_PREWARM);
+		LLRegionPrewarm::getInstance()->update();
+	}
 	{
 		const F32 max_region_update_time = .001f; // 1ms
 		LLFastTimer t(FTM_REGION_UPDATE);
@@ -37,7 +37,9 @@ class LLFrameTimer;
 class LLPumpIO;
 class LLTextureCache;
 class LLImageDecodeThread;
+class LLImageCompositeThread;
 class LLTextureFetch;
+class LLJobPool;
 class LLWatchdogTimeout;
 class LLUpdaterService;
 
@@ -94,7 +96,9 @@ public:
 	// Thread accessors
 	static LLTextureCache* getTextureCache() { return sTextureCache; }
 	static LLImageDecodeThread* getImageDecodeThread() { return sImageDecodeThread; }
+	static LLImageCompositeThread* getImageCompositeThread() { return sImageCompositeThread; }
 	static LLTextureFetch* getTextureFetch() { return sTextureFetch; }
+	static LLJobPool* getJobPool() { return sJobPool; }
 
 	static U32 getTextureCacheVersion() ;
 	static U32 getObjectCacheVersion() ;
@@ -241,7 +245,9 @@ private:
 	// Thread objects.
 	static LLTextureCache* sTextureCache; 
 	static LLImageDecodeThread* sImageDecodeThread; 
+	static LLImageCompositeThread* sImageCompositeThread;
 	static LLTextureFetch* sTextureFetch;
+	static LLJobPool* sJobPool;
 
 	S32 mNumSessions;
 
@@ -677,48 +677,55 @@ void LLDrawable::updateDistance(LLCamera& camera, bool force_update)
 	//switch LOD with the spatial group to avoid artifacts
 	//LLSpatialGroup* sg = getSpatialGroup();
 
+	//if (!sg || sg->changeLOD())
+	{
+		LLVector3 pos = prepDistanceUpdate(camera, force_update);
+
+		pos -= camera.getOrigin();	
+		mDistanceWRTCamera = llround(pos.magVec(), 0.01f);
+		mVObjp->updateLOD();
+	}
+}
+
+LLVector3 LLDrawable::prepDistanceUpdate(LLCamera& camera, bool force_update)
+{
 	LLVector3 pos;
 
-	//if (!sg || sg->changeLOD())
+	LLVOVolume* volume = getVOVolume();
+	if (volume)
 	{
-		LLVOVolume* volume = getVOVolume();
-		if (volume)
+		volume->updateRelativeXform();
+		pos = volume->getRelativeXform().getTranslation();
+		if (isStatic())
 		{
-			volume->updateRelativeXform();
-			pos = volume->getRelativeXform().getTranslation();
-			if (isStatic())
-			{
-				pos += volume->getRegion()->getOriginAgent();
-			}
+			pos += volume->getRegion()->getOriginAgent();
+		}
 
-			if (isState(LLDrawable::HAS_ALPHA))
+		if (isState(LLDrawable::HAS_ALPHA))
+		{
+			for (S32 i = 0; i < getNumFaces(); i++)
 			{
-				for (S32 i = 0; i < getNumFaces(); i++)
+				LLFace* facep = getFace(i);
+				if (force_update || facep->getPoolType() == LLDrawPool::POOL_ALPHA)
 				{
-					LLFace* facep = getFace(i);
-					if (force_update || facep->getPoolType() == LLDrawPool::POOL_ALPHA)
+					LLVector3 box = (facep->mExtents[1] - facep->mExtents[0]) * 0.25f;
+					LLVector3 v = (facep->mCenterLocal-camera.getOrigin());
+					const LLVector3& at = camera.getAtAxis();
+					for (U32 j = 0; j < 3; j++)
 					{
-						LLVector3 box = (facep->mExtents[1] - facep->mExtents[0]) * 0.25f;
-						LLVector3 v = (facep->mCenterLocal-camera.getOrigin());
-						const LLVector3& at = camera.getAtAxis();
-						for (U32 j = 0; j < 3; j++)
-						{
-							v.mV[j] -= box.mV[j] * at.mV[j];
-						}
-						facep->mDistance = v * camera.getAtAxis();
+						v.mV[j] -= box.mV[j] * at.mV[j];
 					}
+					facep->mDistance = v * camera.getAtAxis();
 				}
 			}
 		}
-		else
-		{
-			pos = LLVector3(getPositionGroup());
-		}
-
-		pos -= camera.getOrigin();	
-		mDistanceWRTCamera = llround(pos.magVec(), 0.01f);
-		mVObjp->updateLOD();
 	}
+	else
+	{
+		pos = LLVector3(getPositionGroup());
+	}
+
+	return pos;
 }
 
 void LLDrawable::updateTexture()
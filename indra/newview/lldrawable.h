@@ -145,6 +145,7 @@ public:
 	void updateTexture();
 	void updateMaterial();
 	virtual void updateDistance(LLCamera& camera, bool force_update);
+	LLVector3 prepDistanceUpdate(LLCamera& camera, bool force_update); // updates alpha face distances, returns agent position used for LOD
 	BOOL updateGeometry(BOOL priority);
 	void updateFaceSize(S32 idx);
 		
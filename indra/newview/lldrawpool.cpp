@@ -396,6 +396,10 @@ void LLFacePool::LLOverrideFaceColor::setColor(F32 r, F32 g, F32 b, F32 a)
 //=============================
 // Render Pass Implementation
 //=============================
+BOOL LLRenderPass::sBatchDrawInfos = TRUE;
+U32 LLRenderPass::sDrawCalls[LLRenderPass::NUM_RENDER_TYPES];
+U32 LLRenderPass::sMergedBatches[LLRenderPass::NUM_RENDER_TYPES];
+
 LLRenderPass::LLRenderPass(const U32 type)
 : LLDrawPool(type)
 {
@@ -435,15 +439,118 @@ void LLRenderPass::renderTexture(U32 type, U32 mask)
 	pushBatches(type, mask, TRUE);
 }
 
+//static
+const char* LLRenderPass::getPassName(U32 type)
+{
+	static const char* pass_names[] =
+	{
+		"Simple",
+		"Grass",
+		"Fullbright",
+		"Invisible",
+		"Invisi Shiny",
+		"Fullbright Shiny",
+		"Shiny",
+		"Bump",
+		"Post Bump",
+		"Glow",
+		"Alpha",
+		"Alpha Mask",
+		"Fullbright Alpha Mask",
+		"Alpha Shadow"
+	};
+
+	if (type < PASS_SIMPLE || type >= NUM_RENDER_TYPES)
+	{
+		return "Unknown";
+	}
+	return pass_names[type - PASS_SIMPLE];
+}
+
+//static
+void LLRenderPass::resetPassStats()
+{
+	memset(sDrawCalls, 0, sizeof(sDrawCalls));
+	memset(sMergedBatches, 0, sizeof(sMergedBatches));
+}
+
+// draw infos can be folded into one draw call when they only differ in which range
+// of a shared vertex buffer they cover and the ranges are back to back
+static BOOL can_merge_batch(const LLDrawInfo& cur, const LLDrawInfo& next, U32 count)
+{
+	return next.mVertexBuffer == cur.mVertexBuffer &&
+		next.mOffset == cur.mOffset + count &&
+		next.mTexture == cur.mTexture &&
+		next.mTextureMatrix == cur.mTextureMatrix &&
+		next.mModelMatrix == cur.mModelMatrix &&
+		next.mFullbright == cur.mFullbright &&
+		next.mBump == cur.mBump &&
+		next.mGlowColor == cur.mGlowColor &&
+		next.mDrawMode == cur.mDrawMode;
+}
+
 void LLRenderPass::pushBatches(U32 type, U32 mask, BOOL texture)
 {
-	for (LLCullResult::drawinfo_list_t::iterator i = gPipeline.beginRenderMap(type); i != gPipeline.endRenderMap(type); ++i)	
+	LLCullResult::drawinfo_list_t::iterator end = gPipeline.endRenderMap(type);
+	for (LLCullResult::drawinfo_list_t::iterator i = gPipeline.beginRenderMap(type); i != end; ++i)	
 	{
 		LLDrawInfo* pparams = *i;
-		if (pparams) 
+		if (!pparams) 
+		{
+			continue;
+		}
+
+		LLCullResult::drawinfo_list_t::iterator j = i;
+		++j;
+
+		if (!sBatchDrawInfos || j == end || !*j || !can_merge_batch(*pparams, **j, pparams->mCount))
 		{
 			pushBatch(*pparams, mask, texture);
+			sDrawCalls[type]++;
+			continue;
 		}
+
+		//fold following draw infos into this one for the duration of the draw
+		U16 start = pparams->mStart;
+		U16 end_vert = pparams->mEnd;
+		U32 count = pparams->mCount;
+		F32 vsize = pparams->mVSize;
+
+		while (j != end && *j && can_merge_batch(*pparams, **j, count))
+		{
+			LLDrawInfo* next = *j;
+			if (next->mGroup)
+			{ //pushBatch only rebuilds the first group
+				next->mGroup->rebuildMesh();
+			}
+			start = llmin(start, next->mStart);
+			end_vert = llmax(end_vert, next->mEnd);
+			count += next->mCount;
+			vsize = llmax(vsize, next->mVSize);
+			sMergedBatches[type]++;
+			++j;
+		}
+
+		U16 old_start = pparams->mStart;
+		U16 old_end = pparams->mEnd;
+		U32 old_count = pparams->mCount;
+		F32 old_vsize = pparams->mVSize;
+
+		pparams->mStart = start;
+		pparams->mEnd = end_vert;
+		pparams->mCount = count;
+		pparams->mVSize = vsize;
+
+		pushBatch(*pparams, mask, texture);
+		sDrawCalls[type]++;
+
+		pparams->mStart = old_start;
+		pparams->mEnd = old_end;
+		pparams->mCount = old_count;
+		pparams->mVSize = old_vsize;
+
+		i = j;
+		--i;
 	}
 }
 
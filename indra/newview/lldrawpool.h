@@ -146,12 +146,17 @@ public:
 	void resetDrawOrders() { }
 
 	static void applyModelMatrix(LLDrawInfo& params);
+	static const char* getPassName(U32 type);
+	static void resetPassStats();
 	virtual void pushBatches(U32 type, U32 mask, BOOL texture = TRUE);
 	virtual void pushBatch(LLDrawInfo& params, U32 mask, BOOL texture);
 	virtual void renderGroup(LLSpatialGroup* group, U32 type, U32 mask, BOOL texture = TRUE);
 	virtual void renderGroups(U32 type, U32 mask, BOOL texture = TRUE);
 	virtual void renderTexture(U32 type, U32 mask);
 
+	static BOOL sBatchDrawInfos;
+	static U32 sDrawCalls[NUM_RENDER_TYPES];	// draw calls issued by pushBatches this frame
+	static U32 sMergedBatches[NUM_RENDER_TYPES];	// draw infos folded into a preceding draw call this frame
 };
 
 class LLFacePool : public LLDrawPool
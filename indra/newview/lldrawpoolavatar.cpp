@@ -679,15 +679,16 @@ void LLDrawPoolAvatar::renderAvatars(LLVOAvatar* single_avatar, S32 pass)
 
 		if (impostor)
 		{
-			if (LLPipeline::sRenderDeferred && avatarp->mImpostor.isComplete()) 
+			LLRenderTarget* impostor_target = avatarp->getImpostorTarget();
+			if (LLPipeline::sRenderDeferred && impostor_target->isComplete()) 
 			{
 				if (normal_channel > -1)
 				{
-					avatarp->mImpostor.bindTexture(2, normal_channel);
+					impostor_target->bindTexture(2, normal_channel);
 				}
 				if (specular_channel > -1)
 				{
-					avatarp->mImpostor.bindTexture(1, specular_channel);
+					impostor_target->bindTexture(1, specular_channel);
 				}
 			}
 			avatarp->renderImpostor(LLColor4U(255,255,255,255), diffuse_channel);
@@ -774,7 +775,9 @@ LLVertexBufferAvatar::LLVertexBufferAvatar()
 : LLVertexBuffer(sDataMask, 
 	GL_STREAM_DRAW_ARB) //avatars are always stream draw due to morph targets
 {
-
+	//but are rewritten far less often than every frame, keep a buffer of our own 
+	//instead of re-uploading into the stream ring whenever our region is recycled
+	mStreamed = FALSE;
 }
 
 
@@ -249,6 +249,7 @@ void LLDriverParam::setWeight(F32 weight, BOOL upload_bake)
 	{
 		mCurWeight = llclamp(weight, min_weight, max_weight);
 	}
+	markDirty();
 
 	//	driven    ________
 	//	^        /|       |\       ^
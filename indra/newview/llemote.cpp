@@ -86,7 +86,7 @@ BOOL LLEmote::onActivate()
 	if (mParam)
 	{
 		mParam->setWeight(0.f, FALSE);
-		mCharacter->updateVisualParams();
+		mCharacter->requestVisualParamUpdate();
 	}
 	
 	return TRUE;
@@ -113,7 +113,7 @@ BOOL LLEmote::onUpdate(F32 time, U8* joint_mask)
 			default_param->setWeight( default_param_weight, FALSE );
 		}
 
-		mCharacter->updateVisualParams();
+		mCharacter->requestVisualParamUpdate();
 	}
 
 	return TRUE;
@@ -136,7 +136,7 @@ void LLEmote::onDeactivate()
 		default_param->setWeight( default_param->getMaxWeight(), FALSE );
 	}
 
-	mCharacter->updateVisualParams();
+	mCharacter->requestVisualParamUpdate();
 }
 
 
@@ -176,6 +176,7 @@ void LLFace::init(LLDrawable* drawablep, LLViewerObject* objp)
 
 	mAtlasInfop = NULL ;
 	mUsingAtlas  = FALSE ;
+	mAtlasDiscardLevel = -1 ;
 	mHasMedia = FALSE ;
 }
 
@@ -1870,6 +1871,27 @@ LLViewerTexture* LLFace::getTexture() const
 	return mTexture ;
 }
 
+//whether switchTexture() could decide differently since the last call:
+//the atlas only qualifies or stops qualifying when the face gets another
+//texture or the texture is loaded at another discard level.
+BOOL LLFace::atlasTextureChanged()
+{
+	if(mTexture.isNull())
+	{
+		return FALSE ;
+	}
+
+	S32 discard_level = mTexture->getDiscardLevel() ;
+	if(mTexture->getID() == mAtlasTextureID && discard_level == mAtlasDiscardLevel)
+	{
+		return FALSE ;
+	}
+
+	mAtlasTextureID = mTexture->getID() ;
+	mAtlasDiscardLevel = discard_level ;
+	return TRUE ;
+}
+
 //switch to atlas or switch back to gl texture 
 //return TRUE if using atlas.
 BOOL LLFace::switchTexture()
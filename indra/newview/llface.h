@@ -204,6 +204,7 @@ public:
 	const LLTextureAtlas* getAtlas()const ;
 	void                  removeAtlas() ;
 	BOOL                  switchTexture() ;
+	BOOL                  atlasTextureChanged() ;
 
 private:	
 	F32         adjustPartialOverlapPixelArea(F32 cos_angle_to_view_dir, F32 radius );
@@ -267,6 +268,8 @@ private:
 	//atlas
 	LLPointer<LLTextureAtlasSlot> mAtlasInfop ;
 	BOOL                          mUsingAtlas ;
+	LLUUID                        mAtlasTextureID ;     //texture and discard level switchTexture() was
+	S32                           mAtlasDiscardLevel ;  //last decided for, see atlasTextureChanged()
 	
 protected:
 	static BOOL	sSafeRenderSelect;
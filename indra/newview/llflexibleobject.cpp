@@ -27,11 +27,13 @@
 #include "llviewerprecompiledheaders.h"
 
 #include "pipeline.h"
+#include "llappviewer.h"
 #include "lldrawpoolbump.h"
 #include "llface.h"
 #include "llflexibleobject.h"
 #include "llglheaders.h"
 #include "llrendersphere.h"
+#include "llv4matrix4.h"
 #include "llviewerobject.h"
 #include "llagent.h"
 #include "llsky.h"
@@ -44,9 +46,13 @@
 #include "llvoavatar.h"
 
 /*static*/ F32 LLVolumeImplFlexible::sUpdateFactor = 1.0f;
+/*static*/ F32 LLVolumeImplFlexible::sUpdateDistance = 64.f;
+/*static*/ LLVolumeImplFlexible::update_list_t LLVolumeImplFlexible::sUpdateList;
+/*static*/ U32 LLVolumeImplFlexible::sSimulationWorkers = 0;
 
 static LLFastTimer::DeclareTimer FTM_FLEXIBLE_REBUILD("Rebuild");
 static LLFastTimer::DeclareTimer FTM_DO_FLEXIBLE_UPDATE("Update");
+static LLFastTimer::DeclareTimer FTM_FLEXIBLE_SIMULATE("Simulate Flexies");
 
 // LLFlexibleObjectData::pack/unpack now in llprimitive.cpp
 
@@ -65,6 +71,12 @@ LLVolumeImplFlexible::LLVolumeImplFlexible(LLViewerObject* vo, LLFlexibleObjectD
 	mFrameNum = 0;
 	mCollisionSphereRadius = 0.f;
 	mRenderRes = 1;
+	mSecondsThisFrame = 0.f;
+	mFrameLength = 0.f;
+	mFrameDistance = 0.f;
+	mFrameWind = NULL;
+	mQueued = false;
+	mSimulatedFrame = U32_MAX;
 
 	if(mVO->mDrawable.notNull())
 	{
@@ -72,6 +84,83 @@ LLVolumeImplFlexible::LLVolumeImplFlexible(LLViewerObject* vo, LLFlexibleObjectD
 	}
 }//-----------------------------------------------
 
+LLVolumeImplFlexible::~LLVolumeImplFlexible()
+{
+	if (mQueued)
+	{
+		update_list_t::iterator iter = std::find(sUpdateList.begin(), sUpdateList.end(), this);
+		if (iter != sUpdateList.end())
+		{
+			sUpdateList.erase(iter);
+		}
+	}
+}
+
+//static
+void LLVolumeImplFlexible::updateClass()
+{
+	if (sUpdateList.empty())
+	{
+		return;
+	}
+
+	LLFastTimer ftm(FTM_FLEXIBLE_SIMULATE);
+
+	static update_list_t update_list;
+	static LLJobPool::job_list_t jobs;
+	update_list.clear();
+	update_list.swap(sUpdateList);
+	jobs.clear();
+
+	// Frame state, path resizes and anything else touching shared data is
+	// done here, only the section stepping and path points are left to the
+	// job pool.  Objects changing LOD get a new volume in doUpdateGeometry()
+	// and are simulated there.
+	U32 frame = LLDrawable::getCurrentFrame();
+	for (update_list_t::iterator iter = update_list.begin(); iter != update_list.end(); ++iter)
+	{
+		LLVolumeImplFlexible* flex = *iter;
+		flex->mQueued = false;
+
+		LLVOVolume* volume = (LLVOVolume*) flex->mVO;
+		if (volume->isDead() || volume->mDrawable.isNull() || volume->mLODChanged || flex->isUpdateDeferred())
+		{
+			continue;
+		}
+
+		if (flex->prepareFlexibleUpdate())
+		{
+			flex->mSimulatedFrame = frame;
+			jobs.push_back(flex);
+		}
+	}
+
+	LLJobPool* pool = LLAppViewer::getJobPool();
+	if (pool)
+	{
+		pool->run(jobs, sSimulationWorkers);
+	}
+	else
+	{
+		for (LLJobPool::job_list_t::iterator iter = jobs.begin(); iter != jobs.end(); ++iter)
+		{
+			(*iter)->run();
+		}
+	}
+}
+
+//static
+void LLVolumeImplFlexible::setSimulationThreads(S32 num_threads)
+{
+	sSimulationWorkers = LLJobPool::resolveMaxWorkers(num_threads);
+}
+
+//static
+void LLVolumeImplFlexible::cleanupClass()
+{
+	sUpdateList.clear();
+}
+
 LLVector3 LLVolumeImplFlexible::getFramePosition() const
 {
 	return mVO->getRenderPosition();
@@ -107,13 +196,13 @@ void LLVolumeImplFlexible::setParentPositionAndRotationDirectly( LLVector3 p, LL
 
 }//-----------------------------------------------------------------------------------------------------
 
+//static
 void LLVolumeImplFlexible::remapSections(LLFlexibleObjectSection *source, S32 source_sections,
-										 LLFlexibleObjectSection *dest, S32 dest_sections)
+										 LLFlexibleObjectSection *dest, S32 dest_sections, F32 length)
 {	
 	S32 num_output_sections = 1<<dest_sections;
-	LLVector3 scale = mVO->mDrawable->getScale();
-	F32 source_section_length = scale.mV[VZ] / (F32)(1<<source_sections);
-	F32 section_length = scale.mV[VZ] / (F32)num_output_sections;
+	F32 source_section_length = length / (F32)(1<<source_sections);
+	F32 section_length = length / (F32)num_output_sections;
 	if (source_sections == -1)
 	{
 		// Generate all from section 0
@@ -232,7 +321,7 @@ void LLVolumeImplFlexible::setAttributesOfAllSections(LLVector3* inScale)
 	LLVector3 parentSectionPosition = mSection[0].mPosition;
 	LLVector3 last_direction = mSection[0].mDirection;
 
-	remapSections(mSection, mInitializedRes, mSection, mSimulateRes);
+	remapSections(mSection, mInitializedRes, mSection, mSimulateRes, mVO->mDrawable->getScale().mV[VZ]);
 	mInitializedRes = mSimulateRes;
 
 	F32 t_inc = 1.f/F32(num_sections);
@@ -314,13 +403,12 @@ BOOL LLVolumeImplFlexible::doIdleUpdate(LLAgent &agent, LLWorld &world, const F6
 		return FALSE; // (we are not initialized or updated)
 	}
 
-	if (force_update)
-	{
-		gPipeline.markRebuild(mVO->mDrawable, LLDrawable::REBUILD_POSITION, FALSE);
-	}
-	else if	(mVO->mDrawable->isVisible() &&
+	BOOL needs_update = force_update;
+	if (!force_update &&
+		mVO->mDrawable->isVisible() &&
 		!mVO->mDrawable->isState(LLDrawable::IN_REBUILD_Q1) &&
-		mVO->getPixelArea() > 256.f)
+		mVO->getPixelArea() > 256.f &&
+		(sUpdateDistance <= 0.f || mVO->mDrawable->mDistanceWRTCamera <= sUpdateDistance))
 	{
 		U32 id;
 		F32 pixel_area = mVO->getPixelArea();
@@ -337,9 +425,16 @@ BOOL LLVolumeImplFlexible::doIdleUpdate(LLAgent &agent, LLWorld &world, const F6
 
 		U32 update_period = (U32) (LLViewerCamera::getInstance()->getScreenPixelArea()*0.01f/(pixel_area*(sUpdateFactor+1.f)))+1;
 
-		if ((LLDrawable::getCurrentFrame()+id)%update_period == 0)
+		needs_update = (LLDrawable::getCurrentFrame()+id)%update_period == 0;
+	}
+
+	if (needs_update)
+	{
+		gPipeline.markRebuild(mVO->mDrawable, LLDrawable::REBUILD_POSITION, FALSE);
+		if (!mQueued)
 		{
-			gPipeline.markRebuild(mVO->mDrawable, LLDrawable::REBUILD_POSITION, FALSE);
+			sUpdateList.push_back(this);
+			mQueued = true;
 		}
 	}
 	
@@ -357,69 +452,50 @@ inline S32 log2(S32 x)
 	return ret;
 }
 
-void LLVolumeImplFlexible::doFlexibleUpdate()
+//static
+LLQuaternion LLVolumeImplFlexible::simulateSections(LLFlexibleObjectSection* sections, S32 simulate_res,
+													const LLFlexibleObjectData& attributes,
+													const LLVector3& base_position, const LLQuaternion& base_rotation,
+													F32 length, F32 seconds, LLWind* wind)
 {
-	LLFastTimer ftm(FTM_DO_FLEXIBLE_UPDATE);
-	LLVolume* volume = mVO->getVolume();
-	LLPath *path = &volume->getPath();
-	if (mSimulateRes == 0)
-	{
-		mVO->markForUpdate(TRUE);
-		if (!doIdleUpdate(gAgent, *LLWorld::getInstance(), 0.0))
-		{
-			return;	// we did not get updated or initialized, proceeding without can be dangerous
-		}
-	}
+	S32 num_sections = 1 << simulate_res;
 
-	llassert_always(mInitialized);
-	
-	S32 num_sections = 1 << mSimulateRes;
-
-    F32 secondsThisFrame = mTimer.getElapsedTimeAndResetF32();
-	if (secondsThisFrame > 0.2f)
-	{
-		secondsThisFrame = 0.2f;
-	}
-
-	LLVector3 BasePosition = getFramePosition();
-	LLQuaternion BaseRotation = getFrameRotation();
-	LLQuaternion parentSegmentRotation = BaseRotation;
+	LLQuaternion parentSegmentRotation = base_rotation;
 	LLVector3 anchorDirectionRotated = LLVector3::z_axis * parentSegmentRotation;
-	LLVector3 anchorScale = mVO->mDrawable->getScale();
 	
-	F32 section_length = anchorScale.mV[VZ] / (F32)num_sections;
+	F32 section_length = length / (F32)num_sections;
 	F32 inv_section_length = 1.f / section_length;
 
 	S32 i;
 
 	// ANCHOR position is offset from BASE position (centroid) by half the length
-	LLVector3 AnchorPosition = BasePosition - (anchorScale.mV[VZ]/2 * anchorDirectionRotated);
+	LLVector3 AnchorPosition = base_position - (length/2 * anchorDirectionRotated);
 	
-	mSection[0].mPosition = AnchorPosition;
-	mSection[0].mDirection = anchorDirectionRotated;
-	mSection[0].mRotation = BaseRotation;
+	sections[0].mPosition = AnchorPosition;
+	sections[0].mDirection = anchorDirectionRotated;
+	sections[0].mRotation = base_rotation;
 
 	LLQuaternion deltaRotation;
 
 	LLVector3 lastPosition;
 
 	// Coefficients which are constant across sections
-	F32 t_factor = mAttributes->getTension() * 0.1f;
-	t_factor = t_factor*(1 - pow(0.85f, secondsThisFrame*30));
+	F32 t_factor = attributes.getTension() * 0.1f;
+	t_factor = t_factor*(1 - pow(0.85f, seconds*30));
 	if ( t_factor > FLEXIBLE_OBJECT_MAX_INTERNAL_TENSION_FORCE )
 	{
 		t_factor = FLEXIBLE_OBJECT_MAX_INTERNAL_TENSION_FORCE;
 	}
 
-	F32 friction_coeff = (mAttributes->getAirFriction()*2+1);
-	friction_coeff = pow(10.f, friction_coeff*secondsThisFrame);
+	F32 friction_coeff = (attributes.getAirFriction()*2+1);
+	friction_coeff = pow(10.f, friction_coeff*seconds);
 	friction_coeff = (friction_coeff > 1) ? friction_coeff : 1;
 	F32 momentum = 1.0f / friction_coeff;
 
-	F32 wind_factor = (mAttributes->getWindSensitivity()*0.1f) * section_length * secondsThisFrame;
+	F32 wind_factor = (attributes.getWindSensitivity()*0.1f) * section_length * seconds;
 	F32 max_angle = atan(section_length*2.f);
 
-	F32 force_factor = section_length * secondsThisFrame;
+	F32 force_factor = section_length * seconds;
 
 	// Update simulated sections
 	for (i=1; i<=num_sections; ++i)
@@ -431,54 +507,54 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 		//---------------------------------------------------
 		// save value of position as lastPosition
 		//---------------------------------------------------
-		lastPosition = mSection[i].mPosition;
+		lastPosition = sections[i].mPosition;
 
 		//------------------------------------------------------------------------------------------
 		// gravity
 		//------------------------------------------------------------------------------------------
-		mSection[i].mPosition.mV[2] -= mAttributes->getGravity() * force_factor;
+		sections[i].mPosition.mV[2] -= attributes.getGravity() * force_factor;
 
 		//------------------------------------------------------------------------------------------
 		// wind force
 		//------------------------------------------------------------------------------------------
-		if (mAttributes->getWindSensitivity() > 0.001f)
+		if (wind && attributes.getWindSensitivity() > 0.001f)
 		{
-			mSection[i].mPosition += gAgent.getRegion()->mWind.getVelocity( mSection[i].mPosition ) * wind_factor;
+			sections[i].mPosition += wind->getVelocity( sections[i].mPosition ) * wind_factor;
 		}
 
 		//------------------------------------------------------------------------------------------
 		// user-defined force
 		//------------------------------------------------------------------------------------------
-		mSection[i].mPosition += mAttributes->getUserForce() * force_factor;
+		sections[i].mPosition += attributes.getUserForce() * force_factor;
 
 		//---------------------------------------------------
 		// tension (rigidity, stiffness)
 		//---------------------------------------------------
-		parentSectionPosition = mSection[i-1].mPosition;
-		parentDirection = mSection[i-1].mDirection;
+		parentSectionPosition = sections[i-1].mPosition;
+		parentDirection = sections[i-1].mDirection;
 
 		if ( i == 1 )
 		{
-			parentSectionVector = mSection[0].mDirection;
+			parentSectionVector = sections[0].mDirection;
 		}
 		else
 		{
-			parentSectionVector = mSection[i-2].mDirection;
+			parentSectionVector = sections[i-2].mDirection;
 		}
 
-		LLVector3 currentVector = mSection[i].mPosition - parentSectionPosition;
+		LLVector3 currentVector = sections[i].mPosition - parentSectionPosition;
 
 		LLVector3 difference = (parentSectionVector*section_length) - currentVector;
 		LLVector3 tensionForce = difference * t_factor;
 
-		mSection[i].mPosition += tensionForce;
+		sections[i].mPosition += tensionForce;
 
 		//------------------------------------------------------------------------------------------
 		// sphere collision, currently not used
 		//------------------------------------------------------------------------------------------
-		/*if ( mAttributes->mUsingCollisionSphere )
+		/*if ( attributes.mUsingCollisionSphere )
 		{
-			LLVector3 vectorToCenterOfCollisionSphere = mCollisionSpherePosition - mSection[i].mPosition;
+			LLVector3 vectorToCenterOfCollisionSphere = mCollisionSpherePosition - sections[i].mPosition;
 			if ( vectorToCenterOfCollisionSphere.magVecSquared() < mCollisionSphereRadius * mCollisionSphereRadius )
 			{
 				F32 distanceToCenterOfCollisionSphere = vectorToCenterOfCollisionSphere.magVec();
@@ -496,21 +572,21 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 				}
 
 				// push the position out to the surface of the collision sphere
-				mSection[i].mPosition -= normalToCenterOfCollisionSphere * penetration;
+				sections[i].mPosition -= normalToCenterOfCollisionSphere * penetration;
 			}
 		}*/
 
 		//------------------------------------------------------------------------------------------
 		// inertia
 		//------------------------------------------------------------------------------------------
-		mSection[i].mPosition += mSection[i].mVelocity * momentum;
+		sections[i].mPosition += sections[i].mVelocity * momentum;
 
 		//------------------------------------------------------------------------------------------
 		// clamp length & rotation
 		//------------------------------------------------------------------------------------------
-		mSection[i].mDirection = mSection[i].mPosition - parentSectionPosition;
-		mSection[i].mDirection.normVec();
-		deltaRotation.shortestArc( parentDirection, mSection[i].mDirection );
+		sections[i].mDirection = sections[i].mPosition - parentSectionPosition;
+		sections[i].mDirection.normVec();
+		deltaRotation.shortestArc( parentDirection, sections[i].mDirection );
 
 		F32 angle;
 		LLVector3 axis;
@@ -529,29 +605,29 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 		LLQuaternion segment_rotation = parentSegmentRotation * deltaRotation;
 		parentSegmentRotation = segment_rotation;
 
-		mSection[i].mDirection = (parentDirection * deltaRotation);
-		mSection[i].mPosition = parentSectionPosition + mSection[i].mDirection * section_length;
-		mSection[i].mRotation = segment_rotation;
+		sections[i].mDirection = (parentDirection * deltaRotation);
+		sections[i].mPosition = parentSectionPosition + sections[i].mDirection * section_length;
+		sections[i].mRotation = segment_rotation;
 
 		if (i > 1)
 		{
 			// Propogate half the rotation up to the parent
 			LLQuaternion halfDeltaRotation(angle/2, axis);
-			mSection[i-1].mRotation = mSection[i-1].mRotation * halfDeltaRotation;
+			sections[i-1].mRotation = sections[i-1].mRotation * halfDeltaRotation;
 		}
 
 		//------------------------------------------------------------------------------------------
 		// calculate velocity
 		//------------------------------------------------------------------------------------------
-		mSection[i].mVelocity = mSection[i].mPosition - lastPosition;
-		if (mSection[i].mVelocity.magVecSquared() > 1.f)
+		sections[i].mVelocity = sections[i].mPosition - lastPosition;
+		if (sections[i].mVelocity.magVecSquared() > 1.f)
 		{
-			mSection[i].mVelocity.normVec();
+			sections[i].mVelocity.normVec();
 		}
 	}
 
 	// Calculate derivatives (not necessary until normals are automagically generated)
-	mSection[0].mdPosition = (mSection[1].mPosition - mSection[0].mPosition) * inv_section_length;
+	sections[0].mdPosition = (sections[1].mPosition - sections[0].mPosition) * inv_section_length;
 	// i = 1..NumSections-1
 	for (i=1; i<num_sections; ++i)
 	{
@@ -568,18 +644,64 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 		// a = [(f1-c)/L1 + (f3-c)/L2] / (L1+L2)
 		// b = (f3-c-aL2^2)/L2
 
-		LLVector3 a = (mSection[i-1].mPosition-mSection[i].mPosition +
-					mSection[i+1].mPosition-mSection[i].mPosition) * 0.5f * inv_section_length * inv_section_length;
-		LLVector3 b = (mSection[i+1].mPosition-mSection[i].mPosition - a*(section_length*section_length));
+		LLVector3 a = (sections[i-1].mPosition-sections[i].mPosition +
+					sections[i+1].mPosition-sections[i].mPosition) * 0.5f * inv_section_length * inv_section_length;
+		LLVector3 b = (sections[i+1].mPosition-sections[i].mPosition - a*(section_length*section_length));
 		b *= inv_section_length;
 
-		mSection[i].mdPosition = b;
+		sections[i].mdPosition = b;
 	}
 
 	// i = NumSections
-	mSection[i].mdPosition = (mSection[i].mPosition - mSection[i-1].mPosition) * inv_section_length;
+	sections[i].mdPosition = (sections[i].mPosition - sections[i-1].mPosition) * inv_section_length;
 
-	// Create points
+	return parentSegmentRotation;
+}
+
+void LLVolumeImplFlexible::doFlexibleUpdate()
+{
+	LLFastTimer ftm(FTM_DO_FLEXIBLE_UPDATE);
+	if (prepareFlexibleUpdate())
+	{
+		doFlexibleSimulation();
+	}
+}
+
+/*virtual*/
+void LLVolumeImplFlexible::run()
+{
+	doFlexibleSimulation();
+}
+
+// Called on the main thread, captures what doFlexibleSimulation() needs.
+bool LLVolumeImplFlexible::prepareFlexibleUpdate()
+{
+	LLVolume* volume = mVO->getVolume();
+	LLPath *path = &volume->getPath();
+	if (mSimulateRes == 0)
+	{
+		mVO->markForUpdate(TRUE);
+		if (!doIdleUpdate(gAgent, *LLWorld::getInstance(), 0.0))
+		{
+			return false;	// we did not get updated or initialized, proceeding without can be dangerous
+		}
+	}
+
+	llassert_always(mInitialized);
+	
+	mSecondsThisFrame = mTimer.getElapsedTimeAndResetF32();
+	if (mSecondsThisFrame > 0.2f)
+	{
+		mSecondsThisFrame = 0.2f;
+	}
+
+	mFramePosition = getFramePosition();
+	mFrameRotation = getFrameRotation();
+	mFrameLength = mVO->mDrawable->getScale().mV[VZ];
+	mFrameDistance = mVO->mDrawable->mDistanceWRTCamera;
+	mFrameWind = gAgent.getRegion() ? &gAgent.getRegion()->mWind : NULL;
+
+	// Resizing reallocates the path, so it stays here
 	S32 num_render_sections = 1<<mRenderRes;
 	if (path->getPathLength() != num_render_sections+1)
 	{
@@ -587,18 +709,33 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 		volume->resizePath(num_render_sections+1);
 	}
 
+	return true;
+}
+
+// Only touches this object's sections and path, may run on a job pool
+// worker thread.
+void LLVolumeImplFlexible::doFlexibleSimulation()
+{
+	mLastSegmentRotation = simulateSections(mSection, mSimulateRes, *mAttributes,
+											mFramePosition, mFrameRotation,
+											mFrameLength, mSecondsThisFrame, mFrameWind);
+
+	// Create points
+	LLPath *path = &mVO->getVolume()->getPath();
+	S32 num_render_sections = 1<<mRenderRes;
+
 	LLPath::PathPt *new_point;
 
 	LLFlexibleObjectSection newSection[ (1<<FLEXIBLE_OBJECT_MAX_SECTIONS)+1 ];
-	remapSections(mSection, mSimulateRes, newSection, mRenderRes);
+	remapSections(mSection, mSimulateRes, newSection, mRenderRes, mFrameLength);
 
 	//generate transform from global to prim space
 	LLVector3 delta_scale = LLVector3(1,1,1);
 	LLVector3 delta_pos;
 	LLQuaternion delta_rot;
 
-	delta_rot = ~getFrameRotation();
-	delta_pos = -getFramePosition()*delta_rot;
+	delta_rot = ~mFrameRotation;
+	delta_pos = -mFramePosition*delta_rot;
 		
 	// Vertex transform (4x4)
 	LLVector3 x_axis = LLVector3(delta_scale.mV[VX], 0.f, 0.f) * delta_rot;
@@ -610,16 +747,19 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 								LLVector4(y_axis, 0.f),
 								LLVector4(z_axis, 0.f),
 								LLVector4(delta_pos, 1.f));
+	LLV4Matrix4 rel_xform_v4;
+	rel_xform_v4 = rel_xform;
 			
-	for (i=0; i<=num_render_sections; ++i)
+	for (S32 i=0; i<=num_render_sections; ++i)
 	{
 		new_point = &path->mPath[i];
-		LLVector3 pos = newSection[i].mPosition * rel_xform;
+		LLVector3 pos;
+		rel_xform_v4.multiply(newSection[i].mPosition, pos);
 		LLQuaternion rot = mSection[i].mAxisRotation * newSection[i].mRotation * delta_rot;
 		
-		if (!mUpdated || (new_point->mPos-pos).magVec()/mVO->mDrawable->mDistanceWRTCamera > 0.001f)
+		if (!mUpdated || (new_point->mPos-pos).magVec()/mFrameDistance > 0.001f)
 		{
-			new_point->mPos = newSection[i].mPosition * rel_xform;
+			new_point->mPos = pos;
 			mUpdated = FALSE;
 		}
 
@@ -627,8 +767,6 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 		new_point->mScale = newSection[i].mScale;
 		new_point->mTexT = ((F32)i)/(num_render_sections);
 	}
-
-	mLastSegmentRotation = parentSegmentRotation;
 }
 
 void LLVolumeImplFlexible::preRebuild()
@@ -654,10 +792,8 @@ void LLVolumeImplFlexible::onSetScale(const LLVector3& scale, BOOL damped)
 	setAttributesOfAllSections((LLVector3*) &scale);
 }
 
-BOOL LLVolumeImplFlexible::doUpdateGeometry(LLDrawable *drawable)
+bool LLVolumeImplFlexible::isUpdateDeferred() const
 {
-	LLVOVolume *volume = (LLVOVolume*)mVO;
-
 	if (mVO->isAttachment())
 	{	//don't update flexible attachments for impostored avatars unless the 
 		//impostor is being updated this frame (w00!)
@@ -672,11 +808,23 @@ BOOL LLVolumeImplFlexible::doUpdateGeometry(LLDrawable *drawable)
 			LLVOAvatar* avatar = (LLVOAvatar*) parent;
 			if (avatar->isImpostor() && !avatar->needsImpostorUpdate())
 			{
-				return TRUE;
+				return true;
 			}
 		}
 	}
 
+	return false;
+}
+
+BOOL LLVolumeImplFlexible::doUpdateGeometry(LLDrawable *drawable)
+{
+	LLVOVolume *volume = (LLVOVolume*)mVO;
+
+	if (isUpdateDeferred())
+	{
+		return TRUE;
+	}
+
 	if (volume->mDrawable.isNull())
 	{
 		return TRUE; // No update to complete
@@ -690,7 +838,9 @@ BOOL LLVolumeImplFlexible::doUpdateGeometry(LLDrawable *drawable)
 	}
 
 	volume->updateRelativeXform();
+	if (mSimulatedFrame != LLDrawable::getCurrentFrame())
 	{
+		// not stepped by updateClass() this frame
 		LLFastTimer t(FTM_DO_FLEXIBLE_UPDATE);
 		doFlexibleUpdate();
 	}
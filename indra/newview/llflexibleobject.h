@@ -37,6 +37,7 @@
 #ifndef LL_LLFLEXIBLEOBJECT_H
 #define LL_LLFLEXIBLEOBJECT_H
 
+#include "lljobpool.h"
 #include "llprimitive.h"
 #include "llvovolume.h"
 #include "llwind.h"
@@ -49,6 +50,9 @@ const U32	FLEXIBLE_OBJECT_MAX_LOD			= 10;
 
 //-------------------------------------------------------------------
 
+// Each section is stepped from its parent's fresh state, so a chain is
+// walked one section at a time and the fields of a section are used
+// together; they stay interleaved.
 struct LLFlexibleObjectSection
 {
 	// Input parameters
@@ -68,10 +72,30 @@ struct LLFlexibleObjectSection
 //---------------------------------------------------------
 // The LLVolumeImplFlexible class 
 //---------------------------------------------------------
-class LLVolumeImplFlexible : public LLVolumeInterface
+class LLVolumeImplFlexible : public LLVolumeInterface, public LLJobPool::Job
 {
 	public:
 		LLVolumeImplFlexible(LLViewerObject* volume, LLFlexibleObjectData* attributes);
+		~LLVolumeImplFlexible();
+
+		// Steps every flexible object marked for rebuild this frame, call
+		// before the build queues are processed.
+		static void updateClass();
+		// most job pool workers stepping flexies, negative for all of them
+		static void setSimulationThreads(S32 num_threads);
+		static void cleanupClass();
+
+		// Steps the sections of one chain, thread safe.  Returns the rotation
+		// of the last section.  wind may be NULL.
+		static LLQuaternion simulateSections(LLFlexibleObjectSection* sections, S32 simulate_res,
+											 const LLFlexibleObjectData& attributes,
+											 const LLVector3& base_position, const LLQuaternion& base_rotation,
+											 F32 length, F32 seconds, LLWind* wind);
+		static void remapSections(LLFlexibleObjectSection *source, S32 source_sections,
+								  LLFlexibleObjectSection *dest, S32 dest_sections, F32 length);
+
+		// Implements LLJobPool::Job
+		/*virtual*/ void run();
 
 		// Implements LLVolumeInterface
 		U32 getID() const { return mID; }
@@ -129,17 +153,34 @@ class LLVolumeImplFlexible : public LLVolumeInterface
 		F32							mCollisionSphereRadius;
 		U32							mID;
 
+		// Frame state captured on the main thread by prepareFlexibleUpdate()
+		F32							mSecondsThisFrame;
+		LLVector3					mFramePosition;
+		LLQuaternion				mFrameRotation;
+		F32							mFrameLength;
+		F32							mFrameDistance;
+		LLWind*						mFrameWind;
+		bool						mQueued;
+		U32							mSimulatedFrame;
+
 		//--------------------------------------
 		// private methods
 		//--------------------------------------
 		void setAttributesOfAllSections	(LLVector3* inScale = NULL);
 
-		void remapSections(LLFlexibleObjectSection *source, S32 source_sections,
-										 LLFlexibleObjectSection *dest, S32 dest_sections);
-		
+		bool isUpdateDeferred() const;
+		bool prepareFlexibleUpdate();
+		void doFlexibleSimulation();
+
+		typedef std::vector<LLVolumeImplFlexible*> update_list_t;
+		static update_list_t		sUpdateList;
+		static U32					sSimulationWorkers;
+
 public:
 		// Global setting for update rate
 		static F32					sUpdateFactor;
+		// Flexies further than this from the camera only update when forced (0 = no limit)
+		static F32					sUpdateDistance;
 
 };// end of class definition
 
@@ -0,0 +1,291 @@
+/** 
+ * @file llgeombatch.cpp
+ * @brief Shared vertex buffers for batching small geometry across spatial groups
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#include "llviewerprecompiledheaders.h"
+
+#include "llgeombatch.h"
+
+#include "llframetimer.h"
+#include "llviewertexture.h"
+
+// start small so one-off textures don't pin large buffers, grow per texture
+const U32 BATCH_BUFFER_MIN_VERTS = 1024;
+const U32 BATCH_BUFFER_MAX_VERTS = 65535;
+const U32 BATCH_BUFFER_INDEX_RATIO = 3;
+// frames an empty buffer is kept for groups rebuilding into it again
+const U32 BATCH_BUFFER_IDLE_FRAMES = 64;
+
+U32 LLGeomBatchPool::sBufferCount = 0;
+
+//----------------------------------------------------------------------------
+
+LLGeomBatchBuffer::LLGeomBatchBuffer(U32 mask, U32 max_verts, U32 max_indices)
+: mMaxVerts(max_verts),
+  mUsedVerts(0),
+  mLastUsedFrame(LLFrameTimer::getFrameCount())
+{
+	// dynamic, not static: static buffers can only be mapped once.  Groups
+	// rebuild their own ranges, so only those get uploaded.
+	mVertexBuffer = new LLVertexBuffer(mask, GL_DYNAMIC_DRAW_ARB);
+	mVertexBuffer->setPartialUpload(TRUE);
+	mVertexBuffer->allocateBuffer(max_verts, max_indices, TRUE);
+
+	mFreeVerts[0] = max_verts;
+	mFreeIndices[0] = max_indices;
+	LLGeomBatchPool::sBufferCount++;
+}
+
+LLGeomBatchBuffer::~LLGeomBatchBuffer()
+{
+	LLGeomBatchPool::sBufferCount--;
+}
+
+BOOL LLGeomBatchBuffer::allocate(U32 verts, U32 indices, U32& vert_start, U32& index_start)
+{
+	if (!allocateRange(mFreeVerts, verts, vert_start))
+	{
+		return FALSE;
+	}
+
+	if (!allocateRange(mFreeIndices, indices, index_start))
+	{
+		releaseRange(mFreeVerts, vert_start, verts);
+		return FALSE;
+	}
+
+	mUsedVerts += verts;
+	mLastUsedFrame = LLFrameTimer::getFrameCount();
+	return TRUE;
+}
+
+void LLGeomBatchBuffer::release(U32 vert_start, U32 verts, U32 index_start, U32 indices)
+{
+	releaseRange(mFreeVerts, vert_start, verts);
+	releaseRange(mFreeIndices, index_start, indices);
+	llassert(mUsedVerts >= verts);
+	mUsedVerts -= verts;
+	mLastUsedFrame = LLFrameTimer::getFrameCount();
+}
+
+//static
+BOOL LLGeomBatchBuffer::allocateRange(free_map_t& free_map, U32 count, U32& start)
+{ //first fit, lowest address first
+	for (free_map_t::iterator iter = free_map.begin(); iter != free_map.end(); ++iter)
+	{
+		if (iter->second >= count)
+		{
+			start = iter->first;
+			U32 remaining = iter->second - count;
+			free_map.erase(iter);
+			if (remaining > 0)
+			{
+				free_map[start + count] = remaining;
+			}
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+//static
+void LLGeomBatchBuffer::releaseRange(free_map_t& free_map, U32 start, U32 count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	free_map_t::iterator iter = free_map.insert(std::make_pair(start, count)).first;
+
+	//coalesce with following range
+	free_map_t::iterator next = iter;
+	++next;
+	if (next != free_map.end() && iter->first + iter->second == next->first)
+	{
+		iter->second += next->second;
+		free_map.erase(next);
+	}
+
+	//coalesce with preceding range
+	if (iter != free_map.begin())
+	{
+		free_map_t::iterator prev = iter;
+		--prev;
+		if (prev->first + prev->second == iter->first)
+		{
+			prev->second += iter->second;
+			free_map.erase(iter);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+
+LLGeomBatchPool::LLGeomBatchPool()
+: mLastPruneFrame(0)
+{
+}
+
+LLGeomBatchPool::~LLGeomBatchPool()
+{
+	cleanup();
+}
+
+BOOL LLGeomBatchPool::allocate(U32 mask, LLViewerTexture* tex, U32 verts, U32 indices, Range& range)
+{
+	if (verts > BATCH_BUFFER_MAX_VERTS || indices > BATCH_BUFFER_MAX_VERTS*BATCH_BUFFER_INDEX_RATIO)
+	{
+		return FALSE;
+	}
+
+	buffer_list_t& buffers = mBuffers[mask][tex ? tex->getID() : LLUUID::null];
+
+	U32 max_verts = BATCH_BUFFER_MIN_VERTS;
+	LLGeomBatchBuffer* empty = NULL;
+
+	for (buffer_list_t::iterator iter = buffers.begin(); iter != buffers.end(); )
+	{
+		LLGeomBatchBuffer* buffer = *iter;
+		if (buffer->isEmpty())
+		{ //keep one empty buffer around so a group rebuilding on its own doesn't churn buffers
+			if (!empty && buffer->getMaxVerts() >= verts)
+			{
+				empty = buffer;
+				++iter;
+			}
+			else
+			{
+				iter = buffers.erase(iter);
+			}
+			continue;
+		}
+		
+		if (buffer->allocate(verts, indices, range.mVertStart, range.mIndexStart))
+		{
+			range.mBuffer = buffer;
+			range.mVerts = verts;
+			range.mIndices = indices;
+			return TRUE;
+		}
+
+		max_verts = llmax(max_verts, buffer->getMaxVerts()*2);
+		++iter;
+	}
+
+	if (empty && empty->allocate(verts, indices, range.mVertStart, range.mIndexStart))
+	{
+		range.mBuffer = empty;
+		range.mVerts = verts;
+		range.mIndices = indices;
+		return TRUE;
+	}
+
+	while (max_verts < verts)
+	{
+		max_verts *= 2;
+	}
+	max_verts = llmin(max_verts, BATCH_BUFFER_MAX_VERTS);
+
+	LLPointer<LLGeomBatchBuffer> buffer = new LLGeomBatchBuffer(mask, max_verts, max_verts*BATCH_BUFFER_INDEX_RATIO);
+	buffers.push_back(buffer);
+
+	if (!buffer->allocate(verts, indices, range.mVertStart, range.mIndexStart))
+	{
+		llwarns << "Fresh batch buffer could not hold " << verts << " vertices." << llendl;
+		return FALSE;
+	}
+
+	range.mBuffer = buffer;
+	range.mVerts = verts;
+	range.mIndices = indices;
+	return TRUE;
+}
+
+//static
+void LLGeomBatchPool::release(range_list_t& ranges)
+{
+	for (range_list_t::iterator iter = ranges.begin(); iter != ranges.end(); ++iter)
+	{
+		Range& range = *iter;
+		range.mBuffer->release(range.mVertStart, range.mVerts, range.mIndexStart, range.mIndices);
+	}
+	ranges.clear();
+}
+
+void LLGeomBatchPool::prune()
+{
+	U32 frame = LLFrameTimer::getFrameCount();
+	if (frame == mLastPruneFrame)
+	{
+		return;
+	}
+	mLastPruneFrame = frame;
+
+	for (buffer_map_t::iterator mask_iter = mBuffers.begin(); mask_iter != mBuffers.end(); )
+	{
+		buffer_texture_map_t& textures = mask_iter->second;
+		for (buffer_texture_map_t::iterator tex_iter = textures.begin(); tex_iter != textures.end(); )
+		{
+			buffer_list_t& buffers = tex_iter->second;
+			for (buffer_list_t::iterator iter = buffers.begin(); iter != buffers.end(); )
+			{
+				LLGeomBatchBuffer* buffer = *iter;
+				if (buffer->isEmpty() && frame - buffer->getLastUsedFrame() > BATCH_BUFFER_IDLE_FRAMES)
+				{
+					iter = buffers.erase(iter);
+				}
+				else
+				{
+					++iter;
+				}
+			}
+
+			if (buffers.empty())
+			{
+				textures.erase(tex_iter++);
+			}
+			else
+			{
+				++tex_iter;
+			}
+		}
+
+		if (textures.empty())
+		{
+			mBuffers.erase(mask_iter++);
+		}
+		else
+		{
+			++mask_iter;
+		}
+	}
+}
+
+void LLGeomBatchPool::cleanup()
+{
+	mBuffers.clear();
+}
@@ -0,0 +1,115 @@
+/** 
+ * @file llgeombatch.h
+ * @brief Shared vertex buffers for batching small geometry across spatial groups
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#ifndef LL_LLGEOMBATCH_H
+#define LL_LLGEOMBATCH_H
+
+#include "llpointer.h"
+#include "llrefcount.h"
+#include "lluuid.h"
+#include "llvertexbuffer.h"
+
+#include <map>
+#include <vector>
+
+class LLViewerTexture;
+
+// One dynamic vertex buffer whose vertex and index space is handed out to
+// spatial groups in ranges.  Ranges are allocated lowest address first so
+// groups rebuilt one after another end up adjacent in the buffer, which lets
+// LLRenderPass::pushBatches fold their draws into a single call.
+class LLGeomBatchBuffer : public LLRefCount
+{
+public:
+	LLGeomBatchBuffer(U32 mask, U32 max_verts, U32 max_indices);
+
+	BOOL allocate(U32 verts, U32 indices, U32& vert_start, U32& index_start);
+	void release(U32 vert_start, U32 verts, U32 index_start, U32 indices);
+
+	BOOL isEmpty() const						{ return mUsedVerts == 0; }
+	U32 getMaxVerts() const						{ return mMaxVerts; }
+	U32 getLastUsedFrame() const				{ return mLastUsedFrame; }
+	LLVertexBuffer* getVertexBuffer() const		{ return mVertexBuffer; }
+
+protected:
+	virtual ~LLGeomBatchBuffer();
+
+private:
+	typedef std::map<U32, U32> free_map_t; // start -> count
+
+	static BOOL allocateRange(free_map_t& free_map, U32 count, U32& start);
+	static void releaseRange(free_map_t& free_map, U32 start, U32 count);
+
+	LLPointer<LLVertexBuffer> mVertexBuffer;
+	free_map_t mFreeVerts;
+	free_map_t mFreeIndices;
+	U32 mMaxVerts;
+	U32 mUsedVerts;
+	U32 mLastUsedFrame;
+};
+
+// Batch buffers for one spatial partition, keyed by vertex mask and texture ID
+// so only geometry that can share a draw call shares a buffer.
+class LLGeomBatchPool
+{
+public:
+	class Range
+	{
+	public:
+		Range() : mVertStart(0), mVerts(0), mIndexStart(0), mIndices(0) { }
+
+		LLPointer<LLGeomBatchBuffer> mBuffer;
+		U32 mVertStart;
+		U32 mVerts;
+		U32 mIndexStart;
+		U32 mIndices;
+	};
+
+	typedef std::vector<Range> range_list_t;
+
+	LLGeomBatchPool();
+	~LLGeomBatchPool();
+
+	BOOL allocate(U32 mask, LLViewerTexture* tex, U32 verts, U32 indices, Range& range);
+	static void release(range_list_t& ranges);
+
+	// drop buffers left empty for a while and the texture/mask entries
+	// that no longer hold any, at most once per frame
+	void prune();
+	void cleanup();
+
+	static U32 sBufferCount;
+
+private:
+	typedef std::vector<LLPointer<LLGeomBatchBuffer> > buffer_list_t;
+	typedef std::map<LLUUID, buffer_list_t> buffer_texture_map_t;
+	typedef std::map<U32, buffer_texture_map_t> buffer_map_t;
+
+	buffer_map_t mBuffers;
+	U32 mLastPruneFrame;
+};
+
+#endif // LL_LLGEOMBATCH_H
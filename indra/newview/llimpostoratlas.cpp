@@ -0,0 +1,285 @@
+/** 
+ * @file llimpostoratlas.cpp
+ * @brief Shared render target holding avatar impostors
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#include "llviewerprecompiledheaders.h"
+
+#include "llimpostoratlas.h"
+
+#include <algorithm>
+
+#include "llrender.h"
+#include "llviewercontrol.h"
+#include "pipeline.h"
+
+// smallest cell handed out, impostors of far away avatars are tiny
+static const U32 MIN_CELL_SIZE = 16;
+
+LLImpostorAtlas::LLImpostorAtlas() :
+	mSize(0),
+	mDeferred(FALSE),
+	mBytesPerTexel(0),
+	mGeneration(1),
+	mNumSlots(0),
+	mSeparateBytes(0)
+{
+}
+
+LLImpostorAtlas::~LLImpostorAtlas()
+{
+	release();
+}
+
+//static
+BOOL LLImpostorAtlas::useAtlas()
+{
+	static LLCachedControl<bool> use_atlas(gSavedSettings, "RenderAvatarImpostorAtlas");
+	return use_atlas && LLRenderTarget::sUseFBO && gGLManager.mHasFramebufferObject;
+}
+
+BOOL LLImpostorAtlas::reserve(Slot& slot, U32 width, U32 height)
+{
+	static LLCachedControl<U32> atlas_size(gSavedSettings, "RenderAvatarImpostorAtlasSize");
+
+	if (!mTarget.isComplete() || 
+		mDeferred != LLPipeline::sRenderDeferred ||
+		mSize != llclamp(nhpo2(atlas_size), (U32) 512, (U32) 4096))
+	{ //(re)allocating drops every slot, their owners regenerate on the next update
+		if (!allocateTarget())
+		{
+			return FALSE;
+		}
+	}
+
+	width = llclamp(width, (U32) 1, mSize);
+	height = llclamp(height, (U32) 1, mSize);
+	U32 size = llmax(nhpo2(llmax(width, height)), MIN_CELL_SIZE);
+
+	if (isValid(slot) && slot.mSize == size)
+	{
+		mSeparateBytes += ((S32) (width*height) - (S32) (slot.mWidth*slot.mHeight))*(S32) mBytesPerTexel;
+		slot.mWidth = width;
+		slot.mHeight = height;
+		return TRUE;
+	}
+
+	free(slot);
+
+	U32 x, y;
+	while (!allocateCell(getLevel(size), x, y))
+	{
+		if (size <= MIN_CELL_SIZE)
+		{
+			return FALSE;
+		}
+		size >>= 1;
+		width = llmax(width >> 1, (U32) 1);
+		height = llmax(height >> 1, (U32) 1);
+	}
+
+	slot.mX = x;
+	slot.mY = y;
+	slot.mSize = size;
+	slot.mWidth = width;
+	slot.mHeight = height;
+	slot.mGeneration = mGeneration;
+
+	mNumSlots++;
+	mSeparateBytes += (S32) (width*height*mBytesPerTexel);
+	return TRUE;
+}
+
+void LLImpostorAtlas::free(Slot& slot)
+{
+	if (!isValid(slot))
+	{
+		return;
+	}
+
+	freeCell(getLevel(slot.mSize), slot.mX, slot.mY);
+
+	mNumSlots--;
+	mSeparateBytes -= (S32) (slot.mWidth*slot.mHeight*mBytesPerTexel);
+	slot = Slot();
+}
+
+BOOL LLImpostorAtlas::isValid(const Slot& slot) const
+{
+	return slot.mSize > 0 && slot.mGeneration == mGeneration;
+}
+
+void LLImpostorAtlas::getTexCoords(const Slot& slot, LLVector2& tc_min, LLVector2& tc_max) const
+{
+	F32 scale = 1.f/mSize;
+	tc_min.set(slot.mX*scale, slot.mY*scale);
+	tc_max.set((slot.mX+slot.mWidth)*scale, (slot.mY+slot.mHeight)*scale);
+}
+
+void LLImpostorAtlas::setViewport(const Slot& slot) const
+{
+	glViewport(slot.mX, slot.mY, slot.mWidth, slot.mHeight);
+	glScissor(slot.mX, slot.mY, slot.mWidth, slot.mHeight);
+}
+
+void LLImpostorAtlas::release()
+{
+	mTarget.release();
+	mFreeCells.clear();
+	mSize = 0;
+	mGeneration++;
+	mNumSlots = 0;
+	mSeparateBytes = 0;
+}
+
+S32 LLImpostorAtlas::getBytesSaved() const
+{
+	if (!mTarget.isComplete())
+	{
+		return 0;
+	}
+	return mSeparateBytes - (S32) (mSize*mSize*mBytesPerTexel);
+}
+
+BOOL LLImpostorAtlas::allocateTarget()
+{
+	static LLCachedControl<U32> atlas_size(gSavedSettings, "RenderAvatarImpostorAtlasSize");
+
+	release();
+
+	mSize = llclamp(nhpo2(atlas_size), (U32) 512, (U32) 4096);
+	mDeferred = LLPipeline::sRenderDeferred;
+
+	mTarget.allocate(mSize, mSize, GL_RGBA, TRUE, TRUE);
+	if (!mTarget.isComplete())
+	{
+		llwarns << "Failed to allocate " << mSize << "x" << mSize << " impostor atlas" << llendl;
+		mSize = 0;
+		return FALSE;
+	}
+
+	if (mDeferred)
+	{
+		mTarget.addColorAttachment(GL_RGBA); //specular
+		mTarget.addColorAttachment(GL_RGBA); //normal+z
+	}
+
+	gGL.getTexUnit(0)->bind(&mTarget);
+	gGL.getTexUnit(0)->setTextureFilteringOption(LLTexUnit::TFO_POINT);
+	gGL.getTexUnit(0)->unbind(LLTexUnit::TT_TEXTURE);
+
+	// color plus packed depth/stencil, plus the deferred attachments
+	mBytesPerTexel = mDeferred ? 16 : 8;
+
+	mFreeCells.resize(getLevel(MIN_CELL_SIZE) + 1);
+	mFreeCells[0].push_back(0);
+
+	llinfos << "Allocated " << mSize << "x" << mSize << " impostor atlas" << llendl;
+	return TRUE;
+}
+
+BOOL LLImpostorAtlas::allocateCell(U32 level, U32& x, U32& y)
+{
+	std::vector<U32>& cells = mFreeCells[level];
+	if (cells.empty())
+	{
+		if (level == 0)
+		{
+			return FALSE;
+		}
+
+		U32 px, py;
+		if (!allocateCell(level - 1, px, py))
+		{
+			return FALSE;
+		}
+
+		// split the parent, keep the lower left quarter
+		U32 size = mSize >> level;
+		cells.push_back(((px + size) << 16) | py);
+		cells.push_back((px << 16) | (py + size));
+		cells.push_back(((px + size) << 16) | (py + size));
+		x = px;
+		y = py;
+		return TRUE;
+	}
+
+	U32 cell = cells.back();
+	cells.pop_back();
+	x = cell >> 16;
+	y = cell & 0xFFFF;
+	return TRUE;
+}
+
+void LLImpostorAtlas::freeCell(U32 level, U32 x, U32 y)
+{
+	std::vector<U32>& cells = mFreeCells[level];
+
+	if (level > 0)
+	{ //merge with the other three quarters of the parent if they are all free
+		U32 size = mSize >> level;
+		U32 px = x & ~(2*size - 1);
+		U32 py = y & ~(2*size - 1);
+
+		U32 buddies[3];
+		U32 num_free = 0;
+		for (U32 i = 0; i < 4; ++i)
+		{
+			U32 bx = px + (i & 1)*size;
+			U32 by = py + (i >> 1)*size;
+			if (bx == x && by == y)
+			{
+				continue;
+			}
+			U32 cell = (bx << 16) | by;
+			if (std::find(cells.begin(), cells.end(), cell) == cells.end())
+			{
+				break;
+			}
+			buddies[num_free++] = cell;
+		}
+
+		if (num_free == 3)
+		{
+			for (U32 i = 0; i < 3; ++i)
+			{
+				cells.erase(std::find(cells.begin(), cells.end(), buddies[i]));
+			}
+			freeCell(level - 1, px, py);
+			return;
+		}
+	}
+
+	cells.push_back((x << 16) | y);
+}
+
+U32 LLImpostorAtlas::getLevel(U32 size) const
+{
+	U32 level = 0;
+	while ((mSize >> level) > size)
+	{
+		level++;
+	}
+	return level;
+}
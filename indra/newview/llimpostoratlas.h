@@ -0,0 +1,109 @@
+/** 
+ * @file llimpostoratlas.h
+ * @brief Shared render target holding avatar impostors
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#ifndef LL_LLIMPOSTORATLAS_H
+#define LL_LLIMPOSTORATLAS_H
+
+#include <vector>
+
+#include "llrendertarget.h"
+#include "llsingleton.h"
+
+class LLVector2;
+
+//-----------------------------------------------------------------------------
+// class LLImpostorAtlas
+// One render target shared by all avatar impostors.  The target is carved
+// into square power of two cells by a buddy allocator; an impostor renders
+// into the lower left width x height texels of its cell.  Only used with
+// FBO render targets, since the copy-to-texture path would clobber the
+// other cells.
+//-----------------------------------------------------------------------------
+class LLImpostorAtlas : public LLSingleton<LLImpostorAtlas>
+{
+public:
+	// A cell owned by one impostor.  Slots from before the last release()
+	// are stale and treated as empty.
+	struct Slot
+	{
+		Slot() : mX(0), mY(0), mSize(0), mWidth(0), mHeight(0), mGeneration(0) { }
+
+		U16 mX;
+		U16 mY;
+		U16 mSize;
+		U16 mWidth;
+		U16 mHeight;
+		U32 mGeneration;
+	};
+
+	LLImpostorAtlas();
+	~LLImpostorAtlas();
+
+	// TRUE if impostors should be rendered into the atlas
+	static BOOL useAtlas();
+
+	// Makes slot cover width x height texels, moving it to a cell of a
+	// different size if needed.  If the atlas is too full the slot is shrunk
+	// (keeping its aspect) down to the smallest cell, mWidth and mHeight hold
+	// the resolution actually reserved.  Returns FALSE if no cell is free.
+	BOOL reserve(Slot& slot, U32 width, U32 height);
+	void free(Slot& slot);
+	BOOL isValid(const Slot& slot) const;
+
+	// texture coordinates of the part of the cell the impostor covers
+	void getTexCoords(const Slot& slot, LLVector2& tc_min, LLVector2& tc_max) const;
+
+	// restricts rendering to the slot, call after binding the target
+	void setViewport(const Slot& slot) const;
+
+	LLRenderTarget& getTarget() { return mTarget; }
+
+	// frees the render target and invalidates every slot
+	void release();
+
+	U32 getNumSlots() const { return mNumSlots; }
+	// bytes separate render targets for the current slots would take,
+	// minus what the atlas takes
+	S32 getBytesSaved() const;
+
+private:
+	BOOL allocateTarget();
+	BOOL allocateCell(U32 level, U32& x, U32& y);
+	void freeCell(U32 level, U32 x, U32 y);
+	U32 getLevel(U32 size) const;
+
+	LLRenderTarget			mTarget;
+	U32						mSize;
+	BOOL					mDeferred;
+	U32						mBytesPerTexel;
+	U32						mGeneration;
+	U32						mNumSlots;
+	S32						mSeparateBytes;
+	// free cells per level, level 0 is the whole atlas, packed as (x << 16) | y
+	std::vector<std::vector<U32> > mFreeCells;
+};
+
+#endif // LL_LLIMPOSTORATLAS_H
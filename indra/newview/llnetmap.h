@@ -34,10 +34,7 @@
 #include "v4color.h"
 #include "llpointer.h"
 
-class LLColor4U;
 class LLCoordGL;
-class LLImageRaw;
-class LLViewerTexture;
 class LLFloaterMap;
 class LLMenuGL;
 
@@ -71,7 +68,6 @@ public:
 	/*virtual*/ BOOL	handleMouseUp(S32 x, S32 y, MASK mask);
 	/*virtual*/ BOOL	handleHover( S32 x, S32 y, MASK mask );
 	/*virtual*/ BOOL	handleToolTip( S32 x, S32 y, MASK mask);
-	/*virtual*/ void	reshape(S32 width, S32 height, BOOL called_from_parent = TRUE);
 
 	/*virtual*/ BOOL 	postBuild();
 	/*virtual*/ BOOL	handleRightMouseDown( S32 x, S32 y, MASK mask );
@@ -80,13 +76,8 @@ public:
 
 	void			setScale( F32 scale );
 	void			setToolTipMsg(const std::string& msg) { mToolTipMsg = msg; }
-	void			renderScaledPointGlobal( const LLVector3d& pos, const LLColor4U &color, F32 radius );
 
 private:
-	const LLVector3d& getObjectImageCenterGlobal()	{ return mObjectImageCenterGlobal; }
-	void 			renderPoint(const LLVector3 &pos, const LLColor4U &color, 
-								S32 diameter, S32 relative_height = 0);
-
 	LLVector3		globalPosToView(const LLVector3d& global_pos);
 	LLVector3d		viewPosToGlobal(S32 x,S32 y);
 
@@ -96,19 +87,16 @@ private:
 	BOOL			handleToolTipAgent(const LLUUID& avatar_id);
 	static void		showAvatarInspector(const LLUUID& avatar_id);
 
-	void			createObjectImage();
+	// Resolution of the object layer for the current scale
+	S32				getObjectLayerTexels() const;
 
 	static bool		outsideSlop(S32 x, S32 y, S32 start_x, S32 start_y, S32 slop);
 
 private:
-	bool			mUpdateNow;
-
 	LLUIColor		mBackgroundColor;
 
 	F32				mScale;					// Size of a region in pixels
 	F32				mPixelsPerMeter;		// world meters to map pixels
-	F32				mObjectMapTPM;			// texels per meter on map
-	F32				mObjectMapPixels;		// Width of object map in pixels
 	F32				mDotRadius;				// Size of avatar markers
 
 	bool			mPanning;			// map is being dragged
@@ -117,10 +105,6 @@ private:
 	LLVector2		mStartPan;		// pan offset at start of drag
 	LLCoordGL		mMouseDown;			// pointer position at start of drag
 
-	LLVector3d		mObjectImageCenterGlobal;
-	LLPointer<LLImageRaw> mObjectRawImagep;
-	LLPointer<LLViewerTexture>	mObjectImagep;
-
 	LLUUID			mClosestAgentToCursor;
 	LLUUID			mClosestAgentAtLastRightClick;
 
@@ -0,0 +1,417 @@
+/** 
+ * @file llnetmapobjectlayer.cpp
+ * @brief Object layer of the minimap, one texture per region
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+  
+#include "llviewerprecompiledheaders.h"
+
+#include "llnetmapobjectlayer.h"
+
+#include "llimage.h"
+#include "llregionhandle.h"
+#include "lluicolor.h"
+#include "lluicolortable.h"
+
+#include "llviewercontrol.h"
+#include "llviewerobject.h"
+#include "llviewerobjectlist.h"
+#include "llviewerregion.h"
+#include "llviewertexture.h"
+#include "llworld.h"
+
+// Meters on the side of a tile
+static const S32 TILE_METERS = REGION_WIDTH_UNITS / LLNetMapObjectLayer::TILES_PER_REGION;
+// How often moving objects are looked at
+static const F32 ACTIVE_UPDATE_PERIOD = 0.5f;
+static const F32 MIN_RADIUS_FOR_OWNED_OBJECTS = 2.f;
+
+LLNetMapObjectLayer::LLNetMapObjectLayer() :
+	mEnabled(false),
+	mTexelsPerRegion(0),
+	mMaxRadius(0.f)
+{
+}
+
+LLNetMapObjectLayer::~LLNetMapObjectLayer()
+{
+}
+
+void LLNetMapObjectLayer::addObject(LLViewerObject* objectp)
+{
+	if (!mEnabled)
+	{
+		return;
+	}
+
+	MapDot dot;
+	if (computeDot(objectp, dot))
+	{
+		insertDot(objectp, dot);
+	}
+}
+
+void LLNetMapObjectLayer::removeObject(LLViewerObject* objectp)
+{
+	dot_map_t::iterator found = mDots.find(objectp);
+	if (found != mDots.end())
+	{
+		eraseDot(found);
+	}
+}
+
+void LLNetMapObjectLayer::updateObject(LLViewerObject* objectp)
+{
+	if (!mEnabled)
+	{
+		return;
+	}
+
+	MapDot dot;
+	bool on_map = computeDot(objectp, dot);
+	dot_map_t::iterator found = mDots.find(objectp);
+	if (found == mDots.end())
+	{
+		if (on_map)
+		{
+			insertDot(objectp, dot);
+		}
+		return;
+	}
+
+	if (on_map)
+	{
+		// Leave the dot alone if it would land on the same texels
+		const MapDot& old_dot = found->second;
+		const F64 texels_per_meter = (F64)mTexelsPerRegion / REGION_WIDTH_METERS;
+		if (old_dot.mBin == dot.mBin &&
+			old_dot.mColor == dot.mColor &&
+			llround((F32)(old_dot.mPosGlobal.mdV[VX] * texels_per_meter)) == llround((F32)(dot.mPosGlobal.mdV[VX] * texels_per_meter)) &&
+			llround((F32)(old_dot.mPosGlobal.mdV[VY] * texels_per_meter)) == llround((F32)(dot.mPosGlobal.mdV[VY] * texels_per_meter)) &&
+			llround(2.f * old_dot.mRadius * (F32)texels_per_meter) == llround(2.f * dot.mRadius * (F32)texels_per_meter))
+		{
+			return;
+		}
+	}
+
+	eraseDot(found);
+	if (on_map)
+	{
+		insertDot(objectp, dot);
+	}
+}
+
+void LLNetMapObjectLayer::update(S32 texels_per_region)
+{
+	if (!mEnabled || ((F32)gSavedSettings.getF32("MiniMapPrimMaxRadius") != mMaxRadius))
+	{
+		mEnabled = true;
+		rebuild();
+	}
+
+	updateRegionLayers(texels_per_region);
+
+	// Moving objects don't get an update message for every position change
+	if (mActiveTimer.getElapsedTimeF32() > ACTIVE_UPDATE_PERIOD)
+	{
+		gObjectList.updateActiveObjectsOnMap(*this);
+		mActiveTimer.reset();
+	}
+
+	for (region_layer_map_t::iterator iter = mRegionLayers.begin(); iter != mRegionLayers.end(); ++iter)
+	{
+		RegionLayer& layer = iter->second;
+		if (!layer.mDirtyTiles)
+		{
+			continue;
+		}
+
+		for (S32 tile = 0; tile < TILES_PER_REGION * TILES_PER_REGION; tile++)
+		{
+			if (layer.mDirtyTiles & (1ULL << tile))
+			{
+				renderTile(iter->first, layer, tile % TILES_PER_REGION, tile / TILES_PER_REGION);
+			}
+		}
+		uploadDirtyTiles(layer);
+		layer.mDirtyTiles = 0;
+	}
+}
+
+LLViewerTexture* LLNetMapObjectLayer::getRegionTexture(const LLViewerRegion* regionp) const
+{
+	region_layer_map_t::const_iterator found = mRegionLayers.find(regionp->getHandle());
+	if (found == mRegionLayers.end())
+	{
+		return NULL;
+	}
+	return found->second.mTexture;
+}
+
+bool LLNetMapObjectLayer::computeDot(LLViewerObject* objectp, MapDot& dot) const
+{
+	static LLUIColor above_water_color = LLUIColorTable::instance().getColor("NetMapOtherOwnAboveWater");
+	static LLUIColor below_water_color = LLUIColorTable::instance().getColor("NetMapOtherOwnBelowWater");
+	static LLUIColor you_own_above_water_color = LLUIColorTable::instance().getColor("NetMapYouOwnAboveWater");
+	static LLUIColor you_own_below_water_color = LLUIColorTable::instance().getColor("NetMapYouOwnBelowWater");
+	static LLUIColor group_own_above_water_color = LLUIColorTable::instance().getColor("NetMapGroupOwnAboveWater");
+	static LLUIColor group_own_below_water_color = LLUIColorTable::instance().getColor("NetMapGroupOwnBelowWater");
+
+	if (objectp->isDead() || !objectp->getRegion() || objectp->isOrphaned() || objectp->isAttachment())
+	{
+		return false;
+	}
+
+	const LLVector3& scale = objectp->getScale();
+	dot.mPosGlobal = objectp->getPositionGlobal();
+	const F64 water_height = F64(objectp->getRegion()->getWaterHeight());
+
+	F32 approx_radius = (scale.mV[VX] + scale.mV[VY]) * 0.5f * 0.5f * 1.3f;  // 1.3 is a fudge
+
+	// Limit the size of megaprims so they don't blot out everything on the minimap.
+	// Attempting to draw very large megaprims also causes client lag.
+	// See DEV-17370 and DEV-29869/SNOW-79 for details.
+	approx_radius = llmin(approx_radius, mMaxRadius);
+
+	LLColor4 color = above_water_color.get();
+	if (objectp->permYouOwner())
+	{
+		if (approx_radius < MIN_RADIUS_FOR_OWNED_OBJECTS)
+		{
+			approx_radius = MIN_RADIUS_FOR_OWNED_OBJECTS;
+		}
+
+		if (dot.mPosGlobal.mdV[VZ] >= water_height)
+		{
+			color = objectp->permGroupOwner() ? group_own_above_water_color.get() : you_own_above_water_color.get();
+		}
+		else
+		{
+			color = objectp->permGroupOwner() ? group_own_below_water_color.get() : you_own_below_water_color.get();
+		}
+	}
+	else if (dot.mPosGlobal.mdV[VZ] < water_height)
+	{
+		color = below_water_color.get();
+	}
+
+	dot.mRadius = approx_radius;
+	dot.mColor = color;
+	dot.mBin = tileKey((U32)llmax(0, llfloor((F32)(dot.mPosGlobal.mdV[VX] / TILE_METERS))),
+					   (U32)llmax(0, llfloor((F32)(dot.mPosGlobal.mdV[VY] / TILE_METERS))));
+	return true;
+}
+
+void LLNetMapObjectLayer::insertDot(LLViewerObject* objectp, const MapDot& dot)
+{
+	mDots[objectp] = dot;
+	mBins[dot.mBin].insert(objectp);
+	markDirty(dot);
+}
+
+void LLNetMapObjectLayer::eraseDot(dot_map_t::iterator iter)
+{
+	const MapDot& dot = iter->second;
+	markDirty(dot);
+
+	bin_map_t::iterator bin = mBins.find(dot.mBin);
+	if (bin != mBins.end())
+	{
+		bin->second.erase(iter->first);
+		if (bin->second.empty())
+		{
+			mBins.erase(bin);
+		}
+	}
+	mDots.erase(iter);
+}
+
+void LLNetMapObjectLayer::markDirty(const MapDot& dot)
+{
+	// Allow for a texel of rounding on each side
+	F64 extent = dot.mRadius + (mTexelsPerRegion ? REGION_WIDTH_METERS / mTexelsPerRegion : 1.f);
+	S32 min_x = llmax(0, llfloor((F32)((dot.mPosGlobal.mdV[VX] - extent) / TILE_METERS)));
+	S32 max_x = llmax(0, llfloor((F32)((dot.mPosGlobal.mdV[VX] + extent) / TILE_METERS)));
+	S32 min_y = llmax(0, llfloor((F32)((dot.mPosGlobal.mdV[VY] - extent) / TILE_METERS)));
+	S32 max_y = llmax(0, llfloor((F32)((dot.mPosGlobal.mdV[VY] + extent) / TILE_METERS)));
+
+	for (S32 tile_y = min_y; tile_y <= max_y; tile_y++)
+	{
+		for (S32 tile_x = min_x; tile_x <= max_x; tile_x++)
+		{
+			U64 handle = to_region_handle((U32)(tile_x / TILES_PER_REGION) * REGION_WIDTH_UNITS,
+										  (U32)(tile_y / TILES_PER_REGION) * REGION_WIDTH_UNITS);
+			region_layer_map_t::iterator found = mRegionLayers.find(handle);
+			if (found != mRegionLayers.end())
+			{
+				found->second.mDirtyTiles |= 1ULL << ((tile_y % TILES_PER_REGION) * TILES_PER_REGION + tile_x % TILES_PER_REGION);
+			}
+		}
+	}
+}
+
+void LLNetMapObjectLayer::updateRegionLayers(S32 texels_per_region)
+{
+	if (texels_per_region != mTexelsPerRegion)
+	{
+		mRegionLayers.clear();
+		mTexelsPerRegion = texels_per_region;
+	}
+
+	// Drop the layers of the regions we left
+	region_layer_map_t::iterator iter = mRegionLayers.begin();
+	while (iter != mRegionLayers.end())
+	{
+		if (!LLWorld::getInstance()->getRegionFromHandle(iter->first))
+		{
+			mRegionLayers.erase(iter++);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+
+	// Start the new ones all dirty
+	for (LLWorld::region_list_t::const_iterator region_iter = LLWorld::getInstance()->getRegionList().begin();
+		 region_iter != LLWorld::getInstance()->getRegionList().end(); ++region_iter)
+	{
+		U64 handle = (*region_iter)->getHandle();
+		if (mRegionLayers.find(handle) == mRegionLayers.end())
+		{
+			RegionLayer& layer = mRegionLayers[handle];
+			layer.mRawImage = new LLImageRaw(mTexelsPerRegion, mTexelsPerRegion, 4);
+			memset(layer.mRawImage->getData(), 0, mTexelsPerRegion * mTexelsPerRegion * 4);
+			layer.mTexture = LLViewerTextureManager::getLocalTexture(layer.mRawImage.get(), FALSE);
+			layer.mDirtyTiles = ~0ULL;
+		}
+	}
+}
+
+void LLNetMapObjectLayer::rebuild()
+{
+	mDots.clear();
+	mBins.clear();
+	mMaxRadius = gSavedSettings.getF32("MiniMapPrimMaxRadius");
+	gObjectList.addObjectsToMapLayer(*this);
+
+	for (region_layer_map_t::iterator iter = mRegionLayers.begin(); iter != mRegionLayers.end(); ++iter)
+	{
+		iter->second.mDirtyTiles = ~0ULL;
+	}
+}
+
+void LLNetMapObjectLayer::renderTile(U64 region_handle, RegionLayer& layer, S32 tile_x, S32 tile_y)
+{
+	const S32 tile_texels = mTexelsPerRegion / TILES_PER_REGION;
+	const S32 x0 = tile_x * tile_texels;
+	const S32 y0 = tile_y * tile_texels;
+	const S32 x1 = x0 + tile_texels;
+	const S32 y1 = y0 + tile_texels;
+	U32* datap = (U32*)layer.mRawImage->getData();
+
+	for (S32 y = y0; y < y1; y++)
+	{
+		memset(datap + y * mTexelsPerRegion + x0, 0, tile_texels * sizeof(U32));
+	}
+
+	U32 origin_x, origin_y;
+	from_region_handle(region_handle, &origin_x, &origin_y);
+	const F64 texels_per_meter = (F64)mTexelsPerRegion / REGION_WIDTH_METERS;
+
+	// Dots centered in the tiles around can spill over this one
+	const F32 max_radius = llmax(mMaxRadius, MIN_RADIUS_FOR_OWNED_OBJECTS) + (F32)(1.0 / texels_per_meter);
+	const S32 reach = llceil(max_radius / TILE_METERS);
+	const S32 bin_x = (S32)(origin_x / TILE_METERS) + tile_x;
+	const S32 bin_y = (S32)(origin_y / TILE_METERS) + tile_y;
+
+	for (S32 y = llmax(0, bin_y - reach); y <= bin_y + reach; y++)
+	{
+		for (S32 x = llmax(0, bin_x - reach); x <= bin_x + reach; x++)
+		{
+			bin_map_t::const_iterator bin = mBins.find(tileKey(x, y));
+			if (bin == mBins.end())
+			{
+				continue;
+			}
+
+			for (object_set_t::const_iterator obj_iter = bin->second.begin(); obj_iter != bin->second.end(); ++obj_iter)
+			{
+				const MapDot& dot = mDots[*obj_iter];
+				S32 diameter = llround(2.f * dot.mRadius * (F32)texels_per_meter);
+				if (diameter <= 0)
+				{
+					continue;
+				}
+
+				S32 left = llround((F32)((dot.mPosGlobal.mdV[VX] - origin_x) * texels_per_meter)) - diameter / 2;
+				S32 bottom = llround((F32)((dot.mPosGlobal.mdV[VY] - origin_y) * texels_per_meter)) - diameter / 2;
+				S32 min_x = llmax(left, x0);
+				S32 max_x = llmin(left + diameter, x1);
+				S32 min_y = llmax(bottom, y0);
+				S32 max_y = llmin(bottom + diameter, y1);
+				for (S32 p_y = min_y; p_y < max_y; p_y++)
+				{
+					U32* rowp = datap + p_y * mTexelsPerRegion;
+					for (S32 p_x = min_x; p_x < max_x; p_x++)
+					{
+						rowp[p_x] = dot.mColor.mAll;
+					}
+				}
+			}
+		}
+	}
+}
+
+// Uploads the dirty tiles, a run of consecutive tiles in a row at a time
+void LLNetMapObjectLayer::uploadDirtyTiles(RegionLayer& layer)
+{
+	if (layer.mDirtyTiles == ~0ULL)
+	{
+		layer.mTexture->setSubImage(layer.mRawImage, 0, 0, mTexelsPerRegion, mTexelsPerRegion);
+		return;
+	}
+
+	const S32 tile_texels = mTexelsPerRegion / TILES_PER_REGION;
+	for (S32 tile_y = 0; tile_y < TILES_PER_REGION; tile_y++)
+	{
+		S32 tile_x = 0;
+		while (tile_x < TILES_PER_REGION)
+		{
+			if (!(layer.mDirtyTiles & (1ULL << (tile_y * TILES_PER_REGION + tile_x))))
+			{
+				tile_x++;
+				continue;
+			}
+
+			S32 run_start = tile_x;
+			while (tile_x < TILES_PER_REGION && (layer.mDirtyTiles & (1ULL << (tile_y * TILES_PER_REGION + tile_x))))
+			{
+				tile_x++;
+			}
+			layer.mTexture->setSubImage(layer.mRawImage,
+										run_start * tile_texels, tile_y * tile_texels,
+										(tile_x - run_start) * tile_texels, tile_texels);
+		}
+	}
+}
@@ -0,0 +1,118 @@
+/** 
+ * @file llnetmapobjectlayer.h
+ * @brief Object layer of the minimap, one texture per region
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+   
+#ifndef LL_LLNETMAPOBJECTLAYER_H
+#define LL_LLNETMAPOBJECTLAYER_H
+
+#include <map>
+#include <set>
+
+#include "llframetimer.h"
+#include "llpointer.h"
+#include "llsingleton.h"
+#include "v3dmath.h"
+#include "v4coloru.h"
+
+class LLImageRaw;
+class LLViewerObject;
+class LLViewerRegion;
+class LLViewerTexture;
+
+// LLNetMapObjectLayer : the object dots of the minimap, kept up to date as objects are
+// added to the map, move or go away instead of being redrawn all at once.
+// Each region has its own texture, split into TILES_PER_REGION x TILES_PER_REGION tiles.
+// Changes mark the tiles under the old and new dot dirty, and only the dirty tiles are
+// redrawn and uploaded. Dots are binned by the tile their center is in so that redrawing
+// a tile only looks at the objects around it.
+class LLNetMapObjectLayer : public LLSingleton<LLNetMapObjectLayer>
+{
+public:
+	// Tiles per region side, so that the dirty tiles of a region fit in a U64
+	static const S32 TILES_PER_REGION = 8;
+
+	LLNetMapObjectLayer();
+	~LLNetMapObjectLayer();
+
+	// Object list notifications. They are ignored until the layer is first updated.
+	void addObject(LLViewerObject* objectp);
+	void removeObject(LLViewerObject* objectp);
+	// Position, scale or ownership of an object on the map may have changed
+	void updateObject(LLViewerObject* objectp);
+
+	// Redraws and uploads the dirty tiles, at texels_per_region texels per region side.
+	// Call before drawing the minimap.
+	void update(S32 texels_per_region);
+	// The object layer of the region, NULL if update() hasn't seen the region yet
+	LLViewerTexture* getRegionTexture(const LLViewerRegion* regionp) const;
+
+private:
+	struct MapDot
+	{
+		LLVector3d	mPosGlobal;
+		F32			mRadius;	// In meters
+		LLColor4U	mColor;
+		U64			mBin;		// Tile the center is in
+	};
+
+	struct RegionLayer
+	{
+		RegionLayer() : mDirtyTiles(0) {}
+
+		LLPointer<LLImageRaw>		mRawImage;
+		LLPointer<LLViewerTexture>	mTexture;
+		U64							mDirtyTiles;	// One bit per tile, row major
+	};
+
+	typedef std::map<LLViewerObject*, MapDot> dot_map_t;
+	typedef std::set<LLViewerObject*> object_set_t;
+	typedef std::map<U64, object_set_t> bin_map_t;
+	typedef std::map<U64, RegionLayer> region_layer_map_t;
+
+	// Returns false if the object shouldn't show on the map
+	bool computeDot(LLViewerObject* objectp, MapDot& dot) const;
+	void insertDot(LLViewerObject* objectp, const MapDot& dot);
+	void eraseDot(dot_map_t::iterator iter);
+	// Marks the tiles the dot covers dirty
+	void markDirty(const MapDot& dot);
+	// Creates and drops region layers to match the regions in the world
+	void updateRegionLayers(S32 texels_per_region);
+	// Gets all the dots again from the object list
+	void rebuild();
+	void renderTile(U64 region_handle, RegionLayer& layer, S32 tile_x, S32 tile_y);
+	void uploadDirtyTiles(RegionLayer& layer);
+
+	static U64 tileKey(U32 tile_x, U32 tile_y)	{ return ((U64)tile_x << 32) | (U64)tile_y; }
+
+	bool				mEnabled;
+	S32					mTexelsPerRegion;
+	F32					mMaxRadius;		// MiniMapPrimMaxRadius the dots were computed with
+	dot_map_t			mDots;
+	bin_map_t			mBins;
+	region_layer_map_t	mRegionLayers;
+	LLFrameTimer		mActiveTimer;	// Moving objects are looked at every ACTIVE_UPDATE_PERIOD
+};
+
+#endif // LL_LLNETMAPOBJECTLAYER_H
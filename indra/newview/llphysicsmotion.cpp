@@ -36,6 +36,9 @@
 #include "llphysicsmotion.h"
 #include "llagent.h"
 #include "llcharacter.h"
+#include "llfasttimer.h"
+#include "llv4math.h"		// for LL_VECTORIZE
+#include "llviewercamera.h"
 #include "llviewercontrol.h"
 #include "llviewervisualparam.h"
 #include "llvoavatarself.h"
@@ -45,6 +48,8 @@ typedef std::map<std::string, F32> default_controller_map_t;
 
 #define MIN_REQUIRED_PIXEL_AREA_AVATAR_PHYSICS_MOTION 0.f
 #define TIME_ITERATION_STEP 0.1f
+#define MAX_PHYSICS_VELOCITY 100.0f
+#define MAX_PHYSICS_LOD_PERIOD 4
 
 inline F64 llsgn(const F64 a)
 {
@@ -66,6 +71,7 @@ inline F64 llsgn(const F64 a)
 
 class LLPhysicsMotion
 {
+        friend class LLPhysicsMotionBatch;
 public:
         /*
           param_driver_name: The param that controls the params that are being affected by the physics.
@@ -95,7 +101,9 @@ public:
                 mLastTime(0),
                 mPosition_local(0),
                 mVelocityJoint_local(0),
-                mPositionLastUpdate_local(0)
+                mPositionLastUpdate_local(0),
+                mDriverParam(NULL),
+                mFrameQueued(FALSE)
         {
                 mJointState = new LLJointState;
         }
@@ -106,6 +114,13 @@ public:
 
         BOOL onUpdate(F32 time);
 
+        // Batched update.  prepareUpdate() does the per-avatar part of onUpdate()
+        // and returns TRUE if the motion has to be integrated this frame, the
+        // batch then integrates it and hands the results to applyUpdate().
+        BOOL prepareUpdate(F32 time, BOOL is_self, BOOL& update_visuals);
+        void applyUpdate(F32 position, F32 velocity, F32 last_update, F32 value,
+                         BOOL done, BOOL wrote, BOOL reset);
+
         LLPointer<LLJointState> getJointState() 
         {
                 return mJointState;
@@ -121,6 +136,12 @@ protected:
                 const std::string& param_name = (*entry).second.c_str();
                 return mCharacter->getVisualParamWeight(param_name.c_str());
         }
+        // Same as getParamValue(), without the name lookups.
+        F32 getControllerValue(U32 controller) const
+        {
+                const LLVisualParam* param = mControllerParams[controller];
+                return param ? param->getWeight() : mControllerDefaults[controller];
+        }
         void setParamValue(LLViewerVisualParam *param,
                            const F32 new_value_local,
                                                    F32 behavior_maxeffect);
@@ -149,8 +170,55 @@ private:
         LLCharacter *mCharacter;
 
         F32 mLastTime;
-        
+
+        enum EController
+        {
+                CONTROLLER_MASS,
+                CONTROLLER_GRAVITY,
+                CONTROLLER_SPRING,
+                CONTROLLER_GAIN,
+                CONTROLLER_DAMPING,
+                CONTROLLER_DRAG,
+                CONTROLLER_MAXEFFECT,
+                NUM_CONTROLLERS
+        };
+
+        // Resolved by initialize() so the batched path never looks params up by name.
+        LLDriverParam *mDriverParam;
+        LLVisualParam *mControllerParams[NUM_CONTROLLERS];
+        F32 mControllerDefaults[NUM_CONTROLLERS];
+
+        // Inputs gathered by prepareUpdate() for the batch.
+        BOOL mFrameQueued;
+        F32 mFrameTime;
+        U32 mFrameIterations;
+        F32 mFrameLastStep;
+        F32 mFramePositionUser;
+        F32 mFrameMaxEffect;
+        F32 mFrameSpring;
+        F32 mFrameDamping;
+        F32 mFrameMass;
+        F32 mFrameForce; // acceleration and gravity forces, constant over the frame
+        F32 mFrameDrag;
+        BOOL mFrameAllowVisual;
+        F32 mFrameMinDelta;
+        F32 mFrameVelocityJoint;
+        F32 mFrameAccelerationJoint;
+        LLVector3 mFramePosition_world;
+
         static default_controller_map_t sDefaultController;
+        static const char* sControllerNames[NUM_CONTROLLERS];
+};
+
+const char* LLPhysicsMotion::sControllerNames[LLPhysicsMotion::NUM_CONTROLLERS] =
+{
+        "Mass",
+        "Gravity",
+        "Spring",
+        "Gain",
+        "Damping",
+        "Drag",
+        "MaxEffect"
 };
 
 default_controller_map_t initDefaultController()
@@ -180,19 +248,105 @@ BOOL LLPhysicsMotion::initialize()
                 llinfos << "Failure reading in  [ " << mParamDriverName << " ]" << llendl;
                 return FALSE;
         }
+        mDriverParam = dynamic_cast<LLDriverParam *>(mParamDriver);
+
+        for (U32 i = 0; i < NUM_CONTROLLERS; ++i)
+        {
+                // Mirrors getParamValue(): unmapped controllers use the default,
+                // mapped ones that the avatar doesn't have read as 0.
+                mControllerParams[i] = NULL;
+                mControllerDefaults[i] = 0.f;
+                const controller_map_t::const_iterator entry = mParamControllers.find(sControllerNames[i]);
+                if (entry == mParamControllers.end())
+                {
+                        mControllerDefaults[i] = sDefaultController[sControllerNames[i]];
+                }
+                else
+                {
+                        mControllerParams[i] = mCharacter->getVisualParam(entry->second.c_str());
+                }
+        }
 
         return TRUE;
 }
 
+//-----------------------------------------------------------------------------
+// class LLPhysicsMotionBatch
+// Collects the physics motions of every avatar animated this frame and
+// integrates them together in structure-of-arrays form, four at a time when
+// SSE is available.  Controllers are queued from onUpdate(), which may run on
+// the animation threads; the integration runs on the main thread.
+//-----------------------------------------------------------------------------
+class LLPhysicsMotionBatch : public LLSingleton<LLPhysicsMotionBatch>
+{
+public:
+        LLPhysicsMotionBatch();
+        ~LLPhysicsMotionBatch();
+
+        void add(LLPhysicsMotionController* controller);
+        void remove(LLPhysicsMotionController* controller);
+        void update();
+
+        enum EArray
+        {
+                // inputs
+                ARRAY_ITERATIONS,
+                ARRAY_LAST_STEP,
+                ARRAY_POSITION_USER,
+                ARRAY_MAX_EFFECT,
+                ARRAY_SPRING,
+                ARRAY_DAMPING,
+                ARRAY_MASS,
+                ARRAY_FORCE,
+                ARRAY_DRAG,
+                ARRAY_ALLOW_VISUAL,
+                ARRAY_MIN_DELTA,
+                // state, read and written back
+                ARRAY_POSITION,
+                ARRAY_VELOCITY,
+                ARRAY_LAST_UPDATE,
+                // outputs, flags are 0 or 1
+                ARRAY_VALUE,
+                ARRAY_DONE,
+                ARRAY_WROTE,
+                ARRAY_VISUALS,
+                ARRAY_RESET,
+                NUM_ARRAYS
+        };
+
+private:
+        F32* getArray(U32 array) { return &mStorage[array * mCapacity]; }
+
+        typedef std::vector<LLPhysicsMotionController*> controller_vec_t;
+        typedef std::vector<LLPhysicsMotion*> motion_vec_t;
+
+        LLMutex					mMutex;
+        controller_vec_t		mQueued;
+        controller_vec_t		mControllers;	// main thread copy of mQueued
+        motion_vec_t			mMotions;		// one per lane
+        std::vector<F32>		mStorage;
+        U32						mCapacity;
+};
+
+static LLVector3 sLODCameraPosition;
+
 LLPhysicsMotionController::LLPhysicsMotionController(const LLUUID &id) : 
         LLMotion(id),
-        mCharacter(NULL)
+        mCharacter(NULL),
+        mIsSelf(FALSE),
+        mQueued(FALSE)
 {
+        static U32 next_lod_phase = 0;
+        mLODPhase = next_lod_phase++;
         mName = "breast_motion";
 }
 
 LLPhysicsMotionController::~LLPhysicsMotionController()
 {
+        if (LLPhysicsMotionBatch::instanceExists())
+        {
+                LLPhysicsMotionBatch::getInstance()->remove(this);
+        }
         for (motion_vec_t::iterator iter = mMotions.begin();
              iter != mMotions.end();
              ++iter)
@@ -213,6 +367,10 @@ void LLPhysicsMotionController::onDeactivate()
 LLMotion::LLMotionInitStatus LLPhysicsMotionController::onInitialize(LLCharacter *character)
 {
         mCharacter = character;
+        mIsSelf = (dynamic_cast<LLVOAvatarSelf *>(character) != NULL);
+
+        // Create the batch here on the main thread, onUpdate() may not be.
+        LLPhysicsMotionBatch::getInstance();
 
         mMotions.clear();
 
@@ -407,22 +565,47 @@ F32 LLPhysicsMotion::calculateAcceleration_local(const F32 velocity_local)
 BOOL LLPhysicsMotionController::onUpdate(F32 time, U8* joint_mask)
 {
         // Skip if disabled globally.
-        if (!gSavedSettings.getBOOL("AvatarPhysics"))
+        if (!LLVOAvatar::sAvatarPhysics)
+        {
+                return TRUE;
+        }
+
+        // Update-rate LOD is part of the batched path, the per-motion path
+        // updates every frame as it always did.
+        if (sBatchUpdate && skipUpdateForLOD())
         {
                 return TRUE;
         }
         
         BOOL update_visuals = FALSE;
-        for (motion_vec_t::iterator iter = mMotions.begin();
-             iter != mMotions.end();
-             ++iter)
+        if (sBatchUpdate)
         {
-                LLPhysicsMotion *motion = (*iter);
-                update_visuals |= motion->onUpdate(time);
+                BOOL queue = FALSE;
+                for (motion_vec_t::iterator iter = mMotions.begin();
+                     iter != mMotions.end();
+                     ++iter)
+                {
+                        LLPhysicsMotion *motion = (*iter);
+                        queue |= motion->prepareUpdate(time, mIsSelf, update_visuals);
+                }
+                if (queue)
+                {
+                        LLPhysicsMotionBatch::getInstance()->add(this);
+                }
+        }
+        else
+        {
+                for (motion_vec_t::iterator iter = mMotions.begin();
+                     iter != mMotions.end();
+                     ++iter)
+                {
+                        LLPhysicsMotion *motion = (*iter);
+                        update_visuals |= motion->onUpdate(time);
+                }
         }
                 
         if (update_visuals)
-                mCharacter->updateVisualParams();
+                mCharacter->requestVisualParamUpdate();
         
         return TRUE;
 }
@@ -710,10 +893,10 @@ BOOL LLPhysicsMotion::onUpdate(F32 time)
         return update_visuals;
 }
 
-// Range of new_value_local is assumed to be [0 , 1] normalized.
-void LLPhysicsMotion::setParamValue(LLViewerVisualParam *param,
-                                    F32 new_value_normalized,
-				    F32 behavior_maxeffect)
+// Range of new_value_normalized is assumed to be [0 , 1] normalized.
+static F32 rescale_param_value(const LLViewerVisualParam *param,
+                               F32 new_value_normalized,
+                               F32 behavior_maxeffect)
 {
         const F32 value_min_local = param->getMinWeight();
         const F32 value_max_local = param->getMaxWeight();
@@ -724,9 +907,586 @@ void LLPhysicsMotion::setParamValue(LLViewerVisualParam *param,
 	const F32 new_value_rescaled = min_val + (max_val-min_val) * new_value_normalized;
 	
 	// Scale from [0,1] to [value_min_local,value_max_local]
-        const F32 new_value_local = value_min_local + (value_max_local-value_min_local) * new_value_rescaled;
+        return value_min_local + (value_max_local-value_min_local) * new_value_rescaled;
+}
 
+void LLPhysicsMotion::setParamValue(LLViewerVisualParam *param,
+                                    F32 new_value_normalized,
+				    F32 behavior_maxeffect)
+{
         mCharacter->setVisualParamWeight(param,
-                                         new_value_local,
+                                         rescale_param_value(param, new_value_normalized, behavior_maxeffect),
                                          FALSE);
 }
+
+// Return TRUE if the motion has to be integrated this frame.  Everything up to
+// the iteration loop of onUpdate(), plus the parts of the loop that don't
+// change between iterations.
+BOOL LLPhysicsMotion::prepareUpdate(F32 time, BOOL is_self, BOOL& update_visuals)
+{
+        mFrameQueued = FALSE;
+
+        if (!mParamDriver)
+                return FALSE;
+
+        if (!mLastTime)
+        {
+                mLastTime = time;
+                return FALSE;
+        }
+
+        const F32 time_delta = time - mLastTime;
+	if (time_delta <= .01)
+	{
+		return FALSE;
+	}
+        if (time_delta > 1.0)
+        {
+                mLastTime = time;
+                return FALSE;
+        }
+
+        const F32 lod_factor = LLVOAvatar::sPhysicsLODFactor;
+        if (lod_factor == 0)
+        {
+                update_visuals = TRUE;
+                return FALSE;
+        }
+
+        LLJoint *joint = mJointState->getJoint();
+
+        mFrameMass = getControllerValue(CONTROLLER_MASS);
+        mFrameSpring = getControllerValue(CONTROLLER_SPRING);
+        mFrameDamping = getControllerValue(CONTROLLER_DAMPING);
+        mFrameMaxEffect = getControllerValue(CONTROLLER_MAXEFFECT);
+        const F32 behavior_gravity = getControllerValue(CONTROLLER_GRAVITY);
+        const F32 behavior_gain = getControllerValue(CONTROLLER_GAIN);
+        const F32 behavior_drag = getControllerValue(CONTROLLER_DRAG);
+
+	mFramePositionUser = (mParamDriver->getWeight() - mParamDriver->getMinWeight()) / (mParamDriver->getMaxWeight() - mParamDriver->getMinWeight());
+
+        const F32 velocity_joint_local = calculateVelocity_local();
+        const F32 acceleration_joint_local = calculateAcceleration_local(velocity_joint_local);
+        mFrameVelocityJoint = velocity_joint_local;
+        mFrameAccelerationJoint = acceleration_joint_local;
+
+        // Same terms and order as the force sum in onUpdate().
+        const F32 force_accel = behavior_gain * (acceleration_joint_local * mFrameMass);
+        const LLVector3 gravity_world(0,0,1);
+        const F32 force_gravity = (toLocal(gravity_world) * behavior_gravity * mFrameMass);
+        mFrameForce = force_accel + force_gravity;
+        mFrameDrag = .5*behavior_drag*velocity_joint_local*velocity_joint_local*llsgn(velocity_joint_local);
+
+        // Count the iterations the way onUpdate() steps through them; only the
+        // last one can be shorter than TIME_ITERATION_STEP.
+        mFrameIterations = 0;
+        mFrameLastStep = TIME_ITERATION_STEP;
+	for (F32 time_iteration = 0; time_iteration <= time_delta; time_iteration += TIME_ITERATION_STEP)
+	{
+                mFrameLastStep = TIME_ITERATION_STEP;
+		if (time_iteration + TIME_ITERATION_STEP > time_delta)
+		{
+			mFrameLastStep = time_delta-time_iteration;
+		}
+                ++mFrameIterations;
+	}
+
+        const F32 area_for_max_settings = 0.0;
+        const F32 area_for_min_settings = 1400.0;
+        const F32 area_for_this_setting = area_for_max_settings + (area_for_min_settings-area_for_max_settings)*(1.0-lod_factor);
+        const F32 pixel_area = fsqrtf(mCharacter->getPixelArea());
+        mFrameAllowVisual = (pixel_area > area_for_this_setting) || is_self;
+        mFrameMinDelta = (1.0001f-lod_factor)*0.4f;
+
+        mFrameTime = time;
+        mFramePosition_world = joint->getWorldPosition();
+        mFrameQueued = TRUE;
+        return TRUE;
+}
+
+// Write back the results of the batch.  done means the iterations stopped
+// early because the effect is off, which leaves the frame state alone like the
+// early return in onUpdate().
+void LLPhysicsMotion::applyUpdate(F32 position, F32 velocity, F32 last_update, F32 value,
+                                  BOOL done, BOOL wrote, BOOL reset)
+{
+        mPosition_local = position;
+        mVelocity_local = velocity;
+        mPositionLastUpdate_local = last_update;
+
+        if (wrote)
+        {
+                mAccelerationJoint_local = mFrameAccelerationJoint;
+                if (mDriverParam)
+                {
+                        if ((mDriverParam->getGroup() != VISUAL_PARAM_GROUP_TWEAKABLE) &&
+                            (mDriverParam->getGroup() != VISUAL_PARAM_GROUP_TWEAKABLE_NO_TRANSMIT))
+                        {
+                                mDriverParam->setWeight(0, FALSE);
+                        }
+                        for (LLDriverParam::entry_list_t::iterator iter = mDriverParam->mDriven.begin();
+                             iter != mDriverParam->mDriven.end();
+                             ++iter)
+                        {
+                                LLViewerVisualParam *driven_param = iter->mParam;
+                                driven_param->setWeight(rescale_param_value(driven_param, value, mFrameMaxEffect), FALSE);
+                        }
+                }
+        }
+
+        if (!done)
+        {
+                mLastTime = mFrameTime;
+                mPosition_world = mFramePosition_world;
+                mVelocityJoint_local = mFrameVelocityJoint;
+        }
+        else if (reset)
+        {
+                mVelocityJoint_local = 0;
+                mPosition_world = LLVector3(0,0,0);
+        }
+}
+
+//-----------------------------------------------------------------------------
+// Batch integration.  Each lane runs the iteration loop of
+// LLPhysicsMotion::onUpdate() on its own motion.  The SSE version handles
+// groups of four lanes and masks out lanes past their iteration count or
+// stopped because the effect is off; the scalar version does the rest.
+//-----------------------------------------------------------------------------
+static void integrate_physics_motions_scalar(F32* const* arrays, U32 begin, U32 end)
+{
+        for (U32 i = begin; i < end; ++i)
+        {
+                const U32 iterations = (U32)arrays[LLPhysicsMotionBatch::ARRAY_ITERATIONS][i];
+                const F32 last_step = arrays[LLPhysicsMotionBatch::ARRAY_LAST_STEP][i];
+                const F32 position_user = arrays[LLPhysicsMotionBatch::ARRAY_POSITION_USER][i];
+                const BOOL no_effect = (arrays[LLPhysicsMotionBatch::ARRAY_MAX_EFFECT][i] == 0);
+                const F32 spring = arrays[LLPhysicsMotionBatch::ARRAY_SPRING][i];
+                const F32 damping = arrays[LLPhysicsMotionBatch::ARRAY_DAMPING][i];
+                const F32 mass = arrays[LLPhysicsMotionBatch::ARRAY_MASS][i];
+                const F32 force = arrays[LLPhysicsMotionBatch::ARRAY_FORCE][i];
+                const F32 drag = arrays[LLPhysicsMotionBatch::ARRAY_DRAG][i];
+                const BOOL allow_visual = (arrays[LLPhysicsMotionBatch::ARRAY_ALLOW_VISUAL][i] > 0);
+                const F32 min_delta = arrays[LLPhysicsMotionBatch::ARRAY_MIN_DELTA][i];
+
+                F32 position = arrays[LLPhysicsMotionBatch::ARRAY_POSITION][i];
+                F32 velocity = arrays[LLPhysicsMotionBatch::ARRAY_VELOCITY][i];
+                F32 last_update = arrays[LLPhysicsMotionBatch::ARRAY_LAST_UPDATE][i];
+                F32 value = 0.f;
+                BOOL done = FALSE, wrote = FALSE, visuals = FALSE, reset = FALSE;
+
+                for (U32 k = 0; k < iterations; ++k)
+                {
+                        const F32 step = (k + 1 == iterations) ? last_step : TIME_ITERATION_STEP;
+                        const F32 position_current = llclamp(position, 0.0f, 1.0f);
+                        if (no_effect && (position_current == position_user))
+                        {
+                                done = TRUE;
+                                break;
+                        }
+
+                        const F32 force_net = force - (position_current - position_user) * spring - damping * velocity + drag;
+                        F32 velocity_new = llclamp(velocity + (force_net / mass) * step,
+                                                   -MAX_PHYSICS_VELOCITY, MAX_PHYSICS_VELOCITY);
+                        F32 position_new = no_effect ? position_user : position_current + velocity_new * step;
+                        if ((position_new < 0 && velocity_new < 0) ||
+                            (position_new > 1 && velocity_new > 0))
+                        {
+                                velocity_new = 0;
+                        }
+                        // onUpdate() keeps the NaN velocity here, reset it as well.
+                        if ((position != position) || (velocity != velocity) || (position_new != position_new))
+                        {
+                                position_new = 0;
+                                velocity_new = 0;
+                                reset = TRUE;
+                        }
+
+                        value = llclamp(position_new, 0.0f, 1.0f);
+                        wrote = TRUE;
+                        if (allow_visual && (llabs(last_update - value) > min_delta))
+                        {
+                                visuals = TRUE;
+                                last_update = position_new;
+                        }
+                        velocity = velocity_new;
+                        position = position_new;
+                }
+
+                arrays[LLPhysicsMotionBatch::ARRAY_POSITION][i] = position;
+                arrays[LLPhysicsMotionBatch::ARRAY_VELOCITY][i] = velocity;
+                arrays[LLPhysicsMotionBatch::ARRAY_LAST_UPDATE][i] = last_update;
+                arrays[LLPhysicsMotionBatch::ARRAY_VALUE][i] = value;
+                arrays[LLPhysicsMotionBatch::ARRAY_DONE][i] = done ? 1.f : 0.f;
+                arrays[LLPhysicsMotionBatch::ARRAY_WROTE][i] = wrote ? 1.f : 0.f;
+                arrays[LLPhysicsMotionBatch::ARRAY_VISUALS][i] = visuals ? 1.f : 0.f;
+                arrays[LLPhysicsMotionBatch::ARRAY_RESET][i] = reset ? 1.f : 0.f;
+        }
+}
+
+#if LL_VECTORIZE
+
+inline __m128 select_ps(const __m128& mask, const __m128& a, const __m128& b)
+{
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline __m128 clamp_ps(const __m128& a, const __m128& lo, const __m128& hi)
+{
+        return _mm_min_ps(_mm_max_ps(a, lo), hi);
+}
+
+static void integrate_physics_motions_sse(F32* const* arrays, U32 count, U32 max_iterations)
+{
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 full_step = _mm_set1_ps(TIME_ITERATION_STEP);
+        const __m128 max_velocity = _mm_set1_ps(MAX_PHYSICS_VELOCITY);
+        const __m128 min_velocity = _mm_set1_ps(-MAX_PHYSICS_VELOCITY);
+        const __m128 sign_mask = _mm_set1_ps(-0.f);
+
+        for (U32 i = 0; i < count; i += 4)
+        {
+                const __m128 iterations = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_ITERATIONS] + i);
+                const __m128 last_step = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_LAST_STEP] + i);
+                const __m128 position_user = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_POSITION_USER] + i);
+                const __m128 no_effect = _mm_cmpeq_ps(_mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_MAX_EFFECT] + i), zero);
+                const __m128 spring = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_SPRING] + i);
+                const __m128 damping = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_DAMPING] + i);
+                const __m128 mass = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_MASS] + i);
+                const __m128 force = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_FORCE] + i);
+                const __m128 drag = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_DRAG] + i);
+                const __m128 allow_visual = _mm_cmpgt_ps(_mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_ALLOW_VISUAL] + i), zero);
+                const __m128 min_delta = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_MIN_DELTA] + i);
+
+                __m128 position = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_POSITION] + i);
+                __m128 velocity = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_VELOCITY] + i);
+                __m128 last_update = _mm_loadu_ps(arrays[LLPhysicsMotionBatch::ARRAY_LAST_UPDATE] + i);
+                __m128 value = zero;
+                __m128 done = zero;
+                __m128 wrote = zero;
+                __m128 visuals = zero;
+                __m128 reset = zero;
+
+                for (U32 k = 0; k < max_iterations; ++k)
+                {
+                        const __m128 iteration = _mm_set1_ps((F32)k);
+                        __m128 live = _mm_andnot_ps(done, _mm_cmplt_ps(iteration, iterations));
+                        if (!_mm_movemask_ps(live))
+                        {
+                                break;
+                        }
+                        const __m128 step = select_ps(_mm_cmpeq_ps(_mm_add_ps(iteration, one), iterations), last_step, full_step);
+                        const __m128 position_current = clamp_ps(position, zero, one);
+
+                        const __m128 stop = _mm_and_ps(live, _mm_and_ps(no_effect, _mm_cmpeq_ps(position_current, position_user)));
+                        done = _mm_or_ps(done, stop);
+                        live = _mm_andnot_ps(stop, live);
+
+                        const __m128 force_spring = _mm_mul_ps(_mm_sub_ps(position_user, position_current), spring);
+                        const __m128 force_damping = _mm_mul_ps(_mm_xor_ps(damping, sign_mask), velocity);
+                        const __m128 force_net = _mm_add_ps(_mm_add_ps(_mm_add_ps(force, force_spring), force_damping), drag);
+
+                        __m128 velocity_new = _mm_add_ps(velocity, _mm_mul_ps(_mm_div_ps(force_net, mass), step));
+                        velocity_new = clamp_ps(velocity_new, min_velocity, max_velocity);
+                        __m128 position_new = select_ps(no_effect, position_user,
+                                                        _mm_add_ps(position_current, _mm_mul_ps(velocity_new, step)));
+
+                        const __m128 at_limit = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(position_new, zero), _mm_cmplt_ps(velocity_new, zero)),
+                                                          _mm_and_ps(_mm_cmpgt_ps(position_new, one), _mm_cmpgt_ps(velocity_new, zero)));
+                        velocity_new = _mm_andnot_ps(at_limit, velocity_new);
+
+                        const __m128 nan = _mm_or_ps(_mm_cmpunord_ps(position, velocity), _mm_cmpunord_ps(position_new, position_new));
+                        position_new = _mm_andnot_ps(nan, position_new);
+                        velocity_new = _mm_andnot_ps(nan, velocity_new);
+                        reset = _mm_or_ps(reset, _mm_and_ps(live, nan));
+
+                        const __m128 position_clamped = clamp_ps(position_new, zero, one);
+                        value = select_ps(live, position_clamped, value);
+                        wrote = _mm_or_ps(wrote, live);
+
+                        const __m128 diff = _mm_andnot_ps(sign_mask, _mm_sub_ps(last_update, position_clamped));
+                        const __m128 moved = _mm_and_ps(_mm_and_ps(live, allow_visual), _mm_cmpgt_ps(diff, min_delta));
+                        visuals = _mm_or_ps(visuals, moved);
+                        last_update = select_ps(moved, position_new, last_update);
+
+                        velocity = select_ps(live, velocity_new, velocity);
+                        position = select_ps(live, position_new, position);
+                }
+
+                _mm_storeu_ps(arrays[LLPhysicsMotionBatch::ARRAY_POSITION] + i, position);
+                _mm_storeu_ps(arrays[LLPhysicsMotionBatch::ARRAY_VELOCITY] + i, velocity);
+                _mm_storeu_ps(arrays[LLPhysicsMotionBatch::ARRAY_LAST_UPDATE] + i, last_update);
+                _mm_storeu_ps(arrays[LLPhysicsMotionBatch::ARRAY_VALUE] + i, value);
+                _mm_storeu_ps(arrays[LLPhysicsMotionBatch::ARRAY_DONE] + i, _mm_and_ps(done, one));
+                _mm_storeu_ps(arrays[LLPhysicsMotionBatch::ARRAY_WROTE] + i, _mm_and_ps(wrote, one));
+                _mm_storeu_ps(arrays[LLPhysicsMotionBatch::ARRAY_VISUALS] + i, _mm_and_ps(visuals, one));
+                _mm_storeu_ps(arrays[LLPhysicsMotionBatch::ARRAY_RESET] + i, _mm_and_ps(reset, one));
+        }
+}
+
+#endif // LL_VECTORIZE
+
+static void integrate_physics_motions(F32* const* arrays, U32 count, U32 max_iterations)
+{
+        U32 scalar_begin = 0;
+#if LL_VECTORIZE
+        scalar_begin = count & ~3;
+        integrate_physics_motions_sse(arrays, scalar_begin, max_iterations);
+#endif
+        integrate_physics_motions_scalar(arrays, scalar_begin, count);
+}
+
+// Synthetic motions for benchmarkIntegration(), swaying at different rates
+// with the default spring and damping and a spread of masses.  Every eighth
+// one has its effect turned off.
+static void set_benchmark_motions(F32* const* arrays, U32 count, U32 frame, F32 frame_time)
+{
+        U32 iterations = 0;
+        F32 last_step = TIME_ITERATION_STEP;
+        for (F32 time_iteration = 0; time_iteration <= frame_time; time_iteration += TIME_ITERATION_STEP)
+        {
+                last_step = llmin(TIME_ITERATION_STEP, frame_time - time_iteration);
+                ++iterations;
+        }
+
+        const F32 time = frame * frame_time;
+        for (U32 i = 0; i < count; ++i)
+        {
+                const F32 mass = 0.1f + 0.05f * (i % 8);
+                if (frame == 0)
+                {
+                        arrays[LLPhysicsMotionBatch::ARRAY_POSITION][i] = 0.5f;
+                        arrays[LLPhysicsMotionBatch::ARRAY_VELOCITY][i] = 0.f;
+                        arrays[LLPhysicsMotionBatch::ARRAY_LAST_UPDATE][i] = 0.5f;
+                }
+                arrays[LLPhysicsMotionBatch::ARRAY_ITERATIONS][i] = (F32)iterations;
+                arrays[LLPhysicsMotionBatch::ARRAY_LAST_STEP][i] = last_step;
+                arrays[LLPhysicsMotionBatch::ARRAY_POSITION_USER][i] = 0.5f;
+                arrays[LLPhysicsMotionBatch::ARRAY_MAX_EFFECT][i] = (i % 8 == 7) ? 0.f : 1.f;
+                arrays[LLPhysicsMotionBatch::ARRAY_SPRING][i] = 10.f;
+                arrays[LLPhysicsMotionBatch::ARRAY_DAMPING][i] = 0.2f;
+                arrays[LLPhysicsMotionBatch::ARRAY_MASS][i] = mass;
+                arrays[LLPhysicsMotionBatch::ARRAY_FORCE][i] = 2.f * mass * sinf(time * (2.f + 0.1f * (i % 16)) + 0.37f * i);
+                arrays[LLPhysicsMotionBatch::ARRAY_DRAG][i] = 0.f;
+                arrays[LLPhysicsMotionBatch::ARRAY_ALLOW_VISUAL][i] = 1.f;
+                arrays[LLPhysicsMotionBatch::ARRAY_MIN_DELTA][i] = 0.0001f * 0.4f;
+        }
+}
+
+//static
+void LLPhysicsMotionController::benchmarkIntegration(U32 num_motions, U32 num_frames, F32 frame_time,
+                                                     F64& batch_seconds, F64& per_motion_seconds)
+{
+        batch_seconds = 0.0;
+        per_motion_seconds = 0.0;
+        if (!num_motions)
+        {
+                return;
+        }
+
+        std::vector<F32> storage(LLPhysicsMotionBatch::NUM_ARRAYS * num_motions);
+        F32* arrays[LLPhysicsMotionBatch::NUM_ARRAYS];
+        for (U32 i = 0; i < LLPhysicsMotionBatch::NUM_ARRAYS; ++i)
+        {
+                arrays[i] = &storage[i * num_motions];
+        }
+
+        LLTimer timer;
+        for (U32 frame = 0; frame < num_frames; ++frame)
+        {
+                set_benchmark_motions(arrays, num_motions, frame, frame_time);
+                timer.reset();
+                integrate_physics_motions(arrays, num_motions, (U32)arrays[LLPhysicsMotionBatch::ARRAY_ITERATIONS][0]);
+                batch_seconds += timer.getElapsedTimeF64();
+        }
+
+        // the per-motion path runs the scalar loop for one motion at a time
+        for (U32 frame = 0; frame < num_frames; ++frame)
+        {
+                set_benchmark_motions(arrays, num_motions, frame, frame_time);
+                timer.reset();
+                for (U32 i = 0; i < num_motions; ++i)
+                {
+                        integrate_physics_motions_scalar(arrays, i, i + 1);
+                }
+                per_motion_seconds += timer.getElapsedTimeF64();
+        }
+}
+
+LLPhysicsMotionBatch::LLPhysicsMotionBatch() :
+        mMutex(NULL),
+        mCapacity(0)
+{
+}
+
+LLPhysicsMotionBatch::~LLPhysicsMotionBatch()
+{
+}
+
+// May be called from the animation threads.
+void LLPhysicsMotionBatch::add(LLPhysicsMotionController* controller)
+{
+        LLMutexLock lock(&mMutex);
+        if (!controller->mQueued)
+        {
+                controller->mQueued = TRUE;
+                mQueued.push_back(controller);
+        }
+}
+
+void LLPhysicsMotionBatch::remove(LLPhysicsMotionController* controller)
+{
+        LLMutexLock lock(&mMutex);
+        if (controller->mQueued)
+        {
+                controller_vec_t::iterator iter = std::find(mQueued.begin(), mQueued.end(), controller);
+                if (iter != mQueued.end())
+                {
+                        mQueued.erase(iter);
+                }
+                controller->mQueued = FALSE;
+        }
+}
+
+static LLFastTimer::DeclareTimer FTM_PHYSICS_BATCH("Avatar Physics Batch");
+
+void LLPhysicsMotionBatch::update()
+{
+        {
+                LLMutexLock lock(&mMutex);
+                if (mQueued.empty())
+                {
+                        return;
+                }
+                mControllers.swap(mQueued);
+                mQueued.clear();
+                for (controller_vec_t::iterator iter = mControllers.begin();
+                     iter != mControllers.end();
+                     ++iter)
+                {
+                        (*iter)->mQueued = FALSE;
+                }
+        }
+
+        LLFastTimer t(FTM_PHYSICS_BATCH);
+
+        mMotions.clear();
+        for (controller_vec_t::iterator iter = mControllers.begin();
+             iter != mControllers.end();
+             ++iter)
+        {
+                LLPhysicsMotionController::motion_vec_t& motions = (*iter)->mMotions;
+                for (LLPhysicsMotionController::motion_vec_t::iterator motion_iter = motions.begin();
+                     motion_iter != motions.end();
+                     ++motion_iter)
+                {
+                        if ((*motion_iter)->mFrameQueued)
+                        {
+                                mMotions.push_back(*motion_iter);
+                        }
+                }
+        }
+
+        const U32 count = mMotions.size();
+        if (count > mCapacity)
+        {
+                mCapacity = count;
+                mStorage.resize(NUM_ARRAYS * mCapacity);
+        }
+
+        F32* arrays[NUM_ARRAYS];
+        for (U32 i = 0; i < NUM_ARRAYS; ++i)
+        {
+                arrays[i] = getArray(i);
+        }
+
+        // Gather
+        U32 max_iterations = 0;
+        for (U32 i = 0; i < count; ++i)
+        {
+                const LLPhysicsMotion* motion = mMotions[i];
+                max_iterations = llmax(max_iterations, motion->mFrameIterations);
+                arrays[ARRAY_ITERATIONS][i] = (F32)motion->mFrameIterations;
+                arrays[ARRAY_LAST_STEP][i] = motion->mFrameLastStep;
+                arrays[ARRAY_POSITION_USER][i] = motion->mFramePositionUser;
+                arrays[ARRAY_MAX_EFFECT][i] = motion->mFrameMaxEffect;
+                arrays[ARRAY_SPRING][i] = motion->mFrameSpring;
+                arrays[ARRAY_DAMPING][i] = motion->mFrameDamping;
+                arrays[ARRAY_MASS][i] = motion->mFrameMass;
+                arrays[ARRAY_FORCE][i] = motion->mFrameForce;
+                arrays[ARRAY_DRAG][i] = motion->mFrameDrag;
+                arrays[ARRAY_ALLOW_VISUAL][i] = motion->mFrameAllowVisual ? 1.f : 0.f;
+                arrays[ARRAY_MIN_DELTA][i] = motion->mFrameMinDelta;
+                arrays[ARRAY_POSITION][i] = motion->mPosition_local;
+                arrays[ARRAY_VELOCITY][i] = motion->mVelocity_local;
+                arrays[ARRAY_LAST_UPDATE][i] = motion->mPositionLastUpdate_local;
+        }
+
+        integrate_physics_motions(arrays, count, max_iterations);
+
+        // Scatter, one visual param update per avatar
+        U32 lane = 0;
+        for (controller_vec_t::iterator iter = mControllers.begin();
+             iter != mControllers.end();
+             ++iter)
+        {
+                LLPhysicsMotionController* controller = *iter;
+                BOOL update_visuals = FALSE;
+                for (LLPhysicsMotionController::motion_vec_t::iterator motion_iter = controller->mMotions.begin();
+                     motion_iter != controller->mMotions.end();
+                     ++motion_iter)
+                {
+                        LLPhysicsMotion* motion = *motion_iter;
+                        if (!motion->mFrameQueued)
+                        {
+                                continue;
+                        }
+                        motion->mFrameQueued = FALSE;
+                        motion->applyUpdate(arrays[ARRAY_POSITION][lane],
+                                            arrays[ARRAY_VELOCITY][lane],
+                                            arrays[ARRAY_LAST_UPDATE][lane],
+                                            arrays[ARRAY_VALUE][lane],
+                                            arrays[ARRAY_DONE][lane] > 0.f,
+                                            arrays[ARRAY_WROTE][lane] > 0.f,
+                                            arrays[ARRAY_RESET][lane] > 0.f);
+                        update_visuals |= (arrays[ARRAY_VISUALS][lane] > 0.f);
+                        ++lane;
+                }
+                if (update_visuals)
+                {
+                        controller->mCharacter->requestVisualParamUpdate();
+                }
+        }
+        mControllers.clear();
+}
+
+BOOL LLPhysicsMotionController::sBatchUpdate = TRUE;
+F32 LLPhysicsMotionController::sLODDistance = 32.f;
+
+BOOL LLPhysicsMotionController::skipUpdateForLOD() const
+{
+        if (mIsSelf || (sLODDistance <= 0.f))
+        {
+                return FALSE;
+        }
+
+        // Full rate up to sLODDistance, then every 2nd, 3rd... frame further out.
+        // The phase spreads the skipped frames of a crowd over several frames.
+        // Skipped time is picked up by the next update's iterations.
+        const F32 distance = dist_vec(mCharacter->getCharacterPosition(), sLODCameraPosition);
+        const U32 period = llmin((U32)(distance / sLODDistance) + 1, (U32)MAX_PHYSICS_LOD_PERIOD);
+        return ((LLFrameTimer::getFrameCount() + mLODPhase) % period) != 0;
+}
+
+//static
+void LLPhysicsMotionController::updateBatch()
+{
+        // Sampled here on the main thread for the next frame's LOD.
+        sLODCameraPosition = LLViewerCamera::getInstance()->getOrigin();
+
+        if (LLPhysicsMotionBatch::instanceExists())
+        {
+                LLPhysicsMotionBatch::getInstance()->update();
+        }
+}
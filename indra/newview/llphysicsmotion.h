@@ -44,6 +44,7 @@ class LLPhysicsMotion;
 class LLPhysicsMotionController :
 	public LLMotion
 {
+	friend class LLPhysicsMotionBatch;
 public:
 	// Constructor
 	LLPhysicsMotionController(const LLUUID &id);
@@ -105,10 +106,33 @@ public:
 
 	LLCharacter* getCharacter() { return mCharacter; }
 
+	// Integrates every physics motion queued by onUpdate() since the last
+	// call and applies the results to the driven params.  Main thread only,
+	// called once per frame after all avatars have been animated.
+	static void updateBatch();
+
+	// Headless benchmark driven by --benchmarkphysics: integrates num_motions
+	// synthetic motions for num_frames frames through the batch, then one
+	// motion at a time through the scalar loop of the per-motion path, and
+	// returns the seconds each took.
+	static void benchmarkIntegration(U32 num_motions, U32 num_frames, F32 frame_time,
+									 F64& batch_seconds, F64& per_motion_seconds);
+
+	static BOOL		sBatchUpdate;	// integrate all avatars together (AvatarPhysicsBatch)
+	static F32		sLODDistance;	// distance at which the update rate starts to drop (AvatarPhysicsLODDistance)
+
 protected:
 	void addMotion(LLPhysicsMotion *motion);
+
+	// returns TRUE if this frame should be skipped for update-rate LOD,
+	// batched path only
+	BOOL skipUpdateForLOD() const;
+
 private:
 	LLCharacter*		mCharacter;
+	BOOL				mIsSelf;
+	U32					mLODPhase;
+	BOOL				mQueued;	// waiting in the physics batch
 
 	typedef std::vector<LLPhysicsMotion *> motion_vec_t;
 	motion_vec_t mMotions;
@@ -498,18 +498,21 @@ BOOL LLPolyMeshSharedData::loadMesh( const std::string& fileName )
                 //----------------------------------------------------------------
                 // Faces
                 //----------------------------------------------------------------
+                // read the whole face table at once rather than a face at a time
+                std::vector<S16> face_data(numFaces * 3 + 1);
+                numRead = fread(&face_data[0], sizeof(U16), numFaces * 3, fp);
+                if (numRead != numFaces * 3)
+                {
+                        llerrs << "can't read Face[" << numRead / 3 << "] from " << fileName << llendl;
+                        return FALSE;
+                }
+                llendianswizzle(&face_data[0], sizeof(U16), numFaces * 3);
+
                 U32 i;
                 U32 numTris = 0;
                 for (i = 0; i < numFaces; i++)
                 {
-                        S16 face[3];
-                        numRead = fread(face, sizeof(U16), 3, fp);
-                        llendianswizzle(face, sizeof(U16), 3);
-                        if (numRead != 3)
-                        {
-                                llerrs << "can't read Face[" << i << "] from " << fileName << llendl;
-                                return FALSE;
-                        }
+                        const S16* face = &face_data[i * 3];
                         if (mReferenceData)
                         {
                                 llassert(face[0] < mReferenceData->mNumVertices);
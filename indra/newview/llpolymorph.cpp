@@ -34,6 +34,7 @@
 #include "llwearable.h"
 #include "llxmltree.h"
 #include "llendianswizzle.h"
+#include "llv4math.h"		// for LL_VECTORIZE
 
 //#include "../tools/imdebug/imdebug.h"
 
@@ -57,6 +58,7 @@ LLPolyMorphData::LLPolyMorphData(const std::string& morph_name)
 	mTexCoords = NULL;
 
 	mMesh = NULL;
+	mDeltaBlocksBuilt = FALSE;
 }
 
 LLPolyMorphData::LLPolyMorphData(const LLPolyMorphData &rhs) :
@@ -69,7 +71,8 @@ LLPolyMorphData::LLPolyMorphData(const LLPolyMorphData &rhs) :
 	mCoords(NULL),
 	mNormals(NULL),
 	mBinormals(NULL),
-	mTexCoords(NULL)
+	mTexCoords(NULL),
+	mDeltaBlocksBuilt(FALSE)
 {
 	const S32 numVertices = mNumIndices;
 
@@ -135,30 +138,32 @@ BOOL LLPolyMorphData::loadBinary(LLFILE *fp, LLPolyMeshSharedData *mesh)
 
 	//-------------------------------------------------------------------------
 	// read vertices
+	// Each record is an index followed by coords, normal, binormal and uv;
+	// pull them all in with one read and unpack from memory.
 	//-------------------------------------------------------------------------
-	for(S32 v = 0; v < numVertices; v++)
+	const S32 RECORD_WORDS = 1 + 3 + 3 + 3 + 2;
+	std::vector<U32> records(numVertices * RECORD_WORDS + 1);
+	numRead = fread(&records[0], sizeof(U32), numVertices * RECORD_WORDS, fp);
+	if (numRead != numVertices * RECORD_WORDS)
 	{
-		numRead = fread(&mVertexIndices[v], sizeof(U32), 1, fp);
-		llendianswizzle(&mVertexIndices[v], sizeof(U32), 1);
-		if (numRead != 1)
-		{
-			llwarns << "Can't read morph target vertex number" << llendl;
-			return FALSE;
-		}
+		llwarns << "Can't read morph target vertex " << numRead / RECORD_WORDS << llendl;
+		return FALSE;
+	}
+	llendianswizzle(&records[0], sizeof(U32), numVertices * RECORD_WORDS);
 
+	const U32* record = &records[0];
+	for(S32 v = 0; v < numVertices; v++, record += RECORD_WORDS)
+	{
+		mVertexIndices[v] = record[0];
 		if (mVertexIndices[v] > 10000)
 		{
 			llerrs << "Bad morph index: " << mVertexIndices[v] << llendl;
 		}
 
-
-		numRead = fread(&mCoords[v].mV, sizeof(F32), 3, fp);
-		llendianswizzle(&mCoords[v].mV, sizeof(F32), 3);
-		if (numRead != 3)
-		{
-			llwarns << "Can't read morph target vertex coordinates" << llendl;
-			return FALSE;
-		}
+		memcpy(mCoords[v].mV, record + 1, sizeof(F32) * 3);
+		memcpy(mNormals[v].mV, record + 4, sizeof(F32) * 3);
+		memcpy(mBinormals[v].mV, record + 7, sizeof(F32) * 3);
+		memcpy(mTexCoords[v].mV, record + 10, sizeof(F32) * 2);
 
 		F32 magnitude = mCoords[v].magVec();
 		
@@ -172,31 +177,6 @@ BOOL LLPolyMorphData::loadBinary(LLFILE *fp, LLPolyMeshSharedData *mesh)
 			mMaxDistortion = magnitude;
 		}
 
-		numRead = fread(&mNormals[v].mV, sizeof(F32), 3, fp);
-		llendianswizzle(&mNormals[v].mV, sizeof(F32), 3);
-		if (numRead != 3)
-		{
-			llwarns << "Can't read morph target normal" << llendl;
-			return FALSE;
-		}
-
-		numRead = fread(&mBinormals[v].mV, sizeof(F32), 3, fp);
-		llendianswizzle(&mBinormals[v].mV, sizeof(F32), 3);
-		if (numRead != 3)
-		{
-			llwarns << "Can't read morph target binormal" << llendl;
-			return FALSE;
-		}
-
-
-		numRead = fread(&mTexCoords[v].mV, sizeof(F32), 2, fp);
-		llendianswizzle(&mTexCoords[v].mV, sizeof(F32), 2);
-		if (numRead != 2)
-		{
-			llwarns << "Can't read morph target uv" << llendl;
-			return FALSE;
-		}
-
 		mNumIndices++;
 	}
 
@@ -206,6 +186,52 @@ BOOL LLPolyMorphData::loadBinary(LLFILE *fp, LLPolyMeshSharedData *mesh)
 	return TRUE;
 }
 
+//-----------------------------------------------------------------------------
+// getDeltaBlocks()
+//-----------------------------------------------------------------------------
+const LLPolyMorphData::delta_block_list_t& LLPolyMorphData::getDeltaBlocks()
+{
+	if (mDeltaBlocksBuilt)
+	{
+		return mDeltaBlocks;
+	}
+	mDeltaBlocksBuilt = TRUE;
+
+	const U32 num_blocks = mNumIndices / 4;
+	mDeltaBlocks.resize(num_blocks);
+	for (U32 b = 0; b < num_blocks; b++)
+	{
+		DeltaBlock& block = mDeltaBlocks[b];
+		for (U32 lane = 0; lane < 4; lane++)
+		{
+			const U32 v = b * 4 + lane;
+			for (U32 axis = 0; axis < 3; axis++)
+			{
+				block.mCoords[axis][lane] = mCoords[v].mV[axis];
+				block.mNormals[axis][lane] = mNormals[v].mV[axis] * NORMAL_SOFTEN_FACTOR;
+				block.mBinormals[axis][lane] = mBinormals[v].mV[axis] * NORMAL_SOFTEN_FACTOR;
+			}
+			block.mTexCoords[VX][lane] = mTexCoords[v].mV[VX];
+			block.mTexCoords[VY][lane] = mTexCoords[v].mV[VY];
+			block.mVertexIndices[lane] = mVertexIndices[v];
+
+			// the lanes of a block are gathered and scattered together
+			for (U32 other = 0; other < lane; other++)
+			{
+				if (block.mVertexIndices[other] == mVertexIndices[v])
+				{
+					llwarns << "Morph " << mName << " lists vertex " << mVertexIndices[v]
+							<< " twice, applying it one vertex at a time" << llendl;
+					mDeltaBlocks.clear();
+					return mDeltaBlocks;
+				}
+			}
+		}
+	}
+
+	return mDeltaBlocks;
+}
+
 //-----------------------------------------------------------------------------
 // LLPolyMorphTargetInfo()
 //-----------------------------------------------------------------------------
@@ -478,6 +504,139 @@ F32	LLPolyMorphTarget::getMaxDistortion()
 	}
 }
 
+#if LL_VECTORIZE
+
+inline void gather_vec3(const LLVector3* vecs, const U32* indices, __m128& x, __m128& y, __m128& z)
+{
+	const F32* a = vecs[indices[0]].mV;
+	const F32* b = vecs[indices[1]].mV;
+	const F32* c = vecs[indices[2]].mV;
+	const F32* d = vecs[indices[3]].mV;
+	x = _mm_setr_ps(a[VX], b[VX], c[VX], d[VX]);
+	y = _mm_setr_ps(a[VY], b[VY], c[VY], d[VY]);
+	z = _mm_setr_ps(a[VZ], b[VZ], c[VZ], d[VZ]);
+}
+
+inline void scatter_vec3(LLVector3* vecs, const U32* indices, const __m128& x, const __m128& y, const __m128& z)
+{
+	F32 xs[4], ys[4], zs[4];
+	_mm_storeu_ps(xs, x);
+	_mm_storeu_ps(ys, y);
+	_mm_storeu_ps(zs, z);
+	for (U32 lane = 0; lane < 4; lane++)
+	{
+		vecs[indices[lane]].setVec(xs[lane], ys[lane], zs[lane]);
+	}
+}
+
+// four LLVector3::normVec() calls at once
+inline void normalize_vec3(__m128& x, __m128& y, __m128& z)
+{
+	__m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+	__m128 valid = _mm_cmpgt_ps(mag, _mm_set1_ps(FP_MAG_THRESHOLD));
+	__m128 oomag = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.f), mag), valid);
+	x = _mm_mul_ps(x, oomag);
+	y = _mm_mul_ps(y, oomag);
+	z = _mm_mul_ps(z, oomag);
+}
+
+// a % b four at a time
+inline void cross_vec3(const __m128& ax, const __m128& ay, const __m128& az,
+					   const __m128& bx, const __m128& by, const __m128& bz,
+					   __m128& x, __m128& y, __m128& z)
+{
+	x = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(by, az));
+	y = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(bz, ax));
+	z = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(bx, ay));
+}
+
+// Applies the whole blocks of a morph, see LLPolyMorphTarget::apply() for
+// the scalar version of the same loop.
+static void apply_delta_blocks(const LLPolyMorphData::delta_block_list_t& blocks,
+							   F32 delta_weight,
+							   const F32* mask_weights,
+							   LLVector3* coords,
+							   LLVector3* scaled_normals,
+							   LLVector3* normals,
+							   LLVector3* scaled_binormals,
+							   LLVector3* binormals,
+							   LLVector4* clothing_weights,
+							   LLVector2* tex_coords)
+{
+	const __m128 delta = _mm_set1_ps(delta_weight);
+	F32 mask[4] = { 1.f, 1.f, 1.f, 1.f };
+	F32 offset[3][4];
+	for (U32 b = 0, b_end = blocks.size(); b < b_end; b++)
+	{
+		const LLPolyMorphData::DeltaBlock& block = blocks[b];
+		const U32* indices = block.mVertexIndices;
+
+		if (mask_weights)
+		{
+			memcpy(mask, mask_weights + b * 4, sizeof(mask));
+		}
+		const __m128 scale = _mm_mul_ps(delta, _mm_loadu_ps(mask));
+
+		__m128 x, y, z;
+
+		// coords
+		__m128 dx = _mm_mul_ps(_mm_loadu_ps(block.mCoords[VX]), scale);
+		__m128 dy = _mm_mul_ps(_mm_loadu_ps(block.mCoords[VY]), scale);
+		__m128 dz = _mm_mul_ps(_mm_loadu_ps(block.mCoords[VZ]), scale);
+		gather_vec3(coords, indices, x, y, z);
+		scatter_vec3(coords, indices, _mm_add_ps(x, dx), _mm_add_ps(y, dy), _mm_add_ps(z, dz));
+
+		if (clothing_weights)
+		{
+			_mm_storeu_ps(offset[VX], dx);
+			_mm_storeu_ps(offset[VY], dy);
+			_mm_storeu_ps(offset[VZ], dz);
+			for (U32 lane = 0; lane < 4; lane++)
+			{
+				LLVector4* clothing_weight = &clothing_weights[indices[lane]];
+				clothing_weight->mV[VX] += offset[VX][lane];
+				clothing_weight->mV[VY] += offset[VY][lane];
+				clothing_weight->mV[VZ] += offset[VZ][lane];
+				clothing_weight->mV[VW] = mask[lane];
+			}
+		}
+
+		// calculate new normals based on half angles
+		__m128 nx, ny, nz;
+		gather_vec3(scaled_normals, indices, nx, ny, nz);
+		nx = _mm_add_ps(nx, _mm_mul_ps(_mm_loadu_ps(block.mNormals[VX]), scale));
+		ny = _mm_add_ps(ny, _mm_mul_ps(_mm_loadu_ps(block.mNormals[VY]), scale));
+		nz = _mm_add_ps(nz, _mm_mul_ps(_mm_loadu_ps(block.mNormals[VZ]), scale));
+		scatter_vec3(scaled_normals, indices, nx, ny, nz);
+		normalize_vec3(nx, ny, nz);
+		scatter_vec3(normals, indices, nx, ny, nz);
+
+		// calculate new binormals
+		__m128 bx, by, bz;
+		gather_vec3(scaled_binormals, indices, bx, by, bz);
+		bx = _mm_add_ps(bx, _mm_mul_ps(_mm_loadu_ps(block.mBinormals[VX]), scale));
+		by = _mm_add_ps(by, _mm_mul_ps(_mm_loadu_ps(block.mBinormals[VY]), scale));
+		bz = _mm_add_ps(bz, _mm_mul_ps(_mm_loadu_ps(block.mBinormals[VZ]), scale));
+		scatter_vec3(scaled_binormals, indices, bx, by, bz);
+		__m128 tx, ty, tz;
+		cross_vec3(bx, by, bz, nx, ny, nz, tx, ty, tz);
+		cross_vec3(nx, ny, nz, tx, ty, tz, x, y, z);
+		normalize_vec3(x, y, z);
+		scatter_vec3(binormals, indices, x, y, z);
+
+		_mm_storeu_ps(offset[VX], _mm_mul_ps(_mm_loadu_ps(block.mTexCoords[VX]), scale));
+		_mm_storeu_ps(offset[VY], _mm_mul_ps(_mm_loadu_ps(block.mTexCoords[VY]), scale));
+		for (U32 lane = 0; lane < 4; lane++)
+		{
+			LLVector2& tex_coord = tex_coords[indices[lane]];
+			tex_coord.mV[VX] += offset[VX][lane];
+			tex_coord.mV[VY] += offset[VY][lane];
+		}
+	}
+}
+
+#endif // LL_VECTORIZE
+
 //-----------------------------------------------------------------------------
 // apply()
 //-----------------------------------------------------------------------------
@@ -521,7 +680,26 @@ void LLPolyMorphTarget::apply( ESex avatar_sex )
 
 		F32 *maskWeightArray = (mVertMask) ? mVertMask->getMorphMaskWeights() : NULL;
 
-		for(U32 vert_index_morph = 0; vert_index_morph < mMorphData->mNumIndices; vert_index_morph++)
+		if (!getInfo()->mIsClothingMorph)
+		{
+			clothing_weights = NULL;
+		}
+
+		U32 vert_index_morph = 0;
+#if LL_VECTORIZE
+		// four vertices at a time from the SoA deltas, whatever is left
+		// over goes through the loop below
+		const LLPolyMorphData::delta_block_list_t& blocks = mMorphData->getDeltaBlocks();
+		if (!blocks.empty())
+		{
+			apply_delta_blocks(blocks, delta_weight, maskWeightArray,
+							   coords, scaled_normals, normals, scaled_binormals, binormals,
+							   clothing_weights, tex_coords);
+			vert_index_morph = blocks.size() * 4;
+		}
+#endif
+
+		for(; vert_index_morph < mMorphData->mNumIndices; vert_index_morph++)
 		{
 			S32 vert_index_mesh = mMorphData->mVertexIndices[vert_index_morph];
 
@@ -532,7 +710,7 @@ void LLPolyMorphTarget::apply( ESex avatar_sex )
 			}
 
 			coords[vert_index_mesh] += mMorphData->mCoords[vert_index_morph] * delta_weight * maskWeight;
-			if (getInfo()->mIsClothingMorph && clothing_weights)
+			if (clothing_weights)
 			{
 				LLVector3 clothing_offset = mMorphData->mCoords[vert_index_morph] * delta_weight * maskWeight;
 				LLVector4* clothing_weight = &clothing_weights[vert_index_mesh];
@@ -625,6 +803,7 @@ void	LLPolyMorphTarget::applyMask(U8 *maskTextureData, S32 width, S32 height, S3
 
 	// set last weight to 0, since we've removed the effect of this morph
 	mLastWeight = 0.f;
+	markDirty();
 
 	mVertMask->generateMask(maskTextureData, width, height, num_components, invert, clothing_weights);
 
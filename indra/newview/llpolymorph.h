@@ -51,6 +51,24 @@ public:
 	BOOL			loadBinary(LLFILE* fp, LLPolyMeshSharedData *mesh);
 	const std::string& getName() { return mName; }
 
+	// Four morph entries regrouped as structure of arrays for
+	// LLPolyMorphTarget::apply().  Normal and binormal deltas have
+	// NORMAL_SOFTEN_FACTOR folded in.
+	struct DeltaBlock
+	{
+		F32				mCoords[3][4];
+		F32				mNormals[3][4];
+		F32				mBinormals[3][4];
+		F32				mTexCoords[2][4];
+		U32				mVertexIndices[4];
+	};
+	typedef std::vector<DeltaBlock> delta_block_list_t;
+
+	// Built on first use, cloned morphs rewrite mCoords after construction.
+	// Only covers whole blocks, the last (mNumIndices % 4) entries are left
+	// to the arrays below.  Empty if a block would touch a vertex twice.
+	const delta_block_list_t& getDeltaBlocks();
+
 public:
 	std::string			mName;
 
@@ -67,6 +85,10 @@ public:
 	F32					mMaxDistortion;		// maximum single vertex distortion in a given morph
 	LLVector3			mAvgDistortion;		// average vertex distortion, to infer directionality of the morph
 	LLPolyMeshSharedData*	mMesh;
+
+private:
+	delta_block_list_t	mDeltaBlocks;
+	BOOL				mDeltaBlocksBuilt;
 };
 
 //-----------------------------------------------------------------------------
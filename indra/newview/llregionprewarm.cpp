@@ -0,0 +1,355 @@
+/** 
+ * @file llregionprewarm.cpp
+ * @brief Background loading for the neighbor regions the agent is heading toward
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+  
+#include "llviewerprecompiledheaders.h"
+
+#include "llregionprewarm.h"
+
+#include <set>
+
+#include "llagent.h"
+#include "llappviewer.h"
+#include "llviewercontrol.h"
+#include "llviewerobjectlist.h"
+#include "llviewerregion.h"
+#include "llviewerstats.h"
+#include "llviewertexture.h"
+#include "llvoavatarself.h"
+#include "llworld.h"
+
+// Reads running at the same time
+static const S32 MAX_CACHE_READS = 2;
+// Below that speed we're not heading anywhere
+static const F32 MIN_PREWARM_SPEED = 2.f;			// meters per second
+// Points along the predicted path looked at to find the next region
+static const S32 PREDICTION_STEPS = 4;
+// Prefetched textures are kept at about that size
+static const F32 PREFETCH_VIRTUAL_SIZE = 64.f * 64.f;
+static const S32 PREFETCH_TEXTURE_BYTES = 64 * 64 * 4;
+// How often the textures of the target region are gathered again as its objects come in
+static const F32 PREFETCH_GATHER_PERIOD = 2.f;		// seconds
+// The hitch is the longest frame in that long after a crossing
+static const F32 CROSSING_HITCH_PERIOD = 2.f;		// seconds
+
+//-----------------------------------------------------------------------------
+// LLRegionPrewarm::CacheReader
+//-----------------------------------------------------------------------------
+
+LLRegionPrewarm::CacheReader::CacheReader(const std::string& filename, const LLUUID& cache_id) :
+	mFilename(filename),
+	mCacheID(cache_id),
+	mSuccess(FALSE),
+	mDone(0)
+{
+}
+
+LLRegionPrewarm::CacheReader::~CacheReader()
+{
+	for (LLVOCacheEntry::vocache_entry_map_t::iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+	{
+		delete iter->second;
+	}
+}
+
+bool LLRegionPrewarm::CacheReader::run()
+{
+	// The global APR file pool is the thread safe one
+	mSuccess = LLVOCache::readCacheFile(mFilename, mCacheID, mEntries, NULL);
+	return true;
+}
+
+void LLRegionPrewarm::CacheReader::completed(bool success)
+{
+	mDone = 1;
+}
+
+//-----------------------------------------------------------------------------
+// LLRegionPrewarm
+//-----------------------------------------------------------------------------
+
+LLRegionPrewarm::LLRegionPrewarm() :
+	mBytesInFlight(0),
+	mTargetHandle(0),
+	mPrefetchHandle(0),
+	mAgentRegionHandle(0),
+	mCrossingHitch(-1.f),
+	mCrossingCount(0)
+{
+}
+
+LLRegionPrewarm::~LLRegionPrewarm()
+{
+	// Readers still queued are released by the thread
+}
+
+bool LLRegionPrewarm::loadObjectCache(LLViewerRegion* regionp)
+{
+	if (!gSavedSettings.getBOOL("RegionPrewarm") || !LLVOCache::hasInstance())
+	{
+		return false;
+	}
+
+	CacheRead read;
+	read.mHandle = regionp->getHandle();
+	read.mCacheID = regionp->getCacheID();
+	if (!LLVOCache::getInstance()->getCacheFileToRead(read.mHandle, read.mFilename))
+	{
+		// Nothing to read
+		return false;
+	}
+	read.mFileSize = LLAPRFile::size(read.mFilename);
+	mCacheReads.push_back(read);
+	return true;
+}
+
+void LLRegionPrewarm::update()
+{
+	updateTarget();
+	updateCacheReads();
+	updateTexturePrefetch();
+	updateCrossingHitch();
+}
+
+LLViewerRegion* LLRegionPrewarm::getTargetRegion() const
+{
+	return mTargetHandle ? LLWorld::getInstance()->getRegionFromHandle(mTargetHandle) : NULL;
+}
+
+void LLRegionPrewarm::updateTarget()
+{
+	mTargetHandle = 0;
+
+	LLViewerRegion* agent_regionp = gAgent.getRegion();
+	if (!agent_regionp || !isAgentAvatarValid() || !gSavedSettings.getBOOL("RegionPrewarm"))
+	{
+		return;
+	}
+
+	// When sitting, that's the velocity of what we sit on
+	LLVector3 velocity = gAgentAvatarp->getRootEdit()->getVelocity();
+	if (velocity.magVecSquared() < MIN_PREWARM_SPEED * MIN_PREWARM_SPEED)
+	{
+		return;
+	}
+
+	// Walk along the predicted path, the first region that isn't ours is where we're heading
+	static LLCachedControl<F32> lookahead(gSavedSettings, "RegionPrewarmLookahead");
+	const LLVector3d pos_global = gAgent.getPositionGlobal();
+	const LLVector3d step = LLVector3d(velocity * ((F32)lookahead / PREDICTION_STEPS));
+	for (S32 i = 1; i <= PREDICTION_STEPS; i++)
+	{
+		LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromPosGlobal(pos_global + step * (F64)i);
+		if (regionp && (regionp != agent_regionp))
+		{
+			mTargetHandle = regionp->getHandle();
+			return;
+		}
+	}
+}
+
+void LLRegionPrewarm::updateCacheReads()
+{
+	if (mCacheReads.empty())
+	{
+		return;
+	}
+	LLAppViewer::getImageCompositeThread()->update(1); // unpauses the composite thread
+
+	S32 reads_in_flight = 0;
+	for (read_list_t::iterator iter = mCacheReads.begin(); iter != mCacheReads.end(); )
+	{
+		read_list_t::iterator curiter = iter++;
+		if (curiter->mReader.isNull())
+		{
+			continue;
+		}
+		if (curiter->mReader->isDone())
+		{
+			finishCacheRead(*curiter);
+			mBytesInFlight -= curiter->mFileSize;
+			mCacheReads.erase(curiter);
+		}
+		else
+		{
+			reads_in_flight++;
+		}
+	}
+
+	// Start the reads of the target region first, then of the closest ones
+	const U64 max_bytes = (U64)gSavedSettings.getU32("RegionPrewarmMemory") * 1024 * 1024;
+	while (reads_in_flight < MAX_CACHE_READS)
+	{
+		read_list_t::iterator best = mCacheReads.end();
+		F64 best_distance = F64_MAX;
+		for (read_list_t::iterator iter = mCacheReads.begin(); iter != mCacheReads.end(); )
+		{
+			read_list_t::iterator curiter = iter++;
+			if (curiter->mReader.notNull())
+			{
+				continue;
+			}
+
+			LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromHandle(curiter->mHandle);
+			if (!regionp || !regionp->isObjectCacheLoadPending())
+			{
+				// Region went away
+				mCacheReads.erase(curiter);
+				continue;
+			}
+
+			F64 distance = (curiter->mHandle == mTargetHandle) ? -1.0 : (regionp->getCenterGlobal() - gAgent.getPositionGlobal()).magVecSquared();
+			if (distance < best_distance)
+			{
+				best = curiter;
+				best_distance = distance;
+			}
+		}
+
+		if (best == mCacheReads.end() ||
+			(reads_in_flight && ((U64)(mBytesInFlight + best->mFileSize) > max_bytes)))
+		{
+			break;
+		}
+
+		best->mReader = new CacheReader(best->mFilename, best->mCacheID);
+		LLAppViewer::getImageCompositeThread()->runJob(best->mReader,
+			(best->mHandle == mTargetHandle) ? LLQueuedThread::PRIORITY_HIGH : LLQueuedThread::PRIORITY_NORMAL);
+		mBytesInFlight += best->mFileSize;
+		reads_in_flight++;
+	}
+}
+
+void LLRegionPrewarm::finishCacheRead(CacheRead& read)
+{
+	LLVOCacheEntry::vocache_entry_map_t& entries = read.mReader->getEntries();
+	if (LLVOCache::hasInstance())
+	{
+		LLVOCache::getInstance()->readDone(read.mHandle, read.mReader->getSuccess(), entries);
+	}
+
+	LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromHandle(read.mHandle);
+	if (regionp && regionp->isObjectCacheLoadPending())
+	{
+		if (regionp->getCacheID() == read.mCacheID)
+		{
+			regionp->setObjectCache(entries);
+		}
+		else
+		{
+			// Not this region's cache after all, start it empty
+			LLVOCacheEntry::vocache_entry_map_t no_entries;
+			regionp->setObjectCache(no_entries);
+		}
+	}
+}
+
+void LLRegionPrewarm::updateTexturePrefetch()
+{
+	LLViewerRegion* regionp = getTargetRegion();
+	if (!regionp)
+	{
+		mPrefetchTextures.clear();
+		mPrefetchHandle = 0;
+		return;
+	}
+
+	if ((mPrefetchHandle != mTargetHandle) || (mPrefetchTimer.getElapsedTimeF32() > PREFETCH_GATHER_PERIOD))
+	{
+		gatherPrefetchTextures(regionp);
+	}
+
+	for (std::vector<LLPointer<LLViewerFetchedTexture> >::iterator iter = mPrefetchTextures.begin();
+		 iter != mPrefetchTextures.end(); ++iter)
+	{
+		(*iter)->addTextureStats(PREFETCH_VIRTUAL_SIZE);
+	}
+}
+
+void LLRegionPrewarm::gatherPrefetchTextures(LLViewerRegion* regionp)
+{
+	mPrefetchTextures.clear();
+	mPrefetchHandle = regionp->getHandle();
+	mPrefetchTimer.reset();
+
+	// Share the memory budget with the cache reads
+	const S64 max_bytes = (S64)gSavedSettings.getU32("RegionPrewarmMemory") * 1024 * 1024 - mBytesInFlight;
+	const S32 max_textures = (S32)llmax((S64)0, max_bytes / PREFETCH_TEXTURE_BYTES);
+
+	std::set<LLViewerFetchedTexture*> seen;
+	const S32 num_objects = gObjectList.getNumObjects();
+	for (S32 i = 0; (i < num_objects) && ((S32)mPrefetchTextures.size() < max_textures); i++)
+	{
+		LLViewerObject* objectp = gObjectList.getObject(i);
+		if (!objectp || objectp->isDead() || (objectp->getRegion() != regionp))
+		{
+			continue;
+		}
+
+		for (U8 te = 0; (te < objectp->getNumTEs()) && ((S32)mPrefetchTextures.size() < max_textures); te++)
+		{
+			LLViewerFetchedTexture* imagep = LLViewerTextureManager::staticCastToFetchedTexture(objectp->getTEImage(te));
+			if (imagep && seen.insert(imagep).second)
+			{
+				mPrefetchTextures.push_back(imagep);
+			}
+		}
+	}
+}
+
+void LLRegionPrewarm::updateCrossingHitch()
+{
+	LLViewerRegion* regionp = gAgent.getRegion();
+	U64 handle = regionp ? regionp->getHandle() : 0;
+	if (handle != mAgentRegionHandle)
+	{
+		// Teleports aren't crossings
+		if (mAgentRegionHandle && handle && (gAgent.getTeleportState() == LLAgent::TELEPORT_NONE))
+		{
+			mCrossingHitch = 0.f;
+			mCrossingTimer.reset();
+		}
+		mAgentRegionHandle = handle;
+	}
+
+	if (mCrossingHitch < 0.f)
+	{
+		return;
+	}
+
+	mCrossingHitch = llmax(mCrossingHitch, gFrameIntervalSeconds);
+	if (mCrossingTimer.getElapsedTimeF32() > CROSSING_HITCH_PERIOD)
+	{
+		++mCrossingCount;
+		LLViewerStats* stats = LLViewerStats::getInstance();
+		F64 avg = (mCrossingCount == 1) ? 0 : stats->getStat(LLViewerStats::ST_CROSSING_HITCH_AVG);
+		stats->setStat(LLViewerStats::ST_CROSSING_HITCH_AVG, (mCrossingHitch + avg * (mCrossingCount - 1)) / mCrossingCount);
+		F64 max = (mCrossingCount == 1) ? 0 : stats->getStat(LLViewerStats::ST_CROSSING_HITCH_MAX);
+		stats->setStat(LLViewerStats::ST_CROSSING_HITCH_MAX, llmax((F64)mCrossingHitch, max));
+
+		LL_DEBUGS("RegionPrewarm") << "Region crossing hitch: longest frame " << mCrossingHitch * 1000.f << " ms" << LL_ENDL;
+		mCrossingHitch = -1.f;
+	}
+}
@@ -0,0 +1,125 @@
+/** 
+ * @file llregionprewarm.h
+ * @brief Background loading for the neighbor regions the agent is heading toward
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+   
+#ifndef LL_LLREGIONPREWARM_H
+#define LL_LLREGIONPREWARM_H
+
+#include <list>
+#include <vector>
+
+#include "llframetimer.h"
+#include "llimageworker.h"
+#include "llpointer.h"
+#include "llsingleton.h"
+#include "llvocache.h"
+
+class LLViewerFetchedTexture;
+class LLViewerRegion;
+
+// LLRegionPrewarm : gets neighbor regions ready before the agent crosses into them.
+// - Object caches of neighbors are read and deserialized on the image composite thread
+//   instead of when the region handshake comes in. The handshake reply, which lets the
+//   simulator start sending objects, goes out once the read completes.
+//   Reads for the region the agent is heading toward go first.
+// - The region the agent is heading toward is predicted from the agent's (or vehicle's)
+//   velocity. Low resolution versions of its object textures are kept loaded, and its
+//   terrain patches are updated before the other regions'.
+// - Reads in flight and prefetched textures are kept under RegionPrewarmMemory MB.
+// - The longest frame in the couple of seconds following a region crossing is
+//   recorded in LLViewerStats (ST_CROSSING_HITCH_AVG and ST_CROSSING_HITCH_MAX).
+class LLRegionPrewarm : public LLSingleton<LLRegionPrewarm>
+{
+public:
+	LLRegionPrewarm();
+	~LLRegionPrewarm();
+
+	// Queues a background read of the region's object cache, LLViewerRegion::setObjectCache()
+	// is called when it's done. Returns false if the cache should be read right away instead.
+	bool loadObjectCache(LLViewerRegion* regionp);
+
+	// Call once per frame
+	void update();
+
+	// The neighbor the agent is heading toward, NULL if none
+	LLViewerRegion* getTargetRegion() const;
+
+private:
+	// Reads an object cache file on the image composite thread
+	class CacheReader : public LLImageCompositeThread::Job
+	{
+	protected:
+		~CacheReader();
+
+	public:
+		CacheReader(const std::string& filename, const LLUUID& cache_id);
+
+		/*virtual*/ bool run();
+		/*virtual*/ void completed(bool success);
+
+		BOOL isDone()									{ return mDone != 0; }
+		BOOL getSuccess() const							{ return mSuccess; }
+		LLVOCacheEntry::vocache_entry_map_t& getEntries()	{ return mEntries; }
+
+	private:
+		const std::string					mFilename;
+		const LLUUID						mCacheID;
+		LLVOCacheEntry::vocache_entry_map_t	mEntries;	// Whatever isn't handed over is deleted with the reader
+		BOOL								mSuccess;
+		LLAtomicU32							mDone;
+	};
+
+	struct CacheRead
+	{
+		U64						mHandle;
+		LLUUID					mCacheID;
+		std::string				mFilename;
+		S32						mFileSize;
+		LLPointer<CacheReader>	mReader;	// NULL until started
+	};
+	typedef std::list<CacheRead> read_list_t;
+
+	void updateTarget();
+	void updateCacheReads();
+	void finishCacheRead(CacheRead& read);
+	void updateTexturePrefetch();
+	void gatherPrefetchTextures(LLViewerRegion* regionp);
+	void updateCrossingHitch();
+
+	read_list_t		mCacheReads;
+	S32				mBytesInFlight;		// Size of the cache files being read
+
+	U64				mTargetHandle;		// 0 if not heading to a neighbor
+	U64				mPrefetchHandle;	// Region mPrefetchTextures were gathered for
+	std::vector<LLPointer<LLViewerFetchedTexture> > mPrefetchTextures;
+	LLFrameTimer	mPrefetchTimer;		// Since mPrefetchTextures were gathered
+
+	U64				mAgentRegionHandle;
+	LLFrameTimer	mCrossingTimer;		// Since the last crossing
+	F32				mCrossingHitch;		// Longest frame since the last crossing, negative when not measuring
+	S32				mCrossingCount;
+};
+
+#endif // LL_LLREGIONPREWARM_H
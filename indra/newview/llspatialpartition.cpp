@@ -691,6 +691,7 @@ void LLSpatialPartition::rebuildGeom(LLSpatialGroup* group)
 	{
 		group->mVertexBuffer = NULL;
 		group->mBufferMap.clear();
+		LLGeomBatchPool::release(group->mBatchRanges);
 	}
 
 	group->mLastUpdateTime = gFrameTimeSeconds;
@@ -1155,6 +1156,8 @@ LLSpatialGroup::LLSpatialGroup(OctreeNode* node, LLSpatialPartition* part) :
 	mBufferUsage(GL_STATIC_DRAW_ARB),
 	mDistance(0.f),
 	mDepth(0.f),
+	mAlphaSortRank(0),
+	mAlphaSortFrame(0),
 	mLastUpdateDistance(-1.f), 
 	mLastUpdateTime(gFrameTimeSeconds),
 	mViewAngle(0.f),
@@ -1360,6 +1363,7 @@ void LLSpatialGroup::handleDestruction(const TreeNode* node)
 	clearDrawMap();
 	mVertexBuffer = NULL;
 	mBufferMap.clear();
+	LLGeomBatchPool::release(mBatchRanges);
 	sZombieGroups++;
 	mOctreeNode = NULL;
 }
@@ -1406,6 +1410,7 @@ void LLSpatialGroup::destroyGL()
 	mBufferMap.clear();
 
 	clearDrawMap();
+	LLGeomBatchPool::release(mBatchRanges);
 
 	for (U32 i = 0; i < LLViewerCamera::NUM_CAMERAS; i++)
 	{
@@ -3609,6 +3614,188 @@ void LLCullResult::pushAlphaGroup(LLSpatialGroup* group)
 	mAlphaGroupsEnd = mAlphaGroups.begin()+mAlphaGroupsSize;
 }
 
+//sort key for an alpha group: 24 bits of quantized depth, ordered far to near
+static inline U32 alpha_sort_key(F32 depth)
+{
+	U32 bits;
+	memcpy(&bits, &depth, sizeof(U32));
+	//flip so the unsigned order of the bits matches the float order
+	bits = (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+	//invert for descending order, drop low mantissa bits so 3 radix passes cover the key
+	return (~bits) >> 8;
+}
+
+static const U32 ALPHA_SORT_RADIX_BITS = 8;
+static const U32 ALPHA_SORT_RADIX = 1 << ALPHA_SORT_RADIX_BITS;
+static const U32 ALPHA_SORT_PASSES = 3;
+
+void LLCullResult::radixSortAlphaGroups()
+{
+	U32 count = mAlphaGroupsSize;
+
+	mAlphaSortKeysTmp.resize(count);
+	mAlphaSortTmp.resize(count);
+
+	//build all histograms in one pass over the keys
+	U32 histogram[ALPHA_SORT_PASSES][ALPHA_SORT_RADIX];
+	memset(histogram, 0, sizeof(histogram));
+
+	for (U32 i = 0; i < count; ++i)
+	{
+		U32 key = mAlphaSortKeys[i];
+		for (U32 pass = 0; pass < ALPHA_SORT_PASSES; ++pass)
+		{
+			histogram[pass][(key >> (pass*ALPHA_SORT_RADIX_BITS)) & (ALPHA_SORT_RADIX-1)]++;
+		}
+	}
+
+	U32* keys = &mAlphaSortKeys[0];
+	U32* keys_tmp = &mAlphaSortKeysTmp[0];
+	LLSpatialGroup** groups = &mAlphaGroups[0];
+	LLSpatialGroup** groups_tmp = &mAlphaSortTmp[0];
+
+	for (U32 pass = 0; pass < ALPHA_SORT_PASSES; ++pass)
+	{
+		U32 shift = pass*ALPHA_SORT_RADIX_BITS;
+		U32* bucket = histogram[pass];
+
+		if (bucket[(keys[0] >> shift) & (ALPHA_SORT_RADIX-1)] == count)
+		{ //every key shares this digit, pass would not move anything
+			continue;
+		}
+
+		U32 offset = 0;
+		for (U32 i = 0; i < ALPHA_SORT_RADIX; ++i)
+		{
+			U32 n = bucket[i];
+			bucket[i] = offset;
+			offset += n;
+		}
+
+		for (U32 i = 0; i < count; ++i)
+		{
+			U32 dst = bucket[(keys[i] >> shift) & (ALPHA_SORT_RADIX-1)]++;
+			keys_tmp[dst] = keys[i];
+			groups_tmp[dst] = groups[i];
+		}
+
+		std::swap(keys, keys_tmp);
+		std::swap(groups, groups_tmp);
+	}
+
+	if (groups != &mAlphaGroups[0])
+	{ //odd number of passes ran, result is in the scratch list
+		memcpy(&mAlphaGroups[0], groups, sizeof(LLSpatialGroup*)*count);
+	}
+}
+
+BOOL LLCullResult::insertionSortAlphaGroups(U32 max_moves)
+{
+	U32 moves = 0;
+	for (U32 i = 1; i < mAlphaGroupsSize; ++i)
+	{
+		U32 key = mAlphaSortKeys[i];
+		LLSpatialGroup* group = mAlphaGroups[i];
+
+		U32 j = i;
+		while (j > 0 && mAlphaSortKeys[j-1] > key)
+		{
+			mAlphaSortKeys[j] = mAlphaSortKeys[j-1];
+			mAlphaGroups[j] = mAlphaGroups[j-1];
+			--j;
+		}
+		mAlphaSortKeys[j] = key;
+		mAlphaGroups[j] = group;
+
+		moves += i-j;
+		if (moves > max_moves)
+		{ //order changed too much since last frame, leave the rest to the radix sort
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static LLFastTimer::DeclareTimer FTM_ALPHA_SORT("Alpha Sort");
+
+//sort alpha groups back to front
+void LLCullResult::sortAlphaGroups(const LLCamera& camera)
+{
+	LLFastTimer t(FTM_ALPHA_SORT);
+
+	U32 count = mAlphaGroupsSize;
+	if (count < 2)
+	{
+		return;
+	}
+
+	static U32 last_frame = 0;
+	static U32 last_count = 0;
+	static LLVector3 last_origin;
+	static LLVector3 last_at;
+
+	BOOL world = LLViewerCamera::sCurCameraID == LLViewerCamera::CAMERA_WORLD;
+	U32 frame = LLFrameTimer::getFrameCount();
+
+	BOOL coherent = world &&
+		frame - last_frame <= 1 &&
+		(camera.getOrigin()-last_origin).magVecSquared() < 0.25f &&
+		camera.getAtAxis()*last_at > 0.99f;
+
+	if (coherent)
+	{ //camera barely moved, start from last frame's order so only a few groups are out of place
+		mAlphaSortTmp.assign(last_count, NULL);
+		for (U32 i = 0; i < count; ++i)
+		{
+			LLSpatialGroup* group = mAlphaGroups[i];
+			if (group->mAlphaSortFrame == last_frame && group->mAlphaSortRank < last_count &&
+				!mAlphaSortTmp[group->mAlphaSortRank])
+			{
+				mAlphaSortTmp[group->mAlphaSortRank] = group;
+			}
+			else
+			{ //newly visible, goes at the end
+				mAlphaSortTmp.push_back(group);
+			}
+		}
+
+		U32 idx = 0;
+		for (U32 i = 0; i < mAlphaSortTmp.size(); ++i)
+		{
+			if (mAlphaSortTmp[i])
+			{
+				mAlphaGroups[idx++] = mAlphaSortTmp[i];
+			}
+		}
+		llassert(idx == count);
+	}
+
+	mAlphaSortKeys.resize(count);
+	for (U32 i = 0; i < count; ++i)
+	{
+		mAlphaSortKeys[i] = alpha_sort_key(mAlphaGroups[i]->mDepth);
+	}
+
+	if (!coherent || !insertionSortAlphaGroups(count*4))
+	{
+		radixSortAlphaGroups();
+	}
+
+	if (world)
+	{
+		for (U32 i = 0; i < count; ++i)
+		{
+			mAlphaGroups[i]->mAlphaSortRank = i;
+			mAlphaGroups[i]->mAlphaSortFrame = frame;
+		}
+		last_frame = frame;
+		last_count = count;
+		last_origin = camera.getOrigin();
+		last_at = camera.getAtAxis();
+	}
+}
+
 void LLCullResult::pushOcclusionGroup(LLSpatialGroup* group)
 {
 	if (mOcclusionGroupsSize < mOcclusionGroups.size())
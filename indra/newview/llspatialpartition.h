@@ -39,6 +39,7 @@
 #include "lldrawpool.h"
 #include "llface.h"
 #include "llviewercamera.h"
+#include "llgeombatch.h"
 
 #include <queue>
 
@@ -118,12 +119,30 @@ public:
 	};
 
 	struct CompareTexturePtrMatrix
-	{
+	{ //sort by texture, then matrix, then buffer range so adjacent ranges of batch buffers end up next to each other
 		bool operator()(const LLPointer<LLDrawInfo>& lhs, const LLPointer<LLDrawInfo>& rhs)	
 		{
-			return lhs.get() != rhs.get() 
-						&& (lhs.isNull() || (rhs.notNull() && (lhs->mTexture.get() > rhs->mTexture.get() ||
-															   (lhs->mTexture.get() == rhs->mTexture.get() && lhs->mModelMatrix > rhs->mModelMatrix))));
+			if (lhs.get() == rhs.get() || rhs.isNull())
+			{
+				return false;
+			}
+			if (lhs.isNull())
+			{
+				return true;
+			}
+			if (lhs->mTexture.get() != rhs->mTexture.get())
+			{
+				return lhs->mTexture.get() > rhs->mTexture.get();
+			}
+			if (lhs->mModelMatrix != rhs->mModelMatrix)
+			{
+				return lhs->mModelMatrix > rhs->mModelMatrix;
+			}
+			if (lhs->mVertexBuffer.get() != rhs->mVertexBuffer.get())
+			{
+				return lhs->mVertexBuffer.get() > rhs->mVertexBuffer.get();
+			}
+			return lhs->mOffset < rhs->mOffset;
 		}
 
 	};
@@ -334,6 +353,7 @@ protected:
 public:
 	bridge_list_t mBridgeList;
 	buffer_map_t mBufferMap; //used by volume buffers to store unique buffers per texture
+	LLGeomBatchPool::range_list_t mBatchRanges; //ranges of partition batch buffers this group's geometry lives in
 
 	F32 mBuilt;
 	OctreeNode* mOctreeNode;
@@ -354,6 +374,8 @@ public:
 	S32 mVisible[LLViewerCamera::NUM_CAMERAS];
 	F32 mDistance;
 	F32 mDepth;
+	U32 mAlphaSortRank; //position in the last world camera alpha sort, seeds the next one
+	U32 mAlphaSortFrame;
 	F32 mLastUpdateDistance;
 	F32 mLastUpdateTime;
 			
@@ -417,7 +439,7 @@ public:
 	void renderDebug();
 	void renderIntersectingBBoxes(LLCamera* camera);
 	void restoreGL();
-	void resetVertexBuffers();
+	virtual void resetVertexBuffers();
 	BOOL isOcclusionEnabled();
 	BOOL getVisibleExtents(LLCamera& camera, LLVector3& visMin, LLVector3& visMax);
 
@@ -501,6 +523,7 @@ public:
 
 	void pushVisibleGroup(LLSpatialGroup* group);
 	void pushAlphaGroup(LLSpatialGroup* group);
+	void sortAlphaGroups(const LLCamera& camera);
 	void pushOcclusionGroup(LLSpatialGroup* group);
 	void pushDrawableGroup(LLSpatialGroup* group);
 	void pushDrawable(LLDrawable* drawable);
@@ -517,6 +540,9 @@ public:
 	void assertDrawMapsEmpty();
 
 private:
+	void radixSortAlphaGroups();
+	BOOL insertionSortAlphaGroups(U32 max_moves);
+
 	U32					mVisibleGroupsSize;
 	U32					mAlphaGroupsSize;
 	U32					mOcclusionGroupsSize;
@@ -539,6 +565,11 @@ private:
 	bridge_list_t::iterator mVisibleBridgeEnd;
 	drawinfo_list_t		mRenderMap[LLRenderPass::NUM_RENDER_TYPES];
 	drawinfo_list_t::iterator mRenderMapEnd[LLRenderPass::NUM_RENDER_TYPES];
+
+	//scratch space for sortAlphaGroups, kept around to avoid reallocating every frame
+	std::vector<U32>	mAlphaSortKeys;
+	std::vector<U32>	mAlphaSortKeysTmp;
+	sg_list_t			mAlphaSortTmp;
 };
 
 
@@ -619,6 +650,7 @@ class LLVolumeGeometryManager: public LLGeometryManager
 	virtual void getGeometry(LLSpatialGroup* group);
 	void genDrawInfo(LLSpatialGroup* group, U32 mask, std::vector<LLFace*>& faces, BOOL distance_sort = FALSE);
 	void registerFace(LLSpatialGroup* group, LLFace* facep, U32 type);
+	virtual LLGeomBatchPool* getBatchPool() { return NULL; }
 };
 
 //spatial partition that uses volume geometry manager (implemented in LLVOVolume.cpp)
@@ -630,6 +662,12 @@ public:
 	virtual void getGeometry(LLSpatialGroup* group) { LLVolumeGeometryManager::getGeometry(group); }
 	virtual void rebuildMesh(LLSpatialGroup* group) { LLVolumeGeometryManager::rebuildMesh(group); }
 	virtual void addGeometryCount(LLSpatialGroup* group, U32 &vertex_count, U32& index_count) { LLVolumeGeometryManager::addGeometryCount(group, vertex_count, index_count); }
+	virtual LLGeomBatchPool* getBatchPool() { return &mBatchPool; }
+	virtual void resetVertexBuffers();
+
+private:
+	//small static geometry from different groups is packed together here (see genDrawInfo)
+	LLGeomBatchPool mBatchPool;
 };
 
 //spatial bridge that uses volume geometry manager (implemented in LLVOVolume.cpp)
@@ -43,6 +43,7 @@
 #include "llworld.h"
 #include "llviewercontrol.h"
 #include "llviewertexture.h"
+#include "llsurfacedecoder.h"
 #include "llsurfacepatch.h"
 #include "llvosurfacepatch.h"
 #include "llvowater.h"
@@ -61,6 +62,7 @@ LLColor4U MAX_WATER_COLOR(0, 48, 96, 240);
 
 
 S32 LLSurface::sTextureSize = 256;
+LLSurfaceDecoder* LLSurface::sDecoder = NULL;
 S32 LLSurface::sTexelsUpdated = 0;
 F32 LLSurface::sTextureUpdateTime = 0.f;
 
@@ -149,6 +151,13 @@ void LLSurface::initClasses()
 {
 }
 
+//static
+void LLSurface::cleanupClass()
+{
+	delete sDecoder;
+	sDecoder = NULL;
+}
+
 void LLSurface::setRegion(LLViewerRegion *regionp)
 {
 	mRegionp = regionp;
@@ -640,6 +649,16 @@ BOOL LLSurface::idleUpdate(F32 max_update_time)
 		getRegion()->dirtyHeights();
 	}
 
+	// Upload finished composites, and swap in a cached texture once the
+	// heights it depends on are all here.
+	LLVLComposition* comp = mRegionp ? mRegionp->getComposition() : NULL;
+	BOOL defer_textures = FALSE;
+	if (comp)
+	{
+		comp->updateTextures();
+		defer_textures = comp->getCacheCheckPending();
+	}
+
 	// Always call updateNormals() / updateVerticalStats()
 	//  every frame to avoid artifacts
 	for(std::set<LLSurfacePatch *>::iterator iter = mDirtyPatchList.begin();
@@ -649,6 +668,10 @@ BOOL LLSurface::idleUpdate(F32 max_update_time)
 		LLSurfacePatch *patchp = *curiter;
 		patchp->updateNormals();
 		patchp->updateVerticalStats();
+		if (defer_textures)
+		{
+			continue;
+		}
 		if (max_update_time == 0.f || update_timer.getElapsedTimeF32() < max_update_time)
 		{
 			if (patchp->updateTexture())
@@ -662,17 +685,31 @@ BOOL LLSurface::idleUpdate(F32 max_update_time)
 	return did_update;
 }
 
+static LLFastTimer::DeclareTimer FTM_DECODE_TERRAIN_PATCHES("Decode Terrain Patches");
+
 void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL b_large_patch) 
 {
+	LLFastTimer t(FTM_DECODE_TERRAIN_PATCHES);
 
 	LLPatchHeader  ph;
 	S32 j, i;
-	S32 patch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 	LLSurfacePatch *patchp;
+	BOOL bad_packet = FALSE;
+
+	if (!sDecoder)
+	{
+		sDecoder = new LLSurfaceDecoder();
+	}
+
+	// The bit stream has to be read in order, so it is unpacked here and
+	// the inverse DCTs and middle normals are left to the decoder.  A patch
+	// sent twice keeps the last copy, jobs can't share a patch.
+	static LLSurfaceDecoder::job_list_t jobs;
+	static std::vector<S32> job_index;
+	jobs.clear();
+	job_index.assign(mNumberOfPatches, -1);
 
-	init_patch_decompressor(gopp->patch_size);
 	gopp->stride = mGridsPerEdge;
-	set_group_of_patch_header(gopp);
 
 	while (1)
 	{
@@ -696,15 +733,31 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
 				<< " quant_wbits " << (S32)ph.quant_wbits
 				<< " patchids " << (S32)ph.patchids
 				<< llendl;
-            LLAppViewer::instance()->badNetworkHandler();
-			return;
+			bad_packet = TRUE;
+			break;
+		}
+
+		S32 patch_id = j*mPatchesPerEdge + i;
+		if (job_index[patch_id] < 0)
+		{
+			job_index[patch_id] = jobs.size();
+			jobs.resize(jobs.size() + 1);
 		}
 
-		patchp = &mPatchList[j*mPatchesPerEdge + i];
+		LLSurfaceDecoder::Job& job = jobs[job_index[patch_id]];
+		patchp = &mPatchList[patch_id];
+		job.mHeader = ph;
+		job.mDataZ = patchp->getDataZ();
+		job.mPatch = patchp;
+
+		decode_patch(bitpack, job.mCoefficients);
+	}
 
+	sDecoder->decode(jobs, gopp->patch_size, gopp->stride);
 
-		decode_patch(bitpack, patch);
-		decompress_patch(patchp->getDataZ(), patch, &ph);
+	for (LLSurfaceDecoder::job_list_t::iterator iter = jobs.begin(); iter != jobs.end(); ++iter)
+	{
+		patchp = iter->mPatch;
 
 		// Update edges for neighbors.  Need to guarantee that this gets done before we generate vertical stats.
 		patchp->updateNorthEdge();
@@ -726,6 +779,14 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
 		// Dirty patch statistics, and flag that the patch has data.
 		patchp->dirtyZ();
 		patchp->setHasReceivedData();
+
+		// the decoder already rebuilt the normals inside the patch
+		patchp->setMiddleNormalsValid();
+	}
+
+	if (bad_packet)
+	{
+		LLAppViewer::instance()->badNetworkHandler();
 	}
 }
 
@@ -1111,6 +1172,16 @@ void LLSurface::setTextureSize(const S32 texture_size)
 	sTextureSize = texture_size;
 }
 
+//static
+void LLSurface::setDecodeThreads(S32 num_threads)
+{
+	if (!sDecoder)
+	{
+		sDecoder = new LLSurfaceDecoder();
+	}
+	sDecoder->setMaxWorkers(LLJobPool::resolveMaxWorkers(num_threads));
+}
+
 
 U32 LLSurface::getRenderLevel(const U32 render_stride) const
 {
@@ -1150,6 +1221,38 @@ void LLSurface::dirtyAllPatches()
 	}
 }
 
+BOOL LLSurface::getHasAllPatchData() const
+{
+	for (S32 i = 0; i < mNumberOfPatches; i++)
+	{
+		if (!mPatchList[i].getHasReceivedData())
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+BOOL LLSurface::getCompositionComplete() const
+{
+	for (S32 i = 0; i < mNumberOfPatches; i++)
+	{
+		if (!mPatchList[i].getHasReceivedData() || mPatchList[i].mSTexUpdate)
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+void LLSurface::applyCachedComposition()
+{
+	for (S32 i = 0; i < mNumberOfPatches; i++)
+	{
+		mPatchList[i].applyCachedComposition();
+	}
+}
+
 void LLSurface::dirtySurfacePatch(LLSurfacePatch *patchp)
 {
 	// Put surface patch on dirty surface patch list
@@ -63,6 +63,7 @@ class LLViewerRegion;
 class LLSurfacePatch;
 class LLBitPack;
 class LLGroupHeader;
+class LLSurfaceDecoder;
 
 class LLSurface 
 {
@@ -71,6 +72,7 @@ public:
 	virtual ~LLSurface();
 
 	static void initClasses(); // Do class initialization for LLSurface and its child classes.
+	static void cleanupClass();
 
 	void create(const S32 surface_grid_width,
 				const S32 surface_patch_width,
@@ -90,6 +92,7 @@ public:
 
 	inline F32 getZ(const U32 k) const				{ return mSurfaceZ[k]; }
 	inline F32 getZ(const S32 i, const S32 j) const	{ return mSurfaceZ[i + j*mGridsPerEdge]; }
+	const F32 *getSurfaceZ() const					{ return mSurfaceZ; }
 
 	LLVector3 getOriginAgent() const;
 	const LLVector3d &getOriginGlobal() const;
@@ -132,11 +135,16 @@ public:
 	BOOL hasZData() const							{ return mHasZData; }
 
 	void dirtyAllPatches();	// Use this to dirty all patches when changing terrain parameters
+	BOOL getHasAllPatchData() const;
+	BOOL getCompositionComplete() const;	// All patches have data and an up to date texture
+	void applyCachedComposition();			// The texture and composition came from the cache
 
 	void dirtySurfacePatch(LLSurfacePatch *patchp);
 	LLVOWater *getWaterObj()						{ return mWaterObjp; }
 
 	static void setTextureSize(const S32 texture_size);
+	// most job pool workers decoding patches, negative for all of them
+	static void setDecodeThreads(S32 num_threads);
 
 	friend class LLSurfacePatch;
 	friend std::ostream& operator<<(std::ostream &s, const LLSurface &S);
@@ -222,6 +230,7 @@ protected:
 private:
 	LLViewerRegion *mRegionp; // Patch whose coordinate system this surface is using.
 	static S32	sTextureSize;				// Size of the surface texture
+	static LLSurfaceDecoder* sDecoder;		// Decompresses LayerData patches
 };
 
 
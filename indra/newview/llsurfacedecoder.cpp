@@ -0,0 +1,72 @@
+/** 
+ * @file llsurfacedecoder.cpp
+ * @brief Decodes terrain patches on worker threads
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+  
+#include "llviewerprecompiledheaders.h"
+
+#include "llsurfacedecoder.h"
+
+#include "llappviewer.h"
+#include "llsurfacepatch.h"
+
+LLSurfaceDecoder::LLSurfaceDecoder()
+:	mMaxWorkers(0),
+	mJobs(NULL),
+	mStride(0)
+{
+}
+
+void LLSurfaceDecoder::decode(job_list_t& jobs, S32 patch_size, S32 stride)
+{
+	mDecompressor.init(patch_size);
+	mJobs = &jobs;
+	mStride = stride;
+
+	LLJobPool* pool = LLAppViewer::getJobPool();
+	if (pool)
+	{
+		pool->run(*this, jobs.size(), mMaxWorkers);
+	}
+	else
+	{
+		for (U32 i = 0; i < jobs.size(); ++i)
+		{
+			run(i);
+		}
+	}
+
+	mJobs = NULL;
+}
+
+/*virtual*/
+void LLSurfaceDecoder::run(U32 index)
+{
+	Job& job = (*mJobs)[index];
+	mDecompressor.decompress(job.mDataZ, mStride, job.mCoefficients, &job.mHeader);
+	if (job.mPatch)
+	{
+		job.mPatch->updateMiddleNormals();
+	}
+}
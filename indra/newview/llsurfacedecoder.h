@@ -0,0 +1,77 @@
+/** 
+ * @file llsurfacedecoder.h
+ * @brief Decodes terrain patches on worker threads
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+  
+#ifndef LL_LLSURFACEDECODER_H
+#define LL_LLSURFACEDECODER_H
+
+#include <vector>
+
+#include "lljobpool.h"
+#include "patch_dct.h"
+
+class LLSurfacePatch;
+
+//-----------------------------------------------------------------------------
+// class LLSurfaceDecoder
+// Fork/join helper for LLSurface::decompressDCTPatch().  The bit stream is
+// unpacked on the main thread into jobs, then decode() runs the inverse DCT
+// for every job and, when the job has a patch, recomputes the normals inside
+// that patch.  The jobs run on the viewer's job pool.  The decompressor
+// tables are built on the calling thread and only read by the workers.
+// decode() returns once every job is done.
+//-----------------------------------------------------------------------------
+class LLSurfaceDecoder : public LLJobPool::Work
+{
+public:
+	struct Job
+	{
+		LLPatchHeader	mHeader;
+		S32				mCoefficients[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+		F32*			mDataZ;			// first height of the patch
+		LLSurfacePatch*	mPatch;			// may be NULL
+	};
+	typedef std::vector<Job> job_list_t;
+
+	LLSurfaceDecoder();
+
+	// patch_size and stride come from the group header, jobs must not share
+	// a patch
+	void decode(job_list_t& jobs, S32 patch_size, S32 stride);
+
+	// most job pool workers to decode with, 0 = the calling thread only
+	void setMaxWorkers(U32 max_workers) { mMaxWorkers = max_workers; }
+
+	// Implements LLJobPool::Work
+	/*virtual*/ void run(U32 index);
+
+private:
+	U32						mMaxWorkers;
+	LLPatchDecompressor		mDecompressor;
+	job_list_t*				mJobs;
+	S32						mStride;
+};
+
+#endif // LL_LLSURFACEDECODER_H
@@ -589,13 +589,7 @@ void LLSurfacePatch::updateNormals()
 	// update the middle normals
 	if (mNormalsInvalid[MIDDLE])
 	{
-		for (j=2; j < grids_per_patch_edge - 2; j++)
-		{
-			for (i=2; i < grids_per_patch_edge - 2; i++)
-			{
-				calcNormal(i, j, 2);
-			}
-		}
+		updateMiddleNormals();
 		dirty_patch = TRUE;
 	}
 
@@ -610,6 +604,31 @@ void LLSurfacePatch::updateNormals()
 	}
 }
 
+// The middle normals only sample this patch's own heights, so LLSurfaceDecoder
+// calls this from its worker threads right after decompressing the patch.
+void LLSurfacePatch::updateMiddleNormals()
+{
+	if (mSurfacep->mType == 'w')
+	{
+		return;
+	}
+	U32 grids_per_patch_edge = mSurfacep->getGridsPerPatchEdge();
+
+	U32 i, j;
+	for (j=2; j < grids_per_patch_edge - 2; j++)
+	{
+		for (i=2; i < grids_per_patch_edge - 2; i++)
+		{
+			calcNormal(i, j, 2);
+		}
+	}
+}
+
+void LLSurfacePatch::setMiddleNormalsValid()
+{
+	mNormalsInvalid[MIDDLE] = FALSE;
+}
+
 void LLSurfacePatch::updateEastEdge()
 {
 	U32 grids_per_patch_edge = mSurfacep->getGridsPerPatchEdge();
@@ -725,6 +744,12 @@ BOOL LLSurfacePatch::updateTexture()
 
 void LLSurfacePatch::updateGL()
 {
+	if (!mSTexUpdate)
+	{
+		// Already filled in from the texture cache
+		return;
+	}
+
 	F32 meters_per_grid = getSurface()->getMetersPerGrid();
 	F32 grids_per_patch_edge = (F32)getSurface()->getGridsPerPatchEdge();
 
@@ -746,6 +771,26 @@ void LLSurfacePatch::updateGL()
 	}
 }
 
+void LLSurfacePatch::applyCachedComposition()
+{
+	if (!mHasReceivedData)
+	{
+		return;
+	}
+	mHeightsGenerated = TRUE;
+	mSTexUpdate = FALSE;
+	updateCompositionStats();
+
+	F32 tex_patch_size = getSurface()->getMetersPerGrid()*(F32)getSurface()->getGridsPerPatchEdge();
+	LLVector3d origin_region = getOriginGlobal() - getSurface()->getOriginGlobal();
+	mSurfacep->generateWaterTexture((F32)origin_region.mdV[VX], (F32)origin_region.mdV[VY],
+									tex_patch_size, tex_patch_size);
+	if (mVObjp)
+	{
+		mVObjp->dirtyGeom();
+	}
+}
+
 void LLSurfacePatch::dirtyZ()
 {
 	mSTexUpdate = TRUE;
@@ -78,6 +78,8 @@ public:
 	void updateVerticalStats();
 	void updateCompositionStats();
 	void updateNormals();
+	void updateMiddleNormals();
+	void setMiddleNormalsValid(); // after updateMiddleNormals() on a worker thread
 
 	void updateEastEdge();
 	void updateNorthEdge();
@@ -85,6 +87,7 @@ public:
 	void updateCameraDistanceRegion( const LLVector3 &pos_region);
 	void updateVisibility();
 	void updateGL();
+	void applyCachedComposition(); // LLVLComposition loaded this patch's texture from the cache
 
 	void dirtyZ(); // Dirty the z values of this patch
 	void setHasReceivedData();
@@ -29,8 +29,11 @@
 #include "lltexlayer.h"
 
 #include "llagent.h"
+#include "llappviewer.h"
+#include "llimagecompositor.h"
 #include "llimagej2c.h"
 #include "llimagetga.h"
+#include "llimageworker.h"
 #include "llnotificationsutil.h"
 #include "llvfile.h"
 #include "llvfs.h"
@@ -106,6 +109,42 @@ LLBakedUploadData::LLBakedUploadData(const LLVOAvatarSelf* avatar,
 { 
 }
 
+//-----------------------------------------------------------------------------
+// LLTexLayerSetCompositeResponder
+// Receives a CPU composite from the composite thread.  LLTexLayerSetBuffer
+// polls it from render() on the main thread.
+//-----------------------------------------------------------------------------
+class LLTexLayerSetCompositeResponder : public LLImageCompositeThread::Responder
+{
+public:
+	LLTexLayerSetCompositeResponder() :
+		mDone(0)
+	{
+	}
+
+	/*virtual*/ void completed(bool success, LLImageCompositor* compositor)
+	{
+		if (success && compositor)
+		{
+			mImage = compositor->getResult();
+		}
+		mDone = 1;
+	}
+
+	BOOL isDone()					{ return mDone != 0; }
+	LLImageRaw* getImage() const	{ return mImage; } // NULL if the composite failed
+
+private:
+	LLPointer<LLImageRaw>	mImage;
+	LLAtomicU32				mDone;
+};
+
+// Local textures are only available to the CPU compositor once their raw data has been saved.
+static LLImageRaw* get_composite_source(LLViewerFetchedTexture* tex)
+{
+	return tex->hasSavedRawImage() ? tex->getSavedRawImage() : NULL;
+}
+
 //-----------------------------------------------------------------------------
 // LLTexLayerSetBuffer
 // The composite image that a LLTexLayerSet writes to.  Each LLTexLayerSet has one.
@@ -124,7 +163,10 @@ LLTexLayerSetBuffer::LLTexLayerSetBuffer(LLTexLayerSet* const owner,
 	mUploadFailCount(0),
 	mNeedsUpdate(TRUE),
 	mNumLowresUpdates(0),
-	mTexLayerSet(owner)
+	mTexLayerSet(owner),
+	mCompositeGeneration(0),
+	mPendingCompositeGeneration(0),
+	mPendingCompositeFinal(FALSE)
 {
 	LLTexLayerSetBuffer::sGLByteCount += getSize();
 	mNeedsUploadTimer.start();
@@ -170,6 +212,7 @@ void LLTexLayerSetBuffer::requestUpdate()
 	restartUpdateTimer();
 	mNeedsUpdate = TRUE;
 	mNumLowresUpdates = 0;
+	mCompositeGeneration++;
 	// If we're in the middle of uploading a baked texture, we don't care about it any more.
 	// When it's downloaded, ignore it.
 	mUploadID.setNull();
@@ -181,6 +224,7 @@ void LLTexLayerSetBuffer::requestUpload()
 	mNeedsUpload = TRUE;
 	mNumLowresUploads = 0;
 	mUploadPending = TRUE;
+	mCompositeGeneration++;
 }
 
 void LLTexLayerSetBuffer::conditionalRestartUploadTimer()
@@ -287,6 +331,34 @@ BOOL LLTexLayerSetBuffer::render()
 	// Default color mask for tex layer render
 	gGL.setColorMask(true, true);
 
+	static LLCachedControl<bool> composite_on_cpu(gSavedSettings, "AvatarBakeCompositeOnCPU");
+	bool retry_on_cpu = true;
+	if (mCompositeResponder.notNull())
+	{
+		LLAppViewer::getImageCompositeThread()->update(1); // unpauses the composite thread
+		if (!mCompositeResponder->isDone())
+		{
+			// Still compositing; leave the current texture alone.
+			return FALSE;
+		}
+
+		LLPointer<LLImageRaw> baked_image = mCompositeResponder->getImage();
+		mCompositeResponder = NULL;
+		if (baked_image.notNull()
+			&& (mPendingCompositeGeneration == mCompositeGeneration)
+			&& (mPendingCompositeFinal == mTexLayerSet->isLocalTextureDataFinal()))
+		{
+			return finishComposite(baked_image);
+		}
+		// The layers changed while we were compositing, so start over.  If the
+		// composite itself failed, fall back to GL this time.
+		retry_on_cpu = baked_image.notNull();
+	}
+	if (composite_on_cpu && retry_on_cpu && startComposite())
+	{
+		return FALSE;
+	}
+
 	// do we need to upload, and do we have sufficient data to create an uploadable composite?
 	// TODO: When do we upload the texture if gAgent.mNumPendingQueries is non-zero?
 	const BOOL upload_now = mNeedsUpload && isReadyToUpload();
@@ -301,26 +373,7 @@ BOOL LLTexLayerSetBuffer::render()
 
 	if(upload_now)
 	{
-		if (!success)
-		{
-			llinfos << "Failed attempt to bake " << mTexLayerSet->getBodyRegionName() << llendl;
-			mUploadPending = FALSE;
-		}
-		else
-		{
-			if (mTexLayerSet->isVisible())
-			{
-				mTexLayerSet->getAvatar()->debugBakedTextureUpload(mTexLayerSet->getBakedTexIndex(), FALSE); // FALSE for start of upload, TRUE for finish.
-				doUpload();
-			}
-			else
-			{
-				mUploadPending = FALSE;
-				mNeedsUpload = FALSE;
-				mNeedsUploadTimer.pause();
-				mTexLayerSet->getAvatar()->setNewBakedTexture(mTexLayerSet->getBakedTexIndex(),IMG_INVISIBLE);
-			}
-		}
+		uploadComposite(success);
 	}
 	
 	if (update_now)
@@ -338,6 +391,84 @@ BOOL LLTexLayerSetBuffer::render()
 	return success;
 }
 
+// Returns TRUE if the layers were handed to the composite thread.  FALSE means
+// some layer needs the GL path (e.g. a local texture without saved raw data).
+BOOL LLTexLayerSetBuffer::startComposite()
+{
+	LLImageCompositeThread* composite_thread = LLAppViewer::getImageCompositeThread();
+	if (!composite_thread)
+	{
+		return FALSE;
+	}
+
+	LLPointer<LLImageCompositor> compositor = new LLImageCompositor(mFullWidth, mFullHeight);
+	if (!mTexLayerSet->composite(compositor, mFullWidth, mFullHeight))
+	{
+		return FALSE;
+	}
+
+	mCompositeResponder = new LLTexLayerSetCompositeResponder;
+	mPendingCompositeGeneration = mCompositeGeneration;
+	mPendingCompositeFinal = mTexLayerSet->isLocalTextureDataFinal();
+	composite_thread->composite(compositor, LLQueuedThread::PRIORITY_NORMAL, mCompositeResponder);
+	composite_thread->update(1); // unpauses the composite thread
+	return TRUE;
+}
+
+// Same bookkeeping as the GL path in render(), with the texture filled from
+// the CPU composite instead of the frame buffer.
+BOOL LLTexLayerSetBuffer::finishComposite(LLImageRaw* baked_image)
+{
+	const BOOL upload_now = mNeedsUpload && isReadyToUpload();
+	const BOOL update_now = mNeedsUpdate && isReadyToUpdate();
+
+	if (mGLTexturep.isNull() || !mGLTexturep->getHasGLTexture() || (mGLTexturep->getDiscardLevel() != 0))
+	{
+		generateGLTexture();
+	}
+	mGLTexturep->setSubImage(baked_image, 0, 0, mFullWidth, mFullHeight);
+
+	if (upload_now)
+	{
+		uploadComposite(TRUE, baked_image);
+	}
+
+	if (update_now)
+	{
+		doUpdate();
+	}
+
+	// we have valid texture data now
+	mGLTexturep->setGLTextureCreated(true);
+
+	// The texture is already filled in; keep postRender() from copying the frame buffer over it.
+	return FALSE;
+}
+
+void LLTexLayerSetBuffer::uploadComposite(BOOL success, LLImageRaw* baked_color)
+{
+	if (!success)
+	{
+		llinfos << "Failed attempt to bake " << mTexLayerSet->getBodyRegionName() << llendl;
+		mUploadPending = FALSE;
+	}
+	else
+	{
+		if (mTexLayerSet->isVisible())
+		{
+			mTexLayerSet->getAvatar()->debugBakedTextureUpload(mTexLayerSet->getBakedTexIndex(), FALSE); // FALSE for start of upload, TRUE for finish.
+			doUpload(baked_color);
+		}
+		else
+		{
+			mUploadPending = FALSE;
+			mNeedsUpload = FALSE;
+			mNeedsUploadTimer.pause();
+			mTexLayerSet->getAvatar()->setNewBakedTexture(mTexLayerSet->getBakedTexIndex(),IMG_INVISIBLE);
+		}
+	}
+}
+
 BOOL LLTexLayerSetBuffer::isInitialized(void) const
 {
 	return mGLTexturep.notNull() && mGLTexturep->isGLTextureCreated();
@@ -437,7 +568,7 @@ BOOL LLTexLayerSetBuffer::requestUpdateImmediate()
 
 // Create the baked texture, send it out to the server, then wait for it to come
 // back so we can switch to using it.
-void LLTexLayerSetBuffer::doUpload()
+void LLTexLayerSetBuffer::doUpload(LLImageRaw* baked_color)
 {
 	llinfos << "Uploading baked " << mTexLayerSet->getBodyRegionName() << llendl;
 	LLViewerStats::getInstance()->incStat(LLViewerStats::ST_TEX_BAKES);
@@ -446,10 +577,15 @@ void LLTexLayerSetBuffer::doUpload()
 	// until this image is sent to the server and the Avatar Appearance message is received.)
 	mTexLayerSet->deleteCaches();
 
-	// Get the COLOR information from our texture
-	U8* baked_color_data = new U8[ mFullWidth * mFullHeight * 4 ];
-	glReadPixels(mOrigin.mX, mOrigin.mY, mFullWidth, mFullHeight, GL_RGBA, GL_UNSIGNED_BYTE, baked_color_data );
-	stop_glerror();
+	// Get the COLOR information from our texture, unless it was composited on the CPU
+	LLPointer<LLImageRaw> baked_color_image = baked_color;
+	if (baked_color_image.isNull())
+	{
+		baked_color_image = new LLImageRaw(mFullWidth, mFullHeight, 4);
+		glReadPixels(mOrigin.mX, mOrigin.mY, mFullWidth, mFullHeight, GL_RGBA, GL_UNSIGNED_BYTE, baked_color_image->getData() );
+		stop_glerror();
+	}
+	const U8* baked_color_data = baked_color_image->getData();
 
 	// Get the MASK information from our texture
 	LLGLSUIDefault gls_ui;
@@ -579,8 +715,6 @@ void LLTexLayerSetBuffer::doUpload()
 		mUploadPending = FALSE;
 		llinfos << "Unable to create baked upload file (reason: failed to write file)" << llendl;
 	}
-
-	delete [] baked_color_data;
 }
 
 // Mostly bookkeeping; don't need to actually "do" anything since
@@ -973,6 +1107,50 @@ BOOL LLTexLayerSet::render( S32 x, S32 y, S32 width, S32 height )
 	return success;
 }
 
+// Records the same draws as render() into a CPU compositor.
+BOOL LLTexLayerSet::composite(LLImageCompositor* compositor, S32 width, S32 height)
+{
+	mIsVisible = TRUE;
+
+	for (layer_list_t::iterator iter = mMaskLayerList.begin(); iter != mMaskLayerList.end(); iter++)
+	{
+		LLTexLayerInterface* layer = *iter;
+		if (layer->isInvisibleAlphaMask())
+		{
+			mIsVisible = FALSE;
+		}
+	}
+
+	// clear to opaque black
+	compositor->setColorMask(true, true);
+	compositor->setBlendFunc(LLImageCompositor::BF_SOURCE_ALPHA, LLImageCompositor::BF_ONE_MINUS_SOURCE_ALPHA);
+	compositor->setColor(LLColor4(0.f, 0.f, 0.f, 1.f));
+	compositor->drawRect();
+
+	if (mIsVisible)
+	{
+		// composite color layers
+		for( layer_list_t::iterator iter = mLayerList.begin(); iter != mLayerList.end(); iter++ )
+		{
+			LLTexLayerInterface* layer = *iter;
+			if (layer->getRenderPass() == LLTexLayer::RP_COLOR)
+			{
+				if (!layer->composite(compositor, width, height))
+				{
+					return FALSE;
+				}
+			}
+		}
+
+		return compositeAlphaMaskTextures(compositor);
+	}
+
+	compositor->setBlendFunc(LLImageCompositor::BF_ONE, LLImageCompositor::BF_ZERO);
+	compositor->setColor(LLColor4(0.f, 0.f, 0.f, 0.f));
+	compositor->drawRect();
+	return TRUE;
+}
+
 
 BOOL LLTexLayerSet::isBodyRegion(const std::string& region) const 
 { 
@@ -1130,6 +1308,53 @@ void LLTexLayerSet::renderAlphaMaskTextures(S32 x, S32 y, S32 width, S32 height,
 	gGL.setSceneBlendType(LLRender::BT_ALPHA);
 }
 
+// CPU equivalent of renderAlphaMaskTextures(), without forceClear.
+BOOL LLTexLayerSet::compositeAlphaMaskTextures(LLImageCompositor* compositor)
+{
+	const LLTexLayerSetInfo *info = getInfo();
+	
+	compositor->setColorMask(false, true);
+	compositor->setBlendFunc(LLImageCompositor::BF_ONE, LLImageCompositor::BF_ZERO);
+	
+	// (Optionally) replace alpha with a single component image from a tga file.
+	if (!info->mStaticAlphaFileName.empty())
+	{
+		LLImageRaw* image_raw = LLTexLayerStaticImageList::getInstance()->getImageRaw(info->mStaticAlphaFileName);
+		if (image_raw)
+		{
+			compositor->setTextureReplace(true);
+			compositor->drawTexture(image_raw, image_raw->getComponents() == 1);
+		}
+	}
+	else if (info->mClearAlpha || (mMaskLayerList.size() > 0))
+	{
+		// Set the alpha channel to one (clean up after previous blending)
+		compositor->setColor(LLColor4(0.f, 0.f, 0.f, 1.f));
+		compositor->drawRect();
+	}
+	
+	// (Optional) Mask out part of the baked texture with alpha masks
+	// will still have an effect even if mClearAlpha is set or the alpha component was replaced
+	if (mMaskLayerList.size() > 0)
+	{
+		compositor->setBlendFunc(LLImageCompositor::BF_DEST_ALPHA, LLImageCompositor::BF_ZERO);
+		compositor->setTextureReplace(true);
+		for (layer_list_t::iterator iter = mMaskLayerList.begin(); iter != mMaskLayerList.end(); iter++)
+		{
+			LLTexLayerInterface* layer = *iter;
+			if (!layer->compositeAlphaTexture(compositor))
+			{
+				return FALSE;
+			}
+		}
+	}
+	
+	compositor->setTextureReplace(false);
+	compositor->setColorMask(true, true);
+	compositor->setBlendFunc(LLImageCompositor::BF_SOURCE_ALPHA, LLImageCompositor::BF_ONE_MINUS_SOURCE_ALPHA);
+	return TRUE;
+}
+
 void LLTexLayerSet::applyMorphMask(U8* tex_data, S32 width, S32 height, S32 num_components)
 {
 	mAvatar->applyMorphMask(tex_data, width, height, num_components, mBakedTexIndex);
@@ -1732,6 +1957,92 @@ BOOL LLTexLayer::render(S32 x, S32 y, S32 width, S32 height)
 	return success;
 }
 
+// Records the same draws as render() into a CPU compositor.
+BOOL LLTexLayer::composite(LLImageCompositor* compositor, S32 width, S32 height)
+{
+	LLColor4 net_color;
+	BOOL color_specified = findNetColor(&net_color);
+	
+	if (mTexLayerSet->getAvatar()->mIsDummy)
+	{
+		color_specified = true;
+		net_color = LLVOAvatar::getDummyColor();
+	}
+
+	// If you can't see the layer, don't render it.
+	if( is_approx_zero( net_color.mV[VW] ) )
+	{
+		return TRUE;
+	}
+
+	BOOL alpha_mask_specified = FALSE;
+	if (!mParamAlphaList.empty())
+	{
+		if (!compositeMorphMasks(compositor, width, height, net_color))
+		{
+			return FALSE;
+		}
+		alpha_mask_specified = TRUE;
+		compositor->setBlendFunc(LLImageCompositor::BF_DEST_ALPHA, LLImageCompositor::BF_ONE_MINUS_DEST_ALPHA);
+	}
+
+	compositor->setColor(net_color);
+
+	if( getInfo()->mWriteAllChannels )
+	{
+		compositor->setBlendFunc(LLImageCompositor::BF_ONE, LLImageCompositor::BF_ZERO);
+	}
+
+	if( (getInfo()->mLocalTexture != -1) && !getInfo()->mUseLocalTextureAlphaOnly )
+	{
+		LLViewerFetchedTexture* tex = NULL;
+		if (mLocalTextureObject && mLocalTextureObject->getImage())
+		{
+			tex = mLocalTextureObject->getImage();
+			if (mLocalTextureObject->getID() == IMG_DEFAULT_AVATAR)
+			{
+				tex = NULL;
+			}
+		}
+		if( tex )
+		{
+			LLImageRaw* image_raw = get_composite_source(tex);
+			if (!image_raw)
+			{
+				return FALSE;
+			}
+			compositor->drawTexture(image_raw, false);
+		}
+	}
+
+	if( !getInfo()->mStaticImageFileName.empty() )
+	{
+		LLImageRaw* image_raw = LLTexLayerStaticImageList::getInstance()->getImageRaw(getInfo()->mStaticImageFileName);
+		if (!image_raw)
+		{
+			return FALSE;
+		}
+		compositor->drawTexture(image_raw, getInfo()->mStaticImageIsMask && (image_raw->getComponents() == 1));
+	}
+
+	if(((-1 == getInfo()->mLocalTexture) ||
+		 getInfo()->mUseLocalTextureAlphaOnly) &&
+		getInfo()->mStaticImageFileName.empty() &&
+		color_specified )
+	{
+		compositor->setColor(net_color);
+		compositor->drawRect();
+	}
+
+	if( alpha_mask_specified || getInfo()->mWriteAllChannels )
+	{
+		// Restore standard blend func value
+		compositor->setBlendFunc(LLImageCompositor::BF_SOURCE_ALPHA, LLImageCompositor::BF_ONE_MINUS_SOURCE_ALPHA);
+	}
+
+	return TRUE;
+}
+
 const U8*	LLTexLayer::getAlphaData() const
 {
 	LLCRC alpha_mask_crc;
@@ -1836,6 +2147,33 @@ BOOL LLTexLayer::blendAlphaTexture(S32 x, S32 y, S32 width, S32 height)
 	return success;
 }
 
+BOOL LLTexLayer::compositeAlphaTexture(LLImageCompositor* compositor)
+{
+	if( !getInfo()->mStaticImageFileName.empty() )
+	{
+		LLImageRaw* image_raw = LLTexLayerStaticImageList::getInstance()->getImageRaw(getInfo()->mStaticImageFileName);
+		if (!image_raw)
+		{
+			return FALSE;
+		}
+		compositor->drawTexture(image_raw, getInfo()->mStaticImageIsMask && (image_raw->getComponents() == 1));
+	}
+	else if (getInfo()->mLocalTexture >=0 && getInfo()->mLocalTexture < TEX_NUM_INDICES)
+	{
+		LLViewerFetchedTexture* tex = mLocalTextureObject->getImage();
+		if (tex)
+		{
+			LLImageRaw* image_raw = get_composite_source(tex);
+			if (!image_raw)
+			{
+				return FALSE;
+			}
+			compositor->drawTexture(image_raw, false);
+		}
+	}
+	return TRUE;
+}
+
 /*virtual*/ void LLTexLayer::gatherAlphaMasks(U8 *data, S32 originX, S32 originY, S32 width, S32 height)
 {
 	addAlphaMask(data, originX, originY, width, height);
@@ -1968,6 +2306,96 @@ BOOL LLTexLayer::renderMorphMasks(S32 x, S32 y, S32 width, S32 height, const LLC
 	return success;
 }
 
+// CPU equivalent of renderMorphMasks().  The morph mask alpha itself is only
+// ever read back from GL, so layers with morphs need a cached mask to go this way.
+BOOL LLTexLayer::compositeMorphMasks(LLImageCompositor* compositor, S32 width, S32 height, const LLColor4 &layer_color)
+{
+	llassert( !mParamAlphaList.empty() );
+
+	const U8* alpha_data = NULL;
+	if (hasMorph())
+	{
+		alpha_data = getAlphaData();
+		if (!alpha_data)
+		{
+			return FALSE;
+		}
+	}
+
+	compositor->setColorMask(false, true);
+
+	LLTexLayerParamAlpha* first_param = *mParamAlphaList.begin();
+	// Note: if the first param is a mulitply, multiply against the current buffer's alpha
+	if( !first_param || !first_param->getMultiplyBlend() )
+	{
+		// Clear the alpha
+		compositor->setBlendFunc(LLImageCompositor::BF_ONE, LLImageCompositor::BF_ZERO);
+		compositor->setColor(LLColor4(0.f, 0.f, 0.f, 0.f));
+		compositor->drawRect();
+	}
+
+	// Accumulate alphas
+	compositor->setColor(LLColor4::white);
+	for (param_alpha_list_t::iterator iter = mParamAlphaList.begin(); iter != mParamAlphaList.end(); iter++)
+	{
+		LLTexLayerParamAlpha* param = *iter;
+		if (!param->composite(compositor))
+		{
+			return FALSE;
+		}
+	}
+
+	// Approximates a min() function
+	compositor->setBlendFunc(LLImageCompositor::BF_DEST_ALPHA, LLImageCompositor::BF_ZERO);
+
+	// Accumulate the alpha component of the texture
+	if( getInfo()->mLocalTexture != -1 )
+	{
+		LLViewerFetchedTexture* tex = mLocalTextureObject->getImage();
+		if( tex && (tex->getComponents() == 4) )
+		{
+			LLImageRaw* image_raw = get_composite_source(tex);
+			if (!image_raw)
+			{
+				return FALSE;
+			}
+			compositor->drawTexture(image_raw, false);
+		}
+	}
+
+	if( !getInfo()->mStaticImageFileName.empty() )
+	{
+		LLImageRaw* image_raw = LLTexLayerStaticImageList::getInstance()->getImageRaw(getInfo()->mStaticImageFileName);
+		if( image_raw )
+		{
+			if(	(image_raw->getComponents() == 4) ||
+				( (image_raw->getComponents() == 1) && getInfo()->mStaticImageIsMask ) )
+			{
+				compositor->drawTexture(image_raw, getInfo()->mStaticImageIsMask);
+			}
+		}
+	}
+
+	// Draw a rectangle with the layer color to multiply the alpha by that color's alpha.
+	if (layer_color.mV[VW] != 1.f)
+	{
+		compositor->setColor(layer_color);
+		compositor->drawRect();
+	}
+
+	compositor->setColorMask(true, true);
+	
+	if (alpha_data)
+	{
+		getTexLayerSet()->getAvatar()->dirtyMesh();
+
+		mMorphMasksValid = TRUE;
+		getTexLayerSet()->applyMorphMask((U8*)alpha_data, width, height, 1);
+	}
+
+	return TRUE;
+}
+
 void LLTexLayer::addAlphaMask(U8 *data, S32 originX, S32 originY, S32 width, S32 height)
 {
 	S32 size = width * height;
@@ -2145,6 +2573,56 @@ LLTexLayer* LLTexLayerTemplate::getLayer(U32 i) const
 	return success;
 }
 
+/*virtual*/ BOOL LLTexLayerTemplate::composite(LLImageCompositor* compositor, S32 width, S32 height)
+{
+	if(!mInfo)
+	{
+		return FALSE ;
+	}
+
+	updateWearableCache();
+	for (wearable_cache_t::const_iterator iter = mWearableCache.begin(); iter!= mWearableCache.end(); iter++)
+	{
+		LLWearable* wearable = NULL;
+		LLLocalTextureObject *lto = NULL;
+		LLTexLayer *layer = NULL;
+		wearable = *iter;
+		if (wearable)
+		{
+			lto = wearable->getLocalTextureObject(mInfo->mLocalTexture);
+		}
+		if (lto)
+		{
+			layer = lto->getTexLayer(getName());
+		}
+		if (layer)
+		{
+			wearable->writeToAvatar();
+			layer->setLTO(lto);
+			if (!layer->composite(compositor, width, height))
+			{
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/*virtual*/ BOOL LLTexLayerTemplate::compositeAlphaTexture(LLImageCompositor* compositor)
+{
+	U32 num_wearables = updateWearableCache();
+	for (U32 i = 0; i < num_wearables; i++)
+	{
+		LLTexLayer *layer = getLayer(i);
+		if (layer && !layer->compositeAlphaTexture(compositor))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 /*virtual*/ BOOL LLTexLayerTemplate::blendAlphaTexture( S32 x, S32 y, S32 width, S32 height) // Multiplies a single alpha texture against the frame buffer
 {
 	BOOL success = TRUE;
@@ -2270,6 +2748,7 @@ void LLTexLayerSet::cloneTemplates(LLLocalTextureObject *lto, LLVOAvatarDefines:
 LLTexLayerStaticImageList::LLTexLayerStaticImageList() :
 	mGLBytes(0),
 	mTGABytes(0),
+	mRawBytes(0),
 	mImageNames(16384)
 {
 }
@@ -2283,12 +2762,13 @@ void LLTexLayerStaticImageList::dumpByteCount() const
 {
 	llinfos << "Avatar Static Textures " <<
 		"KB GL:" << (mGLBytes / 1024) <<
-		"KB TGA:" << (mTGABytes / 1024) << "KB" << llendl;
+		"KB TGA:" << (mTGABytes / 1024) <<
+		"KB Raw:" << (mRawBytes / 1024) << "KB" << llendl;
 }
 
 void LLTexLayerStaticImageList::deleteCachedImages()
 {
-	if( mGLBytes || mTGABytes )
+	if( mGLBytes || mTGABytes || mRawBytes )
 	{
 		//llinfos << "Clearing Static Textures " <<
 		//	"KB GL:" << (mGLBytes / 1024) <<
@@ -2298,9 +2778,11 @@ void LLTexLayerStaticImageList::deleteCachedImages()
 		
 		mStaticImageListTGA.clear();
 		mStaticImageList.clear();
+		mStaticImageListRaw.clear();
 		
 		mGLBytes = 0;
 		mTGABytes = 0;
+		mRawBytes = 0;
 	}
 }
 
@@ -2377,6 +2859,27 @@ LLViewerTexture* LLTexLayerStaticImageList::getTexture(const std::string& file_n
 	return tex;
 }
 
+// Returns the decoded data from a tga file named file_name, for the CPU compositor.
+// Caches the result to speed identical subsequent requests.
+LLImageRaw* LLTexLayerStaticImageList::getImageRaw(const std::string& file_name)
+{
+	const char *namekey = mImageNames.addString(file_name);
+	image_raw_map_t::const_iterator iter = mStaticImageListRaw.find(namekey);
+	if( iter != mStaticImageListRaw.end() )
+	{
+		return iter->second;
+	}
+
+	LLPointer<LLImageRaw> image_raw = new LLImageRaw;
+	if( loadImageRaw( file_name, image_raw ) )
+	{
+		mStaticImageListRaw[ namekey ] = image_raw;
+		mRawBytes += image_raw->getDataSize();
+		return image_raw;
+	}
+	return NULL;
+}
+
 // Reads a .tga file, decodes it, and puts the decoded data in image_raw.
 // Returns TRUE if successful.
 BOOL LLTexLayerStaticImageList::loadImageRaw(const std::string& file_name, LLImageRaw* image_raw)
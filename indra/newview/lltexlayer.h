@@ -34,6 +34,7 @@
 
 class LLVOAvatar;
 class LLVOAvatarSelf;
+class LLImageCompositor;
 class LLImageTGA;
 class LLImageRaw;
 class LLXmlTreeNode;
@@ -41,6 +42,7 @@ class LLTexLayerSet;
 class LLTexLayerSetInfo;
 class LLTexLayerInfo;
 class LLTexLayerSetBuffer;
+class LLTexLayerSetCompositeResponder;
 class LLWearable;
 class LLViewerVisualParam;
 
@@ -68,6 +70,10 @@ public:
 	virtual void			deleteCaches() = 0;
 	virtual BOOL			blendAlphaTexture(S32 x, S32 y, S32 width, S32 height) = 0;
 	virtual BOOL			isInvisibleAlphaMask() const = 0;
+	// CPU equivalents of render() and blendAlphaTexture().  Return FALSE if the layer
+	// can't be composited on the CPU right now and the GL path should be used instead.
+	virtual BOOL			composite(LLImageCompositor* compositor, S32 width, S32 height) = 0;
+	virtual BOOL			compositeAlphaTexture(LLImageCompositor* compositor) = 0;
 
 	const LLTexLayerInfo* 	getInfo() const 			{ return mInfo; }
 	virtual BOOL			setInfo(const LLTexLayerInfo *info, LLWearable* wearable); // sets mInfo, calls initialization functions
@@ -119,6 +125,8 @@ public:
 	/*virtual*/ BOOL		render(S32 x, S32 y, S32 width, S32 height);
 	/*virtual*/ BOOL		setInfo(const LLTexLayerInfo *info, LLWearable* wearable); // This sets mInfo and calls initialization functions
 	/*virtual*/ BOOL		blendAlphaTexture(S32 x, S32 y, S32 width, S32 height); // Multiplies a single alpha texture against the frame buffer
+	/*virtual*/ BOOL		composite(LLImageCompositor* compositor, S32 width, S32 height);
+	/*virtual*/ BOOL		compositeAlphaTexture(LLImageCompositor* compositor);
 	/*virtual*/ void		gatherAlphaMasks(U8 *data, S32 originX, S32 originY, S32 width, S32 height);
 	/*virtual*/ void		setHasMorph(BOOL newval);
 	/*virtual*/ void		deleteCaches();
@@ -156,6 +164,9 @@ public:
 	BOOL					renderMorphMasks(S32 x, S32 y, S32 width, S32 height, const LLColor4 &layer_color);
 	void					addAlphaMask(U8 *data, S32 originX, S32 originY, S32 width, S32 height);
 	/*virtual*/ BOOL		isInvisibleAlphaMask() const;
+	/*virtual*/ BOOL		composite(LLImageCompositor* compositor, S32 width, S32 height);
+	/*virtual*/ BOOL		compositeAlphaTexture(LLImageCompositor* compositor);
+	BOOL					compositeMorphMasks(LLImageCompositor* compositor, S32 width, S32 height, const LLColor4 &layer_color);
 
 	void					setLTO(LLLocalTextureObject *lto) 	{ mLocalTextureObject = lto; }
 	LLLocalTextureObject* 	getLTO() 							{ return mLocalTextureObject; }
@@ -187,6 +198,8 @@ public:
 
 	BOOL						render(S32 x, S32 y, S32 width, S32 height);
 	void						renderAlphaMaskTextures(S32 x, S32 y, S32 width, S32 height, bool forceClear = false);
+	BOOL						composite(LLImageCompositor* compositor, S32 width, S32 height); // CPU equivalent of render()
+	BOOL						compositeAlphaMaskTextures(LLImageCompositor* compositor);
 
 	BOOL						isBodyRegion(const std::string& region) const;
 	LLTexLayerSetBuffer*		getComposite();
@@ -289,6 +302,13 @@ protected:
 	virtual void			preRender(BOOL clear_depth);
 	virtual void			postRender(BOOL success);
 	virtual BOOL			render();	
+	BOOL					startComposite(); 				// Records the layers and queues them on the composite thread.
+	BOOL					finishComposite(LLImageRaw* baked_image);
+private:
+	LLPointer<LLTexLayerSetCompositeResponder> mCompositeResponder; // CPU composite in flight, if any
+	U32						mCompositeGeneration; 			// Bumped whenever an update or upload is requested
+	U32						mPendingCompositeGeneration; 	// mCompositeGeneration when the composite in flight was recorded
+	BOOL					mPendingCompositeFinal; 		// isLocalTextureDataFinal() when the composite in flight was recorded
 	
 	//--------------------------------------------------------------------
 	// Uploads
@@ -304,7 +324,8 @@ public:
 													S32 result, LLExtStat ext_status);
 protected:
 	BOOL					isReadyToUpload() const;
-	void					doUpload(); 					// Does a read back and upload.
+	void					uploadComposite(BOOL success, LLImageRaw* baked_color = NULL);
+	void					doUpload(LLImageRaw* baked_color = NULL); // Does a read back (unless given the color data) and upload.
 	void					conditionalRestartUploadTimer();
 private:
 	BOOL					mNeedsUpload; 					// Whether we need to send our baked textures to the server
@@ -342,6 +363,7 @@ public:
 	~LLTexLayerStaticImageList();
 	LLViewerTexture*	getTexture(const std::string& file_name, BOOL is_mask);
 	LLImageTGA*			getImageTGA(const std::string& file_name);
+	LLImageRaw*			getImageRaw(const std::string& file_name);
 	void				deleteCachedImages();
 	void				dumpByteCount() const;
 protected:
@@ -352,8 +374,11 @@ private:
 	texture_map_t 		mStaticImageList;
 	typedef std::map<const char*, LLPointer<LLImageTGA> > image_tga_map_t;
 	image_tga_map_t 	mStaticImageListTGA;
+	typedef std::map<const char*, LLPointer<LLImageRaw> > image_raw_map_t;
+	image_raw_map_t 	mStaticImageListRaw;
 	S32 				mGLBytes;
 	S32 				mTGABytes;
+	S32 				mRawBytes;
 };
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
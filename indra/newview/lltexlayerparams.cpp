@@ -29,6 +29,7 @@
 #include "lltexlayerparams.h"
 
 #include "llagentcamera.h"
+#include "llimagecompositor.h"
 #include "llimagetga.h"
 #include "lltexlayer.h"
 #include "llvoavatarself.h"
@@ -172,6 +173,7 @@ void LLTexLayerParamAlpha::setWeight(F32 weight, BOOL upload_bake)
 	if (cur_u8 != new_u8)
 	{
 		mCurWeight = new_weight;
+		markDirty();
 
 		if ((mAvatar->getSex() & getSex()) && (mAvatar->isSelf() && !mIsDummy)) // only trigger a baked texture update if we're changing a wearable's visual param.
 		{
@@ -268,19 +270,9 @@ BOOL LLTexLayerParamAlpha::render(S32 x, S32 y, S32 width, S32 height)
 
 	if (!info->mStaticImageFileName.empty() && !mStaticImageInvalid)
 	{
-		if (mStaticImageTGA.isNull())
+		if (!getStaticImageTGA())
 		{
-			// Don't load the image file until we actually need it the first time.  Like now.
-			mStaticImageTGA = LLTexLayerStaticImageList::getInstance()->getImageTGA(info->mStaticImageFileName);  
-			// We now have something in one of our caches
-			LLTexLayerSet::sHasCaches |= mStaticImageTGA.notNull() ? TRUE : FALSE;
-
-			if (mStaticImageTGA.isNull())
-			{
-				llwarns << "Unable to load static file: " << info->mStaticImageFileName << llendl;
-				mStaticImageInvalid = TRUE; // don't try again.
-				return FALSE;
-			}
+			return FALSE;
 		}
 
 		const S32 image_tga_width = mStaticImageTGA->getWidth();
@@ -348,6 +340,79 @@ BOOL LLTexLayerParamAlpha::render(S32 x, S32 y, S32 width, S32 height)
 	return success;
 }
 
+// Records the same draws as render() into a CPU compositor.  Only the processed
+// image is rebuilt here; the GL texture is left for render() to create if needed.
+BOOL LLTexLayerParamAlpha::composite(LLImageCompositor* compositor)
+{
+	if (!mTexLayer)
+	{
+		return TRUE;
+	}
+
+	F32 effective_weight = (mTexLayer->getTexLayerSet()->getAvatar()->getSex() & getSex()) ? mCurWeight : getDefaultWeight();
+	if (getSkip())
+	{
+		return TRUE;
+	}
+
+	LLTexLayerParamAlphaInfo *info = (LLTexLayerParamAlphaInfo *)getInfo();
+	if (info->mMultiplyBlend)
+	{
+		compositor->setBlendFunc(LLImageCompositor::BF_DEST_ALPHA, LLImageCompositor::BF_ZERO);
+	}
+	else
+	{
+		compositor->setBlendFunc(LLImageCompositor::BF_ONE, LLImageCompositor::BF_ONE);
+	}
+
+	if (!info->mStaticImageFileName.empty() && !mStaticImageInvalid)
+	{
+		if (!getStaticImageTGA())
+		{
+			return FALSE;
+		}
+
+		if (mStaticImageRaw.isNull() || (effective_weight != mCachedEffectiveWeight))
+		{
+			mCachedEffectiveWeight = effective_weight;
+
+			// Build into a new image; the previous one may still be in use by the composite thread.
+			LLPointer<LLImageRaw> image_raw = new LLImageRaw;
+			mStaticImageTGA->decodeAndProcess(image_raw, info->mDomain, effective_weight);
+			mStaticImageRaw = image_raw;
+			mNeedsCreateTexture = TRUE;
+		}
+
+		compositor->drawTexture(mStaticImageRaw, true);
+	}
+	else
+	{
+		compositor->setColor(LLColor4(0.f, 0.f, 0.f, effective_weight));
+		compositor->drawRect();
+	}
+
+	return TRUE;
+}
+
+LLImageTGA* LLTexLayerParamAlpha::getStaticImageTGA()
+{
+	if (mStaticImageTGA.isNull())
+	{
+		// Don't load the image file until we actually need it the first time.  Like now.
+		const LLTexLayerParamAlphaInfo *info = (LLTexLayerParamAlphaInfo *)getInfo();
+		mStaticImageTGA = LLTexLayerStaticImageList::getInstance()->getImageTGA(info->mStaticImageFileName);  
+		// We now have something in one of our caches
+		LLTexLayerSet::sHasCaches |= mStaticImageTGA.notNull() ? TRUE : FALSE;
+
+		if (mStaticImageTGA.isNull())
+		{
+			llwarns << "Unable to load static file: " << info->mStaticImageFileName << llendl;
+			mStaticImageInvalid = TRUE; // don't try again.
+		}
+	}
+	return mStaticImageTGA;
+}
+
 //-----------------------------------------------------------------------------
 // LLTexLayerParamAlphaInfo
 //-----------------------------------------------------------------------------
@@ -463,6 +528,7 @@ void LLTexLayerParamColor::setWeight(F32 weight, BOOL upload_bake)
 	if (cur_u8 != new_u8)
 	{
 		mCurWeight = new_weight;
+		markDirty();
 
 		if (info->mNumColors <= 0)
 		{
@@ -29,6 +29,7 @@
 
 #include "llviewervisualparam.h"
 
+class LLImageCompositor;
 class LLImageRaw;
 class LLImageTGA;
 class LLTexLayer;
@@ -84,11 +85,14 @@ public:
 
 	// New functions
 	BOOL					render( S32 x, S32 y, S32 width, S32 height );
+	BOOL					composite(LLImageCompositor* compositor); // CPU equivalent of render()
 	BOOL					getSkip() const;
 	void					deleteCaches();
 	BOOL					getMultiplyBlend() const;
 
 private:
+	LLImageTGA*				getStaticImageTGA();
+
 	LLPointer<LLViewerTexture>	mCachedProcessedTexture;
 	LLPointer<LLImageTGA>	mStaticImageTGA;
 	LLPointer<LLImageRaw>	mStaticImageRaw;
@@ -0,0 +1,755 @@
+/** 
+ * @file llviewerbenchmark.cpp
+ * @brief Renders a fixed number of frames and writes fast timer statistics as JSON
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#include "llviewerprecompiledheaders.h"
+
+#include "llviewerbenchmark.h"
+
+#include "bitpack.h"
+#include "llappviewer.h"
+#include "lldir.h"
+#include "llfasttimer.h"
+#include "llflexibleobject.h"
+#include "llphysicsmotion.h"
+#include "llprimitive.h"
+#include "llsdserialize.h"
+#include "llstartup.h"
+#include "llsurfacedecoder.h"
+#include "llv4matrix4.h"
+#include "llviewercamera.h"
+#include "llviewercontrol.h"
+#include "llviewerobjectlist.h"
+#include "llvolumemgr.h"
+#include "llvovolume.h"
+#include "patch_code.h"
+#include "patch_dct.h"
+
+#include <iomanip>
+
+U32 LLViewerBenchmark::sFrames = 0;
+U32 LLViewerBenchmark::sFramesRecorded = 0;
+F32 LLViewerBenchmark::sWarmupTime = 0.f;
+F64 LLViewerBenchmark::sFrameTimeTotal = 0.0;
+F64 LLViewerBenchmark::sFrameTimeMin = 0.0;
+F64 LLViewerBenchmark::sFrameTimeMax = 0.0;
+LLTimer LLViewerBenchmark::sFrameTimer;
+LLTimer LLViewerBenchmark::sWarmupTimer;
+LLViewerBenchmark::EState LLViewerBenchmark::sState = LLViewerBenchmark::BENCHMARK_OFF;
+bool LLViewerBenchmark::sHistoryPaused = false;
+LLViewerBenchmark::stats_map_t LLViewerBenchmark::sStats;
+LLSD LLViewerBenchmark::sScene;
+U32 LLViewerBenchmark::sSceneFrame = 0;
+bool LLViewerBenchmark::sSceneFrameReplayed = false;
+LLFILE* LLViewerBenchmark::sLayerDataCapture = NULL;
+
+const U32 LAYER_DATA_PASSES = 20;
+const U32 FLEXI_FRAMES = 300;
+const F32 FLEXI_FRAME_TIME = 1.f/45.f;
+const F32 FLEXI_CHAIN_LENGTH = 2.f;
+const U32 PHYSICS_FRAMES = 300;
+const F32 PHYSICS_FRAME_TIME = 1.f/45.f;
+
+static LLFastTimer::DeclareTimer FTM_SCENE_LOD("Scene Benchmark LOD");
+static LLFastTimer::DeclareTimer FTM_SCENE_VOLUMES("Scene Benchmark Volumes");
+
+// Stand-in for LLVolumeImplFlexible, a chain hanging from a swaying anchor
+class LLFlexiBenchmarkChain : public LLJobPool::Job
+{
+public:
+	LLFlexiBenchmarkChain(U32 index)
+	:	mPhase((F32) index * 0.37f),
+		mOrigin((F32) (index % 64) * 4.f, (F32) (index / 64) * 4.f, 25.f)
+	{
+		mAttributes.setSimulateLOD(FLEXIBLE_OBJECT_MAX_SECTIONS);
+
+		S32 num_sections = 1 << FLEXIBLE_OBJECT_MAX_SECTIONS;
+		for (S32 i = 0; i <= num_sections; ++i)
+		{
+			mSections[i].mPosition = mOrigin + LLVector3(0.f, 0.f, FLEXI_CHAIN_LENGTH * ((F32) i / num_sections - 0.5f));
+			mSections[i].mDirection = LLVector3::z_axis;
+			mSections[i].mdPosition = LLVector3::z_axis;
+			mSections[i].mScale.setVec(0.1f, 0.1f);
+		}
+		setFrame(0);
+	}
+
+	void setFrame(U32 frame)
+	{
+		F32 t = (F32) frame * FLEXI_FRAME_TIME;
+		mBasePosition = mOrigin + LLVector3(0.5f * sinf(t + mPhase), 0.f, 0.f);
+		mBaseRotation.setQuat(0.5f * sinf(2.f * t + mPhase), LLVector3::x_axis);
+	}
+
+	/*virtual*/ void run()
+	{
+		LLVolumeImplFlexible::simulateSections(mSections, FLEXIBLE_OBJECT_MAX_SECTIONS, mAttributes,
+											   mBasePosition, mBaseRotation,
+											   FLEXI_CHAIN_LENGTH, FLEXI_FRAME_TIME, NULL);
+		LLVolumeImplFlexible::remapSections(mSections, FLEXIBLE_OBJECT_MAX_SECTIONS,
+											mRenderSections, FLEXIBLE_OBJECT_MAX_SECTIONS, FLEXI_CHAIN_LENGTH);
+
+		// back to prim space, as the path points are
+		LLMatrix4 rel_xform;
+		rel_xform.initAll(LLVector3(1.f, 1.f, 1.f), ~mBaseRotation, -mBasePosition * ~mBaseRotation);
+		LLV4Matrix4 rel_xform_v4;
+		rel_xform_v4 = rel_xform;
+		S32 num_sections = 1 << FLEXIBLE_OBJECT_MAX_SECTIONS;
+		for (S32 i = 0; i <= num_sections; ++i)
+		{
+			rel_xform_v4.multiply(mRenderSections[i].mPosition, mPoints[i]);
+		}
+	}
+
+private:
+	LLFlexibleObjectData	mAttributes;
+	LLFlexibleObjectSection	mSections[(1<<FLEXIBLE_OBJECT_MAX_SECTIONS)+1];
+	LLFlexibleObjectSection	mRenderSections[(1<<FLEXIBLE_OBJECT_MAX_SECTIONS)+1];
+	LLVector3				mPoints[(1<<FLEXIBLE_OBJECT_MAX_SECTIONS)+1];
+	F32						mPhase;
+	LLVector3				mOrigin;
+	LLVector3				mBasePosition;
+	LLQuaternion			mBaseRotation;
+};
+
+// One prim of a scene capture and the volume it currently holds
+struct LLScenePrim
+{
+	LLVolumeParams	mParams;
+	LLVector3		mPosition;
+	F32				mRadius;
+	S32				mDetail;
+	LLVolume*		mVolume;
+};
+
+static std::vector<LLScenePrim> sScenePrims;
+
+//static
+void LLViewerBenchmark::initClass()
+{
+	sFrames = gSavedSettings.getU32("BenchmarkFrames");
+	sWarmupTime = gSavedSettings.getF32("BenchmarkWarmupTime");
+
+	std::string scene_file = gSavedSettings.getString("BenchmarkSceneFile");
+	if (!scene_file.empty())
+	{
+		if (loadScene(scene_file))
+		{
+			sState = BENCHMARK_REPLAYING;
+			llinfos << "Replaying " << sScene["camera"].size() << " frames of benchmark scene " << scene_file << llendl;
+		}
+		else
+		{
+			sState = BENCHMARK_DONE;
+			LLAppViewer::instance()->forceQuit();
+		}
+	}
+	else if (sFrames > 0)
+	{
+		sState = BENCHMARK_WAITING;
+		llinfos << "Benchmarking " << sFrames << " frames after " << sWarmupTime << " seconds in world" << llendl;
+	}
+}
+
+//static
+void LLViewerBenchmark::nextFrame()
+{
+	switch (sState)
+	{
+	case BENCHMARK_WAITING:
+		if (LLStartUp::getStartupState() >= STATE_STARTED)
+		{ //give textures and objects time to arrive before measuring
+			sState = BENCHMARK_WARMUP;
+			sWarmupTimer.reset();
+		}
+		break;
+
+	case BENCHMARK_WARMUP:
+		if (sWarmupTimer.getElapsedTimeF32() >= sWarmupTime)
+		{ //the frame that just finished straddled the warmup, start with the next one
+			sState = BENCHMARK_RECORDING;
+			sFrameTimer.reset();
+			if (gSavedSettings.getBOOL("BenchmarkCaptureScene"))
+			{
+				captureScene();
+			}
+		}
+		break;
+
+	case BENCHMARK_RECORDING:
+		if (LLFastTimer::sPauseHistory)
+		{ //timer history is frozen, these frames would repeat stale counts
+			sHistoryPaused = true;
+			break;
+		}
+		if (sHistoryPaused)
+		{ //the first frame after a pause only resets the history
+			sHistoryPaused = false;
+			sFrameTimer.reset();
+			break;
+		}
+
+		recordFrame();
+		if (sScene.has("camera"))
+		{
+			sScene["camera"].append(LLViewerCamera::getInstance()->getOrigin().getValue());
+		}
+
+		if (sFramesRecorded >= sFrames)
+		{
+			writeResults("benchmark.json");
+			if (sScene.has("camera"))
+			{
+				writeScene();
+			}
+			sState = BENCHMARK_DONE;
+			LLAppViewer::instance()->forceQuit();
+		}
+		break;
+
+	case BENCHMARK_REPLAYING:
+		if (!sSceneFrameReplayed)
+		{ //nothing replayed yet, start timing with this frame
+			sFrameTimer.reset();
+			break;
+		}
+		sSceneFrameReplayed = false;
+
+		recordFrame();
+		if (sSceneFrame >= (U32) sScene["camera"].size())
+		{
+			releaseScene();
+			writeResults("scene_benchmark.json");
+			sState = BENCHMARK_DONE;
+			LLAppViewer::instance()->forceQuit();
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+//static
+void LLViewerBenchmark::idle()
+{
+	if (sState == BENCHMARK_REPLAYING && sSceneFrame < (U32) sScene["camera"].size())
+	{
+		replaySceneFrame();
+		sSceneFrameReplayed = true;
+	}
+}
+
+static void gather_timers(LLFastTimer::NamedTimer& timer, std::vector<LLFastTimer::NamedTimer*>& timers)
+{
+	timers.push_back(&timer);
+	for (LLFastTimer::NamedTimer::child_const_iter iter = timer.beginChildren(); iter != timer.endChildren(); ++iter)
+	{
+		if (*iter != &timer)
+		{
+			gather_timers(**iter, timers);
+		}
+	}
+}
+
+//static
+void LLViewerBenchmark::recordFrame()
+{
+	F64 frame_time = sFrameTimer.getElapsedTimeAndResetF64();
+	sFrameTimeTotal += frame_time;
+	sFrameTimeMin = sFramesRecorded ? llmin(sFrameTimeMin, frame_time) : frame_time;
+	sFrameTimeMax = llmax(sFrameTimeMax, frame_time);
+	sFramesRecorded++;
+
+	std::vector<LLFastTimer::NamedTimer*> timers;
+	gather_timers(LLFastTimer::NamedTimer::getRootNamedTimer(), timers);
+
+	for (std::vector<LLFastTimer::NamedTimer*>::iterator iter = timers.begin(); iter != timers.end(); ++iter)
+	{
+		LLFastTimer::NamedTimer* timerp = *iter;
+		TimerStats& stats = sStats[timerp->getName()];
+		if (timerp->getParent() && timerp->getParent() != timerp)
+		{
+			stats.mParent = timerp->getParent()->getName();
+		}
+		U32 count = timerp->getHistoricalCount(0);
+		stats.mTime += count;
+		stats.mCalls += timerp->getHistoricalCalls(0);
+		stats.mMaxTime = llmax(stats.mMaxTime, count);
+	}
+}
+
+static std::string json_escape(const std::string& str)
+{
+	std::string out;
+	for (std::string::const_iterator iter = str.begin(); iter != str.end(); ++iter)
+	{
+		switch (*iter)
+		{
+		case '"':	out += "\\\""; break;
+		case '\\':	out += "\\\\"; break;
+		case '\n':	out += "\\n"; break;
+		case '\t':	out += "\\t"; break;
+		default:	out += *iter; break;
+		}
+	}
+	return out;
+}
+
+//static
+void LLViewerBenchmark::writeResults(const std::string& name)
+{
+	std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, name);
+	llofstream os(filename);
+	if (!os.is_open())
+	{
+		llwarns << "Unable to open " << filename << " for benchmark results" << llendl;
+		return;
+	}
+
+	F64 ms_per_count = 1000.0 / (F64) LLFastTimer::countsPerSecond();
+	F64 frames = llmax((F64) sFramesRecorded, 1.0);
+
+	os << std::fixed << std::setprecision(4);
+	os << "{\n";
+	os << "  \"frames\": " << sFramesRecorded << ",\n";
+	os << "  \"frame_ms\": { \"mean\": " << sFrameTimeTotal*1000.0/frames
+		<< ", \"min\": " << sFrameTimeMin*1000.0
+		<< ", \"max\": " << sFrameTimeMax*1000.0 << " },\n";
+	os << "  \"timers\": {";
+
+	bool first = true;
+	for (stats_map_t::iterator iter = sStats.begin(); iter != sStats.end(); ++iter)
+	{
+		const TimerStats& stats = iter->second;
+		if (stats.mCalls == 0)
+		{
+			continue;
+		}
+		os << (first ? "\n" : ",\n");
+		first = false;
+		os << "    \"" << json_escape(iter->first) << "\": { "
+			<< "\"parent\": \"" << json_escape(stats.mParent) << "\", "
+			<< "\"mean_ms\": " << stats.mTime*ms_per_count/frames << ", "
+			<< "\"max_ms\": " << stats.mMaxTime*ms_per_count << ", "
+			<< "\"calls_per_frame\": " << stats.mCalls/frames << " }";
+	}
+	os << "\n  }\n}\n";
+
+	llinfos << "Wrote benchmark results for " << sFramesRecorded << " frames to " << filename << llendl;
+}
+
+//static
+void LLViewerBenchmark::captureScene()
+{
+	sScene = LLSD::emptyMap();
+	sScene["objects"] = LLSD::emptyArray();
+	sScene["camera"] = LLSD::emptyArray();
+
+	for (S32 i = 0; i < gObjectList.getNumObjects(); ++i)
+	{
+		LLViewerObject* objectp = gObjectList.getObject(i);
+		if (!objectp || objectp->isDead() || objectp->getPCode() != LL_PCODE_VOLUME || !objectp->getVolume())
+		{
+			continue;
+		}
+
+		// sculpt maps are textures, not available offline
+		LLVOVolume* volumep = (LLVOVolume*) objectp;
+		if (volumep->isSculpted())
+		{
+			continue;
+		}
+
+		LLSD object;
+		object["volume"] = volumep->getVolume()->getParams().asLLSD();
+		object["position"] = volumep->getPositionAgent().getValue();
+		object["lod_radius"] = volumep->getLODRadius();
+		sScene["objects"].append(object);
+	}
+
+	llinfos << "Capturing " << sScene["objects"].size() << " prims for the scene benchmark" << llendl;
+}
+
+//static
+void LLViewerBenchmark::writeScene()
+{
+	std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "benchmark_scene.xml");
+	llofstream os(filename);
+	if (!os.is_open())
+	{
+		llwarns << "Unable to open " << filename << " for the benchmark scene" << llendl;
+		return;
+	}
+
+	LLSDSerialize::toPrettyXML(sScene, os);
+	llinfos << "Wrote benchmark scene to " << filename << llendl;
+}
+
+//static
+bool LLViewerBenchmark::loadScene(const std::string& filename)
+{
+	LLSD scene;
+	llifstream is(filename);
+	if (!is.is_open())
+	{
+		llwarns << "Unable to open benchmark scene " << filename << llendl;
+		return false;
+	}
+	LLSDSerialize::fromXML(scene, is);
+	is.close();
+
+	sScenePrims.clear();
+
+	const LLSD& objects = scene["objects"];
+	for (LLSD::array_const_iterator iter = objects.beginArray(); iter != objects.endArray(); ++iter)
+	{
+		LLScenePrim prim;
+		LLSD volume = (*iter)["volume"];
+		if (!prim.mParams.fromLLSD(volume))
+		{
+			continue;
+		}
+		prim.mPosition.setValue((*iter)["position"]);
+		prim.mRadius = (F32) (*iter)["lod_radius"].asReal();
+		prim.mDetail = -1;
+		prim.mVolume = NULL;
+		sScenePrims.push_back(prim);
+	}
+
+	if (sScenePrims.empty() || scene["camera"].size() == 0)
+	{
+		llwarns << "No prims or camera path in benchmark scene " << filename << llendl;
+		sScenePrims.clear();
+		return false;
+	}
+
+	sScene = LLSD::emptyMap();
+	sScene["camera"] = scene["camera"];
+	sSceneFrame = 0;
+	sSceneFrameReplayed = false;
+	sStats.clear();
+	sFramesRecorded = 0;
+	return true;
+}
+
+//static
+void LLViewerBenchmark::replaySceneFrame()
+{
+	LLVector3 origin(sScene["camera"][sSceneFrame++]);
+
+	static std::vector<S32> detail;
+	detail.resize(sScenePrims.size());
+
+	{ //same distance rounding as LLDrawable::updateDistance
+		LLFastTimer t(FTM_SCENE_LOD);
+		for (U32 i = 0; i < sScenePrims.size(); ++i)
+		{
+			F32 distance = llround((sScenePrims[i].mPosition - origin).magVec(), 0.01f);
+			detail[i] = LLVOVolume::calcLODDetail(distance, sScenePrims[i].mRadius);
+		}
+	}
+
+	{
+		LLFastTimer t(FTM_SCENE_VOLUMES);
+		LLVolumeMgr* volume_mgr = LLPrimitive::getVolumeManager();
+		for (U32 i = 0; i < sScenePrims.size(); ++i)
+		{
+			LLScenePrim& prim = sScenePrims[i];
+			if (prim.mDetail != detail[i])
+			{ //ref the new LOD before dropping the old one, as LLVOVolume::setVolume does
+				LLVolume* volume = volume_mgr->refVolume(prim.mParams, detail[i]);
+				if (prim.mVolume)
+				{
+					volume_mgr->unrefVolume(prim.mVolume);
+				}
+				prim.mVolume = volume;
+				prim.mDetail = detail[i];
+			}
+		}
+	}
+}
+
+//static
+void LLViewerBenchmark::releaseScene()
+{
+	LLVolumeMgr* volume_mgr = LLPrimitive::getVolumeManager();
+	for (U32 i = 0; i < sScenePrims.size(); ++i)
+	{
+		if (sScenePrims[i].mVolume)
+		{
+			volume_mgr->unrefVolume(sScenePrims[i].mVolume);
+		}
+	}
+	sScenePrims.clear();
+	sScene.clear();
+}
+
+//static
+void LLViewerBenchmark::captureLayerData(S8 type, const U8* data, S32 size)
+{
+	static LLCachedControl<bool> capture(gSavedSettings, "BenchmarkCaptureLayerData");
+	if (!capture)
+	{
+		return;
+	}
+
+	if (!sLayerDataCapture)
+	{
+		std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "layerdata.bin");
+		sLayerDataCapture = LLFile::fopen(filename, "wb");
+		if (!sLayerDataCapture)
+		{
+			llwarns << "Unable to open " << filename << " for layer data capture" << llendl;
+			gSavedSettings.setBOOL("BenchmarkCaptureLayerData", FALSE);
+			return;
+		}
+		llinfos << "Capturing layer data to " << filename << llendl;
+	}
+
+	// records are the layer type, the size in bytes and the blob
+	fwrite(&type, sizeof(type), 1, sLayerDataCapture);
+	fwrite(&size, sizeof(size), 1, sLayerDataCapture);
+	fwrite(data, 1, size, sLayerDataCapture);
+	fflush(sLayerDataCapture);
+}
+
+//static
+bool LLViewerBenchmark::runLayerDataBenchmark(const std::string& filename)
+{
+	typedef std::vector<U8> blob_t;
+	std::vector<blob_t> blobs;
+
+	LLFILE* fp = LLFile::fopen(filename, "rb");
+	if (!fp)
+	{
+		llwarns << "Unable to open layer data capture " << filename << llendl;
+		return false;
+	}
+
+	S8 type;
+	S32 size;
+	while (fread(&type, sizeof(type), 1, fp) == 1
+		   && fread(&size, sizeof(size), 1, fp) == 1)
+	{
+		if (size <= 0)
+		{
+			break;
+		}
+		blob_t blob(size);
+		if (fread(&blob[0], 1, size, fp) != (size_t) size)
+		{
+			break;
+		}
+		if (type == LAND_LAYER_CODE)
+		{
+			blobs.push_back(blob);
+		}
+	}
+	fclose(fp);
+
+	if (blobs.empty())
+	{
+		llwarns << "No land layer data in " << filename << llendl;
+		return false;
+	}
+
+	// workers the decoder gets from the job pool
+	U32 num_threads = llmin(LLAppViewer::getJobPool()->getNumWorkers(),
+							LLJobPool::resolveMaxWorkers(gSavedSettings.getS32("TerrainDecodeThreads")));
+	LLSurfaceDecoder decoder;
+	decoder.setMaxWorkers(num_threads);
+	LLSurfaceDecoder::job_list_t jobs;
+
+	// big enough for any patch id in any patch size, the heights themselves
+	// are thrown away
+	const S32 stride = 32*LARGE_PATCH_SIZE + 1;
+	std::vector<F32> heights(stride*stride);
+
+	LLTimer timer;
+	F64 unpack_time = 0.0;
+	F64 decode_time = 0.0;
+	U32 patches = 0;
+
+	for (U32 pass = 0; pass < LAYER_DATA_PASSES; ++pass)
+	{
+		for (std::vector<blob_t>::iterator iter = blobs.begin(); iter != blobs.end(); ++iter)
+		{
+			timer.reset();
+
+			LLBitPack bitpack(&(*iter)[0], iter->size());
+			LLGroupHeader gopp;
+			LLPatchHeader ph;
+
+			decode_patch_group_header(bitpack, &gopp);
+			jobs.clear();
+			while (1)
+			{
+				decode_patch_header(bitpack, &ph);
+				if (ph.quant_wbits == END_OF_PATCHES)
+				{
+					break;
+				}
+
+				jobs.resize(jobs.size() + 1);
+				LLSurfaceDecoder::Job& job = jobs.back();
+				S32 i = (ph.patchids >> 5) & 0x1F;
+				S32 j = ph.patchids & 0x1F;
+				job.mHeader = ph;
+				job.mDataZ = &heights[(j*stride + i)*gopp.patch_size];
+				job.mPatch = NULL;
+				decode_patch(bitpack, job.mCoefficients);
+			}
+			unpack_time += timer.getElapsedTimeAndResetF64();
+
+			decoder.decode(jobs, gopp.patch_size, stride);
+			decode_time += timer.getElapsedTimeF64();
+
+			patches += jobs.size();
+		}
+	}
+
+	std::string out_filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "layerdata_benchmark.json");
+	llofstream os(out_filename);
+	if (!os.is_open())
+	{
+		llwarns << "Unable to open " << out_filename << " for benchmark results" << llendl;
+		return false;
+	}
+
+	F64 passes = (F64) LAYER_DATA_PASSES;
+	os << std::fixed << std::setprecision(4);
+	os << "{\n";
+	os << "  \"capture\": \"" << json_escape(filename) << "\",\n";
+	os << "  \"blobs\": " << blobs.size() << ",\n";
+	os << "  \"patches\": " << patches/LAYER_DATA_PASSES << ",\n";
+	os << "  \"passes\": " << LAYER_DATA_PASSES << ",\n";
+	os << "  \"threads\": " << num_threads << ",\n";
+	os << "  \"unpack_ms\": " << unpack_time*1000.0/passes << ",\n";
+	os << "  \"decode_ms\": " << decode_time*1000.0/passes << ",\n";
+	os << "  \"us_per_patch\": " << (unpack_time + decode_time)*1000000.0/llmax((F64) patches, 1.0) << "\n";
+	os << "}\n";
+
+	llinfos << "Decoded " << patches << " terrain patches in " << (unpack_time + decode_time)*1000.0
+		<< " ms, wrote results to " << out_filename << llendl;
+	return true;
+}
+
+//static
+bool LLViewerBenchmark::runFlexiBenchmark(U32 num_chains)
+{
+	// workers the chains get from the job pool
+	LLJobPool* pool = LLAppViewer::getJobPool();
+	U32 num_threads = llmin(pool->getNumWorkers(),
+							LLJobPool::resolveMaxWorkers(gSavedSettings.getS32("FlexiSimulationThreads")));
+
+	std::vector<LLFlexiBenchmarkChain> chains;
+	chains.reserve(num_chains);
+	for (U32 i = 0; i < num_chains; ++i)
+	{
+		chains.push_back(LLFlexiBenchmarkChain(i));
+	}
+
+	LLJobPool::job_list_t jobs;
+	for (U32 i = 0; i < num_chains; ++i)
+	{
+		jobs.push_back(&chains[i]);
+	}
+
+	LLTimer timer;
+	F64 total_time = 0.0;
+	F64 max_time = 0.0;
+
+	for (U32 frame = 0; frame < FLEXI_FRAMES; ++frame)
+	{
+		for (U32 i = 0; i < num_chains; ++i)
+		{
+			chains[i].setFrame(frame);
+		}
+
+		timer.reset();
+		pool->run(jobs, num_threads);
+		F64 frame_time = timer.getElapsedTimeF64();
+
+		total_time += frame_time;
+		max_time = llmax(max_time, frame_time);
+	}
+
+	std::string out_filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "flexi_benchmark.json");
+	llofstream os(out_filename);
+	if (!os.is_open())
+	{
+		llwarns << "Unable to open " << out_filename << " for benchmark results" << llendl;
+		return false;
+	}
+
+	F64 frames = (F64) FLEXI_FRAMES;
+	os << std::fixed << std::setprecision(4);
+	os << "{\n";
+	os << "  \"chains\": " << num_chains << ",\n";
+	os << "  \"sections\": " << (1 << FLEXIBLE_OBJECT_MAX_SECTIONS) << ",\n";
+	os << "  \"frames\": " << FLEXI_FRAMES << ",\n";
+	os << "  \"threads\": " << num_threads << ",\n";
+	os << "  \"ms_per_frame\": " << total_time*1000.0/frames << ",\n";
+	os << "  \"max_ms\": " << max_time*1000.0 << ",\n";
+	os << "  \"us_per_chain\": " << total_time*1000000.0/(frames*llmax((F64) num_chains, 1.0)) << "\n";
+	os << "}\n";
+
+	llinfos << "Simulated " << num_chains << " flexible chains for " << FLEXI_FRAMES << " frames in "
+		<< total_time*1000.0 << " ms, wrote results to " << out_filename << llendl;
+	return true;
+}
+
+//static
+bool LLViewerBenchmark::runPhysicsBenchmark(U32 num_motions)
+{
+	F64 batch_time = 0.0;
+	F64 per_motion_time = 0.0;
+	LLPhysicsMotionController::benchmarkIntegration(num_motions, PHYSICS_FRAMES, PHYSICS_FRAME_TIME,
+													batch_time, per_motion_time);
+
+	std::string out_filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "physics_benchmark.json");
+	llofstream os(out_filename);
+	if (!os.is_open())
+	{
+		llwarns << "Unable to open " << out_filename << " for benchmark results" << llendl;
+		return false;
+	}
+
+	F64 frames = (F64) PHYSICS_FRAMES;
+	os << std::fixed << std::setprecision(4);
+	os << "{\n";
+	os << "  \"motions\": " << num_motions << ",\n";
+	os << "  \"frames\": " << PHYSICS_FRAMES << ",\n";
+	os << "  \"batch_ms_per_frame\": " << batch_time*1000.0/frames << ",\n";
+	os << "  \"per_motion_ms_per_frame\": " << per_motion_time*1000.0/frames << ",\n";
+	os << "  \"speedup\": " << per_motion_time/llmax(batch_time, 0.000001) << "\n";
+	os << "}\n";
+
+	llinfos << "Integrated " << num_motions << " physics motions for " << PHYSICS_FRAMES << " frames in "
+		<< batch_time*1000.0 << " ms batched, " << per_motion_time*1000.0 << " ms one at a time, wrote results to "
+		<< out_filename << llendl;
+	return true;
+}
@@ -0,0 +1,137 @@
+/** 
+ * @file llviewerbenchmark.h
+ * @brief Renders a fixed number of frames and writes fast timer statistics as JSON
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#ifndef LL_LLVIEWERBENCHMARK_H
+#define LL_LLVIEWERBENCHMARK_H
+
+#include "llsd.h"
+#include "lltimer.h"
+
+#include <map>
+#include <string>
+
+// Frame benchmark driven by --benchmarkframes.  Once the viewer is logged in
+// and the warmup period has passed, per-timer fast timer counts are summed
+// for the requested number of frames, written to the logs directory as JSON
+// and the viewer quits.  Pair with --replaysession to get a repeatable
+// camera path.  Frames during which the fast timer history is paused are
+// not counted.
+//
+// With --benchmarkscene the camera path of a benchmark_scene.xml capture
+// (see BenchmarkCaptureScene) is replayed instead, one position a frame from
+// the main loop once the settings and the pipeline are set up.  Every frame
+// selects LODs for the captured prims and generates their volumes the way
+// the viewer does, then scene_benchmark.json is written in the
+// benchmark.json layout and the viewer quits.  No region is needed.
+class LLViewerBenchmark
+{
+public:
+	static void initClass();
+
+	// call once a frame, right after LLFastTimer::nextFrame()
+	static void nextFrame();
+
+	// call once a frame from LLAppViewer::idle()
+	static void idle();
+
+	static bool isRunning()					{ return sState != BENCHMARK_OFF && sState != BENCHMARK_DONE; }
+
+	// With BenchmarkCaptureLayerData set, appends every LayerData blob
+	// received to layerdata.bin in the logs directory.
+	static void captureLayerData(S8 type, const U8* data, S32 size);
+
+	// Headless benchmark driven by --benchmarklayerdata: decodes the land
+	// patches of a layerdata.bin capture a number of times with
+	// TerrainDecodeThreads workers and writes layerdata_benchmark.json to
+	// the logs directory.  Runs before the window is created.
+	static bool runLayerDataBenchmark(const std::string& filename);
+
+	// Headless benchmark driven by --benchmarkflexi: steps the given number
+	// of synthetic flexible object chains with FlexiSimulationThreads
+	// workers and writes flexi_benchmark.json to the logs directory.
+	static bool runFlexiBenchmark(U32 num_chains);
+
+	// Headless benchmark driven by --benchmarkphysics: integrates the given
+	// number of synthetic avatar physics motions through the batched path
+	// and one motion at a time, and writes physics_benchmark.json to the
+	// logs directory.
+	static bool runPhysicsBenchmark(U32 num_motions);
+
+private:
+	typedef enum
+	{
+		BENCHMARK_OFF,
+		BENCHMARK_WAITING,		// not logged in yet
+		BENCHMARK_WARMUP,		// in world, letting the scene load
+		BENCHMARK_RECORDING,
+		BENCHMARK_REPLAYING,	// --benchmarkscene
+		BENCHMARK_DONE
+	} EState;
+
+	struct TimerStats
+	{
+		TimerStats() : mTime(0), mCalls(0), mMaxTime(0) { }
+
+		std::string mParent;
+		U64 mTime;
+		U64 mCalls;
+		U32 mMaxTime;
+	};
+
+	typedef std::map<std::string, TimerStats> stats_map_t;
+
+	static void recordFrame();
+	static void writeResults(const std::string& name);
+
+	// With BenchmarkCaptureScene set, the prims of a --benchmarkframes run
+	// and the camera position of every recorded frame are kept in sScene
+	// and written to benchmark_scene.xml along with the results.
+	static void captureScene();
+	static void writeScene();
+
+	// --benchmarkscene
+	static bool loadScene(const std::string& filename);
+	static void replaySceneFrame();
+	static void releaseScene();
+
+	static U32 sFrames;
+	static U32 sFramesRecorded;
+	static F32 sWarmupTime;
+	static F64 sFrameTimeTotal;
+	static F64 sFrameTimeMin;
+	static F64 sFrameTimeMax;
+	static LLTimer sFrameTimer;
+	static LLTimer sWarmupTimer;
+	static EState sState;
+	static bool sHistoryPaused;
+	static stats_map_t sStats;
+	static LLSD sScene;
+	static U32 sSceneFrame;
+	static bool sSceneFrameReplayed;
+	static LLFILE* sLayerDataCapture;
+};
+
+#endif // LL_LLVIEWERBENCHMARK_H
@@ -41,9 +41,11 @@
 #include "lldrawpoolterrain.h"
 #include "llflexibleobject.h"
 #include "llfeaturemanager.h"
+#include "llphysicsmotion.h"
 #include "llviewershadermgr.h"
 
 #include "llsky.h"
+#include "llsurface.h"
 #include "llvieweraudio.h"
 #include "llviewermenu.h"
 #include "llviewertexturelist.h"
@@ -173,12 +175,60 @@ static bool handleAvatarPhysicsLODChanged(const LLSD& newvalue)
 	return true;
 }
 
+static bool handleAvatarPhysicsChanged(const LLSD& newvalue)
+{
+	LLVOAvatar::sAvatarPhysics = newvalue.asBoolean();
+	return true;
+}
+
+static bool handleAvatarPhysicsBatchChanged(const LLSD& newvalue)
+{
+	LLPhysicsMotionController::sBatchUpdate = newvalue.asBoolean();
+	return true;
+}
+
+static bool handleAvatarPhysicsLODDistanceChanged(const LLSD& newvalue)
+{
+	LLPhysicsMotionController::sLODDistance = (F32) newvalue.asReal();
+	return true;
+}
+
+static bool handleAvatarUpdateBudgetChanged(const LLSD& newvalue)
+{
+	LLVOAvatar::sUpdateBudget = (F32) newvalue.asReal();
+	return true;
+}
+
+static bool handleAvatarUpdateHeavyCostChanged(const LLSD& newvalue)
+{
+	LLVOAvatar::sUpdateHeavyCost = (F32) newvalue.asReal();
+	return true;
+}
+
+static bool handleAvatarAnimationThreadsChanged(const LLSD& newvalue)
+{
+	LLVOAvatar::setAnimationThreads(newvalue.asInteger());
+	return true;
+}
+
+static bool handleAvatarSkinningThreadsChanged(const LLSD& newvalue)
+{
+	LLViewerJointMesh::setSkinningThreads(newvalue.asInteger());
+	return true;
+}
+
 static bool handleAvatarMaxVisibleChanged(const LLSD& newvalue)
 {
 	LLVOAvatar::sMaxVisible = (U32) newvalue.asInteger();
 	return true;
 }
 
+static bool handleTerrainDecodeThreadsChanged(const LLSD& newvalue)
+{
+	LLSurface::setDecodeThreads(newvalue.asInteger());
+	return true;
+}
+
 static bool handleTerrainLODChanged(const LLSD& newvalue)
 {
 		LLVOSurfacePatch::sLODFactor = (F32)newvalue.asReal();
@@ -201,6 +251,24 @@ static bool handleFlexLODChanged(const LLSD& newvalue)
 	return true;
 }
 
+static bool handleFlexUpdateDistanceChanged(const LLSD& newvalue)
+{
+	LLVolumeImplFlexible::sUpdateDistance = (F32) newvalue.asReal();
+	return true;
+}
+
+static bool handleFlexiSimulationThreadsChanged(const LLSD& newvalue)
+{
+	LLVolumeImplFlexible::setSimulationThreads(newvalue.asInteger());
+	return true;
+}
+
+static bool handleSkyTileThreadsChanged(const LLSD& newvalue)
+{
+	LLVOSky::setTileThreads(newvalue.asInteger());
+	return true;
+}
+
 static bool handleGammaChanged(const LLSD& newvalue)
 {
 	F32 gamma = (F32) newvalue.asReal();
@@ -351,6 +419,12 @@ static bool handleRenderDynamicLODChanged(const LLSD& newvalue)
 	return true;
 }
 
+static bool handleRenderBatchLODChanged(const LLSD& newvalue)
+{
+	LLVolumeLODBatch::sEnabled = newvalue.asBoolean();
+	return true;
+}
+
 static bool handleRenderUseFBOChanged(const LLSD& newvalue)
 {
 	LLRenderTarget::sUseFBO = newvalue.asBoolean();
@@ -585,20 +659,35 @@ void settings_setup_listeners()
 	gSavedSettings.getControl("RenderVolumeLODFactor")->getSignal()->connect(boost::bind(&handleVolumeLODChanged, _2));
 	gSavedSettings.getControl("RenderAvatarLODFactor")->getSignal()->connect(boost::bind(&handleAvatarLODChanged, _2));
 	gSavedSettings.getControl("RenderAvatarPhysicsLODFactor")->getSignal()->connect(boost::bind(&handleAvatarPhysicsLODChanged, _2));
+	gSavedSettings.getControl("AvatarPhysics")->getSignal()->connect(boost::bind(&handleAvatarPhysicsChanged, _2));
+	gSavedSettings.getControl("AvatarPhysicsBatch")->getSignal()->connect(boost::bind(&handleAvatarPhysicsBatchChanged, _2));
+	gSavedSettings.getControl("AvatarPhysicsLODDistance")->getSignal()->connect(boost::bind(&handleAvatarPhysicsLODDistanceChanged, _2));
+	gSavedSettings.getControl("AvatarUpdateBudget")->getSignal()->connect(boost::bind(&handleAvatarUpdateBudgetChanged, _2));
+	gSavedSettings.getControl("AvatarUpdateHeavyCost")->getSignal()->connect(boost::bind(&handleAvatarUpdateHeavyCostChanged, _2));
+	gSavedSettings.getControl("AvatarAnimationThreads")->getSignal()->connect(boost::bind(&handleAvatarAnimationThreadsChanged, _2));
+	gSavedSettings.getControl("AvatarSkinningThreads")->getSignal()->connect(boost::bind(&handleAvatarSkinningThreadsChanged, _2));
 	gSavedSettings.getControl("RenderTerrainLODFactor")->getSignal()->connect(boost::bind(&handleTerrainLODChanged, _2));
+	gSavedSettings.getControl("TerrainDecodeThreads")->getSignal()->connect(boost::bind(&handleTerrainDecodeThreadsChanged, _2));
 	gSavedSettings.getControl("RenderTreeLODFactor")->getSignal()->connect(boost::bind(&handleTreeLODChanged, _2));
 	gSavedSettings.getControl("RenderFlexTimeFactor")->getSignal()->connect(boost::bind(&handleFlexLODChanged, _2));
+	gSavedSettings.getControl("RenderFlexUpdateDistance")->getSignal()->connect(boost::bind(&handleFlexUpdateDistanceChanged, _2));
+	gSavedSettings.getControl("FlexiSimulationThreads")->getSignal()->connect(boost::bind(&handleFlexiSimulationThreadsChanged, _2));
+	gSavedSettings.getControl("SkyTileThreads")->getSignal()->connect(boost::bind(&handleSkyTileThreadsChanged, _2));
 	gSavedSettings.getControl("ThrottleBandwidthKBPS")->getSignal()->connect(boost::bind(&handleBandwidthChanged, _2));
 	gSavedSettings.getControl("RenderGamma")->getSignal()->connect(boost::bind(&handleGammaChanged, _2));
 	gSavedSettings.getControl("RenderFogRatio")->getSignal()->connect(boost::bind(&handleFogRatioChanged, _2));
 	gSavedSettings.getControl("RenderMaxPartCount")->getSignal()->connect(boost::bind(&handleMaxPartCountChanged, _2));
 	gSavedSettings.getControl("RenderDynamicLOD")->getSignal()->connect(boost::bind(&handleRenderDynamicLODChanged, _2));
+	gSavedSettings.getControl("RenderBatchLOD")->getSignal()->connect(boost::bind(&handleRenderBatchLODChanged, _2));
 	gSavedSettings.getControl("RenderDebugTextureBind")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
 	gSavedSettings.getControl("RenderAutoMaskAlphaDeferred")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
 	gSavedSettings.getControl("RenderAutoMaskAlphaNonDeferred")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
 	gSavedSettings.getControl("RenderObjectBump")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
 	gSavedSettings.getControl("RenderMaxVBOSize")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
 	gSavedSettings.getControl("RenderUseStreamVBO")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
+	gSavedSettings.getControl("RenderUseStreamRing")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
+	gSavedSettings.getControl("RenderBatchGroups")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
+	gSavedSettings.getControl("RenderBatchMaxVerts")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
 	gSavedSettings.getControl("RenderUseFBO")->getSignal()->connect(boost::bind(&handleRenderUseFBOChanged, _2));
 	gSavedSettings.getControl("RenderDeferredNoise")->getSignal()->connect(boost::bind(&handleReleaseGLBufferChanged, _2));
 	gSavedSettings.getControl("RenderUseImpostors")->getSignal()->connect(boost::bind(&handleRenderUseImpostorsChanged, _2));
@@ -688,6 +777,7 @@ void settings_setup_listeners()
 	gSavedSettings.getControl("VectorizePerfTest")->getSignal()->connect(boost::bind(&handleVectorizeChanged, _2));
 	gSavedSettings.getControl("VectorizeEnable")->getSignal()->connect(boost::bind(&handleVectorizeChanged, _2));
 	gSavedSettings.getControl("VectorizeProcessor")->getSignal()->connect(boost::bind(&handleVectorizeChanged, _2));
+	gSavedSettings.getControl("VectorizeAVX")->getSignal()->connect(boost::bind(&handleVectorizeChanged, _2));
 	gSavedSettings.getControl("VectorizeSkin")->getSignal()->connect(boost::bind(&handleVectorizeChanged, _2));
 	gSavedSettings.getControl("EnableVoiceChat")->getSignal()->connect(boost::bind(&handleVoiceClientPrefsChanged, _2));
 	gSavedSettings.getControl("PTTCurrentlyEnabled")->getSignal()->connect(boost::bind(&handleVoiceClientPrefsChanged, _2));
@@ -34,6 +34,7 @@
 #include "llrender.h"
 
 #include "llapr.h"
+#include "llappviewer.h"
 #include "llbox.h"
 #include "lldrawable.h"
 #include "lldrawpoolavatar.h"
@@ -42,6 +43,8 @@
 #include "llface.h"
 #include "llgldbg.h"
 #include "llglheaders.h"
+#include "lljobpool.h"
+#include "llsys.h"
 #include "lltexlayer.h"
 #include "llviewercamera.h"
 #include "llviewercontrol.h"
@@ -376,17 +379,14 @@ const S32 NUM_AXES = 3;
 
 static LLMatrix4	gJointMatUnaligned[32];
 static LLMatrix3	gJointRotUnaligned[32];
-static LLVector4	gJointPivot[32];
 
-//-----------------------------------------------------------------------------
-// uploadJointMatrices()
-//-----------------------------------------------------------------------------
-void LLViewerJointMesh::uploadJointMatrices()
+// Fills in the joint matrices of a mesh with the skin pivots folded into
+// the translation.  Only touches the arrays passed in, so the CPU skinning
+// path can call it from the skinning threads.
+static void compute_joint_matrices(LLPolyMesh* reference_mesh, LLMatrix4* joint_mats, LLMatrix3* joint_rots, BOOL hardware_skinning)
 {
 	S32 joint_num;
-	LLPolyMesh *reference_mesh = mMesh->getReferenceMesh();
-	LLDrawPool *poolp = mFace ? mFace->getPool() : NULL;
-	BOOL hardware_skinning = (poolp && poolp->getVertexShaderLevel() > 0) ? TRUE : FALSE;
+	LLVector4 joint_pivots[32];
 
 	//calculate joint matrices
 	for (joint_num = 0; joint_num < reference_mesh->mJointRenderData.count(); joint_num++)
@@ -397,8 +397,8 @@ void LLViewerJointMesh::uploadJointMatrices()
 		{
 			joint_mat *= LLDrawPoolAvatar::getModelView();
 		}
-		gJointMatUnaligned[joint_num] = joint_mat;
-		gJointRotUnaligned[joint_num] = joint_mat.getMat3();
+		joint_mats[joint_num] = joint_mat;
+		joint_rots[joint_num] = joint_mat.getMat3();
 	}
 
 	BOOL last_pivot_uploaded = FALSE;
@@ -414,13 +414,13 @@ void LLViewerJointMesh::uploadJointMatrices()
 			{
 				LLVector4 parent_pivot(sj->mRootToParentJointSkinOffset);
 				parent_pivot.mV[VW] = 0.f;
-				gJointPivot[j++] = parent_pivot;
+				joint_pivots[j++] = parent_pivot;
 			}
 
 			LLVector4 child_pivot(sj->mRootToJointSkinOffset);
 			child_pivot.mV[VW] = 0.f;
 
-			gJointPivot[j++] = child_pivot;
+			joint_pivots[j++] = child_pivot;
 
 			last_pivot_uploaded = TRUE;
 		}
@@ -434,10 +434,23 @@ void LLViewerJointMesh::uploadJointMatrices()
 	for (S32 i = 0; i < j; i++)
 	{
 		LLVector3 pivot;
-		pivot = LLVector3(gJointPivot[i]);
-		pivot = pivot * gJointRotUnaligned[i];
-		gJointMatUnaligned[i].translate(pivot);
+		pivot = LLVector3(joint_pivots[i]);
+		pivot = pivot * joint_rots[i];
+		joint_mats[i].translate(pivot);
 	}
+}
+
+//-----------------------------------------------------------------------------
+// uploadJointMatrices()
+//-----------------------------------------------------------------------------
+void LLViewerJointMesh::uploadJointMatrices()
+{
+	S32 joint_num;
+	LLPolyMesh *reference_mesh = mMesh->getReferenceMesh();
+	LLDrawPool *poolp = mFace ? mFace->getPool() : NULL;
+	BOOL hardware_skinning = (poolp && poolp->getVertexShaderLevel() > 0) ? TRUE : FALSE;
+
+	compute_joint_matrices(reference_mesh, gJointMatUnaligned, gJointRotUnaligned, hardware_skinning);
 
 	// upload matrices
 	if (hardware_skinning)
@@ -783,15 +796,11 @@ BOOL LLViewerJointMesh::updateLOD(F32 pixel_area, BOOL activate)
 }
 
 // static
-void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
+void LLViewerJointMesh::updateGeometryOriginal(LLPolyMesh *mMesh, LLStrider<LLVector3> o_vertices, LLStrider<LLVector3> o_normals)
 {
-	LLStrider<LLVector3> o_vertices;
-	LLStrider<LLVector3> o_normals;
-
-	//get vertex and normal striders
-	LLVertexBuffer *buffer = mFace->mVertexBuffer;
-	buffer->getVertexStrider(o_vertices,  0);
-	buffer->getNormalStrider(o_normals,   0);
+	LLMatrix4 joint_mats[32];
+	LLMatrix3 joint_rots[32];
+	compute_joint_matrices(mMesh->getReferenceMesh(), joint_mats, joint_rots, FALSE);
 
 	F32 last_weight = F32_MAX;
 	LLMatrix4 gBlendMat;
@@ -802,8 +811,6 @@ void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 	const LLVector3* normals = mMesh->getNormals();
 	for (U32 index = 0; index < mMesh->getNumVertices(); index++)
 	{
-		U32 bidx = index + mMesh->mFaceVertexOffset;
-		
 		// blend by first matrix
 		F32 w = weights[index]; 
 		
@@ -812,8 +819,8 @@ void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 		// common case.  JC
 		if (w == last_weight)
 		{
-			o_vertices[bidx] = coords[index] * gBlendMat;
-			o_normals[bidx] = normals[index] * gBlendRotMat;
+			o_vertices[index] = coords[index] * gBlendMat;
+			o_normals[index] = normals[index] * gBlendRotMat;
 			continue;
 		}
 		
@@ -825,18 +832,18 @@ void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 		// No lerp required in this case.
 		if (w == 1.0f)
 		{
-			gBlendMat = gJointMatUnaligned[joint+1];
-			o_vertices[bidx] = coords[index] * gBlendMat;
-			gBlendRotMat = gJointRotUnaligned[joint+1];
-			o_normals[bidx] = normals[index] * gBlendRotMat;
+			gBlendMat = joint_mats[joint+1];
+			o_vertices[index] = coords[index] * gBlendMat;
+			gBlendRotMat = joint_rots[joint+1];
+			o_normals[index] = normals[index] * gBlendRotMat;
 			continue;
 		}
 		
 		// Try to keep all the accesses to the matrix data as close
 		// together as possible.  This function is a hot spot on the
 		// Mac. JC
-		LLMatrix4 &m0 = gJointMatUnaligned[joint+1];
-		LLMatrix4 &m1 = gJointMatUnaligned[joint+0];
+		LLMatrix4 &m0 = joint_mats[joint+1];
+		LLMatrix4 &m1 = joint_mats[joint+0];
 		
 		gBlendMat.mMatrix[VX][VX] = lerp(m1.mMatrix[VX][VX], m0.mMatrix[VX][VX], w);
 		gBlendMat.mMatrix[VX][VY] = lerp(m1.mMatrix[VX][VY], m0.mMatrix[VX][VY], w);
@@ -854,10 +861,10 @@ void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 		gBlendMat.mMatrix[VW][VY] = lerp(m1.mMatrix[VW][VY], m0.mMatrix[VW][VY], w);
 		gBlendMat.mMatrix[VW][VZ] = lerp(m1.mMatrix[VW][VZ], m0.mMatrix[VW][VZ], w);
 
-		o_vertices[bidx] = coords[index] * gBlendMat;
+		o_vertices[index] = coords[index] * gBlendMat;
 		
-		LLMatrix3 &n0 = gJointRotUnaligned[joint+1];
-		LLMatrix3 &n1 = gJointRotUnaligned[joint+0];
+		LLMatrix3 &n0 = joint_rots[joint+1];
+		LLMatrix3 &n1 = joint_rots[joint+0];
 		
 		gBlendRotMat.mMatrix[VX][VX] = lerp(n1.mMatrix[VX][VX], n0.mMatrix[VX][VX], w);
 		gBlendRotMat.mMatrix[VX][VY] = lerp(n1.mMatrix[VX][VY], n0.mMatrix[VX][VY], w);
@@ -871,52 +878,142 @@ void LLViewerJointMesh::updateGeometryOriginal(LLFace *mFace, LLPolyMesh *mMesh)
 		gBlendRotMat.mMatrix[VZ][VY] = lerp(n1.mMatrix[VZ][VY], n0.mMatrix[VZ][VY], w);
 		gBlendRotMat.mMatrix[VZ][VZ] = lerp(n1.mMatrix[VZ][VZ], n0.mMatrix[VZ][VZ], w);
 		
-		o_normals[bidx] = normals[index] * gBlendRotMat;
+		o_normals[index] = normals[index] * gBlendRotMat;
 	}
-
-	buffer->setBuffer(0);
 }
 
-const U32 UPDATE_GEOMETRY_CALL_MASK			= 0x1FFF; // 8K samples before overflow
-const U32 UPDATE_GEOMETRY_CALL_OVERFLOW		= ~UPDATE_GEOMETRY_CALL_MASK;
-static bool sUpdateGeometryCallPointer		= false;
-static F64 sUpdateGeometryGlobalTime		= 0.0 ;
-static F64 sUpdateGeometryElapsedTime		= 0.0 ;
-static F64 sUpdateGeometryElapsedTimeOff	= 0.0 ;
-static F64 sUpdateGeometryElapsedTimeOn		= 0.0 ;
-static F64 sUpdateGeometryRunAvgOff[10];
-static F64 sUpdateGeometryRunAvgOn[10];
-static U32 sUpdateGeometryRunCount			= 0 ;
-static U32 sUpdateGeometryCalls				= 0 ;
-static U32 sUpdateGeometryLastProcessor		= 0 ;
+// Skinning paths, compared by the VectorizePerfTest benchmark.  Apart from
+// the original code each one matches a VectorizeProcessor value.
+enum ESkinPath
+{
+	SKIN_PATH_ORIGINAL,
+	SKIN_PATH_VECTORIZED,	// VectorizeProcessor 0
+	SKIN_PATH_SSE,			// VectorizeProcessor 1
+	SKIN_PATH_SSE2,			// VectorizeProcessor 2
+	SKIN_PATH_AVX,			// VectorizeProcessor 3
+	SKIN_PATH_COUNT
+};
+
+static const char* SKIN_PATH_NAMES[SKIN_PATH_COUNT] =
+{
+	"original",
+	"vectorized",
+	"SSE",
+	"SSE2",
+	"AVX"
+};
+
+const U32 SKIN_BENCH_CALLS					= 256;	// meshes skinned with one path before moving to the next
+const U32 SKIN_BENCH_ROUNDS					= 10;	// passes over every path before picking one
+static U32 sSkinBenchPath					= SKIN_PATH_ORIGINAL;
+static U32 sSkinBenchCalls					= 0;
+static U32 sSkinBenchRound					= 0;
+static F64 sSkinBenchTime[SKIN_PATH_COUNT];
+static F64 sSkinBenchVertices[SKIN_PATH_COUNT];
 static BOOL sVectorizePerfTest 				= FALSE;
+static BOOL sVectorizeEnable				= FALSE;
 static U32 sVectorizeProcessor 				= 0;
+static BOOL sVectorizeAVX					= FALSE;
+
+// most job pool workers skinning at once, 0 = skin on the main thread
+static U32 sSkinningWorkers					= 0;
+
+typedef void (*skin_func_t)(LLPolyMesh* mesh, LLStrider<LLVector3> vertices, LLStrider<LLVector3> normals);
+
+// The vertex buffer is mapped on the main thread, the jobs only carry
+// striders into it.
+struct LLSkinningJob
+{
+	LLPolyMesh*				mMesh;
+	LLStrider<LLVector3>	mVertices;
+	LLStrider<LLVector3>	mNormals;
+};
+typedef std::vector<LLSkinningJob> skinning_job_list_t;
+
+class LLSkinningWork : public LLJobPool::Work
+{
+public:
+	LLSkinningWork(const skinning_job_list_t& jobs, skin_func_t func)
+	:	mJobs(jobs),
+		mFunc(func)
+	{
+	}
+
+	/*virtual*/ void run(U32 index)
+	{
+		const LLSkinningJob& job = mJobs[index];
+		mFunc(job.mMesh, job.mVertices, job.mNormals);
+	}
+
+private:
+	const skinning_job_list_t&	mJobs;
+	skin_func_t					mFunc;
+};
+
+static bool skin_path_available(U32 path)
+{
+	switch(path)
+	{
+		case SKIN_PATH_ORIGINAL:	return true;
+		case SKIN_PATH_VECTORIZED:	return sVectorizeEnable;
+		case SKIN_PATH_SSE:			return sVectorizeEnable && gSysCPU.hasSSE();
+		case SKIN_PATH_SSE2:		return sVectorizeEnable && gSysCPU.hasSSE2();
+		case SKIN_PATH_AVX:			return sVectorizeEnable && sVectorizeAVX && gSysCPU.hasAVX();
+		default:					return false;
+	}
+}
+
+static void reset_skin_benchmark()
+{
+	sSkinBenchPath = SKIN_PATH_ORIGINAL;
+	sSkinBenchCalls = 0;
+	sSkinBenchRound = 0;
+	for (U32 i = 0; i < SKIN_PATH_COUNT; ++i)
+	{
+		sSkinBenchTime[i] = 0.0;
+		sSkinBenchVertices[i] = 0.0;
+	}
+}
 
 //static
-void (*LLViewerJointMesh::sUpdateGeometryFunc)(LLFace* face, LLPolyMesh* mesh);
+void (*LLViewerJointMesh::sUpdateGeometryFunc)(LLPolyMesh* mesh, LLStrider<LLVector3> vertices, LLStrider<LLVector3> normals);
 
 //static
 void LLViewerJointMesh::updateVectorize()
 {
-	sVectorizePerfTest = gSavedSettings.getBOOL("VectorizePerfTest");
+	BOOL perf_test = gSavedSettings.getBOOL("VectorizePerfTest");
+	if (perf_test && !sVectorizePerfTest)
+	{
+		reset_skin_benchmark();
+	}
+	sVectorizePerfTest = perf_test;
 	sVectorizeProcessor = gSavedSettings.getU32("VectorizeProcessor");
-	BOOL vectorizeEnable = gSavedSettings.getBOOL("VectorizeEnable");
+	sVectorizeEnable = gSavedSettings.getBOOL("VectorizeEnable");
+	sVectorizeAVX = gSavedSettings.getBOOL("VectorizeAVX");
 	BOOL vectorizeSkin = gSavedSettings.getBOOL("VectorizeSkin");
 
 	std::string vp;
 	switch(sVectorizeProcessor)
 	{
-		case 2: vp = "SSE2"; break;					// *TODO: replace the magic #s
+		case 3: vp = "AVX"; break;					// *TODO: replace the magic #s
+		case 2: vp = "SSE2"; break;
 		case 1: vp = "SSE"; break;
 		default: vp = "COMPILER DEFAULT"; break;
 	}
-	LL_INFOS("AppInit") << "Vectorization         : " << ( vectorizeEnable ? "ENABLED" : "DISABLED" ) << LL_ENDL ;
+	LL_INFOS("AppInit") << "Vectorization         : " << ( sVectorizeEnable ? "ENABLED" : "DISABLED" ) << LL_ENDL ;
 	LL_INFOS("AppInit") << "Vector Processor      : " << vp << LL_ENDL ;
 	LL_INFOS("AppInit") << "Vectorized Skinning   : " << ( vectorizeSkin ? "ENABLED" : "DISABLED" ) << LL_ENDL ;
-	if(vectorizeEnable && vectorizeSkin)
+	if(sVectorizeEnable && vectorizeSkin)
 	{
 		switch(sVectorizeProcessor)
 		{
+			case 3:
+				if (sVectorizeAVX)
+				{
+					sUpdateGeometryFunc = &updateGeometryAVX;
+					break;
+				}
+				// AVX is opt-in, fall back to SSE2
 			case 2:
 				sUpdateGeometryFunc = &updateGeometrySSE2;
 				break;
@@ -934,141 +1031,176 @@ void LLViewerJointMesh::updateVectorize()
 	}
 }
 
+//static
+void LLViewerJointMesh::setSkinningThreads(S32 num_threads)
+{
+	sSkinningWorkers = LLJobPool::resolveMaxWorkers(num_threads);
+}
+
+BOOL LLViewerJointMesh::needsJointGeometry() const
+{
+	return mValid
+		&& mMesh
+		&& mFace
+		&& mMesh->hasWeights()
+		&& mFace->mVertexBuffer.notNull()
+		&& LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) == 0;
+}
+
 void LLViewerJointMesh::updateJointGeometry()
 {
-	if (!(mValid
-		  && mMesh
-		  && mFace
-		  && mMesh->hasWeights()
-		  && mFace->mVertexBuffer.notNull()
-		  && LLViewerShaderMgr::instance()->getVertexShaderLevel(LLViewerShaderMgr::SHADER_AVATAR) == 0))
+	if (!needsJointGeometry())
 	{
 		return;
 	}
 
+	LLStrider<LLVector3> o_vertices;
+	LLStrider<LLVector3> o_normals;
+
+	LLVertexBuffer *buffer = mFace->mVertexBuffer;
+	buffer->getVertexStrider(o_vertices,  mMesh->mFaceVertexOffset);
+	buffer->getNormalStrider(o_normals,   mMesh->mFaceVertexOffset);
+
 	if (!sVectorizePerfTest)
 	{
-		// Once we've measured performance, just run the specified
-		// code version.
-		if(sUpdateGeometryFunc == updateGeometryOriginal)
-			uploadJointMatrices();
-		sUpdateGeometryFunc(mFace, mMesh);
+		sUpdateGeometryFunc(mMesh, o_vertices, o_normals);
 	}
 	else
 	{
-		// At startup, measure the amount of time in skinning and choose
-		// the fastest one.
-		LLTimer ug_timer ;
-		
-		if (sUpdateGeometryCallPointer)
+		benchmarkJointGeometry(mMesh, o_vertices, o_normals);
+	}
+
+	//setBuffer(0) called in LLVOAvatar::renderSkinned
+}
+
+//static
+void LLViewerJointMesh::updateJointGeometry(const mesh_list_t& meshes)
+{
+	LLJobPool* pool = LLAppViewer::getJobPool();
+	if (!sSkinningWorkers || !pool || sVectorizePerfTest)
+	{
+		// the benchmark wants each path timed on its own
+		for (mesh_list_t::const_iterator iter = meshes.begin(); iter != meshes.end(); ++iter)
 		{
-			if(sUpdateGeometryFunc == updateGeometryOriginal)
-				uploadJointMatrices();
-			// call accelerated version for this processor
-			sUpdateGeometryFunc(mFace, mMesh);
+			(*iter)->updateJointGeometry();
 		}
-		else
+		return;
+	}
+
+	// only touched from the main thread
+	static skinning_job_list_t jobs;
+	jobs.clear();
+
+	// map the buffer up front, the skinning threads must not touch GL
+	for (mesh_list_t::const_iterator iter = meshes.begin(); iter != meshes.end(); ++iter)
+	{
+		LLViewerJointMesh* joint_mesh = *iter;
+		if (!joint_mesh->needsJointGeometry())
 		{
-			uploadJointMatrices();
-			updateGeometryOriginal(mFace, mMesh);
+			continue;
 		}
-	
-		sUpdateGeometryElapsedTime += ug_timer.getElapsedTimeF64();
-		++sUpdateGeometryCalls;
-		if(0 != (sUpdateGeometryCalls & UPDATE_GEOMETRY_CALL_OVERFLOW))
+
+		LLSkinningJob job;
+		job.mMesh = joint_mesh->mMesh;
+		LLVertexBuffer *buffer = joint_mesh->mFace->mVertexBuffer;
+		buffer->getVertexStrider(job.mVertices,  job.mMesh->mFaceVertexOffset);
+		buffer->getNormalStrider(job.mNormals,   job.mMesh->mFaceVertexOffset);
+		jobs.push_back(job);
+	}
+
+	LLSkinningWork work(jobs, sUpdateGeometryFunc);
+	pool->run(work, jobs.size(), sSkinningWorkers);
+}
+
+// static
+void LLViewerJointMesh::benchmarkJointGeometry(LLPolyMesh* mesh, LLStrider<LLVector3> o_vertices, LLStrider<LLVector3> o_normals)
+{
+	static void (* const skin_funcs[SKIN_PATH_COUNT])(LLPolyMesh*, LLStrider<LLVector3>, LLStrider<LLVector3>) =
+	{
+		&updateGeometryOriginal,
+		&updateGeometryVectorized,
+		&updateGeometrySSE,
+		&updateGeometrySSE2,
+		&updateGeometryAVX
+	};
+
+	// Every available path skins SKIN_BENCH_CALLS meshes in turn, so they all
+	// see roughly the same scene.  Time is kept per vertex since the meshes
+	// differ a lot in size.
+	LLTimer ug_timer;
+	skin_funcs[sSkinBenchPath](mesh, o_vertices, o_normals);
+	sSkinBenchTime[sSkinBenchPath] += ug_timer.getElapsedTimeF64();
+	sSkinBenchVertices[sSkinBenchPath] += (F64)mesh->getNumVertices();
+
+	if (++sSkinBenchCalls < SKIN_BENCH_CALLS)
+	{
+		return;
+	}
+	sSkinBenchCalls = 0;
+
+	do
+	{
+		if (++sSkinBenchPath == SKIN_PATH_COUNT)
 		{
-			F64 time_since_app_start = ug_timer.getElapsedSeconds();
-			if(sUpdateGeometryGlobalTime == 0.0 
-				|| sUpdateGeometryLastProcessor != sVectorizeProcessor)
-			{
-				sUpdateGeometryGlobalTime		= time_since_app_start;
-				sUpdateGeometryElapsedTime		= 0;
-				sUpdateGeometryCalls			= 0;
-				sUpdateGeometryRunCount			= 0;
-				sUpdateGeometryLastProcessor	= sVectorizeProcessor;
-				sUpdateGeometryCallPointer		= false;
-				return;
-			}
-			F64 percent_time_in_function = 
-				( sUpdateGeometryElapsedTime * 100.0 ) / ( time_since_app_start - sUpdateGeometryGlobalTime ) ;
-			sUpdateGeometryGlobalTime = time_since_app_start;
-			if (!sUpdateGeometryCallPointer)
-			{
-				// First set of run data is with vectorization off.
-				sUpdateGeometryCallPointer = true;
-				llinfos << "profile (avg of " << sUpdateGeometryCalls << " samples) = "
-					<< "vectorize off " << percent_time_in_function
-					<< "% of time with "
-					<< (sUpdateGeometryElapsedTime / (F64)sUpdateGeometryCalls)
-					<< " seconds per call "
-					<< llendl;
-				sUpdateGeometryRunAvgOff[sUpdateGeometryRunCount] = percent_time_in_function;
-				sUpdateGeometryElapsedTimeOff += sUpdateGeometryElapsedTime;
-				sUpdateGeometryCalls = 0;
-			}
-			else
-			{
-				// Second set of run data is with vectorization on.
-				sUpdateGeometryCallPointer = false;
-				llinfos << "profile (avg of " << sUpdateGeometryCalls << " samples) = "
-					<< "VEC on " << percent_time_in_function
-					<< "% of time with "
-					<< (sUpdateGeometryElapsedTime / (F64)sUpdateGeometryCalls)
-					<< " seconds per call "
-					<< llendl;
-				sUpdateGeometryRunAvgOn[sUpdateGeometryRunCount] = percent_time_in_function ;
-				sUpdateGeometryElapsedTimeOn += sUpdateGeometryElapsedTime;
-
-				sUpdateGeometryCalls = 0;
-				sUpdateGeometryRunCount++;
-				F64 a = 0.0, b = 0.0;
-				for(U32 i = 0; i<sUpdateGeometryRunCount; i++)
-				{
-					a += sUpdateGeometryRunAvgOff[i];
-					b += sUpdateGeometryRunAvgOn[i];
-				}
-				a /= sUpdateGeometryRunCount;
-				b /= sUpdateGeometryRunCount;
-				F64 perf_boost = ( sUpdateGeometryElapsedTimeOff - sUpdateGeometryElapsedTimeOn ) / sUpdateGeometryElapsedTimeOn;
-				llinfos << "run averages (" << (F64)sUpdateGeometryRunCount
-					<< "/10) vectorize off " << a
-					<< "% : vectorize type " << sVectorizeProcessor
-					<< " " << b
-					<< "% : performance boost " 
-					<< perf_boost * 100.0
-					<< "%"
-					<< llendl ;
-				if(sUpdateGeometryRunCount == 10)
-				{
-					// In case user runs test again, force reset of data on
-					// next run.
-					sUpdateGeometryGlobalTime = 0.0;
-
-					// We have data now on which version is faster.  Switch to that
-					// code and save the data for next run.
-					gSavedSettings.setBOOL("VectorizePerfTest", FALSE);
-
-					if (perf_boost > 0.0)
-					{
-						llinfos << "Vectorization improves avatar skinning performance, "
-							<< "keeping on for future runs."
-							<< llendl;
-						gSavedSettings.setBOOL("VectorizeSkin", TRUE);
-					}
-					else
-					{
-						// SIMD decreases performance, fall back to original code
-						llinfos << "Vectorization decreases avatar skinning performance, "
-							<< "switching back to original code."
-							<< llendl;
-
-						gSavedSettings.setBOOL("VectorizeSkin", FALSE);
-					}
-				}
-			}
-			sUpdateGeometryElapsedTime = 0.0f;
+			sSkinBenchPath = SKIN_PATH_ORIGINAL;
+			++sSkinBenchRound;
+		}
+	}
+	while (!skin_path_available(sSkinBenchPath));
+
+	if (sSkinBenchRound < SKIN_BENCH_ROUNDS)
+	{
+		return;
+	}
+
+	const F64 original_time = sSkinBenchTime[SKIN_PATH_ORIGINAL] / llmax(sSkinBenchVertices[SKIN_PATH_ORIGINAL], 1.0);
+	U32 best_path = SKIN_PATH_ORIGINAL;
+	F64 best_time = original_time;
+	for (U32 path = SKIN_PATH_ORIGINAL; path < SKIN_PATH_COUNT; ++path)
+	{
+		if (!skin_path_available(path) || sSkinBenchVertices[path] <= 0.0)
+		{
+			continue;
+		}
+
+		F64 time = sSkinBenchTime[path] / sSkinBenchVertices[path];
+		llinfos << "skinning profile (" << SKIN_BENCH_ROUNDS << " runs) = "
+			<< SKIN_PATH_NAMES[path] << " "
+			<< time * 1000000000.0 << " ns per vertex over "
+			<< (U64)sSkinBenchVertices[path] << " vertices : performance boost "
+			<< (original_time / time - 1.0) * 100.0 << "%"
+			<< llendl;
+
+		if (time < best_time)
+		{
+			best_time = time;
+			best_path = path;
 		}
 	}
+
+	reset_skin_benchmark();
+
+	// We have data now on which version is faster.  Switch to that
+	// code and save the data for next run.
+	if (best_path != SKIN_PATH_ORIGINAL)
+	{
+		llinfos << "Vectorization improves avatar skinning performance, "
+			<< "keeping " << SKIN_PATH_NAMES[best_path] << " on for future runs."
+			<< llendl;
+		gSavedSettings.setU32("VectorizeProcessor", best_path - SKIN_PATH_VECTORIZED);
+		gSavedSettings.setBOOL("VectorizeSkin", TRUE);
+	}
+	else
+	{
+		// SIMD decreases performance, fall back to original code
+		llinfos << "Vectorization decreases avatar skinning performance, "
+			<< "switching back to original code."
+			<< llendl;
+		gSavedSettings.setBOOL("VectorizeSkin", FALSE);
+	}
+
+	// also picks up the new path through updateVectorize()
+	gSavedSettings.setBOOL("VectorizePerfTest", FALSE);
 }
 
 void LLViewerJointMesh::dump()
@@ -30,6 +30,7 @@
 #include "llviewerjoint.h"
 #include "llviewertexture.h"
 #include "llpolymesh.h"
+#include "llstrider.h"
 #include "v4color.h"
 
 class LLDrawable;
@@ -87,6 +88,8 @@ public:
 	static LLColor4				sClothingInnerColor;
 
 public:
+	typedef std::vector<LLViewerJointMesh*> mesh_list_t;
+
 	// Constructor
 	LLViewerJointMesh();
 
@@ -137,6 +140,7 @@ public:
 	/*virtual*/ void updateFaceData(LLFace *face, F32 pixel_area, BOOL damp_wind = FALSE, bool terse_update = false);
 	/*virtual*/ BOOL updateLOD(F32 pixel_area, BOOL activate);
 	/*virtual*/ void updateJointGeometry();
+	/*virtual*/ void getSkinnedMeshes(mesh_list_t& meshes) { meshes.push_back(this); }
 	/*virtual*/ void dump();
 
 	void setIsTransparent(BOOL is_transparent) { mIsTransparent = is_transparent; }
@@ -144,22 +148,40 @@ public:
 	/*virtual*/ BOOL isAnimatable() const { return FALSE; }
 	
 	static void updateVectorize(); // Update globals when settings variables change
+
+	// Skins meshes that share one vertex buffer, spreading them over the
+	// job pool.  The caller unmaps the buffer afterwards.
+	static void updateJointGeometry(const mesh_list_t& meshes);
+
+	// most job pool workers to skin with, negative for all of them
+	static void setSkinningThreads(S32 num_threads);
 	
 private:
 	// Avatar vertex skinning is a significant performance issue on computers
 	// with avatar vertex programs turned off (for example, most Macs).  We
 	// therefore have custom versions that use SIMD instructions.
 	//
-	// These functions require compiler options for SSE2, SSE, or neither, and
-	// hence are contained in separate individual .cpp files.  JC
-	static void updateGeometryOriginal(LLFace* face, LLPolyMesh* mesh);
+	// These functions require compiler options for AVX, SSE2, SSE, or neither,
+	// and hence are contained in separate individual .cpp files.  JC
+	//
+	// They write through striders already positioned at the mesh's first
+	// vertex and keep no state of their own, so several meshes can be skinned
+	// at once.
+	static void updateGeometryOriginal(LLPolyMesh* mesh, LLStrider<LLVector3> vertices, LLStrider<LLVector3> normals);
 	// generic vector code, used for Altivec
-	static void updateGeometryVectorized(LLFace* face, LLPolyMesh* mesh);
-	static void updateGeometrySSE(LLFace* face, LLPolyMesh* mesh);
-	static void updateGeometrySSE2(LLFace* face, LLPolyMesh* mesh);
+	static void updateGeometryVectorized(LLPolyMesh* mesh, LLStrider<LLVector3> vertices, LLStrider<LLVector3> normals);
+	static void updateGeometrySSE(LLPolyMesh* mesh, LLStrider<LLVector3> vertices, LLStrider<LLVector3> normals);
+	static void updateGeometrySSE2(LLPolyMesh* mesh, LLStrider<LLVector3> vertices, LLStrider<LLVector3> normals);
+	static void updateGeometryAVX(LLPolyMesh* mesh, LLStrider<LLVector3> vertices, LLStrider<LLVector3> normals);
 
 	// Use a fuction pointer to indicate which version we are running.
-	static void (*sUpdateGeometryFunc)(LLFace* face, LLPolyMesh* mesh);
+	static void (*sUpdateGeometryFunc)(LLPolyMesh* mesh, LLStrider<LLVector3> vertices, LLStrider<LLVector3> normals);
+
+	// VectorizePerfTest: times every path available on this machine
+	static void benchmarkJointGeometry(LLPolyMesh* mesh, LLStrider<LLVector3> vertices, LLStrider<LLVector3> normals);
+
+	// whether this mesh gets skinned on the CPU right now
+	BOOL needsJointGeometry() const;
 
 private:
 	// Allocate skin data
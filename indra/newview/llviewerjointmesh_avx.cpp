@@ -0,0 +1,178 @@
+/** 
+ * @file llviewerjointmesh_avx.cpp
+ * @brief AVX vectorized joint skinning code, only used when video card does
+ * not support avatar vertex programs.
+ *
+ * *NOTE: Disabled on Windows builds. See llv4math.h for details.
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+//-----------------------------------------------------------------------------
+// Header Files
+//-----------------------------------------------------------------------------
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llviewerjointmesh.h"
+
+// project includes
+#include "llpolymesh.h"
+
+// library includes
+#include "lldarray.h"
+#include "llstrider.h"
+#include "llv4math.h"		// for LL_VECTORIZE
+#include "llv4matrix3.h"
+#include "llv4matrix4.h"
+#include "m4math.h"
+#include "v3math.h"
+
+
+// This file is built with the same flags as llviewerjointmesh_sse2.cpp, not
+// with -mavx: every inline function it pulls in from the headers would
+// otherwise be emitted with VEX encodings, and the linker is free to keep
+// that copy for the whole viewer.  Only the functions marked LL_AVX_TARGET
+// below use AVX, and they are only reached once the CPU reported support.
+#if LL_VECTORIZE && LL_LINUX && (defined(__i386__) || defined(__x86_64__)) && \
+	(defined(__clang__) ? (__clang_major__ > 3 || (__clang_major__ == 3 && __clang_minor__ >= 8)) \
+						: (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+
+#include <immintrin.h>
+
+#define LL_AVX_TARGET __attribute__((target("avx")))
+
+static inline void matrix_translate(LLV4Matrix4& m, const LLMatrix4* w, const LLVector3& j)
+{
+	m.mV[VX] = _mm_loadu_ps(w->mMatrix[VX]);
+	m.mV[VY] = _mm_loadu_ps(w->mMatrix[VY]);
+	m.mV[VZ] = _mm_loadu_ps(w->mMatrix[VZ]);
+	m.mV[VW] = _mm_loadu_ps(w->mMatrix[VW]);
+	m.mV[VW] = _mm_add_ps(m.mV[VW], _mm_mul_ps(_mm_set1_ps(j.mV[VX]), m.mV[VX])); // ( ax * vx ) + vw
+	m.mV[VW] = _mm_add_ps(m.mV[VW], _mm_mul_ps(_mm_set1_ps(j.mV[VY]), m.mV[VY]));
+	m.mV[VW] = _mm_add_ps(m.mV[VW], _mm_mul_ps(_mm_set1_ps(j.mV[VZ]), m.mV[VZ]));
+}
+
+// low half from lo, high half from hi
+static inline LL_AVX_TARGET __m256 pair_ps(const __m128& lo, const __m128& hi)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+static inline LL_AVX_TARGET __m256 pair_set1_ps(F32 lo, F32 hi)
+{
+	return pair_ps(_mm_set1_ps(lo), _mm_set1_ps(hi));
+}
+
+static LL_AVX_TARGET void update_geometry_avx(LLPolyMesh *mesh, LLStrider<LLVector3>& o_vertices, LLStrider<LLVector3>& o_normals)
+{
+	// This cannot be a static because it will be initialized before main()
+	// using AVX code, which will crash on older processors.  It also has
+	// to live on the stack, meshes are skinned from several threads.
+	LLV4Matrix4			sJointMat[32];
+	LLDynamicArray<LLJointRenderData*>& joint_data = mesh->getReferenceMesh()->mJointRenderData;
+
+	//upload joint pivots/matrices
+	for(S32 j = 0, jend = joint_data.count(); j < jend ; ++j )
+	{
+		matrix_translate(sJointMat[j], joint_data[j]->mWorldMatrix,
+			joint_data[j]->mSkinJoint ?
+				joint_data[j]->mSkinJoint->mRootToJointSkinOffset
+				: joint_data[j+1]->mSkinJoint->mRootToParentJointSkinOffset);
+	}
+
+	// Two vertices per iteration: the low half of every register belongs to
+	// the even vertex and the high half to the odd one.  Neighbouring vertices
+	// mostly share their weights, so the blended pair is only rebuilt when
+	// one of them changes.
+	F32					weight_lo	= F32_MAX;
+	F32					weight_hi	= F32_MAX;
+	__m256				blend_mat[4];
+	F32					out[8];
+
+	const F32*			weights			= mesh->getWeights();
+	const LLVector3*	coords			= mesh->getCoords();
+	const LLVector3*	normals			= mesh->getNormals();
+	const U32			index_end		= mesh->getNumVertices();
+	U32 index = 0;
+	for (; index + 1 < index_end; index += 2)
+	{
+		if (weight_lo != weights[index] || weight_hi != weights[index+1])
+		{
+			S32 joint_lo = llfloor(weight_lo = weights[index]);
+			S32 joint_hi = llfloor(weight_hi = weights[index+1]);
+			__m256 w = pair_set1_ps(weight_lo - joint_lo, weight_hi - joint_hi);
+			for (S32 i = 0; i < 4; ++i)
+			{
+				__m256 a = pair_ps(sJointMat[joint_lo].mV[i], sJointMat[joint_hi].mV[i]);
+				__m256 b = pair_ps(sJointMat[joint_lo+1].mV[i], sJointMat[joint_hi+1].mV[i]);
+				blend_mat[i] = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(b, a), w), a); // ( b - a ) * w + a
+			}
+		}
+
+		const LLVector3& c0 = coords[index];
+		const LLVector3& c1 = coords[index+1];
+		__m256 v = _mm256_add_ps(blend_mat[VW], _mm256_mul_ps(pair_set1_ps(c0.mV[VX], c1.mV[VX]), blend_mat[VX]));
+		v = _mm256_add_ps(v, _mm256_mul_ps(pair_set1_ps(c0.mV[VY], c1.mV[VY]), blend_mat[VY]));
+		v = _mm256_add_ps(v, _mm256_mul_ps(pair_set1_ps(c0.mV[VZ], c1.mV[VZ]), blend_mat[VZ]));
+		_mm256_storeu_ps(out, v);
+		o_vertices[index].setVec(out);
+		o_vertices[index+1].setVec(out + 4);
+
+		const LLVector3& n0 = normals[index];
+		const LLVector3& n1 = normals[index+1];
+		__m256 n = _mm256_mul_ps(pair_set1_ps(n0.mV[VX], n1.mV[VX]), blend_mat[VX]);
+		n = _mm256_add_ps(n, _mm256_mul_ps(pair_set1_ps(n0.mV[VY], n1.mV[VY]), blend_mat[VY]));
+		n = _mm256_add_ps(n, _mm256_mul_ps(pair_set1_ps(n0.mV[VZ], n1.mV[VZ]), blend_mat[VZ]));
+		_mm256_storeu_ps(out, n);
+		o_normals[index].setVec(out);
+		o_normals[index+1].setVec(out + 4);
+	}
+
+	// odd vertex count, finish the last one four wide
+	if (index < index_end)
+	{
+		LLV4Matrix4 blend_mat;
+		S32 joint = llfloor(weights[index]);
+		blend_mat.lerp(sJointMat[joint], sJointMat[joint+1], weights[index] - joint);
+		blend_mat.multiply(coords[index], o_vertices[index]);
+		((LLV4Matrix3)blend_mat).multiply(normals[index], o_normals[index]);
+	}
+
+}
+
+// static
+void LLViewerJointMesh::updateGeometryAVX(LLPolyMesh *mesh, LLStrider<LLVector3> o_vertices, LLStrider<LLVector3> o_normals)
+{
+	update_geometry_avx(mesh, o_vertices, o_normals);
+
+	//setBuffer(0) called in LLVOAvatar::renderSkinned
+}
+
+#else
+
+void LLViewerJointMesh::updateGeometryAVX(LLPolyMesh *mesh, LLStrider<LLVector3> o_vertices, LLStrider<LLVector3> o_normals)
+{
+	LLViewerJointMesh::updateGeometrySSE2(mesh, o_vertices, o_normals);
+}
+
+#endif
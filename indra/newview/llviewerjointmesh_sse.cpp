@@ -61,11 +61,12 @@ inline void matrix_translate(LLV4Matrix4& m, const LLMatrix4* w, const LLVector3
 }
 
 // static
-void LLViewerJointMesh::updateGeometrySSE(LLFace *face, LLPolyMesh *mesh)
+void LLViewerJointMesh::updateGeometrySSE(LLPolyMesh *mesh, LLStrider<LLVector3> o_vertices, LLStrider<LLVector3> o_normals)
 {
-	// This cannot be a file-level static because it will be initialized
-	// before main() using SSE code, which will crash on non-SSE processors.
-	static LLV4Matrix4	sJointMat[32];
+	// This cannot be a static because it will be initialized before main()
+	// using SSE code, which will crash on non-SSE processors.  It also has
+	// to live on the stack, meshes are skinned from several threads.
+	LLV4Matrix4			sJointMat[32];
 	LLDynamicArray<LLJointRenderData*>& joint_data = mesh->getReferenceMesh()->mJointRenderData;
 
 	//upload joint pivots/matrices
@@ -80,13 +81,6 @@ void LLViewerJointMesh::updateGeometrySSE(LLFace *face, LLPolyMesh *mesh)
 	F32					weight		= F32_MAX;
 	LLV4Matrix4			blend_mat;
 
-	LLStrider<LLVector3> o_vertices;
-	LLStrider<LLVector3> o_normals;
-
-	LLVertexBuffer *buffer = face->mVertexBuffer;
-	buffer->getVertexStrider(o_vertices,  mesh->mFaceVertexOffset);
-	buffer->getNormalStrider(o_normals,   mesh->mFaceVertexOffset);
-
 	const F32*			weights			= mesh->getWeights();
 	const LLVector3*	coords			= mesh->getCoords();
 	const LLVector3*	normals			= mesh->getNormals();
@@ -100,15 +94,13 @@ void LLViewerJointMesh::updateGeometrySSE(LLFace *face, LLPolyMesh *mesh)
 		blend_mat.multiply(coords[index], o_vertices[index]);
 		((LLV4Matrix3)blend_mat).multiply(normals[index], o_normals[index]);
 	}
-
-	buffer->setBuffer(0);
 }
 
 #else
 
-void LLViewerJointMesh::updateGeometrySSE(LLFace *face, LLPolyMesh *mesh)
+void LLViewerJointMesh::updateGeometrySSE(LLPolyMesh *mesh, LLStrider<LLVector3> o_vertices, LLStrider<LLVector3> o_normals)
 {
-	LLViewerJointMesh::updateGeometryVectorized(face, mesh);
+	LLViewerJointMesh::updateGeometryVectorized(mesh, o_vertices, o_normals);
 }
 
 #endif
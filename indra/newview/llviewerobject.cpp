@@ -226,7 +226,8 @@ LLViewerObject::LLViewerObject(const LLUUID &id, const LLPCode pcode, LLViewerRe
 	mDead(FALSE),
 	mOrphaned(FALSE),
 	mUserSelected(FALSE),
-	mOnActiveList(FALSE),
+	mListIndex(-1),
+	mLastIdleFrame(0),
 	mOnMap(FALSE),
 	mStatic(FALSE),
 	mNumFaces(0),
@@ -2195,6 +2196,12 @@ BOOL LLViewerObject::idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time)
 	return TRUE;
 }
 
+void LLViewerObject::idleUpdateMotion(LLAgent &agent, LLWorld &world, const F64 &time)
+{
+	// Not virtual, skips texture animation, flexible and particle updates
+	LLViewerObject::idleUpdate(agent, world, time);
+}
+
 
 // Move an object due to idle-time viewer side updates by iterpolating motion
 void LLViewerObject::interpolateLinearMotion(const F64 & time, const F32 & dt)
@@ -3047,6 +3054,10 @@ void LLViewerObject::setScale(const LLVector3 &scale, BOOL damped)
 				gObjectList.addToMap(this);
 				mOnMap = TRUE;
 			}
+			else
+			{
+				gObjectList.updateOnMap(this);
+			}
 		}
 		else
 		{
@@ -151,6 +151,9 @@ public:
 
 	// Object create and update functions
 	virtual BOOL	idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time);
+	// Motion interpolation and drawable update only, for culled objects
+	// whose full idleUpdate() is skipped this frame
+	void			idleUpdateMotion(LLAgent &agent, LLWorld &world, const F64 &time);
 
 	// Types of media we can associate
 	enum { MEDIA_NONE = 0, MEDIA_SET = 1 };
@@ -172,8 +175,13 @@ public:
 
 
 	virtual BOOL    isActive() const; // Whether this object needs to do an idleUpdate.
-	BOOL			onActiveList() const				{return mOnActiveList;}
-	void			setOnActiveList(BOOL on_active)		{ mOnActiveList = on_active; }
+	BOOL			onActiveList() const				{return mListIndex != -1;}
+	// slot in LLViewerObjectList's dense active list, -1 when not on it
+	S32				getListIndex() const				{ return mListIndex; }
+	void			setListIndex(S32 index)				{ mListIndex = index; }
+	// frame of the last full idleUpdate() from LLViewerObjectList::update()
+	U32				getLastIdleFrame() const			{ return mLastIdleFrame; }
+	void			setLastIdleFrame(U32 frame)			{ mLastIdleFrame = frame; }
 
 	virtual BOOL	isAttachment() const { return FALSE; }
 	virtual BOOL	isHUDAttachment() const { return FALSE; }
@@ -652,7 +660,8 @@ protected:
 	BOOL			mDead;
 	BOOL			mOrphaned;					// This is an orphaned child
 	BOOL			mUserSelected;				// Cached user select information
-	BOOL			mOnActiveList;
+	S32				mListIndex;
+	U32				mLastIdleFrame;
 	BOOL			mOnMap;						// On the map.
 	BOOL			mStatic;					// Object doesn't move.
 	S32				mNumFaces;
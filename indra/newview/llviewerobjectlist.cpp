@@ -37,9 +37,10 @@
 #include "llviewercontrol.h"
 #include "llface.h"
 #include "llvoavatar.h"
+#include "llphysicsmotion.h"
 #include "llviewerobject.h"
 #include "llviewerwindow.h"
-#include "llnetmap.h"
+#include "llnetmapobjectlayer.h"
 #include "llagent.h"
 #include "llagentcamera.h"
 #include "pipeline.h"
@@ -97,6 +98,7 @@ LLViewerObjectList::LLViewerObjectList()
 	mNumVisCulled = 0;
 	mNumSizeCulled = 0;
 	mCurLazyUpdateIndex = 0;
+	mCurSweep = 0;
 	mCurBin = 0;
 	mNumDeadObjects = 0;
 	mNumOrphans = 0;
@@ -253,6 +255,11 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
 	// (from gPipeline.addObject)
 	// so that the drawable parent is set properly
 	findOrphans(objectp, msg->getSenderIP(), msg->getSenderPort());
+
+	if (objectp->mOnMap)
+	{
+		updateOnMap(objectp);
+	}
 	
 	// If we're just wandering around, don't create new objects selected.
 	if (just_created 
@@ -620,8 +627,28 @@ void LLViewerObjectList::dirtyAllObjectInventory()
 	}
 }
 
+static LLFastTimer::DeclareTimer FTM_APPARENT_ANGLES("Apparent Angles");
+static LLFastTimer::DeclareTimer FTM_IDLE_AVATARS("Idle Avatars");
+static LLFastTimer::DeclareTimer FTM_IDLE_VISIBLE("Idle Visible");
+static LLFastTimer::DeclareTimer FTM_IDLE_CULLED("Idle Culled");
+static LLFastTimer::DeclareTimer FTM_IDLE_CULLED_MOTION("Idle Culled Motion");
+
+// Objects that were out of view last frame and nobody is looking at
+// through an attachment or the selection.  Their idle updates and apparent
+// angles are refreshed at a lower rate.
+static bool is_culled_object(LLViewerObject* objectp)
+{
+	return objectp->mDrawable.notNull() &&
+		!objectp->isAvatar() &&
+		!objectp->isAttachment() &&
+		!objectp->isSelected() &&
+		!objectp->mDrawable->isVisible();
+}
+
 void LLViewerObjectList::updateApparentAngles(LLAgent &agent)
 {
+	LLFastTimer t(FTM_APPARENT_ANGLES);
+
 	S32 i;
 	S32 num_objects = 0;
 	LLViewerObject *objectp;
@@ -674,12 +701,23 @@ void LLViewerObjectList::updateApparentAngles(LLAgent &agent)
 	} func;
 	LLSelectMgr::getInstance()->getSelection()->applyToRootObjects(&func);
 
+	// Culled objects only get refreshed every few sweeps, their texture
+	// stats stay from the last refresh in the meantime.
+	U32 culled_sweeps = llmax(gSavedSettings.getU32("ObjectCulledAngleSweeps"), (U32) 1);
+
 	// Iterate through some of the objects and lazy update their texture priorities
 	for (i = mCurLazyUpdateIndex; i < max_value; i++)
 	{
 		objectp = mObjects[i];
 		if (!objectp->isDead())
 		{
+			if (culled_sweeps > 1 &&
+				(mCurSweep + i) % culled_sweeps != 0 &&
+				is_culled_object(objectp))
+			{
+				continue;
+			}
+
 			num_objects++;
 
 			//  Update distance & gpw 
@@ -692,6 +730,7 @@ void LLViewerObjectList::updateApparentAngles(LLAgent &agent)
 	if (mCurLazyUpdateIndex == mObjects.size())
 	{
 		mCurLazyUpdateIndex = 0;
+		mCurSweep++;
 	}
 
 	mCurBin = (mCurBin + 1) % NUM_BINS;
@@ -749,58 +788,125 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 	S32 num_active_objects = 0;
 	LLViewerObject *objectp = NULL;	
 	
-	// Make a copy of the list in case something in idleUpdate() messes with it
-	std::vector<LLViewerObject*> idle_list;
+	// Make a copy of the list in case something in idleUpdate() messes with
+	// it, sorted into buckets by update rate.  Avatars schedule their own
+	// work, visible objects update every frame and culled ones every
+	// ObjectIdleCulledPeriod frames.  Interpolation works off the time of
+	// the last update, so a culled object catches up when its turn comes.
+	// Culled objects that are moving still get their position and drawable
+	// updated in between, so culling sees them where they are.
+	enum
+	{
+		IDLE_AVATARS,
+		IDLE_VISIBLE,
+		IDLE_CULLED,
+		IDLE_CULLED_MOTION,
+		IDLE_BUCKET_COUNT
+	};
+	static std::vector<LLViewerObject*> idle_list[IDLE_BUCKET_COUNT];
+	static LLFastTimer::DeclareTimer* idle_timer[IDLE_BUCKET_COUNT] =
+	{
+		&FTM_IDLE_AVATARS,
+		&FTM_IDLE_VISIBLE,
+		&FTM_IDLE_CULLED,
+		&FTM_IDLE_CULLED_MOTION
+	};
 	
 	static LLFastTimer::DeclareTimer idle_copy("Idle Copy");
 
 	{
 		LLFastTimer t(idle_copy);
-		idle_list.reserve( mActiveObjects.size() );
 
- 		for (std::set<LLPointer<LLViewerObject> >::iterator active_iter = mActiveObjects.begin();
-			active_iter != mActiveObjects.end(); active_iter++)
+		for (S32 bucket = 0; bucket < IDLE_BUCKET_COUNT; ++bucket)
 		{
-			objectp = *active_iter;
-			if (objectp)
-			{
-				idle_list.push_back( objectp );
-			}
-			else
+			idle_list[bucket].clear();
+		}
+
+		U32 culled_period = llmax(gSavedSettings.getU32("ObjectIdleCulledPeriod"), (U32) 1);
+		U32 frame = LLFrameTimer::getFrameCount();
+		S32 count = (S32) mActiveObjects.size();
+		for (S32 i = 0; i < count; ++i)
+		{
+			objectp = mActiveObjects[i];
+			if (!objectp)
 			{	// There shouldn't be any NULL pointers in the list, but they have caused
 				// crashes before.  This may be idleUpdate() messing with the list.
 				llwarns << "LLViewerObjectList::update has a NULL objectp" << llendl;
 			}
+			else if (objectp->isAvatar())
+			{
+				idle_list[IDLE_AVATARS].push_back(objectp);
+				objectp->setLastIdleFrame(frame);
+			}
+			else if (!is_culled_object(objectp))
+			{
+				idle_list[IDLE_VISIBLE].push_back(objectp);
+				objectp->setLastIdleFrame(frame);
+			}
+			else if (frame - objectp->getLastIdleFrame() >= culled_period)
+			{
+				idle_list[IDLE_CULLED].push_back(objectp);
+				// Line the next update up with a phase keyed by ID, so objects
+				// culled on the same frame spread out.  Never later than
+				// culled_period frames from now.
+				objectp->setLastIdleFrame(frame - (frame + objectp->getLocalID()) % culled_period);
+			}
+			else if (!objectp->getVelocity().isExactlyZero() ||
+					 !objectp->getAcceleration().isExactlyZero())
+			{
+				idle_list[IDLE_CULLED_MOTION].push_back(objectp);
+			}
+			else
+			{
+				// skipped this frame, still active
+				num_active_objects++;
+			}
 		}
 	}
 
+	// decide which avatars get a full update before any of them runs
+	LLVOAvatar::scheduleUpdates();
+
 	if (gSavedSettings.getBOOL("FreezeTime"))
 	{
-		for (std::vector<LLViewerObject*>::iterator iter = idle_list.begin();
-			iter != idle_list.end(); iter++)
+		num_active_objects = 0;
+		for (S32 bucket = 0; bucket < IDLE_BUCKET_COUNT; ++bucket)
 		{
-			objectp = *iter;
-			if (objectp->getPCode() == LLViewerObject::LL_VO_CLOUDS ||
-				objectp->isAvatar())
+			for (std::vector<LLViewerObject*>::iterator iter = idle_list[bucket].begin();
+				iter != idle_list[bucket].end(); iter++)
 			{
-				objectp->idleUpdate(agent, world, frame_time);
+				objectp = *iter;
+				if (objectp->getPCode() == LLViewerObject::LL_VO_CLOUDS ||
+					objectp->isAvatar())
+				{
+					objectp->idleUpdate(agent, world, frame_time);
+				}
 			}
 		}
 	}
 	else
 	{
-		for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list.begin();
-			idle_iter != idle_list.end(); idle_iter++)
+		for (S32 bucket = 0; bucket < IDLE_BUCKET_COUNT; ++bucket)
 		{
-			objectp = *idle_iter;
-			if (!objectp->idleUpdate(agent, world, frame_time))
-			{
-				//  If Idle Update returns false, kill object!
-				kill_list.push_back(objectp);
-			}
-			else
+			LLFastTimer t(*idle_timer[bucket]);
+			for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list[bucket].begin();
+				idle_iter != idle_list[bucket].end(); idle_iter++)
 			{
-				num_active_objects++;
+				objectp = *idle_iter;
+				if (bucket == IDLE_CULLED_MOTION)
+				{
+					objectp->idleUpdateMotion(agent, world, frame_time);
+					num_active_objects++;
+				}
+				else if (!objectp->idleUpdate(agent, world, frame_time))
+				{
+					//  If Idle Update returns false, kill object!
+					kill_list.push_back(objectp);
+				}
+				else
+				{
+					num_active_objects++;
+				}
 			}
 		}
 		for (std::vector<LLViewerObject*>::iterator kill_iter = kill_list.begin();
@@ -811,6 +917,12 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 		}
 	}
 
+	// avatars may have queued their motion evaluation in idleUpdate()
+	LLVOAvatar::updateDeferredAnimations();
+
+	// avatar physics queued by the animation updates above
+	LLPhysicsMotionController::updateBatch();
+
 	mNumSizeCulled = 0;
 	mNumVisCulled = 0;
 
@@ -914,8 +1026,7 @@ void LLViewerObjectList::cleanupReferences(LLViewerObject *objectp)
 	if (objectp->onActiveList())
 	{
 		//llinfos << "Removing " << objectp->mID << " " << objectp->getPCodeString() << " from active list in cleanupReferences." << llendl;
-		objectp->setOnActiveList(FALSE);
-		mActiveObjects.erase(objectp);
+		removeFromActiveList(objectp);
 	}
 
 	if (objectp->isOnMap())
@@ -1023,6 +1134,10 @@ void LLViewerObjectList::killAllObjects()
 	if (!mActiveObjects.empty())
 	{
 		llwarns << "Some objects still on active object list!" << llendl;
+		for (vobj_list_t::iterator iter = mActiveObjects.begin(); iter != mActiveObjects.end(); ++iter)
+		{
+			(*iter)->setListIndex(-1);
+		}
 		mActiveObjects.clear();
 	}
 
@@ -1084,18 +1199,38 @@ void LLViewerObjectList::updateActive(LLViewerObject *objectp)
 		if (active)
 		{
 			//llinfos << "Adding " << objectp->mID << " " << objectp->getPCodeString() << " to active list." << llendl;
-			mActiveObjects.insert(objectp);
-			objectp->setOnActiveList(TRUE);
+			objectp->setListIndex(mActiveObjects.size());
+			mActiveObjects.push_back(objectp);
 		}
 		else
 		{
 			//llinfos << "Removing " << objectp->mID << " " << objectp->getPCodeString() << " from active list." << llendl;
-			mActiveObjects.erase(objectp);
-			objectp->setOnActiveList(FALSE);
+			removeFromActiveList(objectp);
 		}
 	}
 }
 
+void LLViewerObjectList::removeFromActiveList(LLViewerObject* objectp)
+{
+	S32 index = objectp->getListIndex();
+	if (index < 0 || index >= (S32) mActiveObjects.size() || mActiveObjects[index] != objectp)
+	{
+		llwarns << "Object " << objectp->mID << " not in its active list slot" << llendl;
+		objectp->setListIndex(-1);
+		return;
+	}
+
+	// move the last object into the hole
+	S32 last = (S32) mActiveObjects.size() - 1;
+	if (index != last)
+	{
+		mActiveObjects[index] = mActiveObjects[last];
+		mActiveObjects[index]->setListIndex(index);
+	}
+	mActiveObjects.pop_back();
+	objectp->setListIndex(-1);
+}
+
 
 
 void LLViewerObjectList::shiftObjects(const LLVector3 &offset)
@@ -1185,89 +1320,55 @@ void LLViewerObjectList::clearAllMapObjectsInRegion(LLViewerRegion* regionp)
 }
 
 
-void LLViewerObjectList::renderObjectsForMap(LLNetMap &netmap)
+void LLViewerObjectList::addObjectsToMapLayer(LLNetMapObjectLayer& layer)
 {
-	LLColor4 above_water_color = LLUIColorTable::instance().getColor( "NetMapOtherOwnAboveWater" );
-	LLColor4 below_water_color = LLUIColorTable::instance().getColor( "NetMapOtherOwnBelowWater" );
-	LLColor4 you_own_above_water_color = 
-						LLUIColorTable::instance().getColor( "NetMapYouOwnAboveWater" );
-	LLColor4 you_own_below_water_color = 
-						LLUIColorTable::instance().getColor( "NetMapYouOwnBelowWater" );
-	LLColor4 group_own_above_water_color = 
-						LLUIColorTable::instance().getColor( "NetMapGroupOwnAboveWater" );
-	LLColor4 group_own_below_water_color = 
-						LLUIColorTable::instance().getColor( "NetMapGroupOwnBelowWater" );
-
-	F32 max_radius = gSavedSettings.getF32("MiniMapPrimMaxRadius");
-
 	for (vobj_list_t::iterator iter = mMapObjects.begin(); iter != mMapObjects.end(); ++iter)
 	{
-		LLViewerObject* objectp = *iter;
-
-		if(objectp->isDead())//some dead objects somehow not cleaned.
-		{
-			continue ;
-		}
+		layer.addObject(*iter);
+	}
+}
 
-		if (!objectp->getRegion() || objectp->isOrphaned() || objectp->isAttachment())
+void LLViewerObjectList::updateActiveObjectsOnMap(LLNetMapObjectLayer& layer)
+{
+	for (vobj_list_t::iterator iter = mActiveObjects.begin(); iter != mActiveObjects.end(); ++iter)
+	{
+		LLViewerObject* objectp = *iter;
+		if (objectp->mOnMap)
 		{
-			continue;
+			layer.updateObject(objectp);
 		}
-		const LLVector3& scale = objectp->getScale();
-		const LLVector3d pos = objectp->getPositionGlobal();
-		const F64 water_height = F64( objectp->getRegion()->getWaterHeight() );
-		// LLWorld::getInstance()->getWaterHeight();
 
-		F32 approx_radius = (scale.mV[VX] + scale.mV[VY]) * 0.5f * 0.5f * 1.3f;  // 1.3 is a fudge
-
-		// Limit the size of megaprims so they don't blot out everything on the minimap.
-		// Attempting to draw very large megaprims also causes client lag.
-		// See DEV-17370 and DEV-29869/SNOW-79 for details.
-		approx_radius = llmin(approx_radius, max_radius);
-
-		LLColor4U color = above_water_color;
-		if( objectp->permYouOwner() )
+		// Children move with their parent
+		LLViewerObject::const_child_list_t& children = objectp->getChildren();
+		for (LLViewerObject::child_list_t::const_iterator child_iter = children.begin(); child_iter != children.end(); ++child_iter)
 		{
-			const F32 MIN_RADIUS_FOR_OWNED_OBJECTS = 2.f;
-			if( approx_radius < MIN_RADIUS_FOR_OWNED_OBJECTS )
+			if ((*child_iter)->mOnMap)
 			{
-				approx_radius = MIN_RADIUS_FOR_OWNED_OBJECTS;
+				layer.updateObject(*child_iter);
 			}
-
-			if( pos.mdV[VZ] >= water_height )
-			{
-				if ( objectp->permGroupOwner() )
-				{
-					color = group_own_above_water_color;
-				}
-				else
-				{
-				color = you_own_above_water_color;
-			}
-			}
-			else
-			{
-				if ( objectp->permGroupOwner() )
-				{
-					color = group_own_below_water_color;
-				}
-			else
-			{
-				color = you_own_below_water_color;
-			}
-		}
-		}
-		else
-		if( pos.mdV[VZ] < water_height )
-		{
-			color = below_water_color;
 		}
+	}
+}
+
+void LLViewerObjectList::addToMap(LLViewerObject *objectp)
+{
+	mMapObjects.push_back(objectp);
+	LLNetMapObjectLayer::getInstance()->addObject(objectp);
+}
 
-		netmap.renderScaledPointGlobal( 
-			pos, 
-			color,
-			approx_radius );
+void LLViewerObjectList::removeFromMap(LLViewerObject *objectp)
+{
+	std::vector<LLPointer<LLViewerObject> >::iterator iter = std::find(mMapObjects.begin(), mMapObjects.end(), objectp);
+	if (iter != mMapObjects.end())
+	{
+		mMapObjects.erase(iter);
 	}
+	LLNetMapObjectLayer::getInstance()->removeObject(objectp);
+}
+
+void LLViewerObjectList::updateOnMap(LLViewerObject *objectp)
+{
+	LLNetMapObjectLayer::getInstance()->updateObject(objectp);
 }
 
 void LLViewerObjectList::renderObjectBounds(const LLVector3 &center)
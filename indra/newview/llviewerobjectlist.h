@@ -38,7 +38,7 @@
 #include "llviewerobject.h"
 
 class LLCamera;
-class LLNetMap;
+class LLNetMapObjectLayer;
 class LLDebugBeacon;
 
 const U32 CLOSE_BIN_SIZE = 10;
@@ -89,7 +89,9 @@ public:
 
 	bool hasMapObjectInRegion(LLViewerRegion* regionp) ;
 	void clearAllMapObjectsInRegion(LLViewerRegion* regionp) ;
-	void renderObjectsForMap(LLNetMap &netmap);
+	// Minimap object layer: all the objects on the map, and the moving ones and their children
+	void addObjectsToMapLayer(LLNetMapObjectLayer& layer);
+	void updateActiveObjectsOnMap(LLNetMapObjectLayer& layer);
 	void renderObjectBounds(const LLVector3 &center);
 
 	void addDebugBeacon(const LLVector3 &pos_agent, const std::string &string,
@@ -102,6 +104,7 @@ public:
 	void dirtyAllObjectInventory();
 
 	void updateActive(LLViewerObject *objectp);
+	void removeFromActiveList(LLViewerObject* objectp);
 	void updateAvatarVisibility();
 
 	// Selection related stuff
@@ -113,6 +116,7 @@ public:
 
 	void addToMap(LLViewerObject *objectp);
 	void removeFromMap(LLViewerObject *objectp);
+	void updateOnMap(LLViewerObject *objectp);	// Position, scale or ownership of an object on the map changed
 
 	void clearDebugText();
 
@@ -178,7 +182,9 @@ protected:
 	typedef std::vector<LLPointer<LLViewerObject> > vobj_list_t;
 
 	vobj_list_t mObjects;
-	std::set<LLPointer<LLViewerObject> > mActiveObjects;
+	// Dense, objects keep their slot (LLViewerObject::getListIndex()) so
+	// they come off in constant time
+	vobj_list_t mActiveObjects;
 
 	vobj_list_t mMapObjects;
 
@@ -189,6 +195,7 @@ protected:
 	std::vector<LLDebugBeacon> mDebugBeacons;
 
 	S32 mCurLazyUpdateIndex;
+	U32 mCurSweep; // Full passes of updateApparentAngles() so far
 
 	static U32 sSimulatorMachineIndex;
 	static std::map<U64, U32> sIPAndPortToIndex;
@@ -255,19 +262,5 @@ inline LLViewerObject *LLViewerObjectList::getObject(const S32 index)
 	return objectp;
 }
 
-inline void LLViewerObjectList::addToMap(LLViewerObject *objectp)
-{
-	mMapObjects.push_back(objectp);
-}
-
-inline void LLViewerObjectList::removeFromMap(LLViewerObject *objectp)
-{
-	std::vector<LLPointer<LLViewerObject> >::iterator iter = std::find(mMapObjects.begin(), mMapObjects.end(), objectp);
-	if (iter != mMapObjects.end())
-	{
-		mMapObjects.erase(iter);
-	}
-}
-
 
 #endif // LL_VIEWER_OBJECT_LIST_H
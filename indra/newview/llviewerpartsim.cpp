@@ -39,6 +39,7 @@
 #include "llworld.h"
 #include "pipeline.h"
 #include "llspatialpartition.h"
+#include "llv4math.h"		// for LL_VECTORIZE
 #include "llvovolume.h"
 
 const F32 PART_SIM_BOX_SIDE = 16.f;
@@ -64,6 +65,17 @@ const F32 LLViewerPartSim::PART_ADAPT_RATE_MULT_RECIP = 1.0f/PART_ADAPT_RATE_MUL
 
 
 U32 LLViewerPart::sNextPartID = 1;
+std::vector<void*> LLViewerPart::sFreeParts;
+
+// Never keep more spare records around than the simulation could use.
+const U32 MAX_FREE_PARTS = 8192;
+
+// Flags that the vectorized update doesn't handle.
+const U32 PART_CUSTOM_FLAGS = LLPartData::LL_PART_FOLLOW_SRC_MASK |
+							  LLPartData::LL_PART_WIND_MASK |
+							  LLPartData::LL_PART_TARGET_POS_MASK |
+							  LLPartData::LL_PART_TARGET_LINEAR_MASK |
+							  LLPartData::LL_PART_BOUNCE_MASK;
 
 F32 calc_desired_size(LLViewerCamera* camera, LLVector3 pos, LLVector2 scale)
 {
@@ -109,6 +121,41 @@ void LLViewerPart::init(LLPointer<LLViewerPartSource> sourcep, LLViewerTexture *
 	mImagep = imagep;
 }
 
+//static
+void* LLViewerPart::operator new(size_t size)
+{
+	if (size != sizeof(LLViewerPart) || sFreeParts.empty())
+	{
+		return ::operator new(size);
+	}
+	void* ptr = sFreeParts.back();
+	sFreeParts.pop_back();
+	return ptr;
+}
+
+//static
+void LLViewerPart::operator delete(void* ptr)
+{
+	if (ptr && sFreeParts.size() < MAX_FREE_PARTS)
+	{
+		sFreeParts.push_back(ptr);
+	}
+	else
+	{
+		::operator delete(ptr);
+	}
+}
+
+//static
+void LLViewerPart::cleanupClass()
+{
+	for (std::vector<void*>::iterator iter = sFreeParts.begin(); iter != sFreeParts.end(); ++iter)
+	{
+		::operator delete(*iter);
+	}
+	sFreeParts.clear();
+}
+
 
 /////////////////////////////
 //
@@ -252,151 +299,393 @@ BOOL LLViewerPartGroup::addPart(LLViewerPart* part, F32 desired_size)
 
 	gPipeline.markRebuild(mVOPartGroupp->mDrawable, LLDrawable::REBUILD_ALL, TRUE);
 	
-	mParticles.push_back(part);
 	part->mSkipOffset=mSkippedTime;
+	appendPart(part);
 	LLViewerPartSim::incPartCount(1);
 	return TRUE;
 }
 
+LLViewerTexture* LLViewerPartGroup::getPartImage(S32 i) const
+{
+	return mParticles[i]->mImagep;
+}
 
-void LLViewerPartGroup::updateParticles(const F32 lastdt)
+void LLViewerPartGroup::appendPart(LLViewerPart* part)
 {
-	LLMemType mt(LLMemType::MTYPE_PARTICLES);
-	F32 dt;
-	
-	LLVector3 gravity(0.f, 0.f, GRAVITY);
+	mParticles.push_back(part);
+	for (S32 k = 0; k < NUM_PART_ARRAYS; k++)
+	{
+		mArrays[k].push_back(0.f);
+	}
+	mPartFlags.push_back(0);
+	mPartCustom.push_back(0);
+	loadPart((S32)mParticles.size() - 1);
+}
 
-	LLViewerPartSim::checkParticleCount(mParticles.size());
+void LLViewerPartGroup::removePart(S32 i)
+{
+	// same swap-with-last removal the particle list has always used
+	S32 last = (S32)mParticles.size() - 1;
+	mParticles[i] = mParticles[last];
+	mParticles.pop_back();
+	for (S32 k = 0; k < NUM_PART_ARRAYS; k++)
+	{
+		mArrays[k][i] = mArrays[k][last];
+		mArrays[k].pop_back();
+	}
+	mPartFlags[i] = mPartFlags[last];
+	mPartFlags.pop_back();
+	mPartCustom[i] = mPartCustom[last];
+	mPartCustom.pop_back();
+}
 
-	LLViewerCamera* camera = LLViewerCamera::getInstance();
-	LLViewerRegion *regionp = getRegion();
-	S32 end = (S32) mParticles.size();
-	for (S32 i = 0 ; i < (S32)mParticles.size();)
+void LLViewerPartGroup::loadPart(S32 i)
+{
+	const LLViewerPart* part = mParticles[i];
+	for (S32 k = 0; k < 3; k++)
+	{
+		mArrays[ARRAY_POS_X + k][i] = part->mPosAgent.mV[k];
+		mArrays[ARRAY_VEL_X + k][i] = part->mVelocity.mV[k];
+		mArrays[ARRAY_ACCEL_X + k][i] = part->mAccel.mV[k];
+	}
+	for (S32 k = 0; k < 4; k++)
+	{
+		mArrays[ARRAY_COLOR_R + k][i] = part->mColor.mV[k];
+		mArrays[ARRAY_START_COLOR_R + k][i] = part->mStartColor.mV[k];
+		mArrays[ARRAY_END_COLOR_R + k][i] = part->mEndColor.mV[k];
+	}
+	for (S32 k = 0; k < 2; k++)
+	{
+		mArrays[ARRAY_SCALE_X + k][i] = part->mScale.mV[k];
+		mArrays[ARRAY_START_SCALE_X + k][i] = part->mStartScale.mV[k];
+		mArrays[ARRAY_END_SCALE_X + k][i] = part->mEndScale.mV[k];
+	}
+	mArrays[ARRAY_AGE][i] = part->mLastUpdateTime;
+	mArrays[ARRAY_MAX_AGE][i] = part->mMaxAge;
+	mArrays[ARRAY_SKIP_OFFSET][i] = part->mSkipOffset;
+	mPartFlags[i] = part->mFlags;
+	mPartCustom[i] = (part->mVPCallback || (part->mFlags & PART_CUSTOM_FLAGS)) ? 1 : 0;
+}
+
+void LLViewerPartGroup::syncPart(S32 i)
+{
+	// only the state the update changes; the rest of the record is current
+	LLViewerPart* part = mParticles[i];
+	for (S32 k = 0; k < 3; k++)
+	{
+		part->mPosAgent.mV[k] = mArrays[ARRAY_POS_X + k][i];
+		part->mVelocity.mV[k] = mArrays[ARRAY_VEL_X + k][i];
+	}
+	for (S32 k = 0; k < 4; k++)
+	{
+		part->mColor.mV[k] = mArrays[ARRAY_COLOR_R + k][i];
+	}
+	for (S32 k = 0; k < 2; k++)
 	{
-		LLVector3 a(0.f, 0.f, 0.f);
-		LLViewerPart* part = mParticles[i] ;
+		part->mScale.mV[k] = mArrays[ARRAY_SCALE_X + k][i];
+	}
+	part->mLastUpdateTime = mArrays[ARRAY_AGE][i];
+	part->mSkipOffset = mArrays[ARRAY_SKIP_OFFSET][i];
+	part->mFlags = mPartFlags[i];
+}
+
+// Full update of a single particle, for the ones that follow their source,
+// sample the wind, chase a target, bounce or run a callback.
+static void update_custom_part(LLViewerPart* part, const F32 dt, LLViewerRegion* regionp)
+{
+	// Update current time
+	const F32 cur_time = part->mLastUpdateTime + dt;
+	const F32 frac = cur_time / part->mMaxAge;
+
+	// "Drift" the object based on the source object
+	if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+	{
+		part->mPosAgent = part->mPartSourcep->mPosAgent;
+		part->mPosAgent += part->mPosOffset;
+	}
+
+	// Do a custom callback if we have one...
+	if (part->mVPCallback)
+	{
+		(*part->mVPCallback)(*part, dt);
+	}
+
+	if (part->mFlags & LLPartData::LL_PART_WIND_MASK)
+	{
+		part->mVelocity *= 1.f - 0.1f*dt;
+		part->mVelocity += 0.1f*dt*regionp->mWind.getVelocity(regionp->getPosRegionFromAgent(part->mPosAgent));
+	}
+
+	// Now do interpolation towards a target
+	if (part->mFlags & LLPartData::LL_PART_TARGET_POS_MASK)
+	{
+		F32 remaining = part->mMaxAge - part->mLastUpdateTime;
+		F32 step = dt / remaining;
+
+		step = llclamp(step, 0.f, 0.1f);
+		step *= 5.f;
+		// we want a velocity that will result in reaching the target in the 
+		// Interpolate towards the target.
+		LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPosAgent;
+
+		delta_pos /= remaining;
+
+		part->mVelocity *= (1.f - step);
+		part->mVelocity += step*delta_pos;
+	}
 
-		dt = lastdt + mSkippedTime - part->mSkipOffset;
-		part->mSkipOffset = 0.f;
 
-		// Update current time
-		const F32 cur_time = part->mLastUpdateTime + dt;
-		const F32 frac = cur_time / part->mMaxAge;
+	if (part->mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK)
+	{
+		LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPartSourcep->mPosAgent;			
+		part->mPosAgent = part->mPartSourcep->mPosAgent;
+		part->mPosAgent += frac*delta_pos;
+		part->mVelocity = delta_pos;
+	}
+	else
+	{
+		// Do velocity interpolation
+		part->mPosAgent += dt*part->mVelocity;
+		part->mPosAgent += 0.5f*dt*dt*part->mAccel;
+		part->mVelocity += part->mAccel*dt;
+	}
 
-		// "Drift" the object based on the source object
-		if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+	// Do a bounce test
+	if (part->mFlags & LLPartData::LL_PART_BOUNCE_MASK)
+	{
+		// Need to do point vs. plane check...
+		// For now, just check relative to object height...
+		F32 dz = part->mPosAgent.mV[VZ] - part->mPartSourcep->mPosAgent.mV[VZ];
+		if (dz < 0)
 		{
-			part->mPosAgent = part->mPartSourcep->mPosAgent;
-			part->mPosAgent += part->mPosOffset;
+			part->mPosAgent.mV[VZ] += -2.f*dz;
+			part->mVelocity.mV[VZ] *= -0.75f;
 		}
+	}
 
-		// Do a custom callback if we have one...
-		if (part->mVPCallback)
+
+	// Reset the offset from the source position
+	if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+	{
+		part->mPosOffset = part->mPosAgent;
+		part->mPosOffset -= part->mPartSourcep->mPosAgent;
+	}
+
+	// Do color interpolation
+	if (part->mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
+	{
+		part->mColor.setVec(part->mStartColor);
+		// note: LLColor4's v%k means multiply-alpha-only,
+		//       LLColor4's v*k means multiply-rgb-only
+		part->mColor *= 1.f - frac; // rgb*k
+		part->mColor %= 1.f - frac; // alpha*k
+		part->mColor += frac%(frac*part->mEndColor); // rgb,alpha
+	}
+
+	// Do scale interpolation
+	if (part->mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
+	{
+		part->mScale.setVec(part->mStartScale);
+		part->mScale *= 1.f - frac;
+		part->mScale += frac*part->mEndScale;
+	}
+
+	// Set the last update time to now.
+	part->mLastUpdateTime = cur_time;
+}
+
+// Ballistic motion plus color and scale interpolation for one particle in
+// the group arrays.  Performs the same operations in the same order as
+// update_custom_part() so both paths produce identical results.
+static inline void integrate_part(F32** a, const U32 flags, const S32 i, const F32 group_dt)
+{
+	typedef LLViewerPartGroup G;
+
+	const F32 dt = group_dt - a[G::ARRAY_SKIP_OFFSET][i];
+	a[G::ARRAY_SKIP_OFFSET][i] = 0.f;
+
+	const F32 cur_time = a[G::ARRAY_AGE][i] + dt;
+	const F32 frac = cur_time / a[G::ARRAY_MAX_AGE][i];
+	const F32 half_dt_sq = 0.5f*dt*dt;
+
+	for (S32 k = 0; k < 3; k++)
+	{
+		F32& pos = a[G::ARRAY_POS_X + k][i];
+		F32& vel = a[G::ARRAY_VEL_X + k][i];
+		const F32 accel = a[G::ARRAY_ACCEL_X + k][i];
+		pos = (pos + dt*vel) + half_dt_sq*accel;
+		vel = vel + accel*dt;
+	}
+
+	const F32 inv_frac = 1.f - frac;
+	if (flags & LLPartData::LL_PART_INTERP_COLOR_MASK)
+	{
+		for (S32 k = 0; k < 4; k++)
 		{
-			(*part->mVPCallback)(*part, dt);
+			a[G::ARRAY_COLOR_R + k][i] = a[G::ARRAY_START_COLOR_R + k][i]*inv_frac + a[G::ARRAY_END_COLOR_R + k][i]*frac;
 		}
-
-		if (part->mFlags & LLPartData::LL_PART_WIND_MASK)
+	}
+	if (flags & LLPartData::LL_PART_INTERP_SCALE_MASK)
+	{
+		for (S32 k = 0; k < 2; k++)
 		{
-			LLVector3 tempVel(part->mVelocity);
-			part->mVelocity *= 1.f - 0.1f*dt;
-			part->mVelocity += 0.1f*dt*regionp->mWind.getVelocity(regionp->getPosRegionFromAgent(part->mPosAgent));
+			a[G::ARRAY_SCALE_X + k][i] = a[G::ARRAY_START_SCALE_X + k][i]*inv_frac + a[G::ARRAY_END_SCALE_X + k][i]*frac;
 		}
+	}
 
-		// Now do interpolation towards a target
-		if (part->mFlags & LLPartData::LL_PART_TARGET_POS_MASK)
-		{
-			F32 remaining = part->mMaxAge - part->mLastUpdateTime;
-			F32 step = dt / remaining;
+	a[G::ARRAY_AGE][i] = cur_time;
+}
 
-			step = llclamp(step, 0.f, 0.1f);
-			step *= 5.f;
-			// we want a velocity that will result in reaching the target in the 
-			// Interpolate towards the target.
-			LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPosAgent;
+#if LL_VECTORIZE
+static inline __m128 select_ps(const __m128 mask, const __m128 a, const __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
 
-			delta_pos /= remaining;
+// all ones in the lanes whose value has any of the mask bits set
+template <class T>
+static inline __m128 lane_mask(const T* values, const U32 mask)
+{
+	return _mm_cmpneq_ps(_mm_set_ps((values[3] & mask) ? 1.f : 0.f,
+									(values[2] & mask) ? 1.f : 0.f,
+									(values[1] & mask) ? 1.f : 0.f,
+									(values[0] & mask) ? 1.f : 0.f),
+						 _mm_setzero_ps());
+}
+#endif
 
-			part->mVelocity *= (1.f - step);
-			part->mVelocity += step*delta_pos;
+// Advances every particle that doesn't take the per-particle path, four at
+// a time where SSE is available.
+static void integrate_parts(F32** a, const U32* flags, const U8* custom, const S32 count, const F32 group_dt)
+{
+	typedef LLViewerPartGroup G;
+
+	S32 i = 0;
+#if LL_VECTORIZE
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 group_dt4 = _mm_set1_ps(group_dt);
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 active = _mm_andnot_ps(lane_mask(custom + i, 1), _mm_cmpeq_ps(zero, zero));
+		if (!_mm_movemask_ps(active))
+		{
+			continue;
 		}
+		const __m128 interp_color = _mm_and_ps(active, lane_mask(flags + i, LLPartData::LL_PART_INTERP_COLOR_MASK));
+		const __m128 interp_scale = _mm_and_ps(active, lane_mask(flags + i, LLPartData::LL_PART_INTERP_SCALE_MASK));
 
+		const __m128 skip = _mm_loadu_ps(a[G::ARRAY_SKIP_OFFSET] + i);
+		const __m128 dt = _mm_sub_ps(group_dt4, skip);
+		_mm_storeu_ps(a[G::ARRAY_SKIP_OFFSET] + i, select_ps(active, zero, skip));
 
-		if (part->mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK)
+		const __m128 age = _mm_loadu_ps(a[G::ARRAY_AGE] + i);
+		const __m128 cur_time = _mm_add_ps(age, dt);
+		const __m128 frac = _mm_div_ps(cur_time, _mm_loadu_ps(a[G::ARRAY_MAX_AGE] + i));
+		const __m128 half_dt_sq = _mm_mul_ps(_mm_mul_ps(half, dt), dt);
+
+		for (S32 k = 0; k < 3; k++)
 		{
-			LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPartSourcep->mPosAgent;			
-			part->mPosAgent = part->mPartSourcep->mPosAgent;
-			part->mPosAgent += frac*delta_pos;
-			part->mVelocity = delta_pos;
+			const __m128 pos = _mm_loadu_ps(a[G::ARRAY_POS_X + k] + i);
+			const __m128 vel = _mm_loadu_ps(a[G::ARRAY_VEL_X + k] + i);
+			const __m128 accel = _mm_loadu_ps(a[G::ARRAY_ACCEL_X + k] + i);
+			const __m128 new_pos = _mm_add_ps(_mm_add_ps(pos, _mm_mul_ps(dt, vel)), _mm_mul_ps(half_dt_sq, accel));
+			const __m128 new_vel = _mm_add_ps(vel, _mm_mul_ps(accel, dt));
+			_mm_storeu_ps(a[G::ARRAY_POS_X + k] + i, select_ps(active, new_pos, pos));
+			_mm_storeu_ps(a[G::ARRAY_VEL_X + k] + i, select_ps(active, new_vel, vel));
 		}
-		else
+
+		const __m128 inv_frac = _mm_sub_ps(one, frac);
+		if (_mm_movemask_ps(interp_color))
 		{
-			// Do velocity interpolation
-			part->mPosAgent += dt*part->mVelocity;
-			part->mPosAgent += 0.5f*dt*dt*part->mAccel;
-			part->mVelocity += part->mAccel*dt;
+			for (S32 k = 0; k < 4; k++)
+			{
+				const __m128 color = _mm_loadu_ps(a[G::ARRAY_COLOR_R + k] + i);
+				const __m128 new_color = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a[G::ARRAY_START_COLOR_R + k] + i), inv_frac),
+													_mm_mul_ps(_mm_loadu_ps(a[G::ARRAY_END_COLOR_R + k] + i), frac));
+				_mm_storeu_ps(a[G::ARRAY_COLOR_R + k] + i, select_ps(interp_color, new_color, color));
+			}
 		}
-
-		// Do a bounce test
-		if (part->mFlags & LLPartData::LL_PART_BOUNCE_MASK)
+		if (_mm_movemask_ps(interp_scale))
 		{
-			// Need to do point vs. plane check...
-			// For now, just check relative to object height...
-			F32 dz = part->mPosAgent.mV[VZ] - part->mPartSourcep->mPosAgent.mV[VZ];
-			if (dz < 0)
+			for (S32 k = 0; k < 2; k++)
 			{
-				part->mPosAgent.mV[VZ] += -2.f*dz;
-				part->mVelocity.mV[VZ] *= -0.75f;
+				const __m128 scale = _mm_loadu_ps(a[G::ARRAY_SCALE_X + k] + i);
+				const __m128 new_scale = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a[G::ARRAY_START_SCALE_X + k] + i), inv_frac),
+													_mm_mul_ps(_mm_loadu_ps(a[G::ARRAY_END_SCALE_X + k] + i), frac));
+				_mm_storeu_ps(a[G::ARRAY_SCALE_X + k] + i, select_ps(interp_scale, new_scale, scale));
 			}
 		}
 
-
-		// Reset the offset from the source position
-		if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+		_mm_storeu_ps(a[G::ARRAY_AGE] + i, select_ps(active, cur_time, age));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		if (!custom[i])
 		{
-			part->mPosOffset = part->mPosAgent;
-			part->mPosOffset -= part->mPartSourcep->mPosAgent;
+			integrate_part(a, flags[i], i, group_dt);
 		}
+	}
+}
 
-		// Do color interpolation
-		if (part->mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
+
+void LLViewerPartGroup::updateParticles(const F32 lastdt)
+{
+	LLMemType mt(LLMemType::MTYPE_PARTICLES);
+
+	LLViewerPartSim::checkParticleCount(mParticles.size());
+
+	LLViewerCamera* camera = LLViewerCamera::getInstance();
+	LLViewerRegion *regionp = getRegion();
+	S32 end = (S32) mParticles.size();
+
+	// Particles that follow their source, sample the wind, chase a target,
+	// bounce or run a callback are updated one at a time on their records.
+	for (S32 i = 0; i < end; i++)
+	{
+		if (mPartCustom[i])
 		{
-			part->mColor.setVec(part->mStartColor);
-			// note: LLColor4's v%k means multiply-alpha-only,
-			//       LLColor4's v*k means multiply-rgb-only
-			part->mColor *= 1.f - frac; // rgb*k
-			part->mColor %= 1.f - frac; // alpha*k
-			part->mColor += frac%(frac*part->mEndColor); // rgb,alpha
+			syncPart(i);
+			LLViewerPart* part = mParticles[i];
+			const F32 dt = lastdt + mSkippedTime - part->mSkipOffset;
+			part->mSkipOffset = 0.f;
+			update_custom_part(part, dt, regionp);
+			loadPart(i);
 		}
+	}
 
-		// Do scale interpolation
-		if (part->mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
+	// Everything else is integrated straight out of the arrays.
+	if (end)
+	{
+		F32* arrays[NUM_PART_ARRAYS];
+		for (S32 k = 0; k < NUM_PART_ARRAYS; k++)
 		{
-			part->mScale.setVec(part->mStartScale);
-			part->mScale *= 1.f - frac;
-			part->mScale += frac*part->mEndScale;
+			arrays[k] = &mArrays[k][0];
 		}
+		integrate_parts(arrays, &mPartFlags[0], &mPartCustom[0], end, lastdt + mSkippedTime);
+	}
 
-		// Set the last update time to now.
-		part->mLastUpdateTime = cur_time;
-
-
+	for (S32 i = 0 ; i < (S32)mParticles.size();)
+	{
 		// Kill dead particles (either flagged dead, or too old)
-		if ((part->mLastUpdateTime > part->mMaxAge) || (LLViewerPart::LL_PART_DEAD_MASK == part->mFlags))
+		if ((mArrays[ARRAY_AGE][i] > mArrays[ARRAY_MAX_AGE][i]) || (LLViewerPart::LL_PART_DEAD_MASK == mPartFlags[i]))
 		{
-			mParticles[i] = mParticles.back() ;
-			mParticles.pop_back() ;
+			LLViewerPart* part = mParticles[i];
+			removePart(i);
 			delete part ;
 		}
 		else 
 		{
-			F32 desired_size = calc_desired_size(camera, part->mPosAgent, part->mScale);
-			if (!posInGroup(part->mPosAgent, desired_size))
+			F32 desired_size = calc_desired_size(camera, getPartPosition(i), getPartScale(i));
+			if (!posInGroup(getPartPosition(i), desired_size))
 			{
 				// Transfer particles between groups
+				syncPart(i);
+				LLViewerPart* part = mParticles[i];
+				removePart(i);
 				LLViewerPartSim::getInstance()->put(part) ;
-				mParticles[i] = mParticles.back() ;
-				mParticles.pop_back() ;
 			}
 			else
 			{
@@ -436,7 +725,9 @@ void LLViewerPartGroup::shift(const LLVector3 &offset)
 
 	for (S32 i = 0 ; i < (S32)mParticles.size(); i++)
 	{
-		mParticles[i]->mPosAgent += offset;
+		mArrays[ARRAY_POS_X][i] += offset.mV[VX];
+		mArrays[ARRAY_POS_Y][i] += offset.mV[VY];
+		mArrays[ARRAY_POS_Z][i] += offset.mV[VZ];
 	}
 }
 
@@ -448,7 +739,7 @@ void LLViewerPartGroup::removeParticlesByID(const U32 source_id)
 	{
 		if(mParticles[i]->mPartSourcep->getID() == source_id)
 		{
-			mParticles[i]->mFlags = LLViewerPart::LL_PART_DEAD_MASK;
+			mPartFlags[i] = LLViewerPart::LL_PART_DEAD_MASK;
 		}		
 	}
 }
@@ -498,6 +789,8 @@ void LLViewerPartSim::destroyClass()
 
 	// Kill all of the sources 
 	mViewerPartSources.clear();
+
+	LLViewerPart::cleanupClass();
 }
 
 BOOL LLViewerPartSim::shouldAddPart()
@@ -56,6 +56,11 @@ public:
 
 	void init(LLPointer<LLViewerPartSource> sourcep, LLViewerTexture *imagep, LLVPCallback cb);
 
+	// Bursts create and kill thousands of particles a second, so records
+	// are recycled through a free list instead of going back to the heap.
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr);
+	static void cleanupClass();
 
 	U32					mPartID;					// Particle ID used primarily for moving between groups
 	F32					mLastUpdateTime;			// Last time the particle was updated
@@ -74,6 +79,9 @@ public:
 	LLVector2		mScale;
 
 	static U32		sNextPartID;
+
+private:
+	static std::vector<void*> sFreeParts;
 };
 
 
@@ -104,6 +112,35 @@ public:
 	LLViewerRegion *getRegion() const		{ return mRegionp; }
 
 	void removeParticlesByID(const U32 source_id);
+
+	// While a particle belongs to a group its simulation state lives in the
+	// group's component arrays below rather than in its LLViewerPart, so the
+	// common case updates and renders without touching the record.  The
+	// record keeps the source, texture and callback, and is synced back
+	// only for particles that need per-particle handling or change groups.
+	enum EPartArray
+	{
+		ARRAY_POS_X, ARRAY_POS_Y, ARRAY_POS_Z,
+		ARRAY_VEL_X, ARRAY_VEL_Y, ARRAY_VEL_Z,
+		ARRAY_ACCEL_X, ARRAY_ACCEL_Y, ARRAY_ACCEL_Z,
+		ARRAY_COLOR_R, ARRAY_COLOR_G, ARRAY_COLOR_B, ARRAY_COLOR_A,
+		ARRAY_START_COLOR_R, ARRAY_START_COLOR_G, ARRAY_START_COLOR_B, ARRAY_START_COLOR_A,
+		ARRAY_END_COLOR_R, ARRAY_END_COLOR_G, ARRAY_END_COLOR_B, ARRAY_END_COLOR_A,
+		ARRAY_SCALE_X, ARRAY_SCALE_Y,
+		ARRAY_START_SCALE_X, ARRAY_START_SCALE_Y,
+		ARRAY_END_SCALE_X, ARRAY_END_SCALE_Y,
+		ARRAY_AGE,
+		ARRAY_MAX_AGE,
+		ARRAY_SKIP_OFFSET,
+		NUM_PART_ARRAYS
+	};
+
+	LLVector3 getPartPosition(S32 i) const	{ return LLVector3(mArrays[ARRAY_POS_X][i], mArrays[ARRAY_POS_Y][i], mArrays[ARRAY_POS_Z][i]); }
+	LLVector3 getPartVelocity(S32 i) const	{ return LLVector3(mArrays[ARRAY_VEL_X][i], mArrays[ARRAY_VEL_Y][i], mArrays[ARRAY_VEL_Z][i]); }
+	LLColor4 getPartColor(S32 i) const		{ return LLColor4(mArrays[ARRAY_COLOR_R][i], mArrays[ARRAY_COLOR_G][i], mArrays[ARRAY_COLOR_B][i], mArrays[ARRAY_COLOR_A][i]); }
+	LLVector2 getPartScale(S32 i) const		{ return LLVector2(mArrays[ARRAY_SCALE_X][i], mArrays[ARRAY_SCALE_Y][i]); }
+	U32 getPartFlags(S32 i) const			{ return mPartFlags[i]; }
+	LLViewerTexture* getPartImage(S32 i) const;
 	
 	LLPointer<LLVOPartGroup> mVOPartGroupp;
 
@@ -114,6 +151,15 @@ public:
 	bool mHud;
 
 protected:
+	void appendPart(LLViewerPart* part);
+	void removePart(S32 i);
+	void loadPart(S32 i);	// record -> arrays
+	void syncPart(S32 i);	// arrays -> record
+
+	std::vector<F32> mArrays[NUM_PART_ARRAYS];
+	std::vector<U32> mPartFlags;
+	std::vector<U8> mPartCustom;	// needs the per-particle update path
+
 	LLVector3 mCenterAgent;
 	F32 mBoxRadius;
 	LLVector3 mMinObjPos;
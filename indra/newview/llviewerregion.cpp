@@ -53,6 +53,7 @@
 #include "llfloaterreporter.h"
 #include "llfloaterregioninfo.h"
 #include "llhttpnode.h"
+#include "llregionprewarm.h"
 #include "llsdutil.h"
 #include "llstartup.h"
 #include "lltrans.h"
@@ -212,6 +213,7 @@ LLViewerRegion::LLViewerRegion(const U64 &handle,
 	mProductName("unknown"),
 	mHttpUrl(""),
 	mCacheLoaded(FALSE),
+	mCacheLoadPending(FALSE),
 	mCacheDirty(FALSE),
 	mCacheID(),
 	mEventPoll(NULL),
@@ -344,6 +346,16 @@ void LLViewerRegion::loadObjectCache()
 	}
 }
 
+void LLViewerRegion::setObjectCache(LLVOCacheEntry::vocache_entry_map_t& cache_entry_map)
+{
+	llassert(mCacheLoadPending && mCacheMap.empty());
+
+	mCacheMap.swap(cache_entry_map);
+	mCacheLoaded = TRUE;
+	mCacheLoadPending = FALSE;
+	sendHandshakeReply();
+}
+
 
 void LLViewerRegion::saveObjectCache()
 {
@@ -1351,21 +1363,37 @@ void LLViewerRegion::unpackRegionHandshake()
 	}
 
 
+	if (mCacheLoadPending)
+	{
+		// The reply goes out when the read completes
+		return;
+	}
+
 	// Now that we have the name, we can load the cache file
-	// off disk.
+	// off disk. Neighbors read theirs in the background.
+	if (!mCacheLoaded && (this != gAgent.getRegion()) && LLRegionPrewarm::getInstance()->loadObjectCache(this))
+	{
+		mCacheLoadPending = TRUE;
+		return;
+	}
 	loadObjectCache();
 
+	sendHandshakeReply();
+}
+
+void LLViewerRegion::sendHandshakeReply()
+{
 	// After loading cache, signal that simulator can start
 	// sending data.
 	// TODO: Send all upstream viewer->sim handshake info here.
-	LLHost host = msg->getSender();
+	LLMessageSystem* msg = gMessageSystem;
 	msg->newMessage("RegionHandshakeReply");
 	msg->nextBlock("AgentData");
 	msg->addUUID("AgentID", gAgent.getID());
 	msg->addUUID("SessionID", gAgent.getSessionID());
 	msg->nextBlock("RegionInfo");
 	msg->addU32("Flags", 0x0 );
-	msg->sendReliable(host);
+	msg->sendReliable(mHost);
 }
 
 void LLViewerRegion::setSeedCapability(const std::string& url)
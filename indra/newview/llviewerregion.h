@@ -97,6 +97,9 @@ public:
 	// Call this after you have the region name and handle.
 	void loadObjectCache();
 	void saveObjectCache();
+	// Hands over a cache read in the background (see LLRegionPrewarm) and lets the simulator start sending
+	void setObjectCache(LLVOCacheEntry::vocache_entry_map_t& cache_entry_map);
+	BOOL isObjectCacheLoadPending() const		{ return mCacheLoadPending; }
 
 	void sendMessage(); // Send the current message to this region's simulator
 	void sendReliableMessage(); // Send the current message to this region's simulator
@@ -207,6 +210,7 @@ public:
 	static void processRegionInfo(LLMessageSystem* msg, void**);
 
 	void setCacheID(const LLUUID& id)			{ mCacheID = id; }
+	const LLUUID& getCacheID() const			{ return mCacheID; }
 
 	F32	getWidth() const						{ return mWidth; }
 
@@ -332,6 +336,7 @@ protected:
 	void disconnectAllNeighbors();
 	void initStats();
 	void setFlags(BOOL b, U32 flags);
+	void sendHandshakeReply();
 
 public:
 	LLWind  mWind;
@@ -414,6 +419,7 @@ private:
 	// Regions can have order 10,000 objects, so assume
 	// a structure of size 2^14 = 16,000
 	BOOL									mCacheLoaded;
+	BOOL									mCacheLoadPending;	// Being read in the background, no handshake reply yet
 	BOOL                                    mCacheDirty;
 	LLVOCacheEntry::vocache_entry_map_t		mCacheMap;
 	LLDynamicArray<U32>						mCacheMissFull;
@@ -55,6 +55,8 @@
 #include "llviewerregion.h"
 #include "llvoavatar.h"
 #include "llvoavatarself.h"
+#include "llvograss.h"
+#include "llvotree.h"
 #include "llviewerwindow.h"		// *TODO: remove, only used for width/height
 #include "llworld.h"
 #include "llfeaturemanager.h"
@@ -195,7 +197,11 @@ const StatAttributes STAT_INFO[LLViewerStats::ST_COUNT] =
 	// ST_TEX_BAKES
 	StatAttributes("Texture Bakes", FALSE, FALSE),
 	// ST_TEX_REBAKES
-	StatAttributes("Texture Rebakes", FALSE, FALSE)
+	StatAttributes("Texture Rebakes", FALSE, FALSE),
+	// ST_CROSSING_HITCH_AVG
+	StatAttributes("CROSSING_HITCH_AVG", FALSE, FALSE),
+	// ST_CROSSING_HITCH_MAX
+	StatAttributes("CROSSING_HITCH_MAX", FALSE, FALSE)
 
 };
 
@@ -264,6 +270,8 @@ LLViewerStats::LLViewerStats() :
 	mNumNewObjectsStat("numnewobjectsstat"),
 	mNumSizeCulledStat("numsizeculledstat"),
 	mNumVisCulledStat("numvisculledstat"),
+	mVegetationRebuildMsecStat("vegetationrebuildmsecstat", 32, TRUE),
+	mVegetationCacheKBStat("vegetationcachekbstat", 32, TRUE),
 	mLastTimeDiff(0.0)
 {
 	for (S32 i = 0; i < ST_COUNT; i++)
@@ -632,6 +640,11 @@ void update_statistics(U32 frame_count)
 	LLViewerStats::getInstance()->mAssetKBitStat.addValue(gTransferManager.getTransferBitsIn(LLTCT_ASSET)/1024.f);
 	gTransferManager.resetTransferBitsIn(LLTCT_ASSET);
 
+	LLViewerStats::getInstance()->mVegetationRebuildMsecStat.addValue((LLVOTree::sRebuildTime + LLVOGrass::sRebuildTime) * 1000.f);
+	LLVOTree::sRebuildTime = 0.f;
+	LLVOGrass::sRebuildTime = 0.f;
+	LLViewerStats::getInstance()->mVegetationCacheKBStat.addValue((LLVOTree::getGeometryCacheBytes() + LLVOGrass::getGeometryCacheBytes()) / 1024.f);
+
 	if (LLAppViewer::getTextureFetch()->getNumRequests() == 0)
 	{
 		gDebugTimers[0].pause();
@@ -110,6 +110,9 @@ public:
 	LLStat mNumSizeCulledStat;
 	LLStat mNumVisCulledStat;
 
+	LLStat mVegetationRebuildMsecStat;	// tree and grass geometry building
+	LLStat mVegetationCacheKBStat;		// tree and grass geometry shared between objects
+
 	void resetStats();
 public:
 	// If you change this, please also add a corresponding text label
@@ -174,8 +177,10 @@ public:
 		ST_WINDOW_HEIGHT = 55,
 		ST_TEX_BAKES = 56,
 		ST_TEX_REBAKES = 57,
+		ST_CROSSING_HITCH_AVG = 58,
+		ST_CROSSING_HITCH_MAX = 59,
 		
-		ST_COUNT = 58
+		ST_COUNT = 60
 	};
 
 
@@ -471,6 +471,12 @@ public:
 			addText(xpos, ypos, llformat("%d Vertex Buffer Sets", LLVertexBuffer::sSetCount));
 			ypos += y_inc;
 
+			addText(xpos, ypos, llformat("%d/%d Vertex Buffers Created/Destroyed", LLVertexBuffer::sCreateCount, LLVertexBuffer::sDestroyCount));
+			ypos += y_inc;
+
+			addText(xpos, ypos, llformat("%d KB Vertex Data Uploaded", LLVertexBuffer::sUploadBytes/1024));
+			ypos += y_inc;
+
 			addText(xpos, ypos, llformat("%d Texture Binds", LLImageGL::sBindCount));
 			ypos += y_inc;
 
@@ -486,6 +492,20 @@ public:
 			addText(xpos, ypos, llformat("%d Texture Matrix Ops", gPipeline.mTextureMatrixOps));
 			ypos += y_inc;
 
+			addText(xpos, ypos, llformat("%d Shared Batch Buffers", LLGeomBatchPool::sBufferCount));
+			ypos += y_inc;
+
+			for (U32 i = LLRenderPass::PASS_SIMPLE; i < LLRenderPass::NUM_RENDER_TYPES; ++i)
+			{
+				if (LLRenderPass::sDrawCalls[i] > 0)
+				{
+					addText(xpos, ypos, llformat("%s: %d Draw Calls, %d Batches Merged", LLRenderPass::getPassName(i),
+						LLRenderPass::sDrawCalls[i], LLRenderPass::sMergedBatches[i]));
+					ypos += y_inc;
+				}
+			}
+			LLRenderPass::resetPassStats();
+
 			gPipeline.mTextureMatrixOps = 0;
 			gPipeline.mMatrixOpCount = 0;
 
@@ -513,12 +533,29 @@ public:
 			
 			ypos += y_inc;
 
+			addText(xpos,ypos, llformat("Impostors: %d updated, %d deferred, %.2f ms", LLVOAvatar::sNumImpostorUpdates,
+				LLVOAvatar::sNumImpostorsDeferred, LLVOAvatar::sImpostorUpdateTime));
+
+			ypos += y_inc;
+
+			addText(xpos,ypos, llformat("Avatar updates: %d interpolated, %.2f ms", LLVOAvatar::sNumUpdatesSkipped,
+				LLVOAvatar::sUpdateTime));
+
+			ypos += y_inc;
+
+			addText(xpos,ypos, llformat("Impostor atlas: %d slots, %d KB saved", LLImpostorAtlas::getInstance()->getNumSlots(),
+				LLImpostorAtlas::getInstance()->getBytesSaved()/1024));
+
+			ypos += y_inc;
+
 			addText(xpos,ypos, llformat("%d Lights visible", LLPipeline::sVisibleLightCount));
 			
 			ypos += y_inc;
 
 			LLVertexBuffer::sBindCount = LLImageGL::sBindCount = 
 				LLVertexBuffer::sSetCount = LLImageGL::sUniqueCount = 
+				LLVertexBuffer::sCreateCount = LLVertexBuffer::sDestroyCount =
+				LLVertexBuffer::sUploadBytes = 
 				gPipeline.mNumVisibleNodes = LLPipeline::sVisibleLightCount = 0;
 		}
 		if (gSavedSettings.getBOOL("DebugShowRenderMatrices"))
@@ -31,6 +31,10 @@
 #include "imageids.h"
 #include "llerror.h"
 #include "v3math.h"
+#include "llappviewer.h"
+#include "lldir.h"
+#include "llimageworker.h"
+#include "llmd5.h"
 #include "llsurface.h"
 #include "lltextureview.h"
 #include "llviewertexture.h"
@@ -39,7 +43,15 @@
 #include "noise.h"
 #include "llregionhandle.h" // for from_region_handle
 #include "llviewercontrol.h"
+#include "llv4math.h"
 
+// SSE2 is only guaranteed when the whole build targets it (see llv4math.h).
+#if LL_VECTORIZE && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define LL_VLCOMPOSITION_SSE2 1
+#include <emmintrin.h>
+#else
+#define LL_VLCOMPOSITION_SSE2 0
+#endif
 
 
 F32 bilinear(const F32 v00, const F32 v01, const F32 v10, const F32 v11, const F32 x_frac, const F32 y_frac)
@@ -80,11 +92,15 @@ LLVLComposition::LLVLComposition(LLSurface *surfacep, const U32 width, const F32
 	mTexScaleX = 16.f;
 	mTexScaleY = 16.f;
 	mTexturesLoaded = FALSE;
+	mCacheState = CACHE_UNKNOWN;
+	mCompositeDirty = FALSE;
 }
 
 
 LLVLComposition::~LLVLComposition()
 {
+	// Jobs still queued finish on their own and are released by the thread.
+	cancelJobs();
 }
 
 
@@ -209,6 +225,237 @@ BOOL LLVLComposition::generateHeights(const F32 x, const F32 y,
 }
 
 static const U32 BASE_SIZE = 128;
+static const F32 CACHE_CHECK_TIMEOUT = 10.f; // seconds to wait for the heights a cached texture needs
+
+//-----------------------------------------------------------------------------
+// LLVLComposition::CompositeJob
+//
+// Blends the detail textures for one patch of the region texture on the image
+// composite thread.  It samples its own copy of the composition values, so the
+// layer can change while the job runs.
+//-----------------------------------------------------------------------------
+
+class LLVLComposition::CompositeJob : public LLImageCompositeThread::Job
+{
+protected:
+	~CompositeJob() {}
+
+public:
+	CompositeJob() :
+		mCancelled(FALSE),
+		mSuccess(false),
+		mDone(0)
+	{
+	}
+
+	/*virtual*/ bool run();
+	/*virtual*/ void completed(bool success)
+	{
+		mSuccess = success;
+		mDone = 1;
+	}
+
+	BOOL isDone()				{ return mDone != 0; }
+	bool getSuccess() const		{ return mSuccess; }
+
+	// Input, set up on the main thread
+	LLPointer<LLImageRaw> mDetailRaws[CORNER_COUNT];
+	std::vector<F32> mComposition;	// Block of the layer starting at mCompX, mCompY
+	S32 mCompX;
+	S32 mCompY;
+	S32 mCompWidth;
+	S32 mLayerWidth;
+	F32 mLayerScaleInv;
+	S32 mTexWidth;
+	S32 mTexHeight;
+	S32 mTexXBegin;
+	S32 mTexYBegin;
+	S32 mTexXEnd;
+	S32 mTexYEnd;
+	F32 mTexXRatio;
+	F32 mTexYRatio;
+	F32 mSTXStride;
+	F32 mSTYStride;
+
+	// Output, tightly packed RGB for the texel rect
+	std::vector<U8> mPixels;
+
+	BOOL mCancelled;	// MAIN THREAD: a newer job covers the same texels
+
+private:
+	bool mSuccess;
+	LLAtomicU32 mDone;
+};
+
+// Texels without a source are left black.
+static inline void blend_texel(U8* out, const U8* a, const U8* b, F32 weight)
+{
+	if (!a)
+	{
+		out[0] = out[1] = out[2] = 0;
+		return;
+	}
+	for (S32 k = 0; k < 3; k++)
+	{
+		F32 fa = a[k];
+		F32 fb = b[k];
+		out[k] = (U8)lltrunc(fa + weight * (fb - fa));
+	}
+}
+
+// Linearly interpolates RGB texels between two detail textures.  The SSE2
+// path does four texels at a time with the same single precision operations
+// and truncation as blend_texel(), so the results are identical.
+static void blend_texels(U8* out, const U8* const* src_a, const U8* const* src_b, const F32* weights, S32 count)
+{
+	S32 i = 0;
+#if LL_VLCOMPOSITION_SSE2
+	for (; i + 4 <= count; i += 4, out += 12)
+	{
+		const U8* a0 = src_a[i];
+		const U8* a1 = src_a[i + 1];
+		const U8* a2 = src_a[i + 2];
+		const U8* a3 = src_a[i + 3];
+		if (!a0 || !a1 || !a2 || !a3)
+		{
+			for (S32 t = 0; t < 4; t++)
+			{
+				blend_texel(out + t * 3, src_a[i + t], src_b[i + t], weights[i + t]);
+			}
+			continue;
+		}
+		const U8* b0 = src_b[i];
+		const U8* b1 = src_b[i + 1];
+		const U8* b2 = src_b[i + 2];
+		const U8* b3 = src_b[i + 3];
+
+		const __m128 va0 = _mm_setr_ps(a0[0], a0[1], a0[2], a1[0]);
+		const __m128 va1 = _mm_setr_ps(a1[1], a1[2], a2[0], a2[1]);
+		const __m128 va2 = _mm_setr_ps(a2[2], a3[0], a3[1], a3[2]);
+		const __m128 vb0 = _mm_setr_ps(b0[0], b0[1], b0[2], b1[0]);
+		const __m128 vb1 = _mm_setr_ps(b1[1], b1[2], b2[0], b2[1]);
+		const __m128 vb2 = _mm_setr_ps(b2[2], b3[0], b3[1], b3[2]);
+
+		const __m128 w = _mm_loadu_ps(weights + i);
+		const __m128 vw0 = _mm_shuffle_ps(w, w, _MM_SHUFFLE(1, 0, 0, 0));
+		const __m128 vw1 = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 1, 1));
+		const __m128 vw2 = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 3, 2));
+
+		const __m128i r0 = _mm_cvttps_epi32(_mm_add_ps(va0, _mm_mul_ps(vw0, _mm_sub_ps(vb0, va0))));
+		const __m128i r1 = _mm_cvttps_epi32(_mm_add_ps(va1, _mm_mul_ps(vw1, _mm_sub_ps(vb1, va1))));
+		const __m128i r2 = _mm_cvttps_epi32(_mm_add_ps(va2, _mm_mul_ps(vw2, _mm_sub_ps(vb2, va2))));
+
+		U8 packed[16];
+		_mm_storeu_si128((__m128i*)packed, _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r2)));
+		memcpy(out, packed, 12);		/* Flawfinder: ignore */
+	}
+#endif
+	for (; i < count; i++, out += 3)
+	{
+		blend_texel(out, src_a[i], src_b[i], weights[i]);
+	}
+}
+
+// Walks the texel rect exactly as the old main thread composite did, with
+// LLViewerLayer::getValueScaled() split into its row and column halves.
+bool LLVLComposition::CompositeJob::run()
+{
+	const U8* st_data[CORNER_COUNT];
+	S32 st_data_size[CORNER_COUNT];
+	for (S32 i = 0; i < CORNER_COUNT; i++)
+	{
+		if (mDetailRaws[i].isNull())
+		{
+			return false;
+		}
+		st_data[i] = mDetailRaws[i]->getData();
+		st_data_size[i] = mDetailRaws[i]->getDataSize();
+	}
+
+	const U32 st_comps = 3;
+	const U32 st_width = BASE_SIZE;
+	const U32 st_height = BASE_SIZE;
+	const S32 width = mTexXEnd - mTexXBegin;
+	mPixels.resize(width * (mTexYEnd - mTexYBegin) * st_comps);
+
+	std::vector<F32> weights(width);
+	std::vector<const U8*> src_a(width);
+	std::vector<const U8*> src_b(width);
+
+	F32 sti, stj;
+	stj = (mTexYBegin * mSTYStride) - st_height*(llfloor((mTexYBegin * mSTYStride)/st_height));
+
+	for (S32 j = mTexYBegin; j < mTexYEnd; j++)
+	{
+		F32 y_frac = (j*mTexYRatio)*mLayerScaleInv;
+		S32 y1 = llfloor(y_frac);
+		S32 y2 = y1 + 1;
+		y_frac -= y1;
+		y1 = llclamp(y1, 0, mLayerWidth - 1);
+		y2 = llclamp(y2, 0, mLayerWidth - 1);
+		const S32 row1 = (y1 - mCompY) * mCompWidth - mCompX;
+		const S32 row2 = (y2 - mCompY) * mCompWidth - mCompX;
+
+		sti = (mTexXBegin * mSTXStride) - st_width*((U32)(mTexXBegin * mSTXStride)/st_width);
+		for (S32 i = mTexXBegin; i < mTexXEnd; i++)
+		{
+			F32 x_frac = (i*mTexXRatio)*mLayerScaleInv;
+			S32 x1 = llfloor(x_frac);
+			S32 x2 = x1 + 1;
+			x_frac -= x1;
+			x1 = llclamp(x1, 0, mLayerWidth - 1);
+			x2 = llclamp(x2, 0, mLayerWidth - 1);
+
+			F32 row1_left  = mComposition[row1 + x1];
+			F32 row1_right = mComposition[row1 + x2];
+			F32 row2_left  = mComposition[row2 + x1];
+			F32 row2_right = mComposition[row2 + x2];
+			F32 row1_interp = row1_left - x_frac * (row1_left - row1_right);
+			F32 row2_interp = row2_left - x_frac * (row2_left - row2_right);
+			F32 composition = row1_interp - y_frac * (row1_interp - row2_interp);
+
+			S32 tex0, tex1;
+			tex0 = llfloor( composition );
+			tex0 = llclamp(tex0, 0, 3);
+			composition -= tex0;
+			tex1 = tex0 + 1;
+			tex1 = llclamp(tex1, 0, 3);
+
+			const S32 texel = i - mTexXBegin;
+			S32 st_offset = (lltrunc(sti) + lltrunc(stj)*st_width) * st_comps;
+			if (st_offset < 0 || st_offset >= st_data_size[tex0] || st_offset >= st_data_size[tex1])
+			{
+				// SJB: This shouldn't be happening, but does... Rounding error?
+				src_a[texel] = NULL;
+				src_b[texel] = NULL;
+				weights[texel] = 0.f;
+			}
+			else
+			{
+				src_a[texel] = st_data[tex0] + st_offset;
+				src_b[texel] = st_data[tex1] + st_offset;
+				weights[texel] = composition;
+			}
+
+			sti += mSTXStride;
+			if (sti >= st_width)
+			{
+				sti -= st_width;
+			}
+		}
+
+		blend_texels(&mPixels[(j - mTexYBegin) * width * st_comps], &src_a[0], &src_b[0], &weights[0], width);
+
+		stj += mSTYStride;
+		if (stj >= st_height)
+		{
+			stj -= st_height;
+		}
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
 
 BOOL LLVLComposition::generateComposition()
 {
@@ -265,9 +512,6 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 	//
 
 	// These have already been validated by generateComposition.
-	U8* st_data[4];
-	S32 st_data_size[4]; // for debugging
-
 	for (S32 i = 0; i < 4; i++)
 	{
 		if (mRawImages[i].isNull())
@@ -306,8 +550,6 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 				mRawImages[i] = newraw; // deletes old
 			}
 		}
-		st_data[i] = mRawImages[i]->getData();
-		st_data_size[i] = mRawImages[i]->getDataSize();
 	}
 
 	///////////////////////////////////////
@@ -342,7 +584,6 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 
 	LLViewerTexture *texturep;
 	U32 tex_width, tex_height, tex_comps;
-	U32 tex_stride;
 	F32 tex_x_scalef, tex_y_scalef;
 	S32 tex_x_begin, tex_y_begin, tex_x_end, tex_y_end;
 	F32 tex_x_ratiof, tex_y_ratiof;
@@ -351,7 +592,6 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 	tex_width = texturep->getWidth();
 	tex_height = texturep->getHeight();
 	tex_comps = texturep->getComponents();
-	tex_stride = tex_width * tex_comps;
 
 	U32 st_comps = 3;
 	U32 st_width = BASE_SIZE;
@@ -373,103 +613,330 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 	tex_x_ratiof = (F32)mWidth*mScale / (F32)tex_width;
 	tex_y_ratiof = (F32)mWidth*mScale / (F32)tex_height;
 
-	LLPointer<LLImageRaw> raw = new LLImageRaw(tex_width, tex_height, tex_comps);
-	U8 *rawp = raw->getData();
-
-	F32 tex_width_inv = 1.f/tex_width;
-	F32 tex_height_inv = 1.f/tex_height;
-
 	F32 st_x_stride, st_y_stride;
 	st_x_stride = ((F32)st_width / (F32)mTexScaleX)*((F32)mWidth / (F32)tex_width);
 	st_y_stride = ((F32)st_height / (F32)mTexScaleY)*((F32)mWidth / (F32)tex_height);
 
 	llassert(st_x_stride > 0.f);
 	llassert(st_y_stride > 0.f);
-	////////////////////////////////
-	//
-	// Iterate through the target texture, striding through the
-	// subtextures and interpolating appropriately.
-	//
-	//
 
-	F32 sti, stj;
-	S32 st_offset;
-	sti = (tex_x_begin * st_x_stride) - st_width*(llfloor((tex_x_begin * st_x_stride)/st_width));
-	stj = (tex_y_begin * st_y_stride) - st_height*(llfloor((tex_y_begin * st_y_stride)/st_height));
-
-	st_offset = (llfloor(stj * st_width) + llfloor(sti)) * st_comps;
-	for (S32 j = tex_y_begin; j < tex_y_end; j++)
+	if (tex_x_end > tex_x_begin && tex_y_end > tex_y_begin)
 	{
-		U32 offset = j * tex_stride + tex_x_begin * tex_comps;
-		sti = (tex_x_begin * st_x_stride) - st_width*((U32)(tex_x_begin * st_x_stride)/st_width);
-		for (S32 i = tex_x_begin; i < tex_x_end; i++)
+		////////////////////////////////
+		//
+		// Hand the blend to the composite thread, along with the block of
+		// composition values getValueScaled() reads for this texel rect.
+		//
+		//
+
+		LLPointer<CompositeJob> job = new CompositeJob;
+		for (S32 i = 0; i < CORNER_COUNT; i++)
 		{
-			S32 tex0, tex1;
-			F32 composition = getValueScaled(i*tex_x_ratiof, j*tex_y_ratiof);
+			job->mDetailRaws[i] = mRawImages[i];
+		}
 
-			tex0 = llfloor( composition );
-			tex0 = llclamp(tex0, 0, 3);
-			composition -= tex0;
-			tex1 = tex0 + 1;
-			tex1 = llclamp(tex1, 0, 3);
+		S32 comp_x_begin = llclamp(llfloor((tex_x_begin*tex_x_ratiof)*mScaleInv), 0, mWidth - 1);
+		S32 comp_y_begin = llclamp(llfloor((tex_y_begin*tex_y_ratiof)*mScaleInv), 0, mWidth - 1);
+		S32 comp_x_end = llclamp(llfloor(((tex_x_end - 1)*tex_x_ratiof)*mScaleInv) + 1, 0, mWidth - 1) + 1;
+		S32 comp_y_end = llclamp(llfloor(((tex_y_end - 1)*tex_y_ratiof)*mScaleInv) + 1, 0, mWidth - 1) + 1;
+		S32 comp_width = comp_x_end - comp_x_begin;
+		job->mComposition.resize(comp_width * (comp_y_end - comp_y_begin));
+		for (S32 j = comp_y_begin; j < comp_y_end; j++)
+		{
+			memcpy(&job->mComposition[(j - comp_y_begin) * comp_width],		/* Flawfinder: ignore */
+				   mDatap + j * mWidth + comp_x_begin, comp_width * sizeof(F32));
+		}
+		job->mCompX = comp_x_begin;
+		job->mCompY = comp_y_begin;
+		job->mCompWidth = comp_width;
+		job->mLayerWidth = mWidth;
+		job->mLayerScaleInv = mScaleInv;
+
+		job->mTexWidth = tex_width;
+		job->mTexHeight = tex_height;
+		job->mTexXBegin = tex_x_begin;
+		job->mTexYBegin = tex_y_begin;
+		job->mTexXEnd = tex_x_end;
+		job->mTexYEnd = tex_y_end;
+		job->mTexXRatio = tex_x_ratiof;
+		job->mTexYRatio = tex_y_ratiof;
+		job->mSTXStride = st_x_stride;
+		job->mSTYStride = st_y_stride;
+
+		// An older job for the same patch would only be overwritten.
+		for (job_list_t::iterator iter = mPendingJobs.begin(); iter != mPendingJobs.end(); ++iter)
+		{
+			CompositeJob* pending = *iter;
+			if (pending->mTexXBegin == tex_x_begin && pending->mTexYBegin == tex_y_begin)
+			{
+				pending->mCancelled = TRUE;
+			}
+		}
 
-			F32 xy_int_i, xy_int_j;
+		LLAppViewer::getImageCompositeThread()->runJob(job, LLQueuedThread::PRIORITY_NORMAL);
+		mPendingJobs.push_back(job);
+	}
+	LLSurface::sTextureUpdateTime += gen_timer.getElapsedTimeF32();
 
-			xy_int_i = i * tex_width_inv;
-			xy_int_j = j * tex_height_inv;
+	for (S32 i = 0; i < 4; i++)
+	{
+		// Un-boost detatil textures (will get re-boosted if rendering in high detail)
+		mDetailTextures[i]->setBoostLevel(LLViewerTexture::BOOST_NONE);
+		mDetailTextures[i]->setMinDiscardLevel(MAX_DISCARD_LEVEL + 1);
+	}
+	
+	return TRUE;
+}
+
+void LLVLComposition::updateTextures()
+{
+	LLTimer update_timer;
+	S32 texels = 0;
+
+	if (!mPendingJobs.empty())
+	{
+		LLAppViewer::getImageCompositeThread()->update(1); // unpauses the composite thread
+	}
+
+	for (job_list_t::iterator iter = mPendingJobs.begin(); iter != mPendingJobs.end(); )
+	{
+		job_list_t::iterator curiter = iter++;
+		CompositeJob* job = *curiter;
+		if (!job->isDone())
+		{
+			continue;
+		}
+
+		LLViewerTexture* texturep = mSurfacep ? mSurfacep->getSTexture() : NULL;
+		if (!job->mCancelled && job->getSuccess() && texturep &&
+			texturep->getWidth() == job->mTexWidth && texturep->getHeight() == job->mTexHeight)
+		{
+			if (mCompositeRaw.isNull() ||
+				mCompositeRaw->getWidth() != job->mTexWidth || mCompositeRaw->getHeight() != job->mTexHeight)
+			{
+				// Same gray as LLSurface::createSTexture()
+				mCompositeRaw = new LLImageRaw(job->mTexWidth, job->mTexHeight, 3);
+				mCompositeRaw->clear(128, 128, 128, 0);
+			}
 
-			st_offset = (lltrunc(sti) + lltrunc(stj)*st_width) * st_comps;
-			for (U32 k = 0; k < tex_comps; k++)
+			const S32 width = job->mTexXEnd - job->mTexXBegin;
+			const S32 height = job->mTexYEnd - job->mTexYBegin;
+			for (S32 j = 0; j < height; j++)
 			{
-				// Linearly interpolate based on composition.
-				if (st_offset >= st_data_size[tex0] || st_offset >= st_data_size[tex1])
-				{
-					// SJB: This shouldn't be happening, but does... Rounding error?
-					//llwarns << "offset 0 [" << tex0 << "] =" << st_offset << " >= size=" << st_data_size[tex0] << llendl;
-					//llwarns << "offset 1 [" << tex1 << "] =" << st_offset << " >= size=" << st_data_size[tex1] << llendl;
-				}
-				else
-				{
-					F32 a = *(st_data[tex0] + st_offset);
-					F32 b = *(st_data[tex1] + st_offset);
-					rawp[ offset ] = (U8)lltrunc( a + composition * (b - a) );
-				}
-				offset++;
-				st_offset++;
+				memcpy(mCompositeRaw->getData() + ((job->mTexYBegin + j) * job->mTexWidth + job->mTexXBegin) * 3,		/* Flawfinder: ignore */
+					   &job->mPixels[j * width * 3], width * 3);
 			}
 
-			sti += st_x_stride;
-			if (sti >= st_width)
+			if (!texturep->hasGLTexture())
 			{
-				sti -= st_width;
+				texturep->createGLTexture(0, mCompositeRaw);
 			}
+			texturep->setSubImage(mCompositeRaw, job->mTexXBegin, job->mTexYBegin, width, height);
+			texels += width * height;
+			mCompositeDirty = TRUE;
 		}
+		mPendingJobs.erase(curiter);
+	}
 
-		stj += st_y_stride;
-		if (stj >= st_height)
+	if (texels)
+	{
+		LLSurface::sTextureUpdateTime += update_timer.getElapsedTimeF32();
+		LLSurface::sTexelsUpdated += texels;
+	}
+
+	static LLCachedControl<bool> use_cache(gSavedSettings, "TerrainCompositionCache");
+	if (!use_cache)
+	{
+		mCacheState = CACHE_CHECKED;
+		return;
+	}
+	if (!mParamsReady || !mSurfacep || !mSurfacep->getRegion())
+	{
+		return;
+	}
+
+	if (mCacheState == CACHE_UNKNOWN)
+	{
+		mCacheState = LLFile::isfile(getCacheFilename()) ? CACHE_PENDING : CACHE_CHECKED;
+		mCacheCheckTimer.reset();
+	}
+	if (mCacheState == CACHE_PENDING)
+	{
+		if (!mSurfacep->getHasAllPatchData())
 		{
-			stj -= st_height;
+			if (mCacheCheckTimer.getElapsedTimeF32() < CACHE_CHECK_TIMEOUT)
+			{
+				return;
+			}
+			// Don't hold up the texture for patches that may never arrive.
+			mCacheState = CACHE_CHECKED;
+		}
+		else
+		{
+			mCacheState = CACHE_CHECKED;
+			if (loadCache())
+			{
+				return;
+			}
 		}
 	}
 
-	if (!texturep->hasGLTexture())
+	if (mCompositeDirty && mPendingJobs.empty() && mSurfacep->getCompositionComplete())
 	{
-		texturep->createGLTexture(0, raw);
+		saveCache();
+		mCompositeDirty = FALSE;
 	}
-	texturep->setSubImage(raw, tex_x_begin, tex_y_begin, tex_x_end - tex_x_begin, tex_y_end - tex_y_begin);
-	LLSurface::sTextureUpdateTime += gen_timer.getElapsedTimeF32();
-	LLSurface::sTexelsUpdated += (tex_x_end - tex_x_begin) * (tex_y_end - tex_y_begin);
+}
 
-	for (S32 i = 0; i < 4; i++)
+void LLVLComposition::cancelJobs()
+{
+	for (job_list_t::iterator iter = mPendingJobs.begin(); iter != mPendingJobs.end(); ++iter)
 	{
-		// Un-boost detatil textures (will get re-boosted if rendering in high detail)
-		mDetailTextures[i]->setBoostLevel(LLViewerTexture::BOOST_NONE);
-		mDetailTextures[i]->setMinDiscardLevel(MAX_DISCARD_LEVEL + 1);
+		(*iter)->mCancelled = TRUE;
 	}
-	
+}
+
+//-----------------------------------------------------------------------------
+// Texture cache
+//
+// One file per region holding the composition layer and the composited
+// texture.  The key covers everything generateHeights() and generateTexture()
+// read, so a hit is exactly what they would have produced.
+//-----------------------------------------------------------------------------
+
+static const U32 CACHE_MAGIC = 0x4e52544c; // "LTRN" on little endian hosts
+static const U32 CACHE_VERSION = 1;
+enum
+{
+	CACHE_HEADER_MAGIC = 0,
+	CACHE_HEADER_VERSION,
+	CACHE_HEADER_LAYER_WIDTH,
+	CACHE_HEADER_TEX_WIDTH,
+	CACHE_HEADER_TEX_HEIGHT,
+	CACHE_HEADER_KEY,
+	CACHE_HEADER_WORDS = CACHE_HEADER_KEY + 4
+};
+
+std::string LLVLComposition::getCacheFilename() const
+{
+	U32 region_x, region_y;
+	from_region_handle(mSurfacep->getRegion()->getHandle(), &region_x, &region_y);
+	return gDirUtilp->getExpandedFilename(LL_PATH_CACHE, llformat("terrain_%u_%u.bin", region_x, region_y));
+}
+
+void LLVLComposition::getCacheKey(U8 key[16]) const
+{
+	LLMD5 md5;
+	const U64 handle = mSurfacep->getRegion()->getHandle();
+	md5.update((const U8*)&handle, sizeof(handle));
+	for (S32 i = 0; i < CORNER_COUNT; i++)
+	{
+		md5.update(mDetailTextures[i]->getID().mData, UUID_BYTES);
+	}
+	md5.update((const U8*)mStartHeight, sizeof(mStartHeight));
+	md5.update((const U8*)mHeightRange, sizeof(mHeightRange));
+	md5.update((const U8*)&mTexScaleX, sizeof(mTexScaleX));
+	md5.update((const U8*)&mTexScaleY, sizeof(mTexScaleY));
+	md5.update((const U8*)&mScale, sizeof(mScale));
+	const S32 grids_per_edge = mSurfacep->getGridsPerEdge();
+	md5.update((const U8*)mSurfacep->getSurfaceZ(), grids_per_edge * grids_per_edge * sizeof(F32));
+	md5.finalize();
+	md5.raw_digest(key);
+}
+
+BOOL LLVLComposition::loadCache()
+{
+	LLViewerTexture* texturep = mSurfacep->getSTexture();
+	if (!texturep || texturep->getComponents() != 3)
+	{
+		return FALSE;
+	}
+	const S32 tex_width = texturep->getWidth();
+	const S32 tex_height = texturep->getHeight();
+
+	LLFILE* fp = LLFile::fopen(getCacheFilename(), "rb");		/*Flawfinder: ignore*/
+	if (!fp)
+	{
+		return FALSE;
+	}
+
+	U32 header[CACHE_HEADER_WORDS];
+	U8 key[16];
+	getCacheKey(key);
+	BOOL success = fread(header, sizeof(U32), CACHE_HEADER_WORDS, fp) == CACHE_HEADER_WORDS &&
+		header[CACHE_HEADER_MAGIC] == CACHE_MAGIC &&
+		header[CACHE_HEADER_VERSION] == CACHE_VERSION &&
+		header[CACHE_HEADER_LAYER_WIDTH] == (U32)mWidth &&
+		header[CACHE_HEADER_TEX_WIDTH] == (U32)tex_width &&
+		header[CACHE_HEADER_TEX_HEIGHT] == (U32)tex_height &&
+		memcmp(&header[CACHE_HEADER_KEY], key, sizeof(key)) == 0;
+
+	std::vector<F32> layer;
+	LLPointer<LLImageRaw> raw;
+	if (success)
+	{
+		layer.resize(mWidth * mWidth);
+		raw = new LLImageRaw(tex_width, tex_height, 3);
+		success = fread(&layer[0], sizeof(F32), layer.size(), fp) == layer.size() &&
+			fread(raw->getData(), 1, raw->getDataSize(), fp) == (size_t)raw->getDataSize();
+	}
+	fclose(fp);
+	if (!success)
+	{
+		return FALSE;
+	}
+
+	cancelJobs();
+	memcpy(mDatap, &layer[0], layer.size() * sizeof(F32));		/* Flawfinder: ignore */
+	mCompositeRaw = raw;
+	mCompositeDirty = FALSE;
+	if (!texturep->hasGLTexture())
+	{
+		texturep->createGLTexture(0, mCompositeRaw);
+	}
+	else
+	{
+		texturep->setSubImage(mCompositeRaw, 0, 0, tex_width, tex_height);
+	}
+	mSurfacep->applyCachedComposition();
+
+	lldebugs << "Loaded terrain texture for region " << mSurfacep->getRegion()->getName() << " from cache" << llendl;
 	return TRUE;
 }
 
+void LLVLComposition::saveCache()
+{
+	if (mCompositeRaw.isNull())
+	{
+		return;
+	}
+
+	U32 header[CACHE_HEADER_WORDS];
+	header[CACHE_HEADER_MAGIC] = CACHE_MAGIC;
+	header[CACHE_HEADER_VERSION] = CACHE_VERSION;
+	header[CACHE_HEADER_LAYER_WIDTH] = mWidth;
+	header[CACHE_HEADER_TEX_WIDTH] = mCompositeRaw->getWidth();
+	header[CACHE_HEADER_TEX_HEIGHT] = mCompositeRaw->getHeight();
+	getCacheKey((U8*)&header[CACHE_HEADER_KEY]);
+
+	const std::string filename = getCacheFilename();
+	LLFILE* fp = LLFile::fopen(filename, "wb");		/*Flawfinder: ignore*/
+	if (!fp)
+	{
+		return;
+	}
+	const size_t layer_size = mWidth * mWidth;
+	BOOL success = fwrite(header, sizeof(U32), CACHE_HEADER_WORDS, fp) == CACHE_HEADER_WORDS;
+	success = success && fwrite(mDatap, sizeof(F32), layer_size, fp) == layer_size;
+	success = success && fwrite(mCompositeRaw->getData(), 1, mCompositeRaw->getDataSize(), fp) == (size_t)mCompositeRaw->getDataSize();
+	fclose(fp);
+	if (!success)
+	{
+		llwarns << "Unable to write terrain cache " << filename << llendl;
+		LLFile::remove(filename);
+	}
+}
+
 LLUUID LLVLComposition::getDetailTextureID(S32 corner)
 {
 	return mDetailTextures[corner]->getID();
@@ -27,6 +27,9 @@
 #ifndef LL_LLVLCOMPOSITION_H
 #define LL_LLVLCOMPOSITION_H
 
+#include <list>
+
+#include "llframetimer.h"
 #include "llviewerlayer.h"
 #include "llviewertexture.h"
 
@@ -43,8 +46,13 @@ public:
 	// Viewer side hack to generate composition values
 	BOOL generateHeights(const F32 x, const F32 y, const F32 width, const F32 height);
 	BOOL generateComposition();
-	// Generate texture from composition values.
+	// Generate texture from composition values.  The blend runs on the image
+	// composite thread; updateTextures() uploads the result.
 	BOOL generateTexture(const F32 x, const F32 y, const F32 width, const F32 height);		
+	// Uploads finished composites and loads or saves the region's texture cache.
+	void updateTextures();
+	// TRUE while the heights needed to validate a cached texture are still arriving.
+	BOOL getCacheCheckPending() const	{ return mCacheState == CACHE_PENDING; }
 
 	// Use these as indeces ito the get/setters below that use 'corner'
 	enum ECorner
@@ -69,6 +77,22 @@ public:
 	void setParamsReady()		{ mParamsReady = TRUE; }
 	BOOL getParamsReady() const	{ return mParamsReady; }
 protected:
+	class CompositeJob;
+	typedef std::list<LLPointer<CompositeJob> > job_list_t;
+
+	enum ECacheState
+	{
+		CACHE_UNKNOWN,		// haven't looked for a cache file yet
+		CACHE_PENDING,		// a cache file exists, waiting for all patch heights
+		CACHE_CHECKED
+	};
+
+	std::string getCacheFilename() const;
+	void getCacheKey(U8 key[16]) const;
+	BOOL loadCache();
+	void saveCache();
+	void cancelJobs();
+
 	BOOL mParamsReady;
 	LLSurface *mSurfacep;
 	BOOL mTexturesLoaded;
@@ -81,6 +105,14 @@ protected:
 
 	F32 mTexScaleX;
 	F32 mTexScaleY;
+
+	// Copy of the whole region texture, kept for the disk cache and for
+	// creating the GL texture.
+	LLPointer<LLImageRaw> mCompositeRaw;
+	job_list_t mPendingJobs;
+	ECacheState mCacheState;
+	LLFrameTimer mCacheCheckTimer;
+	BOOL mCompositeDirty; // mCompositeRaw changed since it was loaded or saved
 };
 
 #endif //LL_LLVLCOMPOSITION_H
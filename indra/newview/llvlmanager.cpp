@@ -35,6 +35,7 @@
 #include "llviewerregion.h"
 #include "llframetimer.h"
 #include "llsurface.h"
+#include "llviewerbenchmark.h"
 
 LLVLManager gVLManager;
 
@@ -67,6 +68,8 @@ void LLVLManager::addLayerData(LLVLData *vl_datap, const S32 mesg_size)
 		llerrs << "Unknown layer type!" << (S32)vl_datap->mType << llendl;
 	}
 
+	LLViewerBenchmark::captureLayerData(vl_datap->mType, vl_datap->mData, vl_datap->mSize);
+
 	mPacketData.put(vl_datap);
 }
 
@@ -47,6 +47,7 @@
 #include "llagentcamera.h"
 #include "llagentwearables.h"
 #include "llanimationstates.h"
+#include "llappviewer.h"
 #include "llavatarnamecache.h"
 #include "llavatarpropertiesprocessor.h"
 #include "llphysicsmotion.h"
@@ -65,6 +66,7 @@
 #include "llkeyframefallmotion.h"
 #include "llkeyframestandmotion.h"
 #include "llkeyframewalkmotion.h"
+#include "lljobpool.h"
 #include "llmutelist.h"
 #include "llmoveview.h"
 #include "llnotificationsutil.h"
@@ -639,7 +641,16 @@ BOOL LLVOAvatar::sShowFootPlane = FALSE;
 BOOL LLVOAvatar::sVisibleInFirstPerson = FALSE;
 F32 LLVOAvatar::sLODFactor = 1.f;
 F32 LLVOAvatar::sPhysicsLODFactor = 1.f;
+BOOL LLVOAvatar::sAvatarPhysics = TRUE;
+F32 LLVOAvatar::sUpdateBudget = 0.f;
+F32 LLVOAvatar::sUpdateHeavyCost = 1.f;
+S32 LLVOAvatar::sNumUpdatesSkipped = 0;
+F32 LLVOAvatar::sUpdateTime = 0.f;
+static F32 sUpdateTimeThisFrame = 0.f;
 BOOL LLVOAvatar::sUseImpostors = FALSE;
+F32 LLVOAvatar::sImpostorUpdateTime = 0.f;
+S32 LLVOAvatar::sNumImpostorUpdates = 0;
+S32 LLVOAvatar::sNumImpostorsDeferred = 0;
 BOOL LLVOAvatar::sJointDebug = FALSE;
 
 F32 LLVOAvatar::sUnbakedTime = 0.f;
@@ -647,6 +658,42 @@ F32 LLVOAvatar::sUnbakedUpdateTime = 0.f;
 F32 LLVOAvatar::sGreyTime = 0.f;
 F32 LLVOAvatar::sGreyUpdateTime = 0.f;
 
+struct LLDeferredAnimation
+{
+	LLDeferredAnimation(LLVOAvatar* avatarp, const LLVector3& root_pos_last, F32 update_time)
+	:	mAvatar(avatarp), mRootPosLast(root_pos_last), mUpdateTime(update_time)
+	{}
+
+	LLPointer<LLVOAvatar>	mAvatar;
+	LLVector3				mRootPosLast;
+	F32						mUpdateTime; // msec spent in idleUpdate() before deferring
+};
+typedef std::vector<LLDeferredAnimation> deferred_animation_list_t;
+static deferred_animation_list_t sDeferredAnimations;
+// most job pool workers evaluating deferred motions, 0 = no deferring
+static U32 sAnimationWorkers = 0;
+
+typedef std::vector<LLCharacter*> character_list_t;
+
+// Evaluates the motions of one deferred avatar per index, between
+// beginMotionUpdate() and commitMotionUpdate() on the main thread.
+class LLMotionEvaluationWork : public LLJobPool::Work
+{
+public:
+	LLMotionEvaluationWork(const character_list_t& characters)
+	:	mCharacters(characters)
+	{
+	}
+
+	/*virtual*/ void run(U32 index)
+	{
+		mCharacters[index]->evaluateMotions();
+	}
+
+private:
+	const character_list_t& mCharacters;
+};
+
 //-----------------------------------------------------------------------------
 // Helper functions
 //-----------------------------------------------------------------------------
@@ -698,7 +745,12 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
 	mPreviousFullyLoaded(FALSE),
 	mFullyLoadedInitialized(FALSE),
 	mSupportsAlphaLayers(FALSE),
-	mLoadedCallbacksPaused(FALSE)
+	mLoadedCallbacksPaused(FALSE),
+	mAnimationDeferred(FALSE),
+	mUpdateCost(0.f),
+	mUpdateInterval(1),
+	mLastUpdateFrame(0),
+	mSkipUpdate(FALSE)
 {
 	LLMemType mt(LLMemType::MTYPE_AVATAR);
 	//VTResume();  // VTune
@@ -743,6 +795,7 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
 
 	mImpostorDistance = 0;
 	mImpostorPixelArea = 0;
+	mImpostorUpdateFrame = 0;
 
 	setNumTEs(TEX_NUM_INDICES);
 
@@ -803,6 +856,11 @@ LLVOAvatar::~LLVOAvatar()
 	}
 	lldebugs << "LLVOAvatar Destructor (0x" << this << ") id:" << mID << llendl;
 
+	if (LLImpostorAtlas::instanceExists())
+	{
+		LLImpostorAtlas::getInstance()->free(mImpostorSlot);
+	}
+
 	mRoot.removeAllChildren();
 
 	deleteAndClearArray(mSkeleton);
@@ -1037,6 +1095,7 @@ void LLVOAvatar::resetImpostors()
 		LLVOAvatar* avatar = (LLVOAvatar*) *iter;
 		avatar->mImpostor.release();
 	}
+	LLImpostorAtlas::getInstance()->release();
 }
 
 // static
@@ -1067,7 +1126,7 @@ void LLVOAvatar::initClass()
 	std::string xmlFile;
 
 	xmlFile = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER,AVATAR_DEFAULT_CHAR) + "_lad.xml";
-	BOOL success = sXMLTree.parseFile( xmlFile, FALSE );
+	BOOL success = parseXmlFileCached(sXMLTree, xmlFile);
 	if (!success)
 	{
 		llerrs << "Problem reading avatar configuration file:" << xmlFile << llendl;
@@ -1177,6 +1236,8 @@ void LLVOAvatar::initClass()
 
 void LLVOAvatar::cleanupClass()
 {
+	setAnimationThreads(0);
+	LLViewerJointMesh::setSkinningThreads(0);
 	deleteAndClear(sAvatarXmlInfo);
 	sSkeletonXMLTree.cleanup();
 	sXMLTree.cleanup();
@@ -1546,6 +1607,41 @@ BOOL LLVOAvatar::lineSegmentIntersect(const LLVector3& start, const LLVector3& e
 	return FALSE;
 }
 
+//-----------------------------------------------------------------------------
+// parseXmlFileCached()
+// Loads an avatar definition file from its binary image in the cache
+// directory, falling back to the XML parser (and refreshing the image) when
+// the image is missing or was built from a different version of the file.
+//-----------------------------------------------------------------------------
+BOOL LLVOAvatar::parseXmlFileCached(LLXmlTree& tree, const std::string& filename)
+{
+	llstat file_status;
+	if (LLFile::stat(filename, &file_status) != 0)
+	{
+		return tree.parseFile(filename, FALSE);
+	}
+
+	// Size and modification time identify the source the image was built from.
+	U64 stamp = ((U64)(U32)file_status.st_size << 32) | (U32)file_status.st_mtime;
+	std::string cache_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, gDirUtilp->getBaseFileName(filename) + ".bin");
+
+	if (tree.loadBinary(cache_file, stamp))
+	{
+		return TRUE;
+	}
+
+	if (!tree.parseFile(filename, FALSE))
+	{
+		return FALSE;
+	}
+
+	if (!tree.saveBinary(cache_file, stamp))
+	{
+		llwarns << "Unable to write avatar definition cache " << cache_file << llendl;
+	}
+	return TRUE;
+}
+
 //-----------------------------------------------------------------------------
 // parseSkeletonFile()
 //-----------------------------------------------------------------------------
@@ -1556,7 +1652,7 @@ BOOL LLVOAvatar::parseSkeletonFile(const std::string& filename)
 	//-------------------------------------------------------------------------
 	// parse the file
 	//-------------------------------------------------------------------------
-	BOOL parsesuccess = sSkeletonXMLTree.parseFile( filename, FALSE );
+	BOOL parsesuccess = parseXmlFileCached(sSkeletonXMLTree, filename);
 
 	if (!parsesuccess)
 	{
@@ -2227,6 +2323,7 @@ BOOL LLVOAvatar::idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time)
 {
 	LLMemType mt(LLMemType::MTYPE_AVATAR);
 	LLFastTimer t(FTM_AVATAR_UPDATE);
+	LLTimer update_timer;
 
 	if (isDead())
 	{
@@ -2296,17 +2393,86 @@ BOOL LLVOAvatar::idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time)
 
 	// attach objects that were waiting for a drawable
 	lazyAttach();
+
+	if (mSkipUpdate)
+	{
+		idleUpdateInterpolated();
+		return TRUE;
+	}
+	mLastUpdateFrame = LLFrameTimer::getFrameCount();
 	
 	// animate the character
 	// store off last frame's root position to be consistent with camera position
 	LLVector3 root_pos_last = mRoot.getWorldPosition();
 	BOOL detailed_update = updateCharacter(agent);
+	mLastUpdatePosition = getRenderPosition();
+	mLastUpdateRotation = getRenderRotation();
 
-	if (gNoRender)
+	if (mAnimationDeferred)
 	{
+		sDeferredAnimations.push_back(LLDeferredAnimation(this, root_pos_last, update_timer.getElapsedTimeF32()*1000.f));
 		return TRUE;
 	}
 
+	idleUpdatePostCharacter(detailed_update, root_pos_last);
+	recordUpdateCost(update_timer.getElapsedTimeF32()*1000.f);
+
+	return TRUE;
+}
+
+//------------------------------------------------------------------------
+// idleUpdateInterpolated()
+// carries the last pose along with the avatar on frames scheduleUpdates()
+// skipped, moving and turning the root by as much as the avatar moved and
+// turned.  The next full update catches the motions up.  Only the motions
+// and the skinning wait, attachments, bridges and the name tag follow the
+// avatar every frame as in a non-detailed update.
+//------------------------------------------------------------------------
+void LLVOAvatar::idleUpdateInterpolated()
+{
+	const LLVector3 root_pos_last = mRoot.getWorldPosition();
+	const LLVector3 render_position = getRenderPosition();
+	const LLVector3 offset = render_position - mLastUpdatePosition;
+	mLastUpdatePosition = render_position;
+
+	const LLQuaternion render_rotation = getRenderRotation();
+	const LLQuaternion turn = ~mLastUpdateRotation * render_rotation;
+	const BOOL turned = render_rotation != mLastUpdateRotation;
+	mLastUpdateRotation = render_rotation;
+
+	const BOOL moved = !offset.isExactlyZero();
+	if (moved || turned)
+	{
+		mRoot.touch();
+		if (moved)
+		{
+			mRoot.setWorldPosition(root_pos_last + offset);
+		}
+		if (turned)
+		{
+			mRoot.setWorldRotation(mRoot.getWorldRotation() * turn);
+		}
+		mRoot.updateWorldMatrixChildren();
+		mNeedsSkin = TRUE;
+	}
+
+	if (gNoRender)
+	{
+		return;
+	}
+
+	idleUpdateMisc(false);
+	idleUpdateNameTag(root_pos_last);
+	idleUpdateRenderCost();
+}
+
+void LLVOAvatar::idleUpdatePostCharacter(BOOL detailed_update, const LLVector3& root_pos_last)
+{
+	if (gNoRender)
+	{
+		return;
+	}
+
 	static LLUICachedControl<bool> visualizers_in_calls("ShowVoiceVisualizersInCalls", false);
 	bool voice_enabled = (visualizers_in_calls || LLVoiceClient::getInstance()->inProximalChannel()) &&
 						 LLVoiceClient::getInstance()->getVoiceEnabled(mID);
@@ -2324,8 +2490,199 @@ BOOL LLVOAvatar::idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time)
 	
 	idleUpdateNameTag( root_pos_last );
 	idleUpdateRenderCost();
+}
 
-	return TRUE;
+//------------------------------------------------------------------------
+// updateDeferredAnimations()
+// evaluates the motions of the avatars queued this frame by idleUpdate()
+// across the animation threads, then finishes their idle updates
+//------------------------------------------------------------------------
+static LLFastTimer::DeclareTimer FTM_DEFERRED_ANIMATION("Deferred Animation");
+static LLFastTimer::DeclareTimer FTM_EVALUATE_ANIMATION("Evaluate Motions");
+
+//static
+void LLVOAvatar::updateDeferredAnimations()
+{
+	if (sDeferredAnimations.empty())
+	{
+		return;
+	}
+
+	LLFastTimer t(FTM_DEFERRED_ANIMATION);
+
+	static character_list_t characters;
+	characters.clear();
+	for (deferred_animation_list_t::iterator iter = sDeferredAnimations.begin();
+		 iter != sDeferredAnimations.end(); ++iter)
+	{
+		LLVOAvatar* avatarp = iter->mAvatar;
+		if (!avatarp->isDead())
+		{
+			characters.push_back(avatarp);
+		}
+	}
+
+	{
+		LLFastTimer t(FTM_EVALUATE_ANIMATION);
+		LLMotionEvaluationWork work(characters);
+		LLJobPool* pool = LLAppViewer::getJobPool();
+		if (pool)
+		{
+			pool->run(work, characters.size(), sAnimationWorkers);
+		}
+		else
+		{
+			for (U32 i = 0; i < characters.size(); ++i)
+			{
+				work.run(i);
+			}
+		}
+	}
+
+	for (deferred_animation_list_t::iterator iter = sDeferredAnimations.begin();
+		 iter != sDeferredAnimations.end(); ++iter)
+	{
+		LLVOAvatar* avatarp = iter->mAvatar;
+		avatarp->mAnimationDeferred = FALSE;
+		if (avatarp->isDead())
+		{
+			continue;
+		}
+		// the motions themselves were evaluated together above and aren't
+		// part of the avatar's cost
+		LLTimer update_timer;
+		avatarp->commitMotionUpdate();
+		BOOL detailed_update = avatarp->updateCharacterPostMotion();
+		avatarp->idleUpdatePostCharacter(detailed_update, iter->mRootPosLast);
+		avatarp->recordUpdateCost(iter->mUpdateTime + update_timer.getElapsedTimeF32()*1000.f);
+	}
+
+	sDeferredAnimations.clear();
+	characters.clear();
+}
+
+//static
+void LLVOAvatar::setAnimationThreads(S32 num_threads)
+{
+	// finish anything already queued with the current limit
+	updateDeferredAnimations();
+
+	sAnimationWorkers = LLJobPool::resolveMaxWorkers(num_threads);
+}
+
+BOOL LLVOAvatar::canDeferAnimation() const
+{
+	// Deferring only pays when the pool has workers to spread the motions
+	// over.  Our own avatar notifies the simulator from requestStopMotion()
+	// and feeds the camera, so it keeps the serial update.
+	LLJobPool* pool = LLAppViewer::getJobPool();
+	return sAnimationWorkers > 0 && pool && pool->getNumWorkers() > 0 &&
+		!isSelf() && !mIsDummy && !gNoRender;
+}
+
+//------------------------------------------------------------------------
+// scheduleUpdates()
+// Gives every visible avatar an update interval from its size on screen,
+// doubled for avatars that are expensive to update, then spends
+// sUpdateBudget on the ones that are due, most overdue first.  Avatars
+// left out are interpolated by idleUpdateInterpolated() and move up the
+// queue as they wait.  Called before the objects' idle updates.
+//------------------------------------------------------------------------
+const F32 AVATAR_FULL_UPDATE_AREA = 20000.f; // pixels, about 200 pixels tall
+const U32 MAX_AVATAR_UPDATE_INTERVAL = 8;
+
+static LLFastTimer::DeclareTimer FTM_SCHEDULE_AVATAR_UPDATES("Schedule Avatar Updates");
+
+//static
+void LLVOAvatar::scheduleUpdates()
+{
+	LLFastTimer t(FTM_SCHEDULE_AVATAR_UPDATES);
+
+	sUpdateTime = sUpdateTimeThisFrame;
+	sUpdateTimeThisFrame = 0.f;
+	sNumUpdatesSkipped = 0;
+
+	const U32 frame = LLFrameTimer::getFrameCount();
+
+	typedef std::vector<std::pair<F32, LLVOAvatar*> > update_queue_t;
+	static update_queue_t queue;
+	queue.clear();
+
+	F32 spent = 0.f;
+	for (std::vector<LLCharacter*>::iterator iter = LLCharacter::sInstances.begin();
+		 iter != LLCharacter::sInstances.end(); ++iter)
+	{
+		LLVOAvatar* avatar = (LLVOAvatar*) *iter;
+		avatar->mSkipUpdate = FALSE;
+		avatar->mUpdateInterval = 1;
+
+		// hidden and impostored avatars already take the cheap path in
+		// updateCharacter()
+		if (sUpdateBudget <= 0.f || avatar->isDead() || avatar->isSelf() || avatar->mIsDummy ||
+			!avatar->mIsBuilt || !avatar->isVisible() || avatar->isImpostor())
+		{
+			continue;
+		}
+
+		// never-updated avatars have nothing to interpolate from yet
+		if (avatar->mLastUpdateFrame == 0 || avatar->isUpdateImportant())
+		{
+			spent += avatar->mUpdateCost;
+			continue;
+		}
+
+		U32 interval = llclamp((U32) sqrtf(AVATAR_FULL_UPDATE_AREA / llmax(avatar->mPixelArea, 1.f)),
+							   (U32) 1, MAX_AVATAR_UPDATE_INTERVAL);
+		if (avatar->mUpdateCost > sUpdateHeavyCost)
+		{
+			interval = llmin(interval * 2, MAX_AVATAR_UPDATE_INTERVAL);
+		}
+		avatar->mUpdateInterval = interval;
+
+		const U32 age = frame - avatar->mLastUpdateFrame;
+		avatar->mSkipUpdate = TRUE;
+		if (age >= interval)
+		{
+			queue.push_back(std::make_pair((F32) age / (F32) interval, avatar));
+		}
+	}
+
+	std::sort(queue.begin(), queue.end(), std::greater<update_queue_t::value_type>());
+
+	// the most overdue avatar always gets its update so nobody starves
+	for (update_queue_t::iterator iter = queue.begin(); iter != queue.end(); ++iter)
+	{
+		LLVOAvatar* avatar = iter->second;
+		if (iter != queue.begin() && spent + avatar->mUpdateCost > sUpdateBudget)
+		{
+			break;
+		}
+		spent += avatar->mUpdateCost;
+		avatar->mSkipUpdate = FALSE;
+	}
+
+	for (std::vector<LLCharacter*>::iterator iter = LLCharacter::sInstances.begin();
+		 iter != LLCharacter::sInstances.end(); ++iter)
+	{
+		if (((LLVOAvatar*) *iter)->mSkipUpdate)
+		{
+			sNumUpdatesSkipped++;
+		}
+	}
+}
+
+// avatars the user is likely watching are updated every frame
+BOOL LLVOAvatar::isUpdateImportant() const
+{
+	return mNeedsAnimUpdate || mAppearanceAnimating || mTyping || !mChats.empty() ||
+		(mVoiceVisualizer && mVoiceVisualizer->getCurrentlySpeaking()) ||
+		gAgentCamera.getFocusObject() == this;
+}
+
+void LLVOAvatar::recordUpdateCost(F32 msec)
+{
+	mUpdateCost = lerp(mUpdateCost, msec, 0.2f);
+	sUpdateTimeThisFrame += msec;
 }
 
 void LLVOAvatar::idleUpdateVoiceVisualizer(bool voice_enabled)
@@ -2540,7 +2897,6 @@ void LLVOAvatar::idleUpdateAppearanceAnimation()
 	// update morphing params
 	if (mAppearanceAnimating)
 	{
-		ESex avatar_sex = getSex();
 		F32 appearance_anim_time = mAppearanceMorphTimer.getElapsedTimeF32();
 		if (appearance_anim_time >= APPEARANCE_MORPH_TIME)
 		{
@@ -2579,13 +2935,8 @@ void LLVOAvatar::idleUpdateAppearanceAnimation()
 				}
 			}
 
-			// apply all params
-			for (param = getFirstVisualParam();
-				 param;
-				 param = getNextVisualParam())
-			{
-				param->apply(avatar_sex);
-			}
+			// apply the params whose interpolated weight moved this frame
+			applyChangedVisualParams();
 
 			mLastAppearanceBlendTime = appearance_anim_time;
 		}
@@ -3324,10 +3675,23 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 {
 	LLMemType mt(LLMemType::MTYPE_AVATAR);
 
+	// move the joint transforms into the pose arrays once the hierarchy is
+	// complete, changes to the hierarchy unbind them again
+	static LLCachedControl<bool> use_skeleton_pose(gSavedSettings, "AvatarSkeletonPose");
+	if (use_skeleton_pose && mIsBuilt && !mSkeletonPose.isBound())
+	{
+		mSkeletonPose.bind(&mRoot);
+	}
+	else if (!use_skeleton_pose && mSkeletonPose.isBound())
+	{
+		mSkeletonPose.unbind();
+	}
+
 	// clear debug text
 	mDebugText.clear();
 	if (LLVOAvatar::sShowAnimationDebug)
 	{
+		addDebugText(llformat("update %.2f ms, every %d frames", mUpdateCost, mUpdateInterval));
 		for (LLMotionController::motion_list_t::iterator iter = mMotionController.getActiveMotions().begin();
 			 iter != mMotionController.getActiveMotions().end(); ++iter)
 		{
@@ -3694,10 +4058,35 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	mSpeed = speed;
 
 	// update animations
+	LLCharacter::e_update_t update_type = LLCharacter::NORMAL_UPDATE;
 	if (mSpecialRenderMode == 1) // Animation Preview
-		updateMotions(LLCharacter::FORCE_UPDATE);
+		update_type = LLCharacter::FORCE_UPDATE;
+
+	if (canDeferAnimation())
+	{
+		// the motions are evaluated with the other avatars' in
+		// updateDeferredAnimations(), which finishes this update
+		mAnimationDeferred = beginMotionUpdate(update_type);
+		if (mAnimationDeferred)
+		{
+			return TRUE;
+		}
+	}
 	else
-		updateMotions(LLCharacter::NORMAL_UPDATE);
+	{
+		updateMotions(update_type);
+	}
+
+	return updateCharacterPostMotion();
+}
+
+//------------------------------------------------------------------------
+// updateCharacterPostMotion()
+// second half of updateCharacter(), once the new pose is applied
+//------------------------------------------------------------------------
+BOOL LLVOAvatar::updateCharacterPostMotion()
+{
+	LLVector3 normal;
 
 	// update head position
 	updateHeadOffset();
@@ -4008,20 +4397,23 @@ U32 LLVOAvatar::renderSkinned(EAvatarRenderPass pass)
 		if (mNeedsSkin)
 		{
 			//generate animated mesh
-			mMeshLOD[MESH_ID_LOWER_BODY]->updateJointGeometry();
-			mMeshLOD[MESH_ID_UPPER_BODY]->updateJointGeometry();
+			static LLViewerJointMesh::mesh_list_t meshes;
+			meshes.clear();
+			mMeshLOD[MESH_ID_LOWER_BODY]->getSkinnedMeshes(meshes);
+			mMeshLOD[MESH_ID_UPPER_BODY]->getSkinnedMeshes(meshes);
 
 			if( isWearingWearableType( LLWearableType::WT_SKIRT ) )
 			{
-				mMeshLOD[MESH_ID_SKIRT]->updateJointGeometry();
+				mMeshLOD[MESH_ID_SKIRT]->getSkinnedMeshes(meshes);
 			}
 
 			if (!isSelf() || gAgent.needsRenderHead() || LLPipeline::sShadowRender)
 			{
-				mMeshLOD[MESH_ID_EYELASH]->updateJointGeometry();
-				mMeshLOD[MESH_ID_HEAD]->updateJointGeometry();
-				mMeshLOD[MESH_ID_HAIR]->updateJointGeometry();
+				mMeshLOD[MESH_ID_EYELASH]->getSkinnedMeshes(meshes);
+				mMeshLOD[MESH_ID_HEAD]->getSkinnedMeshes(meshes);
+				mMeshLOD[MESH_ID_HAIR]->getSkinnedMeshes(meshes);
 			}
+			LLViewerJointMesh::updateJointGeometry(meshes);
 			mNeedsSkin = FALSE;
 			
 			LLVertexBuffer* vb = mDrawable->getFace(0)->mVertexBuffer;
@@ -4250,11 +4642,19 @@ U32 LLVOAvatar::renderRigid()
 
 U32 LLVOAvatar::renderImpostor(LLColor4U color, S32 diffuse_channel)
 {
-	if (!mImpostor.isComplete())
+	LLRenderTarget* target = getImpostorTarget();
+	if (!target->isComplete())
 	{
 		return 0;
 	}
 
+	LLVector2 tc_min(0.f, 0.f);
+	LLVector2 tc_max(1.f, 1.f);
+	if (target != &mImpostor)
+	{
+		LLImpostorAtlas::getInstance()->getTexCoords(mImpostorSlot, tc_min, tc_max);
+	}
+
 	LLVector3 pos(getRenderPosition()+mImpostorOffset);
 	LLVector3 at = (pos - LLViewerCamera::getInstance()->getOrigin());
 	at.normalize();
@@ -4268,15 +4668,15 @@ U32 LLVOAvatar::renderImpostor(LLColor4U color, S32 diffuse_channel)
 	gGL.setAlphaRejectSettings(LLRender::CF_GREATER, 0.f);
 
 	gGL.color4ubv(color.mV);
-	gGL.getTexUnit(diffuse_channel)->bind(&mImpostor);
+	gGL.getTexUnit(diffuse_channel)->bind(target);
 	gGL.begin(LLRender::QUADS);
-	gGL.texCoord2f(0,0);
+	gGL.texCoord2f(tc_min.mV[0], tc_min.mV[1]);
 	gGL.vertex3fv((pos+left-up).mV);
-	gGL.texCoord2f(1,0);
+	gGL.texCoord2f(tc_max.mV[0], tc_min.mV[1]);
 	gGL.vertex3fv((pos-left-up).mV);
-	gGL.texCoord2f(1,1);
+	gGL.texCoord2f(tc_max.mV[0], tc_max.mV[1]);
 	gGL.vertex3fv((pos-left+up).mV);
-	gGL.texCoord2f(0,1);
+	gGL.texCoord2f(tc_min.mV[0], tc_max.mV[1]);
 	gGL.vertex3fv((pos+left+up).mV);
 	gGL.end();
 	gGL.flush();
@@ -8204,15 +8604,74 @@ U32 LLVOAvatar::getPartitionType() const
 //static
 void LLVOAvatar::updateImpostors() 
 {
+	static LLCachedControl<F32> budget_ms(gSavedSettings, "RenderAvatarImpostorBudget");
+
+	LLTimer update_timer;
+
+	typedef std::vector<std::pair<F32, LLVOAvatar*> > impostor_queue_t;
+	impostor_queue_t queue;
 	for (std::vector<LLCharacter*>::iterator iter = LLCharacter::sInstances.begin();
 		 iter != LLCharacter::sInstances.end(); ++iter)
 	{
 		LLVOAvatar* avatar = (LLVOAvatar*) *iter;
-		if (!avatar->isDead() && avatar->needsImpostorUpdate() && avatar->isVisible() && avatar->isImpostor())
+		if (!avatar->isDead() && avatar->isVisible() && avatar->isImpostor() &&
+			(avatar->needsImpostorUpdate() || !avatar->hasImpostor()))
+		{
+			queue.push_back(std::make_pair(avatar->getImpostorUpdatePriority(), avatar));
+		}
+	}
+
+	std::sort(queue.begin(), queue.end(), std::greater<impostor_queue_t::value_type>());
+
+	// Avatars without an impostor sort first and are always done, otherwise
+	// they would not render at all.  The rest wait for a later frame once
+	// the budget is spent and gain priority while they wait.
+	sNumImpostorUpdates = 0;
+	for (impostor_queue_t::iterator iter = queue.begin(); iter != queue.end(); ++iter)
+	{
+		LLVOAvatar* avatar = iter->second;
+		if (budget_ms > 0.f && sNumImpostorUpdates > 0 && avatar->hasImpostor() &&
+			update_timer.getElapsedTimeF32()*1000.f >= budget_ms)
 		{
-			gPipeline.generateImpostor(avatar);
+			break;
 		}
+		gPipeline.generateImpostor(avatar);
+		sNumImpostorUpdates++;
+	}
+
+	sNumImpostorsDeferred = queue.size() - sNumImpostorUpdates;
+	sImpostorUpdateTime = update_timer.getElapsedTimeF32()*1000.f;
+}
+
+F32 LLVOAvatar::getImpostorUpdatePriority() const
+{
+	if (!hasImpostor())
+	{
+		return F32_MAX;
+	}
+	// bigger on screen and longer since the last update go first
+	U32 age = LLFrameTimer::getFrameCount() - mImpostorUpdateFrame;
+	return mImpostorPixelArea * (F32) (age + 1);
+}
+
+LLRenderTarget* LLVOAvatar::getImpostorTarget()
+{
+	LLImpostorAtlas* atlas = LLImpostorAtlas::getInstance();
+	if (atlas->isValid(mImpostorSlot))
+	{
+		return &atlas->getTarget();
+	}
+	return &mImpostor;
+}
+
+BOOL LLVOAvatar::hasImpostor() const
+{
+	LLImpostorAtlas* atlas = LLImpostorAtlas::getInstance();
+	if (atlas->isValid(mImpostorSlot))
+	{
+		return atlas->getTarget().isComplete();
 	}
+	return mImpostor.isComplete();
 }
 
 BOOL LLVOAvatar::isImpostor() const
@@ -8244,6 +8703,7 @@ void LLVOAvatar::setImpostorDim(const LLVector2& dim)
 void LLVOAvatar::cacheImpostorValues()
 {
 	getImpostorValues(mImpostorExtents, mImpostorAngle, mImpostorDistance);
+	mImpostorUpdateFrame = LLFrameTimer::getFrameCount();
 }
 
 void LLVOAvatar::getImpostorValues(LLVector3* extents, LLVector3& angle, F32& distance) const
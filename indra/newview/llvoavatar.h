@@ -41,6 +41,7 @@
 #include "llviewerjointmesh.h"
 #include "llviewerjointattachment.h"
 #include "llrendertarget.h"
+#include "llimpostoratlas.h"
 #include "llvoavatardefines.h"
 #include "lltexglobalcolor.h"
 #include "lldriverparam.h"
@@ -203,6 +204,15 @@ private:
 	//--------------------------------------------------------------------
 public:
 	virtual BOOL 	updateCharacter(LLAgent &agent);
+	// finishes an idle update whose motions were deferred by updateCharacter()
+	static void		updateDeferredAnimations();
+	static void		setAnimationThreads(S32 num_threads);
+	// picks the avatars that get a full idle update this frame, the others
+	// keep their last pose and only follow their position, attachments
+	// included (see AvatarUpdateBudget)
+	static void		scheduleUpdates();
+	F32				getUpdateCost() const { return mUpdateCost; }
+	U32				getUpdateInterval() const { return mUpdateInterval; }
 	void 			idleUpdateVoiceVisualizer(bool voice_enabled);
 	void 			idleUpdateMisc(bool detailed_update);
 	virtual void	idleUpdateAppearanceAnimation();
@@ -221,6 +231,20 @@ public:
 	void			addNameTagLine(const std::string& line, const LLColor4& color, S32 style, const LLFontGL* font);
 	void 			idleUpdateRenderCost();
 	void 			idleUpdateBelowWater();
+private:
+	BOOL			canDeferAnimation() const;
+	BOOL			updateCharacterPostMotion();
+	void			idleUpdatePostCharacter(BOOL detailed_update, const LLVector3& root_pos_last);
+	void			idleUpdateInterpolated();
+	BOOL			isUpdateImportant() const;
+	void			recordUpdateCost(F32 msec);
+	BOOL			mAnimationDeferred; // motions are waiting for updateDeferredAnimations()
+	F32				mUpdateCost; // smoothed msec of a full idle update
+	U32				mUpdateInterval; // frames between full idle updates, set by scheduleUpdates()
+	U32				mLastUpdateFrame;
+	BOOL			mSkipUpdate; // scheduleUpdates() left this avatar out this frame
+	LLVector3		mLastUpdatePosition; // render position at the last idle update
+	LLQuaternion	mLastUpdateRotation; // render rotation at the last idle update
 
 	//--------------------------------------------------------------------
 	// Static preferences (controlled by user settings/menus)
@@ -241,6 +265,11 @@ public:
 	static BOOL		sShowAttachmentPoints;
 	static F32		sLODFactor; // user-settable LOD factor
 	static F32		sPhysicsLODFactor; // user-settable physics LOD factor
+	static BOOL		sAvatarPhysics; // cached "AvatarPhysics", read by LLPhysicsMotionController off the main thread
+	static F32		sUpdateBudget; // msec per frame for full avatar idle updates, 0 updates every avatar every frame
+	static F32		sUpdateHeavyCost; // avatars whose idle update takes longer than this (msec) are updated less often
+	static S32		sNumUpdatesSkipped; // avatars interpolated instead of updated this frame
+	static F32		sUpdateTime; // msec spent in full avatar idle updates last frame
 	static BOOL		sJointDebug; // output total number of joints being touched for each avatar
 	static BOOL		sDebugAvatarRotation;
 
@@ -288,6 +317,7 @@ public:
 	LLVector3			mHeadOffset; // current head position
 	LLViewerJoint		mRoot;
 protected:
+	static BOOL			parseXmlFileCached(LLXmlTree& tree, const std::string& filename);
 	static BOOL			parseSkeletonFile(const std::string& filename);
 	void				buildCharacter();
 	virtual BOOL		loadAvatar();
@@ -406,8 +436,16 @@ public:
 	void 		setImpostorDim(const LLVector2& dim);
 	static void	resetImpostors();
 	static void updateImpostors();
+	F32			getImpostorUpdatePriority() const;
+	// the atlas while the impostor has a slot in it, mImpostor otherwise
+	LLRenderTarget* getImpostorTarget();
+	BOOL		hasImpostor() const;
 	LLRenderTarget mImpostor;
+	LLImpostorAtlas::Slot mImpostorSlot;
 	BOOL		mNeedsImpostorUpdate;
+	static F32	sImpostorUpdateTime; // msec spent regenerating impostors last frame
+	static S32	sNumImpostorUpdates;
+	static S32	sNumImpostorsDeferred; // impostors left for a later frame by the budget
 private:
 	LLVector3	mImpostorOffset;
 	LLVector2	mImpostorDim;
@@ -416,6 +454,7 @@ private:
 	LLVector3	mImpostorAngle;
 	F32			mImpostorDistance;
 	F32			mImpostorPixelArea;
+	U32			mImpostorUpdateFrame;
 	LLVector3	mLastAnimExtents[2];  
 
 	//--------------------------------------------------------------------
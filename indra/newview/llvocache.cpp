@@ -591,11 +591,23 @@ BOOL LLVOCache::updateEntry(const HeaderEntryInfo* entry)
 }
 
 void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
+{
+	std::string filename;
+	if(!getCacheFileToRead(handle, filename))
+	{
+		return ;
+	}
+
+	BOOL success = readCacheFile(filename, id, cache_entry_map, mLocalAPRFilePoolp) ;
+	readDone(handle, success, cache_entry_map) ;
+}
+
+BOOL LLVOCache::getCacheFileToRead(U64 handle, std::string& filename) 
 {
 	if(!mEnabled)
 	{
 		llwarns << "Not reading cache for handle " << handle << "): Cache is currently disabled." << llendl;
-		return ;
+		return FALSE ;
 	}
 	llassert_always(mInitialized);
 
@@ -603,55 +615,61 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 	if(iter == mHandleEntryMap.end()) //no cache
 	{
 		llwarns << "No handle map entry for " << handle << llendl;
-		return ;
+		return FALSE ;
 	}
 
-	bool success = true ;
-	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_READ|APR_BINARY, mLocalAPRFilePoolp);
-	
-		LLUUID cache_id ;
-		success = check_read(&apr_file, cache_id.mData, UUID_BYTES) ;
-	
+	getObjectCacheFilename(handle, filename);
+	return TRUE ;
+}
+
+//static
+BOOL LLVOCache::readCacheFile(const std::string& filename, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, LLVolatileAPRPool* pool) 
+{
+	LLAPRFile apr_file(filename, APR_READ|APR_BINARY, pool);
+
+	LLUUID cache_id ;
+	BOOL success = check_read(&apr_file, cache_id.mData, UUID_BYTES) ;
+
+	if(success)
+	{		
+		if(cache_id != id)
+		{
+			llinfos << "Cache ID doesn't match for this region, discarding"<< llendl;
+			success = FALSE ;
+		}
+
 		if(success)
-		{		
-			if(cache_id != id)
-			{
-				llinfos << "Cache ID doesn't match for this region, discarding"<< llendl;
-				success = false ;
-			}
+		{
+			S32 num_entries;
+			success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
 
-			if(success)
+			for (S32 i = 0; success && i < num_entries; i++)
 			{
-				S32 num_entries;
-				success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-	
-				for (S32 i = 0; success && i < num_entries; i++)
+				LLVOCacheEntry* entry = new LLVOCacheEntry(&apr_file);
+				if (!entry->getLocalID())
 				{
-					LLVOCacheEntry* entry = new LLVOCacheEntry(&apr_file);
-					if (!entry->getLocalID())
-					{
-						llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
-						delete entry ;
-						success = false ;
-					}
-					cache_entry_map[entry->getLocalID()] = entry;
+					llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
+					delete entry ;
+					success = FALSE ;
 				}
+				cache_entry_map[entry->getLocalID()] = entry;
 			}
-		}		
-	}
-	
-	if(!success)
+		}
+	}		
+
+	return success ;
+}
+
+void LLVOCache::readDone(U64 handle, BOOL success, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
+{
+	if(!success && cache_entry_map.empty())
 	{
-		if(cache_entry_map.empty())
+		handle_entry_map_t::iterator iter = mHandleEntryMap.find(handle) ;
+		if(iter != mHandleEntryMap.end())
 		{
 			removeEntry(iter->second) ;
 		}
 	}
-
-	return ;
 }
 	
 void LLVOCache::purgeEntries(U32 size)
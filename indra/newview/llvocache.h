@@ -115,6 +115,10 @@ public:
 	void removeCache(ELLPath location) ;
 
 	void readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
+	// Reading in the background: getCacheFileToRead() and readDone() on the main thread, readCacheFile() anywhere
+	BOOL getCacheFileToRead(U64 handle, std::string& filename) ;
+	static BOOL readCacheFile(const std::string& filename, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, LLVolatileAPRPool* pool) ;
+	void readDone(U64 handle, BOOL success, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
 	void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache) ;
 	void removeEntry(U64 handle) ;
 
@@ -66,6 +66,21 @@ F32 w_mod[GRASS_MAX_BLADES];					//  Factor to modulate wind movement by to rand
 
 LLVOGrass::SpeciesMap LLVOGrass::sSpeciesTable;
 S32 LLVOGrass::sMaxGrassSpecies = 0;
+F32 LLVOGrass::sRebuildTime = 0.f;
+
+// Every blade is the same two sided quad
+static const LLVector2 BLADE_TEX_COORDS[8] =
+{
+	LLVector2(0, 0),
+	LLVector2(0, 0),
+	LLVector2(0, 0.98f),
+	LLVector2(0, 0.98f),
+	LLVector2(1, 0),
+	LLVector2(1, 0),
+	LLVector2(1, 0.98f),
+	LLVector2(1, 0.98f)
+};
+static const U16 BLADE_INDICES[12] = { 0, 2, 4,  2, 6, 4,  1, 5, 3,  3, 5, 7 };
 
 
 LLVOGrass::LLVOGrass(const LLUUID &id, const LLPCode pcode, LLViewerRegion *regionp)
@@ -235,6 +250,32 @@ void LLVOGrass::initClass()
 		w_mod[i] = 0.5f + ll_frand();						//  Degree to which blade is moved by wind
 
 	}
+
+	for (SpeciesMap::iterator iter = sSpeciesTable.begin(); iter != sSpeciesTable.end(); ++iter)
+	{
+		initBladeLayout(iter->second);
+	}
+}
+
+//static
+void LLVOGrass::initBladeLayout(GrassSpeciesData* species)
+{
+	species->mBladeBaseX.resize(GRASS_MAX_BLADES);
+	species->mBladeBaseY.resize(GRASS_MAX_BLADES);
+	species->mBladeHeight.resize(GRASS_MAX_BLADES);
+
+	for (S32 i = 0; i < GRASS_MAX_BLADES; i++)
+	{
+		species->mBladeBaseX[i] = rot_x[i] * GRASS_BLADE_BASE * species->mBladeSizeX * w_mod[i];
+		species->mBladeBaseY[i] = rot_y[i] * GRASS_BLADE_BASE * species->mBladeSizeX * w_mod[i];
+		species->mBladeHeight[i] = GRASS_BLADE_HEIGHT * species->mBladeSizeY * w_mod[i];
+	}
+}
+
+//static
+U32 LLVOGrass::getGeometryCacheBytes()
+{
+	return sSpeciesTable.size() * GRASS_MAX_BLADES * 3 * sizeof(F32);
 }
 
 void LLVOGrass::cleanupClass()
@@ -479,6 +520,8 @@ void LLVOGrass::getGeometry(S32 idx,
 	if (mPatch)
 		mLastPatchUpdateTime = mPatch->getLastUpdateTime();
 	
+	LLTimer rebuild_timer;
+
 	LLVector3 position;
 	// Create random blades of grass with gaussian distribution
 	F32 x,y,xf,yf,dzx,dzy;
@@ -487,8 +530,9 @@ void LLVOGrass::getGeometry(S32 idx,
 
 	LLFace *face = mDrawable->getFace(idx);
 
-	F32 width  = sSpeciesTable[mSpecies]->mBladeSizeX;
-	F32 height = sSpeciesTable[mSpecies]->mBladeSizeY;
+	const GrassSpeciesData* species = sSpeciesTable[mSpecies];
+	const LLVector3 origin_agent = mRegionp->getOriginAgent();
+	LLSurface& land = mRegionp->getLand();
 
 	U32 index_offset = face->getGeomIndex();
 
@@ -496,40 +540,31 @@ void LLVOGrass::getGeometry(S32 idx,
 	{
 		x   = exp_x[i] * mScale.mV[VX];
 		y   = exp_y[i] * mScale.mV[VY];
-		xf  = rot_x[i] * GRASS_BLADE_BASE * width * w_mod[i];
-		yf  = rot_y[i] * GRASS_BLADE_BASE * width * w_mod[i];
+		xf  = species->mBladeBaseX[i];
+		yf  = species->mBladeBaseY[i];
 		dzx = dz_x [i];
 		dzy = dz_y [i];
 
 		LLVector3 v1,v2,v3;
-		F32 blade_height= GRASS_BLADE_HEIGHT * height * w_mod[i];
-
-		*texcoordsp++   = LLVector2(0, 0);
-		*texcoordsp++   = LLVector2(0, 0);
-		*texcoordsp++   = LLVector2(0, 0.98f);
-		*texcoordsp++   = LLVector2(0, 0.98f);
-		*texcoordsp++   = LLVector2(1, 0);
-		*texcoordsp++   = LLVector2(1, 0);
-		*texcoordsp++   = LLVector2(1, 0.98f);
-		*texcoordsp++   = LLVector2(1, 0.98f);
+		F32 blade_height= species->mBladeHeight[i];
 
 		position.mV[0]  = mPosition.mV[VX] + x + xf;
 		position.mV[1]  = mPosition.mV[VY] + y + yf;
-		position.mV[2]  = mRegionp->getLand().resolveHeightRegion(position);
-		*verticesp++    = v1 = position + mRegionp->getOriginAgent();
+		position.mV[2]  = land.resolveHeightRegion(position);
+		*verticesp++    = v1 = position + origin_agent;
 		*verticesp++    = v1;
 
 
 		position.mV[0] += dzx;
 		position.mV[1] += dzy;
 		position.mV[2] += blade_height;
-		*verticesp++    = v2 = position + mRegionp->getOriginAgent();
+		*verticesp++    = v2 = position + origin_agent;
 		*verticesp++    = v2;
 
 		position.mV[0]  = mPosition.mV[VX] + x - xf;
 		position.mV[1]  = mPosition.mV[VY] + y - xf;
-		position.mV[2]  = mRegionp->getLand().resolveHeightRegion(position);
-		*verticesp++    = v3 = position + mRegionp->getOriginAgent();
+		position.mV[2]  = land.resolveHeightRegion(position);
+		*verticesp++    = v3 = position + origin_agent;
 		*verticesp++    = v3;
 
 		LLVector3 normal1 = (v1-v2) % (v2-v3);
@@ -541,7 +576,7 @@ void LLVOGrass::getGeometry(S32 idx,
 		position.mV[0] += dzx;
 		position.mV[1] += dzy;
 		position.mV[2] += blade_height;
-		*verticesp++    = v1 = position + mRegionp->getOriginAgent();
+		*verticesp++    = v1 = position + origin_agent;
 		*verticesp++    = v1;
 
 		*(normalsp++)   = normal1;
@@ -554,34 +589,22 @@ void LLVOGrass::getGeometry(S32 idx,
 		*(normalsp++)   = normal1;
 		*(normalsp++)   = normal2;
 
-		*(colorsp++)   = color;
-		*(colorsp++)   = color;
-		*(colorsp++)   = color;
-		*(colorsp++)   = color;
-		*(colorsp++)   = color;
-		*(colorsp++)   = color;
-		*(colorsp++)   = color;
-		*(colorsp++)   = color;
-		
-		*indicesp++     = index_offset + 0;
-		*indicesp++     = index_offset + 2;
-		*indicesp++     = index_offset + 4;
-
-		*indicesp++     = index_offset + 2;
-		*indicesp++     = index_offset + 6;
-		*indicesp++     = index_offset + 4;
-
-		*indicesp++     = index_offset + 1;
-		*indicesp++     = index_offset + 5;
-		*indicesp++     = index_offset + 3;
+		for (S32 j = 0; j < 8; j++)
+		{
+			*texcoordsp++ = BLADE_TEX_COORDS[j];
+			*colorsp++ = color;
+		}
 
-		*indicesp++     = index_offset + 3;
-		*indicesp++     = index_offset + 5;
-		*indicesp++     = index_offset + 7;
+		for (S32 j = 0; j < 12; j++)
+		{
+			*indicesp++ = index_offset + BLADE_INDICES[j];
+		}
 		index_offset   += 8;
 	}
 
 	LLPipeline::sCompiles++;
+
+	sRebuildTime += rebuild_timer.getElapsedTimeF32();
 }
 
 U32 LLVOGrass::getPartitionType() const
@@ -635,8 +658,7 @@ BOOL LLVOGrass::lineSegmentIntersect(const LLVector3& start, const LLVector3& en
 
 	LLColor4U color(255,255,255,255);
 
-	F32 width  = sSpeciesTable[mSpecies]->mBladeSizeX;
-	F32 height = sSpeciesTable[mSpecies]->mBladeSizeY;
+	const GrassSpeciesData* species = sSpeciesTable[mSpecies];
 
 	LLVector2 tc[4];
 	LLVector3 v[4];
@@ -648,13 +670,13 @@ BOOL LLVOGrass::lineSegmentIntersect(const LLVector3& start, const LLVector3& en
 	{
 		x   = exp_x[i] * mScale.mV[VX];
 		y   = exp_y[i] * mScale.mV[VY];
-		xf  = rot_x[i] * GRASS_BLADE_BASE * width * w_mod[i];
-		yf  = rot_y[i] * GRASS_BLADE_BASE * width * w_mod[i];
+		xf  = species->mBladeBaseX[i];
+		yf  = species->mBladeBaseY[i];
 		dzx = dz_x [i];
 		dzy = dz_y [i];
 
 		LLVector3 v1,v2,v3;
-		F32 blade_height= GRASS_BLADE_HEIGHT * height * w_mod[i];
+		F32 blade_height= species->mBladeHeight[i];
 
 		tc[0]   = LLVector2(0, 0);
 		tc[1]   = LLVector2(0, 0.98f);
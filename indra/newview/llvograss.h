@@ -87,12 +87,22 @@ public:
 
 	static S32 sMaxGrassSpecies;
 
+	static F32 sRebuildTime;		// Seconds spent building grass geometry, reset by the stats each frame
+
+	// Memory held by the blade layouts shared between grass objects, in bytes
+	static U32 getGeometryCacheBytes();
+
 	struct GrassSpeciesData
 	{
 		LLUUID	mTextureID;
 		
 		F32		mBladeSizeX;
 		F32		mBladeSizeY;
+
+		// Blade shapes, the same for all grass of the species
+		std::vector<F32> mBladeBaseX;	// half width of the blade base
+		std::vector<F32> mBladeBaseY;
+		std::vector<F32> mBladeHeight;
 	};
 
 	typedef std::map<U32, GrassSpeciesData*> SpeciesMap;
@@ -116,6 +126,7 @@ protected:
 
 private:
 	void updateSpecies();
+	static void initBladeLayout(GrassSpeciesData* species);
 	F32 mLastHeight;		// For cheap update hack
 	S32 mNumBlades;
 
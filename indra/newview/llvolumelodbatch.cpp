@@ -0,0 +1,196 @@
+/** 
+ * @file llvolumelodbatch.cpp
+ * @brief Batched distance and LOD selection for static volumes
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#include "llviewerprecompiledheaders.h"
+
+#include "llvolumelodbatch.h"
+
+#include "llcamera.h"
+#include "lldrawable.h"
+#include "llv4math.h"		// for LL_VECTORIZE
+#include "llviewercamera.h"
+#include "llvolumemgr.h"
+#include "llvovolume.h"
+#include "pipeline.h"
+
+BOOL LLVolumeLODBatch::sEnabled = TRUE;
+
+static LLFastTimer::DeclareTimer FTM_VOLUME_LOD_BATCH("Volume LOD");
+
+LLVolumeLODBatch::LLVolumeLODBatch()
+{
+}
+
+//static
+bool LLVolumeLODBatch::canBatch(LLDrawable* drawablep)
+{
+	//active drawables are updated through their bridge, avatars update visibility in updateLOD
+	return sEnabled && 
+		LLViewerCamera::sCurCameraID == LLViewerCamera::CAMERA_WORLD &&
+		!drawablep->isActive() && 
+		drawablep->getVOVolume() != NULL;
+}
+
+void LLVolumeLODBatch::push(LLDrawable* drawablep, LLCamera& camera)
+{
+	LLVOVolume* volume = drawablep->getVOVolume();
+	LLVector3 pos = drawablep->prepDistanceUpdate(camera, false);
+
+	mDrawables.push_back(drawablep);
+	mPosX.push_back(pos.mV[VX]);
+	mPosY.push_back(pos.mV[VY]);
+	mPosZ.push_back(pos.mV[VZ]);
+	mRadius.push_back(llround(volume->getLODRadius(), 0.01f));
+}
+
+void LLVolumeLODBatch::clear()
+{
+	mDrawables.clear();
+	mPosX.clear();
+	mPosY.clear();
+	mPosZ.clear();
+	mRadius.clear();
+}
+
+void LLVolumeLODBatch::process(LLCamera& camera)
+{
+	U32 count = mDrawables.size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	LLFastTimer t(FTM_VOLUME_LOD_BATCH);
+
+	mDistance.resize(count);
+	mDetail.resize(count);
+
+	const LLVector3& origin = camera.getOrigin();
+	U32 vec_end = 0;
+#if LL_VECTORIZE
+	if (LLPipeline::sDynamicLOD)
+	{ //static LOD depends only on radius, nothing to gain
+		vec_end = count & ~3;
+		computeVectorized(origin, 0, vec_end);
+	}
+#endif
+	computeScalar(origin, vec_end, count);
+
+	//write back
+	for (U32 i = 0; i < count; ++i)
+	{
+		LLDrawable* drawablep = mDrawables[i];
+		drawablep->mDistanceWRTCamera = mDistance[i];
+		drawablep->getVOVolume()->applyLODDetail(mDetail[i]);
+	}
+
+	clear();
+}
+
+void LLVolumeLODBatch::computeScalar(const LLVector3& origin, U32 begin, U32 end)
+{
+	for (U32 i = begin; i < end; ++i)
+	{
+		LLVector3 pos(mPosX[i], mPosY[i], mPosZ[i]);
+		pos -= origin;
+		mDistance[i] = llround(pos.magVec(), 0.01f);
+		mDetail[i] = LLVOVolume::calcLODDetail(mDistance[i], mRadius[i]);
+	}
+}
+
+#if LL_VECTORIZE
+
+//same rounding as llround(v, 0.01f), floor(v*100 + 0.5)*0.01 with .5 rounding up,
+//for the non-negative values used here.  Values too large to carry a fraction pass through.
+inline V4F32 round_hundredth(V4F32 v)
+{
+	const V4F32 magic = _mm_set1_ps(8388608.f);
+	const V4F32 one = _mm_set1_ps(1.f);
+	V4F32 t = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(100.f)), _mm_set1_ps(0.5f));
+
+	//the magic add rounds to nearest even, step back down where that went up to get floor()
+	V4F32 r = _mm_sub_ps(_mm_add_ps(t, magic), magic);
+	r = _mm_sub_ps(r, _mm_and_ps(_mm_cmpgt_ps(r, t), one));
+
+	V4F32 has_fraction = _mm_cmplt_ps(t, magic);
+	t = _mm_or_ps(_mm_and_ps(has_fraction, r), _mm_andnot_ps(has_fraction, t));
+	return _mm_mul_ps(t, _mm_set1_ps(0.01f));
+}
+
+//same math as LLVOVolume::calcLOD, four volumes at a time
+void LLVolumeLODBatch::computeVectorized(const LLVector3& origin, U32 begin, U32 end)
+{
+	const V4F32 ox = _mm_set1_ps(origin.mV[VX]);
+	const V4F32 oy = _mm_set1_ps(origin.mV[VY]);
+	const V4F32 oz = _mm_set1_ps(origin.mV[VZ]);
+
+	const F32 ramp_dist = LLVOVolume::sLODFactor * 2.f;
+	const V4F32 ramp = _mm_set1_ps(ramp_dist);
+	const V4F32 inv_ramp = _mm_set1_ps(1.f/ramp_dist);
+	const V4F32 distance_factor = _mm_set1_ps(LLVOVolume::sDistanceFactor);
+	const V4F32 fov_factor = _mm_set1_ps(F_PI/3.f);
+	const V4F32 lod_factor = _mm_set1_ps(LLVOVolume::sLODFactor);
+
+	LL_LLV4MATH_ALIGN_PREFIX F32 tan_angle[4] LL_LLV4MATH_ALIGN_POSTFIX;
+
+	for (U32 i = begin; i < end; i += 4)
+	{
+		V4F32 dx = _mm_sub_ps(_mm_loadu_ps(&mPosX[i]), ox);
+		V4F32 dy = _mm_sub_ps(_mm_loadu_ps(&mPosY[i]), oy);
+		V4F32 dz = _mm_sub_ps(_mm_loadu_ps(&mPosZ[i]), oz);
+
+		V4F32 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		dist = round_hundredth(_mm_sqrt_ps(dist));
+		_mm_storeu_ps(&mDistance[i], dist);
+
+		V4F32 lod_dist = _mm_mul_ps(dist, distance_factor);
+
+		// Boost LOD when you're REALLY close
+		V4F32 near_dist = _mm_mul_ps(lod_dist, inv_ramp);
+		near_dist = _mm_mul_ps(_mm_mul_ps(near_dist, near_dist), ramp);
+		V4F32 is_near = _mm_cmplt_ps(lod_dist, ramp);
+		lod_dist = _mm_or_ps(_mm_and_ps(is_near, near_dist), _mm_andnot_ps(is_near, lod_dist));
+
+		lod_dist = round_hundredth(_mm_mul_ps(lod_dist, fov_factor));
+
+		V4F32 tan_v = _mm_div_ps(_mm_mul_ps(lod_factor, _mm_loadu_ps(&mRadius[i])), lod_dist);
+		_mm_store_ps(tan_angle, round_hundredth(tan_v));
+
+		for (U32 j = 0; j < 4; ++j)
+		{ //threshold lookup is a handful of compares, not worth vectorizing
+			mDetail[i+j] = LLVolumeLODGroup::getDetailFromTan(tan_angle[j]);
+		}
+	}
+}
+
+#else
+
+void LLVolumeLODBatch::computeVectorized(const LLVector3& origin, U32 begin, U32 end)
+{
+	computeScalar(origin, begin, end);
+}
+
+#endif
@@ -0,0 +1,69 @@
+/** 
+ * @file llvolumelodbatch.h
+ * @brief Batched distance and LOD selection for static volumes
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+ 
+#ifndef LL_LLVOLUMELODBATCH_H
+#define LL_LLVOLUMELODBATCH_H
+
+#include "v3math.h"
+
+#include <vector>
+
+class LLCamera;
+class LLDrawable;
+
+// Collects the static volumes whose LOD is due for an update during stateSort
+// and selects their LOD all at once.  Positions and radii are packed into
+// flat arrays so the distance/LOD math can run four objects at a time when
+// the build is vectorized (see llv4math.h).
+class LLVolumeLODBatch
+{
+public:
+	LLVolumeLODBatch();
+
+	static bool canBatch(LLDrawable* drawablep);
+
+	void push(LLDrawable* drawablep, LLCamera& camera);
+	void process(LLCamera& camera);
+	void clear();
+
+	U32 size() const								{ return mDrawables.size(); }
+
+	static BOOL sEnabled;
+
+private:
+	void computeScalar(const LLVector3& origin, U32 begin, U32 end);
+	void computeVectorized(const LLVector3& origin, U32 begin, U32 end);
+
+	std::vector<LLDrawable*> mDrawables;
+	std::vector<F32> mPosX;
+	std::vector<F32> mPosY;
+	std::vector<F32> mPosZ;
+	std::vector<F32> mRadius;
+	std::vector<F32> mDistance;
+	std::vector<S32> mDetail;
+};
+
+#endif // LL_LLVOLUMELODBATCH_H
@@ -120,9 +120,9 @@ LLDrawable* LLVOPartGroup::createDrawable(LLPipeline *pipeline)
 
 F32 LLVOPartGroup::getPartSize(S32 idx)
 {
-	if (idx < (S32) mViewerPartGroupp->mParticles.size())
+	if (idx < mViewerPartGroupp->getCount())
 	{
-		return mViewerPartGroupp->mParticles[idx]->mScale.mV[0];
+		return mViewerPartGroupp->getPartScale(idx).mV[0];
 	}
 
 	return 0.f;
@@ -181,17 +181,17 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 	F32 pixel_meter_ratio = LLViewerCamera::getInstance()->getPixelMeterRatio();
 	pixel_meter_ratio *= pixel_meter_ratio;
 
-	LLViewerPartSim::checkParticleCount(mViewerPartGroupp->mParticles.size()) ;
+	LLViewerPartSim::checkParticleCount(mViewerPartGroupp->getCount()) ;
 
 	S32 count=0;
 	mDepth = 0.f;
 	S32 i = 0 ;
 	LLVector3 camera_agent = getCameraPosition();
-	for (i = 0 ; i < (S32)mViewerPartGroupp->mParticles.size(); i++)
+	const LLViewerPartGroup* part_group = mViewerPartGroupp;
+	for (i = 0 ; i < part_group->getCount(); i++)
 	{
-		const LLViewerPart *part = mViewerPartGroupp->mParticles[i];
-
-		LLVector3 part_pos_agent(part->mPosAgent);
+		LLVector3 part_pos_agent(part_group->getPartPosition(i));
+		LLVector2 part_scale(part_group->getPartScale(i));
 		LLVector3 at(part_pos_agent - camera_agent);
 
 		F32 camera_dist_squared = at.lengthSquared();
@@ -200,7 +200,7 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 			inv_camera_dist_squared = 1.f / camera_dist_squared;
 		else
 			inv_camera_dist_squared = 1.f;
-		F32 area = part->mScale.mV[0] * part->mScale.mV[1] * inv_camera_dist_squared;
+		F32 area = part_scale.mV[0] * part_scale.mV[1] * inv_camera_dist_squared;
 		tot_area = llmax(tot_area, area);
  		
 		if (tot_area > max_area)
@@ -231,7 +231,7 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 		
 		facep->setViewerObject(this);
 
-		if (part->mFlags & LLPartData::LL_PART_EMISSIVE_MASK)
+		if (part_group->getPartFlags(i) & LLPartData::LL_PART_EMISSIVE_MASK)
 		{
 			facep->setState(LLFace::FULLBRIGHT);
 		}
@@ -240,14 +240,15 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 			facep->clearState(LLFace::FULLBRIGHT);
 		}
 
-		facep->mCenterLocal = part->mPosAgent;
-		facep->setFaceColor(part->mColor);
-		facep->setTexture(part->mImagep);
+		LLViewerTexture* imagep = part_group->getPartImage(i);
+		facep->mCenterLocal = part_pos_agent;
+		facep->setFaceColor(part_group->getPartColor(i));
+		facep->setTexture(imagep);
 			
 		//check if this particle texture is replaced by a parcel media texture.
-		if(part->mImagep.notNull() && part->mImagep->hasParcelMedia()) 
+		if(imagep && imagep->hasParcelMedia()) 
 		{
-			part->mImagep->getParcelMedia()->addMediaToFace(facep) ;
+			imagep->getParcelMedia()->addMediaToFace(facep) ;
 		}
 
 		mPixelArea = tot_area * pixel_meter_ratio;
@@ -278,17 +279,18 @@ void LLVOPartGroup::getGeometry(S32 idx,
 								LLStrider<LLColor4U>& colorsp, 
 								LLStrider<U16>& indicesp)
 {
-	if (idx >= (S32) mViewerPartGroupp->mParticles.size())
+	const LLViewerPartGroup* part_group = mViewerPartGroupp;
+	if (idx >= part_group->getCount())
 	{
 		return;
 	}
 
-	const LLViewerPart &part = *((LLViewerPart*) (mViewerPartGroupp->mParticles[idx]));
-
 	U32 vert_offset = mDrawable->getFace(idx)->getGeomIndex();
 
 	
-	LLVector3 part_pos_agent(part.mPosAgent);
+	LLVector3 part_pos_agent(part_group->getPartPosition(idx));
+	LLVector2 part_scale(part_group->getPartScale(idx));
+	LLColor4 part_color(part_group->getPartColor(idx));
 	LLVector3 camera_agent = getCameraPosition(); 
 	LLVector3 at = part_pos_agent - camera_agent;
 	LLVector3 up;
@@ -299,9 +301,9 @@ void LLVOPartGroup::getGeometry(S32 idx,
 	up = right % at;
 	up.normalize();
 
-	if (part.mFlags & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK)
+	if (part_group->getPartFlags(idx) & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK)
 	{
-		LLVector3 normvel = part.mVelocity;
+		LLVector3 normvel = part_group->getPartVelocity(idx);
 		normvel.normalize();
 		LLVector2 up_fracs;
 		up_fracs.mV[0] = normvel*right;
@@ -317,8 +319,8 @@ void LLVOPartGroup::getGeometry(S32 idx,
 		right.normalize();
 	}
 
-	right *= 0.5f*part.mScale.mV[0];
-	up *= 0.5f*part.mScale.mV[1];
+	right *= 0.5f*part_scale.mV[0];
+	up *= 0.5f*part_scale.mV[1];
 
 
 	LLVector3 normal = -LLViewerCamera::getInstance()->getXAxis();
@@ -328,10 +330,10 @@ void LLVOPartGroup::getGeometry(S32 idx,
 	*verticesp++ = part_pos_agent + up + right;
 	*verticesp++ = part_pos_agent - up + right;
 
-	*colorsp++ = part.mColor;
-	*colorsp++ = part.mColor;
-	*colorsp++ = part.mColor;
-	*colorsp++ = part.mColor;
+	*colorsp++ = part_color;
+	*colorsp++ = part_color;
+	*colorsp++ = part_color;
+	*colorsp++ = part_color;
 
 	*texcoordsp++ = LLVector2(0.f, 1.f);
 	*texcoordsp++ = LLVector2(0.f, 0.f);
@@ -42,6 +42,8 @@
 #include "lldrawpoolsky.h"
 #include "lldrawpoolwater.h"
 #include "llglheaders.h"
+#include "llappviewer.h"
+#include "lljobpool.h"
 #include "llsky.h"
 #include "llviewercamera.h"
 #include "llviewertexturelist.h"
@@ -316,6 +318,32 @@ F32	LLHeavenBody::sInterpVal = 0;
 S32 LLVOSky::sResolution = LLSkyTex::getResolution();
 S32 LLVOSky::sTileResX = sResolution/NUM_TILES_X;
 S32 LLVOSky::sTileResY = sResolution/NUM_TILES_Y;
+U32 LLVOSky::sTileWorkers = 0;
+
+// every tile of every side of the sky and environment map textures, one
+// index per tile
+class LLSkyTileWork : public LLJobPool::Work
+{
+public:
+	LLSkyTileWork(LLVOSky* sky)
+	:	mSky(sky)
+	{
+	}
+
+	/*virtual*/ void run(U32 index)
+	{
+		mSky->createSkyTexture(index / NUM_TILES, index % NUM_TILES);
+	}
+
+private:
+	LLVOSky*	mSky;
+};
+
+//static
+void LLVOSky::setTileThreads(S32 num_threads)
+{
+	sTileWorkers = LLJobPool::resolveMaxWorkers(num_threads);
+}
 
 LLVOSky::LLVOSky(const LLUUID &id, const LLPCode pcode, LLViewerRegion *regionp)
 :	LLStaticViewerObject(id, pcode, regionp, TRUE),
@@ -1118,11 +1146,20 @@ BOOL LLVOSky::updateSky()
                     if (mForceUpdate)
 					{
 						updateFog(LLViewerCamera::getInstance()->getFar());
-						for (int side = 0; side < 6; side++) 
+
+						// tiles only write their own pixels, so they can
+						// be filled in parallel
+						LLSkyTileWork tiles(this);
+						LLJobPool* pool = LLAppViewer::getJobPool();
+						if (pool)
+						{
+							pool->run(tiles, total_no_tiles, sTileWorkers);
+						}
+						else
 						{
-							for (int tile = 0; tile < NUM_TILES; tile++) 
+							for (S32 i = 0; i < total_no_tiles; ++i)
 							{
-								createSkyTexture(side, tile);
+								tiles.run(i);
 							}
 						}
 
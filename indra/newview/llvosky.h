@@ -546,6 +546,10 @@ public:
 	LLViewerTexture*	getBloomTex() const					{ return mBloomTexturep; }
 	void forceSkyUpdate(void)							{ mForceUpdate = TRUE; }
 
+	// most job pool workers filling the tiles of a full sky rebuild,
+	// negative for all of them
+	static void setTileThreads(S32 num_threads);
+
 public:
 	LLFace	*mFace[FACE_COUNT];
 	LLVector3	mBumpSunDir;
@@ -560,6 +564,7 @@ protected:
 	static S32			sResolution;
 	static S32			sTileResX;
 	static S32			sTileResY;
+	static U32			sTileWorkers;
 	LLSkyTex			mSkyTex[6];
 	LLSkyTex			mShinyTex[6];
 	LLHeavenBody		mSun;
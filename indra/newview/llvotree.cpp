@@ -34,6 +34,8 @@
 #include "lldir.h"
 #include "llprimitive.h"
 #include "lltree_common.h"
+#include "llv4matrix3.h"
+#include "llv4matrix4.h"
 #include "llxmltree.h"
 #include "material_codes.h"
 #include "object_flags.h"
@@ -74,6 +76,10 @@ F32 LLVOTree::sTreeFactor = 1.f;
 LLVOTree::SpeciesMap LLVOTree::sSpeciesTable;
 S32 LLVOTree::sMaxTreeSpecies = 0;
 
+LLVOTree::ReferenceBufferMap LLVOTree::sReferenceBuffers;
+LLVOTree::MeshMap LLVOTree::sMeshes;
+F32 LLVOTree::sRebuildTime = 0.f;
+
 // Tree variables and functions
 
 LLVOTree::LLVOTree(const LLUUID &id, const LLPCode pcode, LLViewerRegion *regionp):
@@ -266,9 +272,34 @@ void LLVOTree::initClass()
 //static
 void LLVOTree::cleanupClass()
 {
+	resetVertexBuffers();
 	std::for_each(sSpeciesTable.begin(), sSpeciesTable.end(), DeletePairedPointer());
 }
 
+//static
+void LLVOTree::resetVertexBuffers()
+{
+	sReferenceBuffers.clear();
+	std::for_each(sMeshes.begin(), sMeshes.end(), DeletePairedPointer());
+	sMeshes.clear();
+}
+
+//static
+U32 LLVOTree::getGeometryCacheBytes()
+{
+	U32 bytes = 0;
+	for (ReferenceBufferMap::const_iterator iter = sReferenceBuffers.begin(); iter != sReferenceBuffers.end(); ++iter)
+	{
+		bytes += iter->second->getSize() + iter->second->getIndicesSize();
+	}
+	for (MeshMap::const_iterator iter = sMeshes.begin(); iter != sMeshes.end(); ++iter)
+	{
+		const TreeMesh* mesh = iter->second;
+		bytes += mesh->mPositions.size() * (2 * sizeof(LLVector3) + sizeof(LLVector2)) + mesh->mIndices.size() * sizeof(U16);
+	}
+	return bytes;
+}
+
 U32 LLVOTree::processUpdateMessage(LLMessageSystem *mesgsys,
 										  void **user_data,
 										  U32 block_num, EObjectUpdateType update_type,
@@ -296,6 +327,7 @@ U32 LLVOTree::processUpdateMessage(LLMessageSystem *mesgsys,
 	// 
 	//  Load Instance-Specific data 
 	//
+	U8 old_species = mSpecies;
 	if (mData)
 	{
 		mSpecies = ((U8 *)mData)[0];
@@ -330,6 +362,12 @@ U32 LLVOTree::processUpdateMessage(LLMessageSystem *mesgsys,
 	mBillboardRatio = sSpeciesTable[mSpecies]->mBillboardRatio;
 	mTrunkAspect = sSpeciesTable[mSpecies]->mTrunkAspect;
 	mBranchAspect = sSpeciesTable[mSpecies]->mBranchAspect;
+
+	if (mSpecies != old_species)
+	{
+		// Pick up the pieces of the new species
+		mReferenceBuffer = NULL;
+	}
 	
 	// position change not caused by us, etc.  make sure to rebuild.
 	gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_ALL);
@@ -529,7 +567,43 @@ BOOL LLVOTree::updateGeometry(LLDrawable *drawable)
 		return TRUE ;
 	}
 
+	LLTimer rebuild_timer;
+
 	if (mReferenceBuffer.isNull() || mDrawable->getFace(0)->mVertexBuffer.isNull())
+	{
+		LLFace *face = drawable->getFace(0);
+
+		face->mCenterAgent = getPositionAgent();
+		face->mCenterLocal = face->mCenterAgent;
+
+		mReferenceBuffer = getReferenceBuffer();
+	}
+
+	if (gSavedSettings.getBOOL("RenderAnimateTrees"))
+	{
+		mDrawable->getFace(0)->mVertexBuffer = mReferenceBuffer;
+	}
+	else
+	{
+		//generate tree mesh
+		updateMesh();
+	}
+
+	sRebuildTime += rebuild_timer.getElapsedTimeF32();
+	
+	return TRUE;
+}
+
+// Branch and leaf pieces the tree meshes are made of, shared by all trees of a species
+LLVertexBuffer* LLVOTree::getReferenceBuffer()
+{
+	ReferenceBufferMap::iterator found = sReferenceBuffers.find(mSpecies);
+	if (found != sReferenceBuffers.end())
+	{
+		return found->second;
+	}
+
+	LLPointer<LLVertexBuffer> buffer;
 	{
 		const F32 SRR3 = 0.577350269f; // sqrt(1/3)
 		const F32 SRR2 = 0.707106781f; // sqrt(1/2)
@@ -541,11 +615,6 @@ BOOL LLVOTree::updateGeometry(LLDrawable *drawable)
 		S32 max_vertices = LEAF_VERTICES;
 		S32 lod;
 
-		LLFace *face = drawable->getFace(0);
-
-		face->mCenterAgent = getPositionAgent();
-		face->mCenterLocal = face->mCenterAgent;
-
 		for (lod = 0; lod < sMAX_NUM_TREE_LOD_LEVELS; lod++)
 		{
 			slices = sLODSlices[lod];
@@ -557,18 +626,18 @@ BOOL LLVOTree::updateGeometry(LLDrawable *drawable)
 			max_vertices += sLODVertexCount[lod];
 		}
 
-		mReferenceBuffer = new LLVertexBuffer(LLDrawPoolTree::VERTEX_DATA_MASK, gSavedSettings.getBOOL("RenderAnimateTrees") ? GL_STATIC_DRAW_ARB : 0);
-		mReferenceBuffer->allocateBuffer(max_vertices, max_indices, TRUE);
+		buffer = new LLVertexBuffer(LLDrawPoolTree::VERTEX_DATA_MASK, gSavedSettings.getBOOL("RenderAnimateTrees") ? GL_STATIC_DRAW_ARB : 0);
+		buffer->allocateBuffer(max_vertices, max_indices, TRUE);
 
 		LLStrider<LLVector3> vertices;
 		LLStrider<LLVector3> normals;
 		LLStrider<LLVector2> tex_coords;
 		LLStrider<U16> indicesp;
 
-		mReferenceBuffer->getVertexStrider(vertices);
-		mReferenceBuffer->getNormalStrider(normals);
-		mReferenceBuffer->getTexCoord0Strider(tex_coords);
-		mReferenceBuffer->getIndexStrider(indicesp);
+		buffer->getVertexStrider(vertices);
+		buffer->getNormalStrider(normals);
+		buffer->getTexCoord0Strider(tex_coords);
+		buffer->getIndexStrider(indicesp);
 				
 		S32 vertex_count = 0;
 		S32 index_count = 0;
@@ -856,22 +925,13 @@ BOOL LLVOTree::updateGeometry(LLDrawable *drawable)
 			slices /= 2; 
 		}
 
-		mReferenceBuffer->setBuffer(0);
+		buffer->setBuffer(0);
 		llassert(vertex_count == max_vertices);
 		llassert(index_count == max_indices);
 	}
 
-	if (gSavedSettings.getBOOL("RenderAnimateTrees"))
-	{
-		mDrawable->getFace(0)->mVertexBuffer = mReferenceBuffer;
-	}
-	else
-	{
-		//generate tree mesh
-		updateMesh();
-	}
-	
-	return TRUE;
+	sReferenceBuffers[mSpecies] = buffer;
+	return buffer;
 }
 
 void LLVOTree::updateMesh()
@@ -910,6 +970,32 @@ void LLVOTree::updateMesh()
 //	const F32 THRESH_ANGLE_FOR_BILLBOARD = 15.f;
 //	const F32 BLEND_RANGE_FOR_BILLBOARD = 3.f;
 
+	LLFace* facep = mDrawable->getFace(0);
+
+	if (mTrunkBend.isExactlyZero())
+	{
+		// Trees at rest all have the same shape, just place the species' mesh
+		const TreeMesh& mesh = getMesh(mTrunkLOD);
+
+		facep->mVertexBuffer = new LLVertexBuffer(LLDrawPoolTree::VERTEX_DATA_MASK, GL_STATIC_DRAW_ARB);
+		facep->mVertexBuffer->allocateBuffer(mesh.mPositions.size(), mesh.mIndices.size(), TRUE);
+
+		LLStrider<LLVector3> vertices;
+		LLStrider<LLVector3> normals;
+		LLStrider<LLVector2> tex_coords;
+		LLStrider<U16> indices;
+
+		facep->mVertexBuffer->getVertexStrider(vertices);
+		facep->mVertexBuffer->getNormalStrider(normals);
+		facep->mVertexBuffer->getTexCoord0Strider(tex_coords);
+		facep->mVertexBuffer->getIndexStrider(indices);
+
+		placeMesh(mesh, scale_mat, rot, vertices, normals, tex_coords, indices);
+
+		facep->mVertexBuffer->setBuffer(0);
+		return;
+	}
+
 	F32 droop = mDroop + 25.f*(1.f - mTrunkBend.magVec());
 	
 	S32 stop_depth = 0;
@@ -920,7 +1006,6 @@ void LLVOTree::updateMesh()
 	
 	calcNumVerts(vert_count, index_count, mTrunkLOD, stop_depth, mDepth, mTrunkDepth, mBranches);
 
-	LLFace* facep = mDrawable->getFace(0);
 	facep->mVertexBuffer = new LLVertexBuffer(LLDrawPoolTree::VERTEX_DATA_MASK, GL_STATIC_DRAW_ARB);
 	facep->mVertexBuffer->allocateBuffer(vert_count, index_count, TRUE);
 	
@@ -942,6 +1027,78 @@ void LLVOTree::updateMesh()
 
 }
 
+// Mesh of an unbent tree of that LOD in tree space, built once per species
+const LLVOTree::TreeMesh& LLVOTree::getMesh(S32 trunk_LOD)
+{
+	const U32 key = ((U32)mSpecies << 8) | (U32)trunk_LOD;
+	MeshMap::iterator found = sMeshes.find(key);
+	if (found != sMeshes.end())
+	{
+		return *found->second;
+	}
+
+	U32 vert_count = 0;
+	U32 index_count = 0;
+	calcNumVerts(vert_count, index_count, trunk_LOD, 0, mDepth, mTrunkDepth, mBranches);
+
+	TreeMesh* mesh = new TreeMesh;
+	mesh->mPositions.resize(vert_count);
+	mesh->mNormals.resize(vert_count);
+	mesh->mTexCoords.resize(vert_count);
+	mesh->mIndices.resize(index_count);
+
+	LLStrider<LLVector3> vertices;
+	LLStrider<LLVector3> normals;
+	LLStrider<LLVector2> tex_coords;
+	LLStrider<U16> indices;
+	vertices = &mesh->mPositions[0];
+	normals = &mesh->mNormals[0];
+	tex_coords = &mesh->mTexCoords[0];
+	indices = &mesh->mIndices[0];
+
+	U16 idx_offset = 0;
+	LLMatrix4 matrix;
+	// Same droop as updateMesh() with no trunk bend
+	genBranchPipeline(vertices, normals, tex_coords, indices, idx_offset, matrix, trunk_LOD, 0, mDepth, mTrunkDepth, 1.0, mTwist, mDroop + 25.f, mBranches, 1.0);
+	mReferenceBuffer->setBuffer(0);
+
+	sMeshes[key] = mesh;
+	return *mesh;
+}
+
+// Transforms a tree space mesh into place, four components at a time where
+// vectorization is available
+//static
+void LLVOTree::placeMesh(const TreeMesh& mesh,
+						 const LLMatrix4& matrix,
+						 const LLQuaternion& rot,
+						 LLStrider<LLVector3>& vertices,
+						 LLStrider<LLVector3>& normals,
+						 LLStrider<LLVector2>& tex_coords,
+						 LLStrider<U16>& indices)
+{
+	LLV4Matrix4 pos_mat;
+	pos_mat = matrix;
+	// Uniform scale, so the inverse transpose genBranchPipeline() uses for
+	// bent trees reduces to the rotation
+	LLV4Matrix3 norm_mat;
+	norm_mat = rot.getMatrix3();
+
+	const S32 vert_count = (S32)mesh.mPositions.size();
+	for (S32 i = 0; i < vert_count; i++)
+	{
+		pos_mat.multiply(mesh.mPositions[i], *vertices++);
+		norm_mat.multiply(mesh.mNormals[i], *normals++);
+		*tex_coords++ = mesh.mTexCoords[i];
+	}
+
+	const S32 index_count = (S32)mesh.mIndices.size();
+	for (S32 i = 0; i < index_count; i++)
+	{
+		*indices++ = mesh.mIndices[i];
+	}
+}
+
 void LLVOTree::appendMesh(LLStrider<LLVector3>& vertices, 
 						 LLStrider<LLVector3>& normals, 
 						 LLStrider<LLVector2>& tex_coords, 
@@ -1035,7 +1192,6 @@ void LLVOTree::genBranchPipeline(LLStrider<LLVector3>& vertices,
 				glh::matrix4f norm((F32*) scale_mat.mMatrix);
 				LLMatrix4 norm_mat = LLMatrix4(norm.inverse().transpose().m);
 
-				norm_mat.invert();
 				appendMesh(vertices, normals, tex_coords, indices, index_offset, scale_mat, norm_mat, 
 							sLODVertexOffset[trunk_LOD], sLODVertexCount[trunk_LOD], sLODIndexCount[trunk_LOD], sLODIndexOffset[trunk_LOD]);
 			}
@@ -55,6 +55,11 @@ public:
 	static void cleanupClass();
 	static bool isTreeRenderingStopped();
 
+	// Drop the geometry shared between trees, it's rebuilt on demand
+	static void resetVertexBuffers();
+	// Memory held by the geometry shared between trees, in bytes
+	static U32 getGeometryCacheBytes();
+
 	/*virtual*/ U32 processUpdateMessage(LLMessageSystem *mesgsys,
 											void **user_data,
 											U32 block_num, const EObjectUpdateType update_type,
@@ -78,6 +83,8 @@ public:
 
 	void updateMesh();
 
+	LLVertexBuffer* getReferenceBuffer();
+
 	void appendMesh(LLStrider<LLVector3>& vertices, 
 						 LLStrider<LLVector3>& normals, 
 						 LLStrider<LLVector2>& tex_coords, 
@@ -149,8 +156,28 @@ public:
 	static F32 sTreeFactor;			// Tree level of detail factor
 	static const S32 sMAX_NUM_TREE_LOD_LEVELS ;
 
+	static F32 sRebuildTime;		// Seconds spent building tree geometry, reset by the stats each frame
+
 	friend class LLDrawPoolTree;
 protected:
+	// Mesh of a tree at rest in tree space, the same for all trees of a species
+	struct TreeMesh
+	{
+		std::vector<LLVector3>	mPositions;
+		std::vector<LLVector3>	mNormals;
+		std::vector<LLVector2>	mTexCoords;
+		std::vector<U16>		mIndices;
+	};
+
+	const TreeMesh& getMesh(S32 trunk_LOD);
+	static void placeMesh(const TreeMesh& mesh,
+						  const LLMatrix4& matrix,
+						  const LLQuaternion& rot,
+						  LLStrider<LLVector3>& vertices,
+						  LLStrider<LLVector3>& normals,
+						  LLStrider<LLVector2>& tex_coords,
+						  LLStrider<U16>& indices);
+
 	LLVector3		mTrunkBend;		// Accumulated wind (used for blowing trees)
 	LLVector3		mTrunkVel;		// 
 	LLVector3		mWind;
@@ -186,6 +213,12 @@ protected:
 	typedef std::map<U32, TreeSpeciesData*> SpeciesMap;
 	static SpeciesMap sSpeciesTable;
 
+	typedef std::map<U8, LLPointer<LLVertexBuffer> > ReferenceBufferMap;
+	static ReferenceBufferMap sReferenceBuffers;	// by species
+
+	typedef std::map<U32, TreeMesh*> MeshMap;
+	static MeshMap sMeshes;		// by species and trunk LOD
+
 	static S32 sLODIndexOffset[4];
 	static S32 sLODIndexCount[4];
 	static S32 sLODVertexOffset[4];
@@ -760,6 +760,11 @@ void LLVOVolume::updateTextureVirtualSize()
 				gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_TCOORD, FALSE);
 			}
 		}
+
+		if (LLViewerTexture::sUseTextureAtlas && face->canUseAtlas() && face->atlasTextureChanged())
+		{ //faces sharing an atlas share a texture, which lets genDrawInfo batch them together
+			face->switchTexture();
+		}
 				
 		if (gPipeline.hasRenderDebugMask(LLPipeline::RENDER_DEBUG_TEXTURE_AREA))
 		{
@@ -1108,6 +1113,7 @@ void LLVOVolume::sculpt()
 	}
 }
 
+//static
 S32	LLVOVolume::computeLODDetail(F32 distance, F32 radius)
 {
 	S32	cur_detail;
@@ -1124,17 +1130,15 @@ S32	LLVOVolume::computeLODDetail(F32 distance, F32 radius)
 	return cur_detail;
 }
 
-BOOL LLVOVolume::calcLOD()
+F32 LLVOVolume::getLODRadius() const
 {
-	if (mDrawable.isNull())
-	{
-		return FALSE;
-	}
+	return getVolume()->mLODScaleBias.scaledVec(getScale()).length();
+}
 
-	S32 cur_detail = 0;
-	
-	F32 radius = getVolume()->mLODScaleBias.scaledVec(getScale()).length();
-	F32 distance = mDrawable->mDistanceWRTCamera; //llmin(mDrawable->mDistanceWRTCamera, MAX_LOD_DISTANCE);
+//static
+S32 LLVOVolume::calcLODDetail(F32 distance, F32 radius)
+{
+	//llmin(mDrawable->mDistanceWRTCamera, MAX_LOD_DISTANCE);
 	distance *= sDistanceFactor;
 			
 	F32 rampDist = LLVOVolume::sLODFactor * 2;
@@ -1150,32 +1154,24 @@ BOOL LLVOVolume::calcLOD()
 	// DON'T Compensate for field of view changing on FOV zoom.
 	distance *= F_PI/3.f;
 
-	cur_detail = computeLODDetail(llround(distance, 0.01f), 
-									llround(radius, 0.01f));
-
-	if (cur_detail != mLOD)
-	{
-		mAppAngle = llround((F32) atan2( mDrawable->getRadius(), mDrawable->mDistanceWRTCamera) * RAD_TO_DEG, 0.01f);
-		mLOD = cur_detail;		
-		return TRUE;
-	}
-	else
-	{
-		return FALSE;
-	}
+	return computeLODDetail(llround(distance, 0.01f), radius);
 }
 
-BOOL LLVOVolume::updateLOD()
+BOOL LLVOVolume::applyLODDetail(S32 detail)
 {
 	if (mDrawable.isNull())
 	{
 		return FALSE;
 	}
-	
-	BOOL lod_changed = calcLOD();
 
-	if (lod_changed)
+	BOOL lod_changed = FALSE;
+
+	if (detail != mLOD)
 	{
+		mAppAngle = llround((F32) atan2( mDrawable->getRadius(), mDrawable->mDistanceWRTCamera) * RAD_TO_DEG, 0.01f);
+		mLOD = detail;
+		lod_changed = TRUE;
+
 		gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_VOLUME, FALSE);
 		mLODChanged = TRUE;
 	}
@@ -1185,6 +1181,16 @@ BOOL LLVOVolume::updateLOD()
 	return lod_changed;
 }
 
+BOOL LLVOVolume::updateLOD()
+{
+	if (mDrawable.isNull())
+	{
+		return FALSE;
+	}
+	
+	return applyLODDetail(calcLODDetail(mDrawable->mDistanceWRTCamera, llround(getLODRadius(), 0.01f)));
+}
+
 BOOL LLVOVolume::setDrawableParent(LLDrawable* parentp)
 {
 	if (!LLViewerObject::setDrawableParent(parentp))
@@ -3241,6 +3247,13 @@ LLVolumeBridge::LLVolumeBridge(LLDrawable* drawablep)
 	mSlopRatio = 0.25f;
 }
 
+void LLVolumePartition::resetVertexBuffers()
+{
+	LLSpatialPartition::resetVertexBuffers();
+	//groups hold references to ranges, not buffers, so the pool can drop its buffers outright
+	mBatchPool.cleanup();
+}
+
 void LLVolumeGeometryManager::registerFace(LLSpatialGroup* group, LLFace* facep, U32 type)
 {
 	LLMemType mt(LLMemType::MTYPE_SPACE_PARTITION);
@@ -3388,6 +3401,12 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 	LLFastTimer ftm2(FTM_REBUILD_VOLUME_VB);
 
 	group->clearDrawMap();
+	LLGeomBatchPool::release(group->mBatchRanges);
+
+	if (getBatchPool())
+	{
+		getBatchPool()->prune();
+	}
 
 	mFaceList.clear();
 
@@ -3635,8 +3654,12 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 					LLFace* face = drawablep->getFace(i);
 					if (face && face->mVertexBuffer.notNull())
 					{
-						face->getGeometryVolume(*volume, face->getTEOffset(), 
-							vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), face->getGeomIndex());
+						if (face->getGeometryVolume(*volume, face->getTEOffset(), 
+							vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), face->getGeomIndex()))
+						{
+							face->mVertexBuffer->markDirty(face->getGeomIndex(), face->getGeomCount(), 
+								face->getIndicesStart(), face->getIndicesCount());
+						}
 					}
 				}
 
@@ -3662,6 +3685,15 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 			}
 		}
 		
+		for (LLGeomBatchPool::range_list_t::iterator i = group->mBatchRanges.begin(); i != group->mBatchRanges.end(); ++i)
+		{
+			LLVertexBuffer* buffer = i->mBuffer->getVertexBuffer();
+			if (buffer->isLocked())
+			{
+				buffer->setBuffer(0);
+			}
+		}
+		
 		// don't forget alpha
 		if(group != NULL && 
 		   !group->mVertexBuffer.isNull() && 
@@ -3703,6 +3735,17 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 	U32 max_vertices = (gSavedSettings.getS32("RenderMaxVBOSize")*1024)/LLVertexBuffer::calcStride(group->mSpatialPartition->mVertexDataMask);
 	max_vertices = llmin(max_vertices, (U32) 65535);
 
+	static LLCachedControl<U32> batch_max_verts(gSavedSettings, "RenderBatchMaxVerts");
+	LLGeomBatchPool* batch_pool = getBatchPool();
+	if (distance_sort || group->mBufferUsage == GL_STREAM_DRAW_ARB || !LLVertexBuffer::sEnableVBOs)
+	{ //sorted and streamed geometry must stay in the group's own buffers
+		batch_pool = NULL;
+	}
+	else if (!LLRenderPass::sBatchDrawInfos)
+	{ //batching turned off, the pool was emptied by resetVertexBuffers
+		batch_pool = NULL;
+	}
+
 	if (!distance_sort)
 	{
 		//sort faces by things that break batches
@@ -3771,43 +3814,55 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 	
 		//create/delete/resize vertex buffer if needed
 		LLVertexBuffer* buffer = NULL;
-		LLSpatialGroup::buffer_texture_map_t::iterator found_iter = group->mBufferMap[mask].find(tex);
-		
-		if (found_iter != group->mBufferMap[mask].end())
+		U32 indices_index = 0;
+		U16 index_offset = 0;
+
+		LLGeomBatchPool::Range range;
+		if (batch_pool && geom_count <= (U32) batch_max_verts &&
+			batch_pool->allocate(mask, tex, geom_count, index_count, range))
+		{ //small run, pack it into a buffer shared with other groups using this texture
+			group->mBatchRanges.push_back(range);
+			buffer = range.mBuffer->getVertexBuffer();
+			index_offset = (U16) range.mVertStart;
+			indices_index = range.mIndexStart;
+		}
+		else
 		{
-			if ((U32) buffer_index < found_iter->second.size())
+			LLSpatialGroup::buffer_texture_map_t::iterator found_iter = group->mBufferMap[mask].find(tex);
+		
+			if (found_iter != group->mBufferMap[mask].end())
 			{
-				buffer = found_iter->second[buffer_index];
+				if ((U32) buffer_index < found_iter->second.size())
+				{
+					buffer = found_iter->second[buffer_index];
+				}
 			}
-		}
 						
-		if (!buffer)
-		{ //create new buffer if needed
-			buffer = createVertexBuffer(mask, 
-											group->mBufferUsage);
-			buffer->allocateBuffer(geom_count, index_count, TRUE);
-		}
-		else 
-		{
-			if (LLVertexBuffer::sEnableVBOs && buffer->getUsage() != group->mBufferUsage)
-			{
-				buffer = createVertexBuffer(group->mSpatialPartition->mVertexDataMask, 
-											group->mBufferUsage);
+			if (!buffer)
+			{ //create new buffer if needed
+				buffer = createVertexBuffer(mask, 
+												group->mBufferUsage);
 				buffer->allocateBuffer(geom_count, index_count, TRUE);
 			}
-			else
+			else 
 			{
-				buffer->resizeBuffer(geom_count, index_count);
+				if (LLVertexBuffer::sEnableVBOs && buffer->getUsage() != group->mBufferUsage)
+				{
+					buffer = createVertexBuffer(group->mSpatialPartition->mVertexDataMask, 
+												group->mBufferUsage);
+					buffer->allocateBuffer(geom_count, index_count, TRUE);
+				}
+				else
+				{
+					buffer->resizeBuffer(geom_count, index_count);
+				}
 			}
-		}
 
-		buffer_map[mask][tex].push_back(buffer);
+			buffer_map[mask][tex].push_back(buffer);
+		}
 
 		//add face geometry
 
-		U32 indices_index = 0;
-		U16 index_offset = 0;
-
 		while (face_iter < i)
 		{
 			facep = *face_iter;
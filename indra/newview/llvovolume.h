@@ -183,6 +183,9 @@ public:
 	/*virtual*/ BOOL	updateGeometry(LLDrawable *drawable);
 	/*virtual*/ void	updateFaceSize(S32 idx);
 	/*virtual*/ BOOL	updateLOD();
+				F32		getLODRadius() const;
+	static		S32		calcLODDetail(F32 distance, F32 radius); // distance from camera, rounded LOD radius
+				BOOL	applyLODDetail(S32 detail);
 				void	updateRadius();
 	/*virtual*/ void	updateTextures();
 				void	updateTextureVirtualSize();
@@ -275,8 +278,7 @@ public:
 	S32 getMDCImplCount() { return mMDCImplCount; }
 	
 protected:
-	S32	computeLODDetail(F32	distance, F32 radius);
-	BOOL calcLOD();
+	static S32 computeLODDetail(F32	distance, F32 radius);
 	LLFace* addFace(S32 face_index);
 	void updateTEData();
 
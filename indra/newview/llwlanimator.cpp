@@ -32,7 +32,8 @@
 #include "llwlparammanager.h"
 
 LLWLAnimator::LLWLAnimator() : mStartTime(0), mDayRate(1), mDayTime(0),
-	mIsRunning(FALSE), mUseLindenTime(false)
+	mIsRunning(FALSE), mUseLindenTime(false),
+	mFirstParams(NULL), mSecondParams(NULL), mSegmentValid(false)
 {
 	mDayTime = 0;
 }
@@ -47,22 +48,29 @@ void LLWLAnimator::update(LLWLParamSet& curParams)
 		return;
 	}
 
-	// start it off
-	mFirstIt = mTimeTrack.begin();
-	mSecondIt = mTimeTrack.begin();
-	mSecondIt++;
+	if(!mSegmentValid || !isInSegment(curTime)) {
 
-	// grab the two tween iterators
-	while(mSecondIt != mTimeTrack.end() && curTime > mSecondIt->first) {
-		mFirstIt++;
+		// start it off
+		mFirstIt = mTimeTrack.begin();
+		mSecondIt = mTimeTrack.begin();
 		mSecondIt++;
-	}
 
-	// scroll it around when you get to the end
-	if(mSecondIt == mTimeTrack.end() || mFirstIt->first > curTime) {
-		mSecondIt = mTimeTrack.begin();
-		mFirstIt = mTimeTrack.end();
-		mFirstIt--;
+		// grab the two tween iterators
+		while(mSecondIt != mTimeTrack.end() && curTime > mSecondIt->first) {
+			mFirstIt++;
+			mSecondIt++;
+		}
+
+		// scroll it around when you get to the end
+		if(mSecondIt == mTimeTrack.end() || mFirstIt->first > curTime) {
+			mSecondIt = mTimeTrack.begin();
+			mFirstIt = mTimeTrack.end();
+			mFirstIt--;
+		}
+
+		mFirstParams = &LLWLParamManager::instance()->mParamList[mFirstIt->second];
+		mSecondParams = &LLWLParamManager::instance()->mParamList[mSecondIt->second];
+		mSegmentValid = true;
 	}
 
 	F32 weight = 0;
@@ -94,8 +102,17 @@ void LLWLAnimator::update(LLWLParamSet& curParams)
 	}
 
 	// do the interpolation and set the parameters
-	curParams.mix(LLWLParamManager::instance()->mParamList[mFirstIt->second], 
-		LLWLParamManager::instance()->mParamList[mSecondIt->second], weight);
+	curParams.mix(*mFirstParams, *mSecondParams, weight);
+}
+
+bool LLWLAnimator::isInSegment(F64 curTime) const
+{
+	if(mFirstIt->first < mSecondIt->first) {
+		return curTime >= mFirstIt->first && curTime <= mSecondIt->first;
+	}
+
+	// wrapped around the end of the time line, or a single key frame
+	return curTime >= mFirstIt->first || curTime <= mSecondIt->first;
 }
 
 F64 LLWLAnimator::getDayTime()
@@ -156,6 +173,7 @@ void LLWLAnimator::setTrack(std::map<F32, std::string>& curTrack,
 							F32 dayRate, F64 dayTime, bool run)
 {
 	mTimeTrack = curTrack;
+	mSegmentValid = false;
 	mDayRate = dayRate;
 	setDayTime(dayTime);
 
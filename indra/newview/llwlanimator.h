@@ -66,6 +66,18 @@ public:
 	void setTrack(std::map<F32, std::string>& track,
 		F32 dayRate, F64 dayTime = 0, bool run = true);
 
+	// forget the cached key frames, when a param set is removed
+	void invalidateSegment() { mSegmentValid = false; }
+
+private:
+	// whether the day time still falls between mFirstIt and mSecondIt
+	bool isInSegment(F64 curTime) const;
+
+	// key frame params of the current segment, only looked up again
+	// when the day time leaves it
+	LLWLParamSet* mFirstParams;
+	LLWLParamSet* mSecondParams;
+	bool mSegmentValid;
 };
 
 #endif // LL_WL_ANIMATOR_H
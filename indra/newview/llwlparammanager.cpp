@@ -498,6 +498,7 @@ bool LLWLParamManager::removeParamSet(const std::string& name, bool delete_from_
 	if(mIt != mParamList.end()) 
 	{
 		mParamList.erase(mIt);
+		mAnimator.invalidateSegment();
 	}
 
 	F32 key;
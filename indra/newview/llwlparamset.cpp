@@ -40,7 +40,10 @@
 
 LLWLParamSet::LLWLParamSet(void) :
 	mName("Unnamed Preset"),
-	mCloudScrollXOffset(0.f), mCloudScrollYOffset(0.f)	
+	mCloudScrollXOffset(0.f), mCloudScrollYOffset(0.f),
+	mCloudPosSlot(-1),
+	mSlotsDirty(true),
+	mValuesDirty(false)
 {
 /* REMOVE or init the LLSD
 	const std::map<std::string, LLVector4>::value_type hardcodedPreset[] = {
@@ -69,158 +72,258 @@ LLWLParamSet::LLWLParamSet(void) :
 */
 }
 
-void LLWLParamSet::update(LLGLSLShader * shader) const 
-{	
+// parameters that are not shader uniforms
+static bool is_uniform_param(const std::string& param)
+{
+	return !(param == "star_brightness" || param == "preset_num" || param == "sun_angle" ||
+			 param == "east_angle" || param == "enable_cloud_scroll" ||
+			 param == "cloud_scroll_rate" || param == "lightnorm");
+}
+
+void LLWLParamSet::compileSlots() const
+{
+	if(!mSlotsDirty)
+	{
+		return;
+	}
+
+	mSlots.clear();
+	mSlotIndex.clear();
+	mCloudPosSlot = -1;
+
 	for(LLSD::map_const_iterator i = mParamValues.beginMap();
 		i != mParamValues.endMap();
 		++i)
 	{
-		const std::string& param = i->first;
-		
-		if(	param == "star_brightness" || param == "preset_num" || param == "sun_angle" ||
-			param == "east_angle" || param == "enable_cloud_scroll" ||
-			param == "cloud_scroll_rate" || param == "lightnorm" ) 
+		ParamSlot slot;
+		slot.mName = i->first;
+		slot.mSize = 0;
+		slot.mReal = false;
+		slot.mUniform = is_uniform_param(i->first);
+		slot.mDirty = false;
+
+		if(i->second.isArray())
+		{
+			slot.mSize = i->second.size();
+			slot.mReal = slot.mSize > 0 && slot.mSize <= 4 && i->second[0].isReal();
+			slot.mValue.setVec(0.f, 0.f, 0.f, 0.f);
+			for(S32 c = 0; c < llmin(slot.mSize, 4); ++c)
+			{
+				slot.mValue.mV[c] = (F32) i->second[c].asReal();
+			}
+		}
+		else if(i->second.isReal() || i->second.isInteger() || i->second.isBoolean())
+		{
+			slot.mReal = i->second.isReal();
+			slot.mValue.mV[0] = (F32) i->second.asReal();
+		}
+
+		if(slot.mName == "cloud_pos_density1")
+		{
+			mCloudPosSlot = mSlots.size();
+		}
+
+		mSlotIndex[slot.mName] = mSlots.size();
+		mSlots.push_back(slot);
+	}
+
+	mSlotsDirty = false;
+}
+
+void LLWLParamSet::syncValues()
+{
+	if(!mValuesDirty)
+	{
+		return;
+	}
+
+	for(slot_list_t::iterator iter = mSlots.begin(); iter != mSlots.end(); ++iter)
+	{
+		if(!iter->mDirty)
 		{
 			continue;
 		}
-		
-		if(param == "cloud_pos_density1") 
+
+		if(iter->mSize == 0)
 		{
-			LLVector4 val;
-			val.mV[0] = F32(i->second[0].asReal()) + mCloudScrollXOffset;
-			val.mV[1] = F32(i->second[1].asReal()) + mCloudScrollYOffset;
-			val.mV[2] = (F32) i->second[2].asReal();
-			val.mV[3] = (F32) i->second[3].asReal();
-			
-			shader->uniform4fv(param, 1, val.mV);	
-		} 
-		else 
+			mParamValues[iter->mName] = iter->mValue.mV[0];
+		}
+		else
 		{
-			LLVector4 val;
-			
-			// handle all the different cases
-			if(i->second.isArray() && i->second.size() == 4) 
-			{
-				val.mV[0] = (F32) i->second[0].asReal();
-				val.mV[1] = (F32) i->second[1].asReal();
-				val.mV[2] = (F32) i->second[2].asReal();
-				val.mV[3] = (F32) i->second[3].asReal();															
-			} 
-			else if(i->second.isReal()) 
-			{
-				val.mV[0] = (F32) i->second.asReal();
-			} 
-			else if(i->second.isInteger()) 
-			{
-				val.mV[0] = (F32) i->second.asReal();
-			} 
-			else if(i->second.isBoolean())
+			LLSD& entry = mParamValues[iter->mName];
+			for(S32 c = 0; c < llmin(iter->mSize, 4); ++c)
 			{
-				val.mV[0] = i->second.asBoolean();
+				entry[c] = iter->mValue.mV[c];
 			}
-			
-			
-			shader->uniform4fv(param, 1, val.mV);
 		}
+		iter->mDirty = false;
 	}
+
+	mValuesDirty = false;
 }
 
-void LLWLParamSet::set(const std::string& paramName, float x) 
+LLWLParamSet::ParamSlot* LLWLParamSet::findSlot(const std::string& paramName)
+{
+	compileSlots();
+
+	std::map<std::string, S32>::const_iterator found = mSlotIndex.find(paramName);
+	return found != mSlotIndex.end() ? &mSlots[found->second] : NULL;
+}
+
+const LLWLParamSet::ParamSlot* LLWLParamSet::findSlot(const std::string& paramName, U32 hint) const
+{
+	// sets loaded from the same presets share their layout
+	if(hint < mSlots.size() && mSlots[hint].mName == paramName)
+	{
+		return &mSlots[hint];
+	}
+
+	std::map<std::string, S32>::const_iterator found = mSlotIndex.find(paramName);
+	return found != mSlotIndex.end() ? &mSlots[found->second] : NULL;
+}
+
+void LLWLParamSet::setComponents(const std::string& paramName, const F32* val, S32 count)
+{
+	ParamSlot* slot = findSlot(paramName);
+	if(slot && slot->mReal && slot->mSize >= count)
+	{
+		for(S32 c = 0; c < count; ++c)
+		{
+			slot->mValue.mV[c] = val[c];
+		}
+		slot->mDirty = true;
+		mValuesDirty = true;
+		return;
+	}
+
+	// new or differently shaped parameter, go through the LLSD
+	syncValues();
+	LLSD& entry = mParamValues[paramName];
+	for(S32 c = 0; c < count; ++c)
+	{
+		entry[c] = val[c];
+	}
+	mSlotsDirty = true;
+}
+
+void LLWLParamSet::setScalar(const std::string& paramName, F32 val)
+{
+	ParamSlot* slot = findSlot(paramName);
+	if(slot && slot->mSize == 0)
+	{
+		slot->mValue.mV[0] = val;
+		slot->mDirty = true;
+		mValuesDirty = true;
+		return;
+	}
+
+	syncValues();
+	mParamValues[paramName] = val;
+	mSlotsDirty = true;
+}
+
+F32 LLWLParamSet::getComponent(const std::string& paramName, S32 index)
+{
+	ParamSlot* slot = findSlot(paramName);
+	return slot && index < 4 ? slot->mValue.mV[index] : 0.f;
+}
+
+void LLWLParamSet::update(LLGLSLShader * shader) const 
 {	
-	// handle case where no array
-	if(mParamValues[paramName].isReal()) 
+	compileSlots();
+
+	for(U32 i = 0; i < mSlots.size(); ++i)
 	{
-		mParamValues[paramName] = x;
-	} 
-	
-	// handle array
-	else if(mParamValues[paramName].isArray() &&
-			mParamValues[paramName][0].isReal())
+		const ParamSlot& slot = mSlots[i];
+		if(!slot.mUniform)
+		{
+			continue;
+		}
+		
+		LLVector4 val;
+		if((S32) i == mCloudPosSlot) 
+		{
+			val = slot.mValue;
+			val.mV[0] += mCloudScrollXOffset;
+			val.mV[1] += mCloudScrollYOffset;
+		} 
+		else if(slot.mSize == 0 || slot.mSize == 4)
+		{
+			val = slot.mValue;
+		}
+
+		shader->uniform4fv(slot.mName, 1, val.mV);
+	}
+}
+
+void LLWLParamSet::set(const std::string& paramName, float x) 
+{	
+	// plain reals and arrays of reals only
+	ParamSlot* slot = findSlot(paramName);
+	if(slot && slot->mReal)
 	{
-		mParamValues[paramName][0] = x;
+		slot->mValue.mV[0] = x;
+		slot->mDirty = true;
+		mValuesDirty = true;
 	}
 }
 
 void LLWLParamSet::set(const std::string& paramName, float x, float y) {
-	mParamValues[paramName][0] = x;
-	mParamValues[paramName][1] = y;
+	F32 val[2] = { x, y };
+	setComponents(paramName, val, 2);
 }
 
 void LLWLParamSet::set(const std::string& paramName, float x, float y, float z) 
 {
-	mParamValues[paramName][0] = x;
-	mParamValues[paramName][1] = y;
-	mParamValues[paramName][2] = z;
+	F32 val[3] = { x, y, z };
+	setComponents(paramName, val, 3);
 }
 
 void LLWLParamSet::set(const std::string& paramName, float x, float y, float z, float w) 
 {
-	mParamValues[paramName][0] = x;
-	mParamValues[paramName][1] = y;
-	mParamValues[paramName][2] = z;
-	mParamValues[paramName][3] = w;
+	F32 val[4] = { x, y, z, w };
+	setComponents(paramName, val, 4);
 }
 
 void LLWLParamSet::set(const std::string& paramName, const float * val) 
 {
-	mParamValues[paramName][0] = val[0];
-	mParamValues[paramName][1] = val[1];
-	mParamValues[paramName][2] = val[2];
-	mParamValues[paramName][3] = val[3];
+	setComponents(paramName, val, 4);
 }
 
 void LLWLParamSet::set(const std::string& paramName, const LLVector4 & val) 
 {
-	mParamValues[paramName][0] = val.mV[0];
-	mParamValues[paramName][1] = val.mV[1];
-	mParamValues[paramName][2] = val.mV[2];
-	mParamValues[paramName][3] = val.mV[3];
+	setComponents(paramName, val.mV, 4);
 }
 
 void LLWLParamSet::set(const std::string& paramName, const LLColor4 & val) 
 {
-	mParamValues[paramName][0] = val.mV[0];
-	mParamValues[paramName][1] = val.mV[1];
-	mParamValues[paramName][2] = val.mV[2];
-	mParamValues[paramName][3] = val.mV[3];
+	setComponents(paramName, val.mV, 4);
 }
 
 LLVector4 LLWLParamSet::getVector(const std::string& paramName, bool& error) 
 {
 	
 	// test to see if right type
-	LLSD cur_val = mParamValues.get(paramName);
-	if (!cur_val.isArray()) 
+	const ParamSlot* slot = findSlot(paramName);
+	if (!slot || slot->mSize == 0) 
 	{
 		error = true;
 		return LLVector4(0,0,0,0);
 	}
 	
-	LLVector4 val;
-	val.mV[0] = (F32) cur_val[0].asReal();
-	val.mV[1] = (F32) cur_val[1].asReal();
-	val.mV[2] = (F32) cur_val[2].asReal();
-	val.mV[3] = (F32) cur_val[3].asReal();
-	
 	error = false;
-	return val;
+	return slot->mValue;
 }
 
 F32 LLWLParamSet::getFloat(const std::string& paramName, bool& error) 
 {
 	
 	// test to see if right type
-	LLSD cur_val = mParamValues.get(paramName);
-	if (cur_val.isArray() && cur_val.size() != 0) 
-	{
-		error = false;
-		return (F32) cur_val[0].asReal();	
-	}
-	
-	if(cur_val.isReal())
+	const ParamSlot* slot = findSlot(paramName);
+	if (slot && (slot->mSize != 0 || slot->mReal)) 
 	{
 		error = false;
-		return (F32) cur_val.asReal();
+		return slot->mValue.mV[0];	
 	}
 	
 	error = true;
@@ -239,7 +342,7 @@ void LLWLParamSet::setSunAngle(float val)
 		val = F_TWO_PI * num;
 	}
 
-	mParamValues["sun_angle"] = val;
+	setScalar("sun_angle", val);
 }
 
 
@@ -253,75 +356,56 @@ void LLWLParamSet::setEastAngle(float val)
 		val = F_TWO_PI * num;
 	}
 
-	mParamValues["east_angle"] = val;
+	setScalar("east_angle", val);
 }
 
 
 void LLWLParamSet::mix(LLWLParamSet& src, LLWLParamSet& dest, F32 weight)
 {
-	// set up the iterators
-	LLSD::map_iterator cIt = mParamValues.beginMap();
+	compileSlots();
+	src.compileSlots();
+	dest.compileSlots();
 
 	// keep cloud positions and coverage the same
 	/// TODO masking will do this later
-	F32 cloudPos1X = (F32) mParamValues["cloud_pos_density1"][0].asReal();
-	F32 cloudPos1Y = (F32) mParamValues["cloud_pos_density1"][1].asReal();
-	F32 cloudPos2X = (F32) mParamValues["cloud_pos_density2"][0].asReal();
-	F32 cloudPos2Y = (F32) mParamValues["cloud_pos_density2"][1].asReal();
-	F32 cloudCover = (F32) mParamValues["cloud_shadow"][0].asReal();
-
-	LLSD srcVal;
-	LLSD destVal;
+	F32 cloudPos1[2] = { getComponent("cloud_pos_density1", 0), getComponent("cloud_pos_density1", 1) };
+	F32 cloudPos2[2] = { getComponent("cloud_pos_density2", 0), getComponent("cloud_pos_density2", 1) };
+	F32 cloudCover = getComponent("cloud_shadow", 0);
 
 	// do the interpolation for all the ones saved as vectors
 	// skip the weird ones
-	for(; cIt != mParamValues.endMap(); cIt++) {
+	for(U32 i = 0; i < mSlots.size(); ++i)
+	{
+		ParamSlot& slot = mSlots[i];
 
-		// check params to make sure they're actually there
-		if(src.mParamValues.has(cIt->first))
-		{
-			srcVal = src.mParamValues[cIt->first];
-		}
-		else
-		{
-			continue;
-		}
-		
-		if(dest.mParamValues.has(cIt->first))
-		{
-			destVal = dest.mParamValues[cIt->first];
-		}
-		else
-		{
-			continue;
-		}		
-				
-		// skip if not a vector
-		if(!cIt->second.isArray()) 
+		// only Real vectors allowed
+		if(slot.mSize == 0 || !slot.mReal) 
 		{
 			continue;
 		}
 
-		// only Real vectors allowed
-		if(!cIt->second[0].isReal()) 
+		// check params to make sure they're actually there
+		const ParamSlot* srcSlot = src.findSlot(slot.mName, i);
+		const ParamSlot* destSlot = dest.findSlot(slot.mName, i);
+		if(!srcSlot || !destSlot)
 		{
 			continue;
 		}
 		
 		// make sure all the same size
-		if(	cIt->second.size() != srcVal.size() ||
-			cIt->second.size() != destVal.size())
+		if(	slot.mSize != srcSlot->mSize ||
+			slot.mSize != destSlot->mSize)
 		{
 			continue;
 		}
 		
-		// more error checking might be necessary;
-		
-		for(int i=0; i < cIt->second.size(); ++i) 
+		for(S32 c = 0; c < slot.mSize; ++c) 
 		{
-			cIt->second[i] = (1.0f - weight) * (F32) srcVal[i].asReal() + 
-				weight * (F32) destVal[i].asReal();
+			slot.mValue.mV[c] = (1.0f - weight) * srcSlot->mValue.mV[c] + 
+				weight * destSlot->mValue.mV[c];
 		}
+		slot.mDirty = true;
+		mValuesDirty = true;
 	}
 
 	// now mix the extra parameters
@@ -374,11 +458,9 @@ void LLWLParamSet::mix(LLWLParamSet& src, LLWLParamSet& dest, F32 weight)
 	// now setup the sun properly
 
 	// reset those cloud positions
-	mParamValues["cloud_pos_density1"][0] = cloudPos1X;
-	mParamValues["cloud_pos_density1"][1] = cloudPos1Y;
-	mParamValues["cloud_pos_density2"][0] = cloudPos2X;
-	mParamValues["cloud_pos_density2"][1] = cloudPos2Y;
-	mParamValues["cloud_shadow"][0] = cloudCover;
+	setComponents("cloud_pos_density1", cloudPos1, 2);
+	setComponents("cloud_pos_density2", cloudPos2, 2);
+	setComponents("cloud_shadow", &cloudCover, 1);
 }
 
 void LLWLParamSet::updateCloudScrolling(void) 
@@ -29,6 +29,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 #include "v4math.h"
 #include "v4color.h"
@@ -51,6 +52,48 @@ private:
 	
 	float mCloudScrollXOffset, mCloudScrollYOffset;
 
+	/// Typed copy of one entry of mParamValues, so the per-frame paths
+	/// (shader upload, day cycle mixing, sky colours) avoid LLSD lookups.
+	struct ParamSlot
+	{
+		std::string	mName;
+		LLVector4	mValue;
+		S32			mSize;		// array length, 0 for a plain value
+		bool		mReal;		// plain real, or array of reals
+		bool		mUniform;	// uploaded by update()
+		bool		mDirty;		// newer than mParamValues
+	};
+	typedef std::vector<ParamSlot> slot_list_t;
+
+	mutable slot_list_t mSlots;
+	mutable std::map<std::string, S32> mSlotIndex;
+	mutable S32 mCloudPosSlot;
+
+	// mParamValues changed since the slots were built
+	mutable bool mSlotsDirty;
+
+	// some slots hold values not written back to mParamValues yet
+	bool mValuesDirty;
+
+	/// Rebuild the slots from mParamValues if it changed.
+	void compileSlots() const;
+
+	/// Write the slots changed since the last sync back to mParamValues.
+	void syncValues();
+
+	ParamSlot* findSlot(const std::string& paramName);
+	const ParamSlot* findSlot(const std::string& paramName, U32 hint) const;
+
+	/// Set the first count components of a parameter, through its slot
+	/// when it has room for them.
+	void setComponents(const std::string& paramName, const F32* val, S32 count);
+
+	/// Set a plain real parameter.
+	void setScalar(const std::string& paramName, F32 val);
+
+	/// Get one component of a parameter, 0 if it is not there.
+	F32 getComponent(const std::string& paramName, S32 index);
+
 public:
 
 	LLWLParamSet();
@@ -177,62 +220,73 @@ inline void LLWLParamSet::setAll(const LLSD& val)
 {
 	if(val.isMap()) {
 		mParamValues = val;
+		mSlotsDirty = true;
+		mValuesDirty = false;
 	}
 }
 
 inline const LLSD& LLWLParamSet::getAll()
 {
+	syncValues();
 	return mParamValues;
 }
 
 inline void LLWLParamSet::setStarBrightness(float val) {
-	mParamValues["star_brightness"] = val;
+	setScalar("star_brightness", val);
 }
 
 inline F32 LLWLParamSet::getStarBrightness() {
-	return (F32) mParamValues["star_brightness"].asReal();
+	return getComponent("star_brightness", 0);
 }
 
 inline F32 LLWLParamSet::getSunAngle() {
-	return (F32) mParamValues["sun_angle"].asReal();
+	return getComponent("sun_angle", 0);
 }
 
 inline F32 LLWLParamSet::getEastAngle() {
-	return (F32) mParamValues["east_angle"].asReal();
+	return getComponent("east_angle", 0);
 }
 
 
 inline void LLWLParamSet::setEnableCloudScrollX(bool val) {
+	syncValues();
 	mParamValues["enable_cloud_scroll"][0] = val;
+	mSlotsDirty = true;
 }
 
 inline bool LLWLParamSet::getEnableCloudScrollX() {
-	return mParamValues["enable_cloud_scroll"][0].asBoolean();
+	return getComponent("enable_cloud_scroll", 0) != 0.f;
 }
 
 inline void LLWLParamSet::setEnableCloudScrollY(bool val) {
+	syncValues();
 	mParamValues["enable_cloud_scroll"][1] = val;
+	mSlotsDirty = true;
 }
 
 inline bool LLWLParamSet::getEnableCloudScrollY() {
-	return mParamValues["enable_cloud_scroll"][1].asBoolean();
+	return getComponent("enable_cloud_scroll", 1) != 0.f;
 }
 
 
 inline void LLWLParamSet::setCloudScrollX(F32 val) {
+	syncValues();
 	mParamValues["cloud_scroll_rate"][0] = val;
+	mSlotsDirty = true;
 }
 
 inline F32 LLWLParamSet::getCloudScrollX() {
-	return (F32) mParamValues["cloud_scroll_rate"][0].asReal();
+	return getComponent("cloud_scroll_rate", 0);
 }
 
 inline void LLWLParamSet::setCloudScrollY(F32 val) {
+	syncValues();
 	mParamValues["cloud_scroll_rate"][1] = val;
+	mSlotsDirty = true;
 }
 
 inline F32 LLWLParamSet::getCloudScrollY() {
-	return (F32) mParamValues["cloud_scroll_rate"][1].asReal();
+	return getComponent("cloud_scroll_rate", 1);
 }
 
 
@@ -38,6 +38,7 @@
 #include "llglheaders.h"
 #include "llhttpnode.h"
 #include "llregionhandle.h"
+#include "llregionprewarm.h"
 #include "llsurface.h"
 #include "lltrans.h"
 #include "llviewercamera.h"
@@ -644,12 +645,23 @@ void LLWorld::updateRegions(F32 max_update_time)
 	LLMemType mt_ur(LLMemType::MTYPE_IDLE_UPDATE_REGIONS);
 	LLTimer update_timer;
 	BOOL did_one = FALSE;
+
+	// The region we're heading to gets its terrain built first
+	LLViewerRegion* target_regionp = LLRegionPrewarm::getInstance()->getTargetRegion();
+	if (target_regionp)
+	{
+		did_one |= target_regionp->idleUpdate(max_update_time);
+	}
 	
 	// Perform idle time updates for the regions (and associated surfaces)
 	for (region_list_t::iterator iter = mRegionList.begin();
 		 iter != mRegionList.end(); ++iter)
 	{
 		LLViewerRegion* regionp = *iter;
+		if (regionp == target_regionp)
+		{
+			continue;
+		}
 		F32 max_time = max_update_time - update_timer.getElapsedTimeF32();
 		if (did_one && max_time <= 0.f)
 			break;
@@ -237,6 +237,8 @@ public:
 	// World Mipmap delegation: currently used when drawing the mipmap
 	void	equalizeBoostLevels();
 	LLPointer<LLViewerFetchedTexture> getObjectsTile(U32 grid_x, U32 grid_y, S32 level, bool load = true) { return mWorldMipmap.getObjectsTile(grid_x, grid_y, level, load); }
+	void	prefetchObjectsTile(U32 grid_x, U32 grid_y, S32 level) { mWorldMipmap.prefetchObjectsTile(grid_x, grid_y, level); }
+	void	getTileStats(S32* memory_hits, S32* disk_hits, S32* server_loads) const { mWorldMipmap.getTileStats(memory_hits, disk_hits, server_loads); }
 
 private:
 	bool clearItems(bool force = false);	// Clears the item lists
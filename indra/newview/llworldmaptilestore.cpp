@@ -0,0 +1,311 @@
+/** 
+ * @file llworldmaptilestore.cpp
+ * @brief Disk tier for the world map tiles
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+  
+#include "llviewerprecompiledheaders.h"
+
+#include "llworldmaptilestore.h"
+
+#include <algorithm>
+
+#include "llappviewer.h"
+#include "lldir.h"
+#include "llimagepng.h"
+#include "llmd5.h"
+#include "llviewercontrol.h"
+#include "llviewertexture.h"
+#include "llworldmipmap.h"
+
+// Tiles that haven't loaded after this long aren't worth keeping the raw image around for
+static const F64 PENDING_TILE_TIMEOUT = 120.0;	// seconds
+
+//-----------------------------------------------------------------------------
+// LLWorldMapTileStore::Writer
+//-----------------------------------------------------------------------------
+
+LLWorldMapTileStore::Writer::Writer(LLImageRaw* raw, const std::string& path) :
+	mRaw(raw),
+	mPath(path),
+	mBytesWritten(0),
+	mDone(0)
+{
+}
+
+LLWorldMapTileStore::Writer::~Writer()
+{
+}
+
+bool LLWorldMapTileStore::Writer::run()
+{
+	LLPointer<LLImagePNG> png = new LLImagePNG;
+	if (!png->encode(mRaw, 0.f))
+	{
+		return false;
+	}
+
+	// Write under a temporary name so that the fetcher never sees a partial file
+	const std::string temp_path = mPath + ".tmp";
+	LLFILE* fp = LLFile::fopen(temp_path, "wb");		/*Flawfinder: ignore*/
+	if (!fp)
+	{
+		return false;
+	}
+	const size_t size = png->getDataSize();
+	const bool success = fwrite(png->getData(), 1, size, fp) == size;
+	fclose(fp);
+	LLFile::remove(mPath);
+	if (!success || LLFile::rename(temp_path, mPath) != 0)
+	{
+		LLFile::remove(temp_path);
+		return false;
+	}
+	mBytesWritten = (S32)size;
+	return true;
+}
+
+void LLWorldMapTileStore::Writer::completed(bool success)
+{
+	mDone = 1;
+}
+
+//-----------------------------------------------------------------------------
+// LLWorldMapTileStore
+//-----------------------------------------------------------------------------
+
+LLWorldMapTileStore::LLWorldMapTileStore() :
+	mStoredBytes(0)
+{
+}
+
+LLWorldMapTileStore::~LLWorldMapTileStore()
+{
+	// Writers still queued finish on their own and are released by the thread
+	clearPending();
+}
+
+std::string LLWorldMapTileStore::getTileURL(S32 level, U32 grid_x, U32 grid_y)
+{
+	if (!checkDirectory())
+	{
+		return std::string();
+	}
+
+	const std::string path = getTilePath(level, grid_x, grid_y);
+	llstat stat_data;
+	if (LLFile::stat(path, &stat_data) != 0)
+	{
+		return std::string();
+	}
+	const F64 max_age = gSavedSettings.getF32("MapTileDiskCacheMaxAge") * 3600.0;
+	if ((F64)(time(NULL) - stat_data.st_mtime) > max_age)
+	{
+		// Too old, the map server may have rendered a new one since
+		return std::string();
+	}
+	return "file://" + path;
+}
+
+void LLWorldMapTileStore::storeWhenLoaded(LLViewerFetchedTexture* img, S32 level, U32 grid_x, U32 grid_y)
+{
+	if (!img || !checkDirectory())
+	{
+		return;
+	}
+
+	img->forceToSaveRawImage(0);
+	PendingTile tile;
+	tile.mImage = img;
+	tile.mPath = getTilePath(level, grid_x, grid_y);
+	tile.mQueuedTime = LLTimer::getElapsedSeconds();
+	mPendingTiles.push_back(tile);
+}
+
+void LLWorldMapTileStore::update()
+{
+	const F64 now = LLTimer::getElapsedSeconds();
+	for (pending_list_t::iterator iter = mPendingTiles.begin(); iter != mPendingTiles.end(); )
+	{
+		pending_list_t::iterator curiter = iter++;
+		LLViewerFetchedTexture* img = curiter->mImage;
+		LLImageRaw* raw = img->hasSavedRawImage() ? img->getSavedRawImage() : NULL;
+		if (raw && raw->getWidth() == img->getFullWidth() && raw->getHeight() == img->getFullHeight())
+		{
+			LLPointer<Writer> writer = new Writer(raw, curiter->mPath);
+			LLAppViewer::getImageCompositeThread()->runJob(writer, LLQueuedThread::PRIORITY_LOW);
+			mWriters.push_back(writer);
+			img->destroySavedRawImage();
+			mPendingTiles.erase(curiter);
+		}
+		else if (img->isMissingAsset() || now - curiter->mQueuedTime > PENDING_TILE_TIMEOUT)
+		{
+			img->destroySavedRawImage();
+			mPendingTiles.erase(curiter);
+		}
+	}
+
+	if (mWriters.empty())
+	{
+		return;
+	}
+	LLAppViewer::getImageCompositeThread()->update(1); // unpauses the composite thread
+
+	for (writer_list_t::iterator iter = mWriters.begin(); iter != mWriters.end(); )
+	{
+		writer_list_t::iterator curiter = iter++;
+		if ((*curiter)->isDone())
+		{
+			mStoredBytes += (*curiter)->getBytesWritten();
+			mWriters.erase(curiter);
+		}
+	}
+
+	const U64 max_bytes = (U64)gSavedSettings.getU32("MapTileDiskCacheSize") * 1024 * 1024;
+	if (max_bytes && mStoredBytes > max_bytes)
+	{
+		// Leave some room so that we don't rescan the store for every new tile
+		purge(max_bytes - max_bytes / 8);
+	}
+}
+
+void LLWorldMapTileStore::clearPending()
+{
+	for (pending_list_t::iterator iter = mPendingTiles.begin(); iter != mPendingTiles.end(); ++iter)
+	{
+		iter->mImage->destroySavedRawImage();
+	}
+	mPendingTiles.clear();
+}
+
+void LLWorldMapTileStore::discardTile(S32 level, U32 grid_x, U32 grid_y)
+{
+	if (checkDirectory())
+	{
+		LLFile::remove(getTilePath(level, grid_x, grid_y));
+	}
+}
+
+bool LLWorldMapTileStore::checkDirectory()
+{
+	const U32 max_size = gSavedSettings.getU32("MapTileDiskCacheSize");
+	const std::string url = gSavedSettings.getString("CurrentMapServerURL");
+	if (!max_size || url.empty())
+	{
+		return false;
+	}
+	if (url == mMapServerURL)
+	{
+		return !mDirectory.empty();
+	}
+
+	// New map server (or first use): one directory per server so that grids don't share tiles
+	clearPending();
+	mMapServerURL = url;
+	mDirectory.clear();
+
+	char digest[33];		/*Flawfinder: ignore*/
+	LLMD5 md5((const unsigned char*)url.c_str());
+	md5.hex_digest(digest);
+
+	const std::string& delim = gDirUtilp->getDirDelimiter();
+	std::string dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "worldmap");
+	LLFile::mkdir(dir);
+	dir += delim + digest;
+	LLFile::mkdir(dir);
+	for (S32 level = 1; level <= LLWorldMipmap::MAP_LEVELS; level++)
+	{
+		LLFile::mkdir(dir + delim + llformat("%d", level));
+	}
+	if (!LLFile::isdir(dir))
+	{
+		llwarns << "Unable to create world map tile directory " << dir << llendl;
+		return false;
+	}
+
+	mDirectory = dir + delim;
+	purge((U64)max_size * 1024 * 1024);
+	return true;
+}
+
+std::string LLWorldMapTileStore::getTilePath(S32 level, U32 grid_x, U32 grid_y) const
+{
+	// Same name as on the map server, only the format differs
+	return mDirectory + llformat("%d", level) + gDirUtilp->getDirDelimiter() +
+		   llformat("map-%d-%d-%d-objects.png", level, grid_x, grid_y);
+}
+
+struct LLWorldMapTileFile
+{
+	time_t		mTime;
+	U64			mSize;
+	std::string	mPath;
+
+	bool operator<(const LLWorldMapTileFile& rhs) const	{ return mTime < rhs.mTime; }
+};
+
+void LLWorldMapTileStore::purge(U64 max_bytes)
+{
+	const time_t now = time(NULL);
+	const F64 max_age = gSavedSettings.getF32("MapTileDiskCacheMaxAge") * 3600.0;
+	const std::string& delim = gDirUtilp->getDirDelimiter();
+
+	std::vector<LLWorldMapTileFile> files;
+	U64 total_bytes = 0;
+	for (S32 level = 1; level <= LLWorldMipmap::MAP_LEVELS; level++)
+	{
+		const std::string dir = mDirectory + llformat("%d", level) + delim;
+		std::string name;
+		while (gDirUtilp->getNextFileInDir(dir, "*.png", name))
+		{
+			LLWorldMapTileFile file;
+			file.mPath = dir + name;
+			llstat stat_data;
+			if (LLFile::stat(file.mPath, &stat_data) != 0)
+			{
+				continue;
+			}
+			if ((F64)(now - stat_data.st_mtime) > max_age)
+			{
+				LLFile::remove(file.mPath);
+				continue;
+			}
+			file.mTime = stat_data.st_mtime;
+			file.mSize = stat_data.st_size;
+			total_bytes += file.mSize;
+			files.push_back(file);
+		}
+	}
+
+	if (total_bytes > max_bytes)
+	{
+		std::sort(files.begin(), files.end());
+		for (std::vector<LLWorldMapTileFile>::iterator iter = files.begin();
+			 iter != files.end() && total_bytes > max_bytes; ++iter)
+		{
+			LLFile::remove(iter->mPath);
+			total_bytes -= iter->mSize;
+		}
+	}
+	mStoredBytes = total_bytes;
+}
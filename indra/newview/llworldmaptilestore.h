@@ -0,0 +1,106 @@
+/** 
+ * @file llworldmaptilestore.h
+ * @brief Disk tier for the world map tiles
+ *
+ * $LicenseInfo:firstyear=2011&license=fsviewerlgpl$
+ * Phoenix Firestorm Viewer Source Code
+ * Copyright (C) 2011, The Phoenix Viewer Project, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * The Phoenix Viewer Project, Inc., 1831 Oakwood Drive, Fairmont, Minnesota 56031-3225 USA
+ * $/LicenseInfo$
+ */
+  
+#ifndef LL_LLWORLDMAPTILESTORE_H
+#define LL_LLWORLDMAPTILESTORE_H
+
+#include <list>
+
+#include "llimageworker.h"
+#include "llpointer.h"
+
+class LLViewerFetchedTexture;
+
+// LLWorldMapTileStore : On disk copies of the world map tiles, so that tiles seen in an earlier
+// session (or dropped from memory in this one) don't have to come back from the map server.
+// Tiles are kept as PNG files, one directory per map server and mipmap level, and are handed
+// back as file:// URLs so that the regular texture fetcher loads and decodes them.
+// Copies older than MapTileDiskCacheMaxAge hours are ignored so that tiles still get refreshed,
+// and the oldest files are removed when the store grows over MapTileDiskCacheSize MB.
+class LLWorldMapTileStore
+{
+public:
+	LLWorldMapTileStore();
+	~LLWorldMapTileStore();
+
+	// Returns the file:// URL of a fresh copy of the tile, or an empty string if there's none
+	std::string getTileURL(S32 level, U32 grid_x, U32 grid_y);
+	// Writes the tile out once the texture has loaded at full resolution
+	void storeWhenLoaded(LLViewerFetchedTexture* img, S32 level, U32 grid_x, U32 grid_y);
+	// Hands loaded tiles to the writer and keeps the store under its size limit. Call once per draw.
+	void update();
+	// Forget about tiles that haven't been written yet
+	void clearPending();
+	// Removes the stored copy of a tile, e.g. when it failed to load
+	void discardTile(S32 level, U32 grid_x, U32 grid_y);
+
+private:
+	// Encodes a tile and writes it out on the image composite thread
+	class Writer : public LLImageCompositeThread::Job
+	{
+	protected:
+		~Writer();
+
+	public:
+		Writer(LLImageRaw* raw, const std::string& path);
+
+		/*virtual*/ bool run();
+		/*virtual*/ void completed(bool success);
+
+		BOOL isDone()					{ return mDone != 0; }
+		S32 getBytesWritten() const		{ return mBytesWritten; }
+
+	private:
+		LLPointer<LLImageRaw>	mRaw;
+		const std::string		mPath;
+		S32						mBytesWritten;
+		LLAtomicU32				mDone;
+	};
+
+	// Sets up the directory for the current map server, returns false if the store is disabled
+	bool checkDirectory();
+	std::string getTilePath(S32 level, U32 grid_x, U32 grid_y) const;
+	// Removes stale files, then the oldest ones until the store fits in max_bytes
+	void purge(U64 max_bytes);
+
+	struct PendingTile
+	{
+		LLPointer<LLViewerFetchedTexture>	mImage;
+		std::string							mPath;
+		F64									mQueuedTime;
+	};
+	typedef std::list<PendingTile> pending_list_t;
+	pending_list_t mPendingTiles;
+
+	typedef std::list<LLPointer<Writer> > writer_list_t;
+	writer_list_t mWriters;
+
+	std::string mMapServerURL;	// The map server mDirectory is for
+	std::string mDirectory;		// With a trailing delimiter
+	U64 mStoredBytes;			// Size of the store as of the last purge, plus what was written since
+};
+
+#endif // LL_LLWORLDMAPTILESTORE_H
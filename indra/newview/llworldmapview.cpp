@@ -339,6 +339,11 @@ void LLWorldMapView::draw()
 	drawMipmap(width, height);
 	gGL.flush();
 
+	if (gSavedSettings.getBOOL("MapShowTileStats"))
+	{
+		drawTileStats();
+	}
+
 	gGL.setAlphaRejectSettings(LLRender::CF_DEFAULT);
 	gGL.setColorMask(true, true);
 
@@ -647,9 +652,102 @@ void LLWorldMapView::drawMipmap(S32 width, S32 height)
 	// Render the current level
 	sVisibleTilesLoaded = drawMipmapLevel(width, height, level);
 
+	// Once what's on screen is loaded, get the tiles we're panning toward
+	LLVector3d view_center = viewPosToGlobal(width / 2, height / 2);
+	LLVector3d motion = view_center - mLastViewCenter;
+	mLastViewCenter = view_center;
+	if (sVisibleTilesLoaded)
+	{
+		prefetchMipmapLevel(width, height, level, motion);
+	}
+
 	return;
 }
 
+// Start loading the band of tiles just outside the view on the side(s) the view is moving toward
+void LLWorldMapView::prefetchMipmapLevel(S32 width, S32 height, S32 level, const LLVector3d& motion)
+{
+	// Size in meters (global) of each tile of that level
+	S32 tile_width = LLWorldMipmap::MAP_TILE_SIZE * (1 << (level - 1));
+	// Same extent as drawMipmapLevel()
+	LLVector3d pos_SW = viewPosToGlobal(0, 0);
+	LLVector3d pos_NE = viewPosToGlobal(width, height);
+	pos_NE[VX] += tile_width;
+	pos_NE[VY] += tile_width;
+
+	// Extend the area by one tile in the direction of the motion
+	F64 min_x = pos_SW[VX];
+	F64 max_x = pos_NE[VX];
+	F64 min_y = pos_SW[VY];
+	F64 max_y = pos_NE[VY];
+	if (motion[VX] > 0.0)
+	{
+		min_x = pos_NE[VX];
+		max_x = pos_NE[VX] + tile_width;
+	}
+	else if (motion[VX] < 0.0)
+	{
+		min_x = pos_SW[VX] - tile_width;
+		max_x = pos_SW[VX];
+	}
+	if (motion[VY] > 0.0)
+	{
+		min_y = pos_NE[VY];
+		max_y = pos_NE[VY] + tile_width;
+	}
+	else if (motion[VY] < 0.0)
+	{
+		min_y = pos_SW[VY] - tile_width;
+		max_y = pos_SW[VY];
+	}
+
+	U32 grid_x, grid_y;
+	if (motion[VX] != 0.0)
+	{
+		// Vertical band (including the corner when moving diagonally)
+		F64 band_min_y = llmin(min_y, pos_SW[VY]);
+		F64 band_max_y = llmax(max_y, pos_NE[VY]);
+		for (F64 index_y = band_min_y; index_y < band_max_y; index_y += tile_width)
+		{
+			for (F64 index_x = min_x; index_x < max_x; index_x += tile_width)
+			{
+				LLWorldMipmap::globalToMipmap(index_x, index_y, level, &grid_x, &grid_y);
+				LLWorldMap::getInstance()->prefetchObjectsTile(grid_x, grid_y, level);
+			}
+		}
+	}
+	if (motion[VY] != 0.0)
+	{
+		// Horizontal band
+		for (F64 index_y = min_y; index_y < max_y; index_y += tile_width)
+		{
+			for (F64 index_x = pos_SW[VX]; index_x < pos_NE[VX]; index_x += tile_width)
+			{
+				LLWorldMipmap::globalToMipmap(index_x, index_y, level, &grid_x, &grid_y);
+				LLWorldMap::getInstance()->prefetchObjectsTile(grid_x, grid_y, level);
+			}
+		}
+	}
+}
+
+// Where the tiles that came into view came from, in the bottom left corner
+void LLWorldMapView::drawTileStats()
+{
+	S32 memory_hits, disk_hits, server_loads;
+	LLWorldMap::getInstance()->getTileStats(&memory_hits, &disk_hits, &server_loads);
+	S32 total = memory_hits + disk_hits + server_loads;
+	F32 hit_rate = total ? 100.f * (F32)(memory_hits + disk_hits) / (F32)total : 0.f;
+
+	std::string stats = llformat("Tiles: %d memory, %d disk, %d server (%.0f%% hits)", memory_hits, disk_hits, server_loads, hit_rate);
+	LLFontGL* font = LLFontGL::getFontSansSerifSmall();
+	font->renderUTF8(
+		stats, 0,
+		4, 
+		4 + llround(font->getLineHeight()),
+		LLColor4::white, LLFontGL::LEFT,
+		LLFontGL::BASELINE, LLFontGL::NORMAL, LLFontGL::DROP_SHADOW);
+}
+
 // Return true if all the tiles required to render that level have been fetched or are truly missing
 bool LLWorldMapView::drawMipmapLevel(S32 width, S32 height, S32 level, bool load)
 {
@@ -87,6 +87,8 @@ public:
 	void			drawFrustum();
 	void			drawMipmap(S32 width, S32 height);
 	bool			drawMipmapLevel(S32 width, S32 height, S32 level, bool load = true);
+	void			prefetchMipmapLevel(S32 width, S32 height, S32 level, const LLVector3d& motion);
+	void			drawTileStats();
 
 	static void		cleanupTextures();
 
@@ -188,6 +190,8 @@ public:
 	typedef std::vector<U64> handle_list_t;
 	handle_list_t mVisibleRegions; // set every frame
 
+	LLVector3d		mLastViewCenter;	// Global position of the center of the view at the last draw
+
 	static std::map<std::string,std::string> sStringsMap;
 
 private:
@@ -32,11 +32,18 @@
 #include "llviewertexturelist.h"
 #include "math.h"	// log()
 
+#include <algorithm>
+#include <vector>
+
 // Turn this on to output tile stats in the standard output
 #define DEBUG_TILES_STAT 0
 
 LLWorldMipmap::LLWorldMipmap() :
-	mCurrentLevel(0)
+	mCurrentLevel(0),
+	mDrawCount(0),
+	mTileMemoryHits(0),
+	mTileDiskHits(0),
+	mTileServerLoads(0)
 {
 }
 
@@ -52,14 +59,18 @@ void LLWorldMipmap::reset()
 	{
 		mWorldObjectsMipMap[level].clear();
 	}
+	mTileStore.clearPending();
 }
 
 // This method should be called before each use of the mipmap (typically, before each draw), so that to let
 // the boost level of unused tiles to drop to 0 (BOOST_NONE).
 // Tiles that are accessed have had their boost level pushed to BOOST_MAP_VISIBLE so we can identify them.
-// The result of this strategy is that if a tile is not used during 2 consecutive loops, its boost level drops to 0.
+// The result of this strategy is that if a tile is not used during 2 consecutive loops, its boost level drops to BOOST_MAP
+// if it's loaded (so it stays in memory, see releaseTiles()) and to 0 otherwise.
 void LLWorldMipmap::equalizeBoostLevels()
 {
+	mDrawCount++;
+	S32 nb_released = 0;
 #if DEBUG_TILES_STAT
 	S32 nb_missing = 0;
 	S32 nb_tiles = 0;
@@ -72,17 +83,24 @@ void LLWorldMipmap::equalizeBoostLevels()
 		// For each tile
 		for (sublevel_tiles_t::iterator iter = level_mipmap.begin(); iter != level_mipmap.end(); iter++)
 		{
-			LLPointer<LLViewerFetchedTexture> img = iter->second;
+			LLPointer<LLViewerFetchedTexture> img = iter->second.mImage;
 			S32 current_boost_level = img->getBoostLevel();
 			if (current_boost_level == LLViewerTexture::BOOST_MAP_VISIBLE)
 			{
 				// If level was BOOST_MAP_VISIBLE, the tile has been used in the last draw so keep it high
 				img->setBoostLevel(LLViewerTexture::BOOST_MAP);
 			}
+			else if (img->hasGLTexture())
+			{
+				// The tile wasn't used in the last draw but it's loaded: keep it around, unless we hold
+				// too many of them already.
+				img->setBoostLevel(LLViewerTexture::BOOST_MAP);
+				nb_released++;
+			}
 			else
 			{
-				// If level was BOOST_MAP only (or anything else...), the tile wasn't used in the last draw 
-				// so we drop its boost level to BOOST_NONE.
+				// If level was BOOST_MAP only (or anything else...) and the tile isn't loaded,
+				// we drop its boost level to BOOST_NONE.
 				img->setBoostLevel(LLViewerTexture::BOOST_NONE);
 			}
 #if DEBUG_TILES_STAT
@@ -102,6 +120,44 @@ void LLWorldMipmap::equalizeBoostLevels()
 #if DEBUG_TILES_STAT
 	LL_INFOS("World Map") << "LLWorldMipmap tile stats : total requested = " << nb_tiles << ", visible = " << nb_visible << ", missing = " << nb_missing << LL_ENDL;
 #endif // DEBUG_TILES_STAT
+
+	S32 memory_cache_size = (S32)gSavedSettings.getU32("MapTileMemoryCacheSize");
+	if (nb_released > memory_cache_size)
+	{
+		releaseTiles(nb_released - memory_cache_size);
+	}
+
+	mTileStore.update();
+}
+
+// Drop the count least recently drawn tiles that are not visible
+void LLWorldMipmap::releaseTiles(S32 count)
+{
+	typedef std::pair<U32, std::pair<S32, U64> > tile_age_t;
+	std::vector<tile_age_t> released;
+	for (S32 level = 0; level < MAP_LEVELS; level++)
+	{
+		sublevel_tiles_t& level_mipmap = mWorldObjectsMipMap[level];
+		for (sublevel_tiles_t::iterator iter = level_mipmap.begin(); iter != level_mipmap.end(); iter++)
+		{
+			// Leave alone the tiles drawn last time
+			if ((iter->second.mLastUsed + 1 < mDrawCount) && iter->second.mImage->hasGLTexture())
+			{
+				released.push_back(tile_age_t(iter->second.mLastUsed, std::make_pair(level, iter->first)));
+			}
+		}
+	}
+
+	count = llmin(count, (S32)released.size());
+	std::partial_sort(released.begin(), released.begin() + count, released.end());
+	for (S32 i = 0; i < count; i++)
+	{
+		sublevel_tiles_t& level_mipmap = mWorldObjectsMipMap[released[i].second.first];
+		sublevel_tiles_t::iterator found = level_mipmap.find(released[i].second.second);
+		// Let the texture list discard it
+		found->second.mImage->setBoostLevel(LLViewerTexture::BOOST_NONE);
+		level_mipmap.erase(found);
+	}
 }
 
 // This method should be used when the mipmap is not actively used for a while, e.g., the map UI is hidden
@@ -114,7 +170,7 @@ void LLWorldMipmap::dropBoostLevels()
 		// For each tile
 		for (sublevel_tiles_t::iterator iter = level_mipmap.begin(); iter != level_mipmap.end(); iter++)
 		{
-			LLPointer<LLViewerFetchedTexture> img = iter->second;
+			LLPointer<LLViewerFetchedTexture> img = iter->second.mImage;
 			img->setBoostLevel(LLViewerTexture::BOOST_NONE);
 		}
 	}
@@ -147,11 +203,18 @@ LLPointer<LLViewerFetchedTexture> LLWorldMipmap::getObjectsTile(U32 grid_x, U32
 		if (load)
 		{
 			// Load it 
-			LLPointer<LLViewerFetchedTexture> img = loadObjectsTile(grid_x, grid_y, level);
+			bool from_store = false;
+			LLPointer<LLViewerFetchedTexture> img = loadObjectsTile(grid_x, grid_y, level, &from_store);
+			if (from_store)
+			{
+				mTileDiskHits++;
+			}
+			else
+			{
+				mTileServerLoads++;
+			}
 			// Insert the image in the map
-			level_mipmap.insert(sublevel_tiles_t::value_type( handle, img ));
-			// Find the element again in the map (it's there now...)
-			found = level_mipmap.find(handle);
+			found = level_mipmap.insert(sublevel_tiles_t::value_type(handle, Tile(img, mDrawCount, from_store))).first;
 		}
 		else
 		{
@@ -159,9 +222,15 @@ LLPointer<LLViewerFetchedTexture> LLWorldMipmap::getObjectsTile(U32 grid_x, U32
 			return NULL;
 		}
 	}
+	else if (load && (found->second.mLastUsed + 1 < mDrawCount))
+	{
+		// Coming back into view and still around
+		mTileMemoryHits++;
+	}
+	found->second.mLastUsed = mDrawCount;
 
 	// Get the image pointer and check if this asset is missing
-	LLPointer<LLViewerFetchedTexture> img = found->second;
+	LLPointer<LLViewerFetchedTexture> img = found->second.mImage;
 	if (img->isMissingAsset())
 	{
 		// Return NULL if asset missing
@@ -178,10 +247,46 @@ LLPointer<LLViewerFetchedTexture> LLWorldMipmap::getObjectsTile(U32 grid_x, U32
 	}
 }
 
-LLPointer<LLViewerFetchedTexture> LLWorldMipmap::loadObjectsTile(U32 grid_x, U32 grid_y, S32 level)
+void LLWorldMipmap::prefetchObjectsTile(U32 grid_x, U32 grid_y, S32 level)
 {
-	// Get the grid coordinates
-	std::string imageurl = gSavedSettings.getString("CurrentMapServerURL") + llformat("map-%d-%d-%d-objects.jpg", level, grid_x, grid_y);
+	// Check the input data
+	llassert(level <= MAP_LEVELS);
+	llassert(level >= 1);
+
+	U64 handle = convertGridToHandle(grid_x, grid_y);
+	sublevel_tiles_t& level_mipmap = mWorldObjectsMipMap[level-1];
+	sublevel_tiles_t::iterator found = level_mipmap.find(handle);
+	if (found == level_mipmap.end())
+	{
+		bool from_store = false;
+		LLPointer<LLViewerFetchedTexture> img = loadObjectsTile(grid_x, grid_y, level, &from_store);
+		// Not drawn in this draw, so it counts as a memory hit when it comes into view
+		level_mipmap.insert(sublevel_tiles_t::value_type(handle, Tile(img, mDrawCount - 1, from_store)));
+	}
+	else if (found->second.mImage->getBoostLevel() != LLViewerTexture::BOOST_MAP_VISIBLE)
+	{
+		// Keep it loading until it's drawn
+		found->second.mImage->setBoostLevel(LLViewerTexture::BOOST_MAP);
+	}
+}
+
+void LLWorldMipmap::getTileStats(S32* memory_hits, S32* disk_hits, S32* server_loads) const
+{
+	*memory_hits = mTileMemoryHits;
+	*disk_hits = mTileDiskHits;
+	*server_loads = mTileServerLoads;
+}
+
+LLPointer<LLViewerFetchedTexture> LLWorldMipmap::loadObjectsTile(U32 grid_x, U32 grid_y, S32 level, bool* from_store)
+{
+	// Use the stored copy if there's a fresh one
+	std::string imageurl = mTileStore.getTileURL(level, grid_x, grid_y);
+	*from_store = !imageurl.empty();
+	if (!*from_store)
+	{
+		// Get the grid coordinates
+		imageurl = gSavedSettings.getString("CurrentMapServerURL") + llformat("map-%d-%d-%d-objects.jpg", level, grid_x, grid_y);
+	}
 
 	// DO NOT COMMIT!! DEBUG ONLY!!!
 	// Use a local jpeg for every tile to test map speed without S3 access
@@ -191,6 +296,10 @@ LLPointer<LLViewerFetchedTexture> LLWorldMipmap::loadObjectsTile(U32 grid_x, U32
 
 	LLPointer<LLViewerFetchedTexture> img = LLViewerTextureManager::getFetchedTextureFromUrl(imageurl, TRUE, LLViewerTexture::BOOST_NONE, LLViewerTexture::LOD_TEXTURE);
 	img->setBoostLevel(LLViewerTexture::BOOST_MAP);
+	if (!*from_store)
+	{
+		mTileStore.storeWhenLoaded(img, level, grid_x, grid_y);
+	}
 
 	// Return the smart pointer
 	return img;
@@ -218,9 +327,16 @@ void LLWorldMipmap::cleanMissedTilesFromLevel(S32 level)
 	sublevel_tiles_t::iterator it = level_mipmap.begin();
 	while (it != level_mipmap.end())
 	{
-		LLPointer<LLViewerFetchedTexture> img = it->second;
+		LLPointer<LLViewerFetchedTexture> img = it->second.mImage;
 		if (img->isMissingAsset())
 		{
+			if (it->second.mFromStore)
+			{
+				// Bad copy, get it from the map server next time
+				U32 grid_x, grid_y;
+				grid_from_region_handle(it->first, &grid_x, &grid_y);
+				mTileStore.discardTile(level, grid_x, grid_y);
+			}
 			level_mipmap.erase(it++);
 		}
 		else
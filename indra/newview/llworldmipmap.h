@@ -32,6 +32,7 @@
 #include "llmemory.h"			// LLPointer
 #include "indra_constants.h"	// REGION_WIDTH_UNITS
 #include "llregionhandle.h"		// to_region_handle()
+#include "llworldmaptilestore.h"
 
 class LLViewerFetchedTexture;
 
@@ -49,6 +50,9 @@ class LLViewerFetchedTexture;
 // Implementation notes:
 // - On the S3 servers, the tiles are rendered in 2 flavors: Objects and Terrain.
 // - For the moment, LLWorldMipmap implements access only to the Objects tiles.
+// - Tiles are kept in memory (with their boost level up) until there's more than MapTileMemoryCacheSize
+//   of them, then the least recently drawn ones are released. Tiles coming from the map server are also
+//   written to an LLWorldMapTileStore so that they can be reloaded from disk later.
 class LLWorldMipmap
 {
 public:
@@ -67,6 +71,10 @@ public:
 	void	dropBoostLevels();
 	// Get the tile smart pointer, does the loading if necessary
 	LLPointer<LLViewerFetchedTexture> getObjectsTile(U32 grid_x, U32 grid_y, S32 level, bool load = true);
+	// Start loading a tile that's likely to come into view soon
+	void	prefetchObjectsTile(U32 grid_x, U32 grid_y, S32 level);
+	// Where the tiles that came into view were found: still in memory, on disk or on the map server
+	void	getTileStats(S32* memory_hits, S32* disk_hits, S32* server_loads) const;
 
 	// Helper functions: those are here as they depend solely on the topology of the mipmap though they don't access it
 	// Convert sim scale (given in sim width in display pixels) into a mipmap level
@@ -77,18 +85,37 @@ public:
 private:
 	// Get a handle (key) from grid coordinates
 	U64		convertGridToHandle(U32 grid_x, U32 grid_y) { return to_region_handle(grid_x * REGION_WIDTH_UNITS, grid_y * REGION_WIDTH_UNITS); }
-	// Load the relevant tile from S3
-	LLPointer<LLViewerFetchedTexture> loadObjectsTile(U32 grid_x, U32 grid_y, S32 level);
+	// Load the relevant tile from the tile store or S3
+	LLPointer<LLViewerFetchedTexture> loadObjectsTile(U32 grid_x, U32 grid_y, S32 level, bool* from_store);
 	// Clear a level from its "missing" tiles
 	void cleanMissedTilesFromLevel(S32 level);
+	// Release the least recently drawn tiles
+	void releaseTiles(S32 count);
+
+	struct Tile
+	{
+		Tile(LLViewerFetchedTexture* image, U32 last_used, bool from_store)
+			: mImage(image), mLastUsed(last_used), mFromStore(from_store) {}
+
+		LLPointer<LLViewerFetchedTexture>	mImage;
+		U32									mLastUsed;	// Draw count when the tile was last drawn
+		bool								mFromStore;	// Loaded from the LLWorldMapTileStore
+	};
 
 	// The mipmap is organized by resolution level (MAP_LEVELS of them). Each resolution level is an std::map
-	// using a region_handle as a key and storing a smart pointer to the image as a value.
-	typedef std::map<U64, LLPointer<LLViewerFetchedTexture> > sublevel_tiles_t;
+	// using a region_handle as a key and storing the tile as a value.
+	typedef std::map<U64, Tile> sublevel_tiles_t;
 	sublevel_tiles_t mWorldObjectsMipMap[MAP_LEVELS];
 //	sublevel_tiles_t mWorldTerrainMipMap[MAP_LEVELS];
 
 	S32 mCurrentLevel;		// The level last accessed by a getObjectsTile()
+	U32 mDrawCount;			// Number of equalizeBoostLevels() calls
+
+	LLWorldMapTileStore mTileStore;
+
+	S32 mTileMemoryHits;
+	S32 mTileDiskHits;
+	S32 mTileServerLoads;
 };
 
 #endif // LL_LLWORLDMIPMAP_H
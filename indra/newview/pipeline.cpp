@@ -60,6 +60,7 @@
 #include "lldrawpoolwater.h"
 #include "llface.h"
 #include "llfeaturemanager.h"
+#include "llflexibleobject.h"
 #include "llfloatertelehub.h"
 #include "llfloaterreg.h"
 #include "llgldbg.h"
@@ -365,6 +366,9 @@ void LLPipeline::init()
 	sRenderBump = gSavedSettings.getBOOL("RenderObjectBump");
 	sUseTriStrips = gSavedSettings.getBOOL("RenderUseTriStrips");
 	LLVertexBuffer::sUseStreamDraw = gSavedSettings.getBOOL("RenderUseStreamVBO");
+	LLVertexBuffer::sUseStreamRing = gSavedSettings.getBOOL("RenderUseStreamRing");
+	LLRenderPass::sBatchDrawInfos = gSavedSettings.getBOOL("RenderBatchGroups");
+	LLVolumeLODBatch::sEnabled = gSavedSettings.getBOOL("RenderBatchLOD");
 	sRenderAttachedLights = gSavedSettings.getBOOL("RenderAttachedLights");
 	sRenderAttachedParticles = gSavedSettings.getBOOL("RenderAttachedParticles");
 
@@ -1890,6 +1894,9 @@ void LLPipeline::updateGeom(F32 max_dtime)
 	// for now, only LLVOVolume does this to throttle LOD changes
 	LLVOVolume::preUpdateGeom();
 
+	// step the flexies marked for rebuild together, ahead of the build queues
+	LLVolumeImplFlexible::updateClass();
+
 	// Iterate through all drawables on the priority build queue,
 	for (LLDrawable::drawable_list_t::iterator iter = mBuildQ1.begin();
 		 iter != mBuildQ1.end();)
@@ -2295,6 +2302,7 @@ void LLPipeline::stateSort(LLCamera& camera, LLCullResult &result)
 			}
 		}
 	}
+	mLODBatch.process(camera);
 	{
 		LLFastTimer ftm(FTM_CLIENT_COPY);
 		LLVertexBuffer::clientCopy();
@@ -2393,8 +2401,15 @@ void LLPipeline::stateSort(LLDrawable* drawablep, LLCamera& camera)
 			{
 				if (!drawablep->isActive())
 				{
-					bool force_update = false;
-					drawablep->updateDistance(camera, force_update);
+					if (LLVolumeLODBatch::canBatch(drawablep))
+					{ //processed all at once at the end of stateSort
+						mLODBatch.push(drawablep, camera);
+					}
+					else
+					{
+						bool force_update = false;
+						drawablep->updateDistance(camera, force_update);
+					}
 				}
 				else if (drawablep->isAvatar())
 				{
@@ -2709,7 +2724,7 @@ void LLPipeline::postSort(LLCamera& camera)
 			}	
 		}
 
-		std::sort(sCull->beginAlphaGroups(), sCull->endAlphaGroups(), LLSpatialGroup::CompareDepthGreater());
+		sCull->sortAlphaGroups(camera);
 	}
 	llpushcallstacks ;
 	// only render if the flag is set. The flag is only set if we are in edit mode or the toggle is set in the menus
@@ -5261,6 +5276,8 @@ void LLPipeline::resetVertexBuffers()
 	sRenderBump = gSavedSettings.getBOOL("RenderObjectBump");
 	sUseTriStrips = gSavedSettings.getBOOL("RenderUseTriStrips");
 	LLVertexBuffer::sUseStreamDraw = gSavedSettings.getBOOL("RenderUseStreamVBO");
+	LLVertexBuffer::sUseStreamRing = gSavedSettings.getBOOL("RenderUseStreamRing");
+	LLRenderPass::sBatchDrawInfos = gSavedSettings.getBOOL("RenderBatchGroups");
 
 	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
 			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
@@ -5279,6 +5296,7 @@ void LLPipeline::resetVertexBuffers()
 	resetDrawOrders();
 
 	gSky.resetVertexBuffers();
+	LLVOTree::resetVertexBuffers();
 
 	if (LLVertexBuffer::sGLCount > 0)
 	{
@@ -8793,19 +8811,34 @@ void LLPipeline::generateImpostor(LLVOAvatar* avatar)
 	U32 resY = llmin(nhpo2((U32) (fov*pa)), (U32) 512);
 	U32 resX = llmin(nhpo2((U32) (atanf(tdim.mV[0]/distance)*2.f*RAD_TO_DEG*pa)), (U32) 512);
 
-	if (!avatar->mImpostor.isComplete() || resX != avatar->mImpostor.getWidth() ||
-		resY != avatar->mImpostor.getHeight())
+	LLImpostorAtlas* atlas = LLImpostorAtlas::getInstance();
+	LLRenderTarget* target = &avatar->mImpostor;
+
+	if (LLImpostorAtlas::useAtlas() && atlas->reserve(avatar->mImpostorSlot, resX, resY))
+	{ //render into a cell of the shared atlas, the atlas may have shrunk the cell if it is full
+		target = &atlas->getTarget();
+		resX = avatar->mImpostorSlot.mWidth;
+		resY = avatar->mImpostorSlot.mHeight;
+		avatar->mImpostor.release();
+	}
+	else
 	{
-		avatar->mImpostor.allocate(resX,resY,GL_RGBA,TRUE,TRUE);
-		
-		if (LLPipeline::sRenderDeferred)
+		atlas->free(avatar->mImpostorSlot);
+
+		if (!avatar->mImpostor.isComplete() || resX != avatar->mImpostor.getWidth() ||
+			resY != avatar->mImpostor.getHeight())
 		{
-			addDeferredAttachments(avatar->mImpostor);
+			avatar->mImpostor.allocate(resX,resY,GL_RGBA,TRUE,TRUE);
+			
+			if (LLPipeline::sRenderDeferred)
+			{
+				addDeferredAttachments(avatar->mImpostor);
+			}
+			
+			gGL.getTexUnit(0)->bind(&avatar->mImpostor);
+			gGL.getTexUnit(0)->setTextureFilteringOption(LLTexUnit::TFO_POINT);
+			gGL.getTexUnit(0)->unbind(LLTexUnit::TT_TEXTURE);
 		}
-		
-		gGL.getTexUnit(0)->bind(&avatar->mImpostor);
-		gGL.getTexUnit(0)->setTextureFilteringOption(LLTexUnit::TFO_POINT);
-		gGL.getTexUnit(0)->unbind(LLTexUnit::TT_TEXTURE);
 	}
 
 	LLGLEnable stencil(GL_STENCIL_TEST);
@@ -8816,8 +8849,12 @@ void LLPipeline::generateImpostor(LLVOAvatar* avatar)
 	{
 		LLGLEnable scissor(GL_SCISSOR_TEST);
 		glScissor(0, 0, resX, resY);
-		avatar->mImpostor.bindTarget();
-		avatar->mImpostor.clear();
+		target->bindTarget();
+		if (target != &avatar->mImpostor)
+		{ //keep rendering and the clear inside the slot
+			atlas->setViewport(avatar->mImpostorSlot);
+		}
+		target->clear();
 	}
 	
 	if (LLPipeline::sRenderDeferred)
@@ -8874,7 +8911,7 @@ void LLPipeline::generateImpostor(LLVOAvatar* avatar)
 	}
 
 
-	avatar->mImpostor.flush();
+	target->flush();
 
 	avatar->setImpostorDim(tdim);
 
@@ -39,6 +39,7 @@
 #include "llgl.h"
 #include "lldrawable.h"
 #include "llrendertarget.h"
+#include "llvolumelodbatch.h"
 
 #include <stack>
 
@@ -73,6 +74,7 @@ void glh_set_current_projection(glh::matrix4f& mat);
 glh::matrix4f gl_ortho(GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat znear, GLfloat zfar);
 glh::matrix4f gl_perspective(GLfloat fovy, GLfloat aspect, GLfloat zNear, GLfloat zFar);
 glh::matrix4f gl_lookat(LLVector3 eye, LLVector3 center, LLVector3 up);
+U32 nhpo2(U32 v); // next highest power of two
 
 extern LLFastTimer::DeclareTimer FTM_RENDER_GEOMETRY;
 extern LLFastTimer::DeclareTimer FTM_RENDER_GRASS;
@@ -606,6 +608,8 @@ protected:
 	LLSpatialGroup::sg_vector_t		mGroupQ1; //priority
 	LLSpatialGroup::sg_vector_t		mGroupQ2; // non-priority
 
+	LLVolumeLODBatch				mLODBatch; // static volumes due for a LOD update this frame
+
 	LLViewerObject::vobj_list_t		mCreateQ;
 		
 	LLDrawable::drawable_set_t		mRetexturedList;
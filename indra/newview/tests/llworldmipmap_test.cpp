@@ -43,14 +43,24 @@
 // * A simulator for a class can be implemented here. Please comment and document thoroughly.
 
 void LLViewerTexture::setBoostLevel(S32 ) { }
+BOOL LLViewerTexture::hasGLTexture() const { return FALSE; }
 LLViewerFetchedTexture* LLViewerTextureManager::getFetchedTextureFromUrl(const std::string&, BOOL, LLViewerTexture::EBoostLevel, S8, 
 																		 LLGLint, LLGLenum, const LLUUID& ) { return NULL; }
 
 LLControlGroup::LLControlGroup(const std::string& name) : LLInstanceTracker<LLControlGroup, std::string>(name) { }
 LLControlGroup::~LLControlGroup() { }
 std::string LLControlGroup::getString(const std::string& ) { return std::string("test_url"); }
+U32 LLControlGroup::getU32(const std::string& ) { return 0; }
 LLControlGroup gSavedSettings("test_settings");
 
+LLWorldMapTileStore::LLWorldMapTileStore() { }
+LLWorldMapTileStore::~LLWorldMapTileStore() { }
+std::string LLWorldMapTileStore::getTileURL(S32 , U32 , U32 ) { return std::string(); }
+void LLWorldMapTileStore::storeWhenLoaded(LLViewerFetchedTexture* , S32 , U32 , U32 ) { }
+void LLWorldMapTileStore::update() { }
+void LLWorldMapTileStore::clearPending() { }
+void LLWorldMapTileStore::discardTile(S32 , U32 , U32 ) { }
+
 // End Stubbing
 // -------------------------------------------------------------------------------------------
 